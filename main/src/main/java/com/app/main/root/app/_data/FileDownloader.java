@@ -90,7 +90,7 @@ public class FileDownloader {
                     if(compressionType > 0) {
                         try {
                             System.out.println("DEBUG: Attempting decompression with type: " + compressionType);
-                            byte[] decompressed = WrapperFileCompressor.decompressData(decryptedContent, compressionType);
+                            byte[] decompressed = WrapperFileCompressor.decompressParallel(decryptedContent, compressionType);
                             
                             if(decompressed != null && decompressed.length > 0) {
                                 decryptedContent = decompressed;
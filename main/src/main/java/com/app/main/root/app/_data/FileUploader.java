@@ -8,6 +8,7 @@ import com.app.main.root.app.file_compressor.WrapperFileCompressor;
 
 import org.springframework.jdbc.core.JdbcTemplate;
 import org.springframework.web.multipart.MultipartFile;
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.sql.SQLException;
@@ -98,7 +99,7 @@ public class FileUploader {
             System.out.println("  MIME type: " + mimeType);
 
             int compressionType = 0;
-            boolean shouldCompress = fileService.shouldCompress(fileSize, mimeType);
+            boolean shouldCompress = fileService.shouldCompress(fileSize, mimeType, fileBytes);
             System.out.println("  shouldCompress result: " + shouldCompress);
             if(shouldCompress) {
                 try {
@@ -107,14 +108,13 @@ public class FileUploader {
                     if(fileSize > 50 * 1024 * 1024) {
                         System.out.println("DEBUG: Large file detected, using streaming compression");
                         
-                        InputStream inputStream = file.getInputStream();
-                        WithCompressionResult compressionResult = 
-                            WrapperFileCompressor.compressStream(inputStream, fileSize, mimeType);
-                        
-                        fileBytes = compressionResult.getData();
-                        compressionType = compressionResult.getCompressionType();
+                        ByteArrayOutputStream compressedOutput = new ByteArrayOutputStream();
+                        try(InputStream inputStream = file.getInputStream()) {
+                            compressionType = 
+                                WrapperFileCompressor.compressStream(inputStream, fileSize, mimeType, compressedOutput);
+                        }
                         
-                        long compressedSize = fileBytes.length;
+                        long compressedSize = compressedOutput.size();
                         double ratio = (double) compressedSize / fileSize;
                         
                         System.out.println("DEBUG: Streaming compression result:");
@@ -123,7 +123,8 @@ public class FileUploader {
                         System.out.println("  Compression type: " + compressionType);
                         System.out.println("  Ratio: " + (ratio * 100) + "%");
                         
-                        if(compressionType == 10 && ratio < 0.95) {
+                        if(compressionType > 0 && ratio < 0.95) {
+                            fileBytes = compressedOutput.toByteArray();
                             this.compressed = true;
                             System.out.println("  Using stream-compressed data");
                         } else {
@@ -135,7 +136,7 @@ public class FileUploader {
                         System.out.println("DEBUG: Using normal compression");
                         fileBytes = file.getBytes();
                         WithCompressionResult compressionResult = 
-                            WrapperFileCompressor.compress(fileBytes);
+                            WrapperFileCompressor.compress(fileBytes, WrapperFileCompressor.LEVEL_FAST, mimeType);
                         
                         byte[] compressedData = compressionResult.getData();
                         compressionType = compressionResult.getCompressionType();
@@ -153,6 +153,15 @@ public enum CommandQueryManager {
             WHERE file_id = ? AND user_id = ? AND is_deleted = FALSE     
         """
     ),
+    GET_DICTIONARY_SAMPLES(
+        """
+            SELECT file_id, user_id, mime_type
+            FROM files_metadata
+            WHERE file_size <= ? AND is_deleted = FALSE
+            ORDER BY uploaded_at DESC
+            LIMIT ?
+        """
+    ),
 
     /*
     * ~~~ IMAGE DATA ~~~ 
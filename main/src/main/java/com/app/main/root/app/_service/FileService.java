@@ -2,6 +2,7 @@ package com.app.main.root.app._service;
 import com.app.main.root.app._db.CommandQueryManager;
 import com.app.main.root.app._db.DbManager;
 import com.app.main.root.app.file_compressor.WrapperFileCompressor;
+import com.app.main.root.app.file_compressor.WithProbeResult;
 import com.app.main.root.app._cache.CacheService;
 import com.app.main.root.app._crypto.file_encoder.FileEncoderWrapper;
 import com.app.main.root.app._crypto.file_encoder.KeyManagerService;
@@ -12,6 +13,7 @@ import org.springframework.stereotype.Service;
 import org.springframework.beans.factory.annotation.Autowired;
 import org.springframework.context.annotation.Lazy;
 import org.springframework.jdbc.core.JdbcTemplate;
+import org.springframework.scheduling.annotation.Scheduled;
 import java.util.*;
 
 @Service
@@ -35,6 +37,12 @@ public class FileService {
 
     private static final long COMPRESSION_MIN_SIZE = 1024 * 100;
     private static final long COMPRESSION_MAX_SIZE = 1024 * 1024 * 500;
+    private static final long DICTIONARY_MIN_SIZE = 256;
+    private static final long DICTIONARY_SAMPLE_MAX_SIZE = 1024 * 16;
+    private static final int DICTIONARY_SAMPLE_LIMIT = 2000;
+    private static final long DICTIONARY_TRAIN_CHECK = 60L * 60 * 1000;
+    private static final long DICTIONARY_TRAIN_INTERVAL = 7L * 24 * 60 * 60 * 1000;
+    private volatile long dictionaryTrainingAttempt = 0;
 
     public FileService(
         Map<String, JdbcTemplate> jdbcTemplates,
@@ -324,6 +332,18 @@ public class FileService {
      * Should Compress
      */
     public boolean shouldCompress(long fileSize, String mimeType) {
+        return shouldCompress(fileSize, mimeType, null);
+    }
+
+    /**
+     * Should Compress
+     * With the head of the file available the native entropy probe
+     * decides instead of the text MIME list, so binaries that compress
+     * well are not skipped and mislabelled media is. Files below
+     * COMPRESSION_MIN_SIZE only qualify when their MIME family has a
+     * trained dictionary.
+     */
+    public boolean shouldCompress(long fileSize, String mimeType, byte[] head) {
         if(mimeType != null && mimeType.toLowerCase().contains("video")) {
             System.out.println("DEBUG: Skipping compression for video file: " + mimeType);
             return false;
@@ -332,11 +352,14 @@ public class FileService {
             System.out.println("DEBUG: File too large for compression: " + fileSize + " bytes");
             return false;
         }
-        if(fileSize < COMPRESSION_MIN_SIZE || fileSize > COMPRESSION_MAX_SIZE) {
+        if(fileSize < COMPRESSION_MIN_SIZE) {
+            return fileSize >= DICTIONARY_MIN_SIZE && WrapperFileCompressor.hasDictionary(mimeType);
+        }
+        if(fileSize > COMPRESSION_MAX_SIZE) {
             return false;
         }
 
-        String lowerMime = mimeType.toLowerCase();
+        String lowerMime = mimeType != null ? mimeType.toLowerCase() : "";
         if(lowerMime.contains("zip") || 
             lowerMime.contains("rar") ||
             lowerMime.contains("gzip") ||
@@ -357,6 +380,15 @@ public class FileService {
             System.out.println("DEBUG: Skipping compression for already-compressed format: " + mimeType);
             return false;
         }
+        if(head != null) {
+            try {
+                WithProbeResult probe = WrapperFileCompressor.probe(head);
+                System.out.println("DEBUG: Probe predicted ratio: " + probe.getPredictedRatio());
+                return probe.shouldCompress();
+            } catch(Exception err) {
+                System.err.println("ERROR: Compressibility probe failed: " + err.getMessage());
+            }
+        }
         
         return lowerMime.contains("text/") ||
             lowerMime.contains("json") ||
@@ -368,4 +400,77 @@ public class FileService {
             lowerMime.contains("css") ||
             lowerMime.contains("javascript");
     }
+
+    /**
+     * Scheduled Dictionary Training
+     * Retrains once the newest dictionary on disk is older than
+     * DICTIONARY_TRAIN_INTERVAL. The on-disk age keeps restarts from
+     * adding versions, and the last attempt keeps a failed or empty
+     * run from repeating every check. At one version a week a family
+     * reaches DICT_MAX_VERSIONS after about fifteen months.
+     */
+    @Scheduled(initialDelay = DICTIONARY_TRAIN_CHECK, fixedDelay = DICTIONARY_TRAIN_CHECK)
+    public void scheduledDictionaryTraining() {
+        long now = System.currentTimeMillis();
+        if(now - WrapperFileCompressor.dictionaryTrainedAt() < DICTIONARY_TRAIN_INTERVAL) return;
+        if(now - dictionaryTrainingAttempt < DICTIONARY_TRAIN_INTERVAL) return;
+        dictionaryTrainingAttempt = now;
+        try {
+            Map<Integer, Integer> trained = trainDictionaries();
+            System.out.println("Trained compression dictionaries: " + trained);
+        } catch(Exception err) {
+            System.err.println("ERROR: Scheduled dictionary training failed: " + err.getMessage());
+        }
+    }
+
+    /**
+     * Train Dictionaries
+     * Samples recent small files, groups them by MIME family and
+     * trains a new dictionary version for each family. Earlier
+     * versions stay loaded so files compressed with them still decode,
+     * which caps a family at DICT_MAX_VERSIONS; a family at the cap
+     * is skipped and keeps its newest dictionary.
+     */
+    public Map<Integer, Integer> trainDictionaries() {
+        JdbcTemplate metadataTemplate = jdbcTemplates.get(METADATA_DB);
+        if(metadataTemplate == null) throw new RuntimeException("files_metadata database not available");
+
+        List<Map<String, Object>> rows = metadataTemplate.queryForList(
+            CommandQueryManager.GET_DICTIONARY_SAMPLES.get(),
+            DICTIONARY_SAMPLE_MAX_SIZE,
+            DICTIONARY_SAMPLE_LIMIT
+        );
+        Map<Integer, List<byte[]>> samples = new HashMap<>();
+        Set<Integer> full = new HashSet<>();
+        for(Map<String, Object> row : rows) {
+            int family = WrapperFileCompressor.dictionaryFamily((String) row.get("mime_type"));
+            if(family == WrapperFileCompressor.DICT_FAMILY_NONE) continue;
+            if(!WrapperFileCompressor.canTrainDictionary(family)) {
+                if(full.add(family)) {
+                    System.err.println("ERROR: Dictionary family " + family + " has reached " +
+                        WrapperFileCompressor.DICT_MAX_VERSIONS + " versions, keeping its current dictionary");
+                }
+                continue;
+            }
+            try {
+                Map<String, Object> file = fileDownloader.download(
+                    String.valueOf(row.get("user_id")),
+                    String.valueOf(row.get("file_id"))
+                );
+                samples.computeIfAbsent(family, k -> new ArrayList<>()).add((byte[]) file.get("content"));
+            } catch(Exception err) {
+                System.err.println("ERROR: Cannot read dictionary sample " + row.get("file_id") + ": " + err.getMessage());
+            }
+        }
+
+        Map<Integer, Integer> trained = new HashMap<>();
+        for(Map.Entry<Integer, List<byte[]>> entry : samples.entrySet()) {
+            try {
+                trained.put(entry.getKey(), WrapperFileCompressor.trainDictionary(entry.getKey(), entry.getValue()));
+            } catch(Exception err) {
+                System.err.println("ERROR: Dictionary training failed for family " + entry.getKey() + ": " + err.getMessage());
+            }
+        }
+        return trained;
+    }
 }
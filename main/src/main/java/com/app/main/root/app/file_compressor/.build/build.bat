@@ -11,6 +11,10 @@ set OPENSSL_LIB=%VCPKG_ROOT%\installed\x64-windows\lib
 set PTHREAD_INCLUDE=%VCPKG_ROOT%\installed\x64-windows\include
 set PTHREAD_LIB=%VCPKG_ROOT%\installed\x64-windows\lib
 
+rem build.bat debug compiles in the DEBUG output (COMP_DEBUG)
+set COMP_FLAGS=
+if /I "%1"=="debug" set COMP_FLAGS=/DCOMP_DEBUG
+
 echo.
 set VS_PATH=C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Auxiliary\Build
 
@@ -30,7 +34,7 @@ del file_compressor.dll 2>nul
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\_main.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\_main.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile _main.c
     pause
@@ -39,7 +43,7 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\_file_compressor_jni.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\_file_compressor_jni.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile _file_compressor_jni.c
     pause
@@ -48,7 +52,7 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\bp.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\bp.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile bp.c
     pause
@@ -57,7 +61,7 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\comp.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\comp.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile comp.c
     pause
@@ -66,7 +70,7 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\delta.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\delta.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile delta.c
     pause
@@ -75,7 +79,7 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\rl.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\rl.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile rl.c
     pause
@@ -84,16 +88,196 @@ if %errorlevel% neq 0 (
 
 echo.
 echo Compiling with CL.EXE...
-cl /nologo /c /O2 /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\sliding_window.c
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\sliding_window.c
 if %errorlevel% neq 0 (
     echo ERROR: Failed to compile sliding_window.c
     pause
     exit /b 1
 )
 
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\match_finder.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile match_finder.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\lz_parse.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile lz_parse.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\sw2.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile sw2.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\huffman.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile huffman.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\lzh.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile lzh.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\fse.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile fse.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\lza.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile lza.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\thread_pool.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile thread_pool.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\frame.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile frame.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\comp_stream.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile comp_stream.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\probe.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile probe.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\filter.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile filter.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\bcj.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile bcj.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\dict.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile dict.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\stats.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile stats.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\file_io.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile file_io.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\checksum.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile checksum.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\chunker.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile chunker.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\rsync.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile rsync.c
+    pause
+    exit /b 1
+)
+
+echo.
+echo Compiling with CL.EXE...
+cl /nologo /c /O2 %COMP_FLAGS% /EHsc /std:c++17 /I"%JAVA_HOME%\include" /I"%JAVA_HOME%\include\win32" /I"%OPENSSL_INCLUDE%" /I"%PTHREAD_INCLUDE%" ..\patch.c
+if %errorlevel% neq 0 (
+    echo ERROR: Failed to compile patch.c
+    pause
+    exit /b 1
+)
+
 echo.
 echo Linking DLL with link.exe...
-link /nologo /DLL /OUT:file_compressor.dll _main.obj _file_compressor_jni.obj bp.obj comp.obj delta.obj rl.obj sliding_window.obj /LIBPATH:"%OPENSSL_LIB%" /LIBPATH:"%PTHREAD_LIB%" libssl.lib libcrypto.lib pthreadVC3.lib ws2_32.lib gdi32.lib crypt32.lib advapi32.lib
+link /nologo /DLL /OUT:file_compressor.dll _main.obj _file_compressor_jni.obj bp.obj comp.obj delta.obj rl.obj sliding_window.obj match_finder.obj lz_parse.obj sw2.obj huffman.obj lzh.obj fse.obj lza.obj thread_pool.obj frame.obj comp_stream.obj probe.obj filter.obj bcj.obj dict.obj stats.obj file_io.obj checksum.obj chunker.obj rsync.obj patch.obj /LIBPATH:"%OPENSSL_LIB%" /LIBPATH:"%PTHREAD_LIB%" libssl.lib libcrypto.lib pthreadVC3.lib ws2_32.lib gdi32.lib crypt32.lib advapi32.lib
 
 if %errorlevel% neq 0 (
     echo ERROR: Linking failed
@@ -0,0 +1,34 @@
+package com.app.main.root.app.file_compressor;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+
+public class WithChunks {
+    public static final int HASH_SIZE = 32;
+    public static final int RECORD_SIZE = 12 + HASH_SIZE;
+
+    private final ByteBuffer records;
+    private final int count;
+    
+    public WithChunks(byte[] records) {
+        this.records = ByteBuffer.wrap(records).order(ByteOrder.LITTLE_ENDIAN);
+        this.count = records.length / RECORD_SIZE;
+    }
+    
+    public int getCount() {
+        return count;
+    }
+    
+    public long getOffset(int index) {
+        return records.getLong(index * RECORD_SIZE);
+    }
+    
+    public int getLength(int index) {
+        return records.getInt(index * RECORD_SIZE + 8);
+    }
+    
+    public byte[] getHash(int index) {
+        int start = index * RECORD_SIZE + 12;
+        return Arrays.copyOfRange(records.array(), start, start + HASH_SIZE);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+package com.app.main.root.app.file_compressor;
+
+public class WithCompressorStats {
+    public static final int SKIP_TOO_SMALL = 0;
+    public static final int SKIP_MEDIA = 1;
+    public static final int SKIP_BINARY = 2;
+    public static final int SKIP_TRIAL = 3;
+    public static final int SKIP_PROBE = 4;
+
+    private static final int HEADER_SIZE = 3;
+    private static final int CODEC_FIELDS = 5;
+
+    private final long[] snapshot;
+    private final int codecCount;
+    private final int reasonCount;
+    
+    public WithCompressorStats(long[] snapshot) {
+        this.snapshot = snapshot;
+        this.codecCount = (int)snapshot[1];
+        this.reasonCount = (int)snapshot[2];
+    }
+
+    private long codecField(int compressionType, int field) {
+        if(compressionType < 0 || compressionType >= codecCount) return 0;
+        return snapshot[HEADER_SIZE + compressionType * CODEC_FIELDS + field];
+    }
+    
+    public long getCalls(int compressionType) {
+        return codecField(compressionType, 0);
+    }
+    
+    public long getBytesIn(int compressionType) {
+        return codecField(compressionType, 1);
+    }
+    
+    public long getBytesOut(int compressionType) {
+        return codecField(compressionType, 2);
+    }
+    
+    public long getNanos(int compressionType) {
+        return codecField(compressionType, 3);
+    }
+    
+    public long getFallbacks(int compressionType) {
+        return codecField(compressionType, 4);
+    }
+    
+    public long getSkips(int reason) {
+        if(reason < 0 || reason >= reasonCount) return 0;
+        return snapshot[HEADER_SIZE + codecCount * CODEC_FIELDS + reason];
+    }
+
+    public int getCodecCount() {
+        return codecCount;
+    }
+
+    public long[] getSnapshot() {
+        return snapshot.clone();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+package com.app.main.root.app.file_compressor;
+
+public class WithProbeResult {
+    private final boolean compress;
+    private final double predictedRatio;
+    
+    public WithProbeResult(boolean compress, double predictedRatio) {
+        this.compress = compress;
+        this.predictedRatio = predictedRatio;
+    }
+    
+    public boolean shouldCompress() {
+        return compress;
+    }
+    
+    public double getPredictedRatio() {
+        return predictedRatio;
+    }
+}
\ No newline at end of file
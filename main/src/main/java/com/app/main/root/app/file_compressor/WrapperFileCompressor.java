@@ -2,20 +2,50 @@ package com.app.main.root.app.file_compressor;
 import java.io.ByteArrayInputStream;
 import java.io.ByteArrayOutputStream;
 import java.io.DataInputStream;
-import java.io.DataOutputStream;
 import java.io.EOFException;
 import java.io.IOException;
 import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.nio.file.Paths;
-import java.util.Arrays;
+import java.util.List;
+import java.util.stream.Stream;
 
 public class WrapperFileCompressor {
     private static final String DLL_PATH = "src/main/java/com/app/main/root/app/file_compressor/.build/";
+    private static final String DICT_PATH = DLL_PATH + "dict/";
+
+    public static final int LEVEL_FAST = 1;
+    public static final int LEVEL_DEFAULT = 5;
+    public static final int LEVEL_MAX = 9;
+    public static final int FRAME_COMPRESSION_TYPE = 8;
+    public static final int STREAM_COMPRESSION_TYPE = 9;
+    public static final int FILTER_COMPRESSION_TYPE = 11;
+    public static final int DICT_COMPRESSION_TYPE = 12;
+    public static final int PATCH_COMPRESSION_TYPE = 13;
+    public static final long SEEKABLE_THRESHOLD = 32L * 1024 * 1024;
+    public static final int MAX_COMPRESSION_TYPE = 13;
+    public static final int DICT_FAMILY_NONE = 0;
+    public static final int DICT_FAMILY_JSON = 1;
+    public static final int DICT_FAMILY_XML = 2;
+    public static final int DICT_FAMILY_CSV = 3;
+    public static final int DICT_FAMILY_TEXT = 4;
+    public static final int DICT_MAX_INPUT = 128 * 1024;
+    public static final int DICT_MAX_VERSIONS = 64;
+    public static final int CHUNK_MIN_SIZE = 16 * 1024;
+    public static final int CHUNK_AVG_SIZE = 64 * 1024;
+    public static final int CHUNK_MAX_SIZE = 256 * 1024;
+    public static final int DELTA_BLOCK_AUTO = 0;
+    public static final int PATCH_MAX_CHAIN = 8;
+    public static final int PATCH_MAX_PERCENT = 50;
+    private static final int VERIFY_OK = 0;
+    private static final int VERIFY_CORRUPT = -1;
     
     static {
         loadNativeLibraries();
+        loadDictionaries();
     }
     
     private static void loadNativeLibraries() {
@@ -106,12 +136,33 @@ public class WrapperFileCompressor {
         }
     }
 
-    private static native WithCompressionResult compressNative(byte[] data);
+    private static void loadDictionaries() {
+        try {
+            Files.createDirectories(Paths.get(DICT_PATH));
+            int loaded = dictInit(DICT_PATH);
+            System.out.println("Loaded compression dictionaries: " + loaded);
+        } catch(Exception err) {
+            System.err.println("Failed to load compression dictionaries: " + err.getMessage());
+        }
+    }
+
+    private static native WithCompressionResult compressNative(byte[] data, int level);
+    private static native long compressIntoNative(ByteBuffer src, int srcPosition, int srcRemaining, ByteBuffer dst, int dstPosition, int dstRemaining, int level);
+    private static native int dictInit(String directory);
+    private static native boolean dictAvailable(int family);
+    private static native int dictVersionCount(int family);
+    private static native WithCompressionResult compressWithDictionaryNative(byte[] data, int level, int family);
+    private static native int trainDictionaryNative(byte[][] samples, int family, String directory);
+    private static native WithCompressionResult compressWithBaseNative(byte[] data, int level, byte[] base, long baseVersion, int baseDepth, int maxChain, int maxPercent);
     
     public static WithCompressionResult compress(byte[] data) throws Exception {
+        return compress(data, LEVEL_DEFAULT);
+    }
+
+    public static WithCompressionResult compress(byte[] data, int level) throws Exception {
         try {
-            System.out.println("DEBUG: Calling native compress, data length: " + data.length);
-            WithCompressionResult result = compressNative(data);
+            System.out.println("DEBUG: Calling native compress, data length: " + data.length + ", level: " + level);
+            WithCompressionResult result = compressNative(data, level);
             if(result == null) {
                 throw new Exception("Native compression returned null");
             }
@@ -127,12 +178,142 @@ public class WrapperFileCompressor {
             throw new RuntimeException("Compression failed", e);
         }
     }
+
+    public static WithCompressionResult compress(byte[] data, int level, String mimeType) throws Exception {
+        int family = dictionaryFamily(mimeType);
+        if(family == DICT_FAMILY_NONE || data.length > DICT_MAX_INPUT) {
+            return compress(data, level);
+        }
+        WithCompressionResult result = compressWithDictionaryNative(data, level, family);
+        if(result == null) {
+            throw new Exception("Native dictionary compression returned null");
+        }
+        System.out.println("DEBUG: Dictionary compress returned, length: " + 
+            result.getData().length + ", type: " + result.getCompressionType());
+        return result;
+    }
+
+    public static WithCompressionResult compressWithBase(byte[] data, int level, byte[] base, long baseVersion, int baseDepth) throws Exception {
+        return compressWithBase(data, level, base, baseVersion, baseDepth, PATCH_MAX_CHAIN, PATCH_MAX_PERCENT);
+    }
+
+    public static WithCompressionResult compressWithBase(
+        byte[] data,
+        int level,
+        byte[] base,
+        long baseVersion,
+        int baseDepth,
+        int maxChain,
+        int maxPercent
+    ) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(maxChain < 0 || maxPercent < 0 || maxPercent > 100) {
+            throw new IllegalArgumentException("Invalid patch policy: chain " + maxChain + ", percent " + maxPercent);
+        }
+        WithCompressionResult result = compressWithBaseNative(data, level, base, baseVersion, baseDepth, maxChain, maxPercent);
+        if(result == null) {
+            throw new Exception("Native compression with base returned null");
+        }
+        System.out.println("DEBUG: Compress with base " + baseVersion + " returned, length: " + 
+            result.getData().length + ", type: " + result.getCompressionType());
+        return result;
+    }
+
+    public static int compressInto(ByteBuffer src, ByteBuffer dst, int level) throws Exception {
+        if(src == null || !src.isDirect() || dst == null || !dst.isDirect()) {
+            throw new IllegalArgumentException("Source and destination must be direct ByteBuffers");
+        }
+        if(!src.hasRemaining()) {
+            throw new IllegalArgumentException("Source cannot be empty");
+        }
+        long packed = compressIntoNative(src, src.position(), src.remaining(), dst, dst.position(), dst.remaining(), level);
+        if(packed < 0) {
+            throw new Exception("Native compression into buffer failed");
+        }
+        int compressionType = (int)(packed & 0xFF);
+        int written = (int)(packed >>> 8);
+        src.position(src.limit());
+        dst.position(dst.position() + written);
+        return compressionType;
+    }
+
+    public static int dictionaryFamily(String mimeType) {
+        String lowerMime = mimeType != null ? mimeType.toLowerCase() : "";
+        if(lowerMime.contains("json")) return DICT_FAMILY_JSON;
+        if(lowerMime.contains("xml") || lowerMime.contains("html")) return DICT_FAMILY_XML;
+        if(lowerMime.contains("csv")) return DICT_FAMILY_CSV;
+        if(lowerMime.startsWith("text/") || lowerMime.contains("log")) return DICT_FAMILY_TEXT;
+        return DICT_FAMILY_NONE;
+    }
+
+    public static boolean hasDictionary(String mimeType) {
+        int family = dictionaryFamily(mimeType);
+        return family != DICT_FAMILY_NONE && dictAvailable(family);
+    }
+
+    public static long dictionaryTrainedAt() {
+        try(Stream<Path> files = Files.list(Paths.get(DICT_PATH))) {
+            return files
+                .filter(path -> path.toString().endsWith(".dict"))
+                .mapToLong(path -> path.toFile().lastModified())
+                .max()
+                .orElse(0L);
+        } catch(Exception err) {
+            return 0L;
+        }
+    }
+
+    public static boolean canTrainDictionary(int family) {
+        return family != DICT_FAMILY_NONE && dictVersionCount(family) < DICT_MAX_VERSIONS;
+    }
+
+    public static int trainDictionary(int family, List<byte[]> samples) throws Exception {
+        if(family == DICT_FAMILY_NONE || samples == null || samples.isEmpty()) {
+            throw new IllegalArgumentException("Invalid dictionary family or samples: " + family);
+        }
+        int id = trainDictionaryNative(samples.toArray(new byte[0][]), family, DICT_PATH);
+        if(id < 0) {
+            throw new Exception("Dictionary training failed for family: " + family);
+        }
+        System.out.println("DEBUG: Trained dictionary " + Integer.toHexString(id) + " from " + samples.size() + " samples");
+        return id;
+    }
+
     public static native byte[] decompress(byte[] data, int compressionType);
-    public static native int compressFile(String inputPath, String outputPath);
+    private static native byte[] decompressParallelNative(byte[] data, int compressionType);
+    private static native byte[] decompressRangeNative(byte[] data, int compressionType, long offset, int length);
+    private static native long decompressedSizeNative(byte[] data, int compressionType);
+    private static native int decompressIntoNative(byte[] data, int compressionType, ByteBuffer dst, int position, int remaining);
+    private static native int decompressDirectNative(ByteBuffer src, int srcPosition, int srcRemaining, int compressionType, ByteBuffer dst, int dstPosition, int dstRemaining);
+    private static native long streamCreate(int level, boolean seekable);
+    private static native byte[] streamUpdate(long handle, byte[] data, int length);
+    private static native byte[] streamFinish(long handle);
+    private static native void streamDestroy(long handle);
+    private static native WithProbeResult probeNative(byte[] data, int length);
+    private static native long[] getCompressorStatsNative();
+    private static native int verifyNative(byte[] data, int compressionType);
+    private static native int verifyFileNative(String inputPath);
+    private static native byte[] chunkNative(byte[] data, int minSize, int avgSize, int maxSize);
+    private static native byte[] chunkFileNative(String inputPath, int minSize, int avgSize, int maxSize);
+    private static native byte[] signatureNative(byte[] base, int blockSize);
+    private static native byte[] signatureFileNative(String basePath, int blockSize);
+    private static native byte[] deltaNative(byte[] signature, byte[] target);
+    private static native byte[] deltaFileNative(byte[] signature, String targetPath);
+    private static native byte[] patchNative(byte[] base, byte[] delta);
+    private static native int patchFileNative(String basePath, byte[] delta, String outputPath);
+    private static native byte[] decompressWithBaseNative(byte[] data, byte[] base);
+    private static native long[] patchInfoNative(byte[] data);
+    public static native int compressFile(String inputPath, String outputPath, int level);
     public static native int decompressFile(String inputPath, String outputPath);
 
     public static void compressFileWrapped(String inputPath, String outputPath) throws Exception {
-        int result = compressFile(inputPath, outputPath);
+        compressFileWrapped(inputPath, outputPath, LEVEL_DEFAULT);
+    }
+
+    public static void compressFileWrapped(String inputPath, String outputPath, int level) throws Exception {
+        int result = compressFile(inputPath, outputPath, level);
         if(result < 0) {
             throw new Exception("Compression failed with error code: " + result);
         }
@@ -154,89 +335,323 @@ public class WrapperFileCompressor {
         if(data == null || data.length == 0) {
             throw new IllegalArgumentException("Data cannot be null or empty");
         }
-        if(compressionType < 0 || compressionType > 4) {
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
             throw new IllegalArgumentException("Invalid compression type: " + compressionType);
         }
         return decompress(data, compressionType);
     }
 
-    public static WithCompressionResult compressStream(InputStream inputStream, long size, String mimeType) throws Exception {
+    public static byte[] decompressParallel(byte[] data, int compressionType) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        byte[] result = decompressParallelNative(data, compressionType);
+        if(result == null) {
+            throw new Exception("Native decompression failed for type: " + compressionType);
+        }
+        return result;
+    }
+
+    public static byte[] decompressRange(byte[] data, int compressionType, long offset, int length) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        if(offset < 0 || length < 0) {
+            throw new IllegalArgumentException("Invalid range: " + offset + " +" + length);
+        }
+        byte[] result = decompressRangeNative(data, compressionType, offset, length);
+        if(result == null) {
+            throw new Exception("Native range decompression failed for type: " + compressionType);
+        }
+        return result;
+    }
+
+    public static long decompressedSize(byte[] data, int compressionType) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        long size = decompressedSizeNative(data, compressionType);
+        if(size < 0) {
+            throw new Exception("Cannot read decompressed size for type: " + compressionType);
+        }
+        return size;
+    }
+
+    public static int decompressInto(byte[] data, int compressionType, ByteBuffer dst) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        if(dst == null || !dst.isDirect()) {
+            throw new IllegalArgumentException("Destination must be a direct ByteBuffer");
+        }
+        int written = decompressIntoNative(data, compressionType, dst, dst.position(), dst.remaining());
+        if(written < 0) {
+            throw new Exception("Native decompression into buffer failed for type: " + compressionType);
+        }
+        dst.position(dst.position() + written);
+        return written;
+    }
+
+    public static int decompressInto(ByteBuffer src, int compressionType, ByteBuffer dst) throws Exception {
+        if(src == null || !src.isDirect() || dst == null || !dst.isDirect()) {
+            throw new IllegalArgumentException("Source and destination must be direct ByteBuffers");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        int written = decompressDirectNative(src, src.position(), src.remaining(), compressionType, dst, dst.position(), dst.remaining());
+        if(written < 0) {
+            throw new Exception("Native decompression between buffers failed for type: " + compressionType);
+        }
+        src.position(src.limit());
+        dst.position(dst.position() + written);
+        return written;
+    }
+
+    public static WithProbeResult probe(byte[] data) throws Exception {
+        if(data == null) {
+            throw new IllegalArgumentException("Data cannot be null");
+        }
+        WithProbeResult result = probeNative(data, data.length);
+        if(result == null) {
+            throw new Exception("Native probe failed");
+        }
+        return result;
+    }
+
+    public static boolean verify(byte[] data, int compressionType) throws Exception {
+        if(data == null || data.length == 0) {
+            throw new IllegalArgumentException("Data cannot be null or empty");
+        }
+        if(compressionType < 0 || compressionType > MAX_COMPRESSION_TYPE) {
+            throw new IllegalArgumentException("Invalid compression type: " + compressionType);
+        }
+        int result = verifyNative(data, compressionType);
+        if(result == VERIFY_CORRUPT) {
+            throw new Exception("Checksum verification failed for type: " + compressionType);
+        }
+        return result == VERIFY_OK;
+    }
+
+    public static boolean verifyFile(String inputPath) throws Exception {
+        int result = verifyFileNative(inputPath);
+        if(result == VERIFY_CORRUPT) {
+            throw new Exception("Checksum verification failed for file: " + inputPath);
+        }
+        if(result < 0) {
+            throw new Exception("Verification failed with error code: " + result);
+        }
+        return result == VERIFY_OK;
+    }
+
+    public static WithChunks chunk(byte[] data) throws Exception {
+        return chunk(data, CHUNK_MIN_SIZE, CHUNK_AVG_SIZE, CHUNK_MAX_SIZE);
+    }
+
+    public static WithChunks chunk(byte[] data, int minSize, int avgSize, int maxSize) throws Exception {
+        if(data == null) {
+            throw new IllegalArgumentException("Data cannot be null");
+        }
+        if(minSize <= 0 || minSize > avgSize || avgSize > maxSize) {
+            throw new IllegalArgumentException("Invalid chunk sizes: " + minSize + "/" + avgSize + "/" + maxSize);
+        }
+        byte[] records = chunkNative(data, minSize, avgSize, maxSize);
+        if(records == null) {
+            throw new Exception("Native chunking failed");
+        }
+        return new WithChunks(records);
+    }
+
+    public static WithChunks chunkFile(String inputPath) throws Exception {
+        return chunkFile(inputPath, CHUNK_MIN_SIZE, CHUNK_AVG_SIZE, CHUNK_MAX_SIZE);
+    }
+
+    public static WithChunks chunkFile(String inputPath, int minSize, int avgSize, int maxSize) throws Exception {
+        if(minSize <= 0 || minSize > avgSize || avgSize > maxSize) {
+            throw new IllegalArgumentException("Invalid chunk sizes: " + minSize + "/" + avgSize + "/" + maxSize);
+        }
+        byte[] records = chunkFileNative(inputPath, minSize, avgSize, maxSize);
+        if(records == null) {
+            throw new Exception("Native chunking failed for file: " + inputPath);
+        }
+        return new WithChunks(records);
+    }
+
+    public static byte[] signature(byte[] base) throws Exception {
+        return signature(base, DELTA_BLOCK_AUTO);
+    }
+
+    public static byte[] signature(byte[] base, int blockSize) throws Exception {
+        if(base == null) {
+            throw new IllegalArgumentException("Base cannot be null");
+        }
+        if(blockSize < 0) {
+            throw new IllegalArgumentException("Invalid block size: " + blockSize);
+        }
+        byte[] result = signatureNative(base, blockSize);
+        if(result == null) {
+            throw new Exception("Native signature failed");
+        }
+        return result;
+    }
+
+    public static byte[] signatureFile(String basePath) throws Exception {
+        return signatureFile(basePath, DELTA_BLOCK_AUTO);
+    }
+
+    public static byte[] signatureFile(String basePath, int blockSize) throws Exception {
+        if(blockSize < 0) {
+            throw new IllegalArgumentException("Invalid block size: " + blockSize);
+        }
+        byte[] result = signatureFileNative(basePath, blockSize);
+        if(result == null) {
+            throw new Exception("Native signature failed for file: " + basePath);
+        }
+        return result;
+    }
+
+    public static byte[] delta(byte[] signature, byte[] target) throws Exception {
+        if(signature == null || signature.length == 0 || target == null) {
+            throw new IllegalArgumentException("Signature and target cannot be null or empty");
+        }
+        byte[] result = deltaNative(signature, target);
+        if(result == null) {
+            throw new Exception("Native delta failed");
+        }
+        return result;
+    }
+
+    public static byte[] deltaFile(byte[] signature, String targetPath) throws Exception {
+        if(signature == null || signature.length == 0) {
+            throw new IllegalArgumentException("Signature cannot be null or empty");
+        }
+        byte[] result = deltaFileNative(signature, targetPath);
+        if(result == null) {
+            throw new Exception("Native delta failed for file: " + targetPath);
+        }
+        return result;
+    }
+
+    public static byte[] patch(byte[] base, byte[] delta) throws Exception {
+        if(base == null || delta == null || delta.length == 0) {
+            throw new IllegalArgumentException("Base and delta cannot be null or empty");
+        }
+        byte[] result = patchNative(base, delta);
+        if(result == null) {
+            throw new Exception("Native patch failed");
+        }
+        return result;
+    }
+
+    public static void patchFile(String basePath, byte[] delta, String outputPath) throws Exception {
+        if(delta == null || delta.length == 0) {
+            throw new IllegalArgumentException("Delta cannot be null or empty");
+        }
+        int result = patchFileNative(basePath, delta, outputPath);
+        if(result < 0) {
+            throw new Exception("Patch failed with error code: " + result);
+        }
+    }
+
+    public static byte[] decompressWithBase(byte[] data, byte[] base) throws Exception {
+        if(data == null || data.length == 0 || base == null) {
+            throw new IllegalArgumentException("Data and base cannot be null or empty");
+        }
+        byte[] result = decompressWithBaseNative(data, base);
+        if(result == null) {
+            throw new Exception("Native decompression with base failed");
+        }
+        return result;
+    }
+
+    public static long getPatchBaseVersion(byte[] data) throws Exception {
+        return patchInfo(data)[0];
+    }
+
+    public static int getPatchDepth(byte[] data) throws Exception {
+        return (int)patchInfo(data)[1];
+    }
+
+    private static long[] patchInfo(byte[] data) throws Exception {
+        if(data == null) {
+            throw new IllegalArgumentException("Data cannot be null");
+        }
+        long[] info = patchInfoNative(data);
+        if(info == null) {
+            throw new Exception("Invalid patch header");
+        }
+        return info;
+    }
+
+    public static WithCompressorStats getCompressorStats() throws Exception {
+        long[] snapshot = getCompressorStatsNative();
+        if(snapshot == null || snapshot.length < 3) {
+            throw new Exception("Native compressor stats unavailable");
+        }
+        return new WithCompressorStats(snapshot);
+    }
+
+    public static int compressStream(InputStream inputStream, long size, String mimeType, OutputStream outputStream) throws Exception {
         System.out.println("DEBUG: Starting stream compression for " + mimeType + ", size: " + size + " bytes");
         
         if(mimeType != null && mimeType.toLowerCase().contains("video")) {
             System.out.println("DEBUG: Video file detected, skipping compression");
-            byte[] data = readFully(inputStream);
-            return new WithCompressionResult(data, 0);
+            inputStream.transferTo(outputStream);
+            return 0;
         }
         
         if(size < 5 * 1024 * 1024) {
             byte[] data = readFully(inputStream);
-            return compress(data);
+            WithCompressionResult result = compress(data);
+            outputStream.write(result.getData());
+            return result.getCompressionType();
         }
         
-        int chunkSize = 5 * 1024 * 1024;
-        ByteArrayOutputStream output = new ByteArrayOutputStream();
-        
-        byte[] buffer = new byte[chunkSize];
+        int sliceSize = 1024 * 1024;
+        byte[] buffer = new byte[sliceSize];
         int bytesRead;
         long totalRead = 0;
-        int chunkNumber = 0;
-        boolean anyCompression = false;
-        
-        DataOutputStream dataOutput = new DataOutputStream(output);
-        dataOutput.writeLong(size);
-        while((bytesRead = inputStream.read(buffer)) != -1) {
-            chunkNumber++;
-            System.out.println("DEBUG: Processing chunk " + chunkNumber + ", size: " + bytesRead + " bytes");
-            
-            boolean chunkIsCompressible = isChunkCompressible(buffer, bytesRead);
-            if(!chunkIsCompressible) {
-                dataOutput.writeByte(0);
-                dataOutput.writeInt(bytesRead);
-                dataOutput.write(buffer, 0, bytesRead);
-                System.out.println("DEBUG: Chunk not compressible, storing as-is");
-            } else {
-                byte[] chunkData = Arrays.copyOf(buffer, bytesRead);
-                WithCompressionResult chunkResult = compress(chunkData);
-                
-                if(chunkResult.getCompressionType() > 0) {
-                    byte[] compressedChunk = chunkResult.getData();
-                    dataOutput.writeByte(chunkResult.getCompressionType());
-                    dataOutput.writeInt(compressedChunk.length);
-                    dataOutput.write(compressedChunk);
-                    anyCompression = true;
-                    System.out.println("DEBUG: Chunk compressed: " + bytesRead + " -> " + compressedChunk.length + " bytes");
-                } else {
-                    dataOutput.writeByte(0);
-                    dataOutput.writeInt(bytesRead);
-                    dataOutput.write(buffer, 0, bytesRead);
-                    System.out.println("DEBUG: Chunk compression not beneficial");
+        long totalWritten = 0;
+
+        boolean seekable = size >= SEEKABLE_THRESHOLD;
+        long handle = streamCreate(LEVEL_DEFAULT, seekable);
+        if(handle == 0) {
+            throw new Exception("Native stream context could not be created");
+        }
+        try {
+            while((bytesRead = inputStream.read(buffer)) != -1) {
+                byte[] produced = streamUpdate(handle, buffer, bytesRead);
+                if(produced == null) {
+                    throw new Exception("Native stream update failed");
                 }
+                outputStream.write(produced);
+                totalRead += bytesRead;
+                totalWritten += produced.length;
             }
-            
-            totalRead += bytesRead;
-            System.out.println("DEBUG: Total processed: " + totalRead + "/" + size + " bytes");
-        }
-        
-        byte[] compressedData = output.toByteArray();
-        System.out.println("DEBUG: Stream compression complete: " + size + " -> " + compressedData.length + " bytes");
-        
-        int finalCompressionType = anyCompression ? 10 : 0;
-        return new WithCompressionResult(compressedData, finalCompressionType);
-    }
-
-    private static boolean isChunkCompressible(byte[] chunk, int length) {
-        int textBytes = 0;
-        int sampleSize = Math.min(length, 1000);
-        
-        for(int i = 0; i < sampleSize; i++) {
-            byte b = chunk[i];
-            if((b >= 32 && b <= 126) || b == '\t' || b == '\n' || b == '\r') {
-                textBytes++;
+            byte[] tail = streamFinish(handle);
+            if(tail == null) {
+                throw new Exception("Native stream finish failed");
             }
+            outputStream.write(tail);
+            totalWritten += tail.length;
+        } finally {
+            streamDestroy(handle);
         }
-        
-        return textBytes * 100 / sampleSize > 70;
+
+        System.out.println("DEBUG: Stream compression complete: " + totalRead + " -> " + totalWritten + " bytes");
+        return seekable ? FRAME_COMPRESSION_TYPE : STREAM_COMPRESSION_TYPE;
     }
     
     public static byte[] decompressStream(byte[] compressedData) throws Exception {
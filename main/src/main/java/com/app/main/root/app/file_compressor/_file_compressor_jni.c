@@ -1,12 +1,148 @@
 ﻿#include "jni_macros.h"
 #include "_main.h"
 #include "comp.h"
+#include "frame.h"
+#include "comp_stream.h"
+#include "probe.h"
+#include "dict.h"
+#include "stats.h"
+#include "chunker.h"
+#include "rsync.h"
+#include "patch.h"
+#include "debug.h"
 #include <jni.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
+#define JNI_CRITICAL_ENCODE_MAX (1 << 20)
+#define JNI_CRITICAL_DECODE_MAX (8 << 20)
+#define JNI_CRITICAL_ENCODE_LEVEL 3
+
+/**
+ * Cached Classes
+ * Result classes and constructors are resolved once in JNI_OnLoad
+ * instead of with FindClass/GetMethodID on every call.
+ */
+static jclass compressionResultClass;
+static jmethodID compressionResultInit;
+static jclass probeResultClass;
+static jmethodID probeResultInit;
+
+static jclass cacheClass(JNIEnv* env, const char* name) {
+    jclass local = (*env)->FindClass(env, name);
+    if(!local) return NULL;
+    jclass global = (jclass)(*env)->NewGlobalRef(env, local);
+    (*env)->DeleteLocalRef(env, local);
+    return global;
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+    JNIEnv* env = NULL;
+    if((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_8) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    compressionResultClass = cacheClass(env, "com/app/main/root/app/file_compressor/WithCompressionResult");
+    probeResultClass = cacheClass(env, "com/app/main/root/app/file_compressor/WithProbeResult");
+    if(!compressionResultClass || !probeResultClass) {
+        printf("ERROR JNI: Cannot find result classes\n");
+        return JNI_ERR;
+    }
+    compressionResultInit = (*env)->GetMethodID(env, compressionResultClass, "<init>", "([BI)V");
+    probeResultInit = (*env)->GetMethodID(env, probeResultClass, "<init>", "(ZD)V");
+    if(!compressionResultInit || !probeResultInit) {
+        printf("ERROR JNI: Cannot find result constructors\n");
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_8;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
+    JNIEnv* env = NULL;
+    if((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_8) != JNI_OK) return;
+    if(compressionResultClass) (*env)->DeleteGlobalRef(env, compressionResultClass);
+    if(probeResultClass) (*env)->DeleteGlobalRef(env, probeResultClass);
+    compressionResultClass = probeResultClass = NULL;
+}
+
+/**
+ * Pinned Array
+ * Arrays up to criticalMax bytes are pinned with
+ * GetPrimitiveArrayCritical, which hands out the heap copy instead of
+ * duplicating it; no JNI calls may be made until unpinArray() and the
+ * GC can be held off meanwhile, so only bounded work runs pinned.
+ * Larger arrays, encodes above the greedy levels, and patch bases,
+ * whose decode runs as long as the patch header claims, go through
+ * GetByteArrayElements.
+ */
+typedef struct {
+    jbyteArray array;
+    jbyte* ptr;
+    int critical;
+} PinnedArray;
+
+static jbyte* pinArray(
+    JNIEnv* env,
+    jbyteArray array,
+    jsize length,
+    jsize criticalMax,
+    PinnedArray* pin
+) {
+    pin->array = array;
+    pin->critical = length <= criticalMax;
+    pin->ptr = pin->critical
+        ? (jbyte*)(*env)->GetPrimitiveArrayCritical(env, array, NULL)
+        : (*env)->GetByteArrayElements(env, array, NULL);
+    return pin->ptr;
+}
+
+/**
+ * Encode Critical Max
+ * Only the greedy levels compress fast enough to run pinned; lazy
+ * and optimal parses work on a copy.
+ */
+static jsize encodeCriticalMax(jint level) {
+    return level <= JNI_CRITICAL_ENCODE_LEVEL ? JNI_CRITICAL_ENCODE_MAX : 0;
+}
+
+static void unpinArray(JNIEnv* env, PinnedArray* pin, jint mode) {
+    if(!pin->ptr) return;
+    if(pin->critical) {
+        (*env)->ReleasePrimitiveArrayCritical(env, pin->array, pin->ptr, mode);
+    } else {
+        (*env)->ReleaseByteArrayElements(env, pin->array, pin->ptr, mode);
+    }
+    pin->ptr = NULL;
+}
+
+/**
+ * New Compression Result
+ * Takes ownership of compressed; a NULL buffer with COMP_NONE is
+ * stored input and wraps the caller's original array unchanged.
+ */
+static jobject newCompressionResult(
+    JNIEnv* env,
+    jbyteArray original,
+    uint8_t* compressed,
+    size_t compressedSize,
+    CompressionType compType
+) {
+    if(!compressed) {
+        return (*env)->NewObject(env, compressionResultClass, compressionResultInit, original, (jint)COMP_NONE);
+    }
+    jbyteArray compressedArray = (*env)->NewByteArray(env, (jsize)compressedSize);
+    if(!compressedArray) {
+        printf("ERROR JNI: Cannot create WithCompressionResult of size: %zu\n", compressedSize);
+        free(compressed);
+        return NULL;
+    }
+    (*env)->SetByteArrayRegion(env, compressedArray, 0, (jsize)compressedSize, (jbyte*)compressed);
+    free(compressed);
+    return (*env)->NewObject(env, compressionResultClass, compressionResultInit, compressedArray, (jint)compType);
+}
+
 JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_FileCompressor_compress(
     JNIEnv* env,
     jclass cls,
@@ -21,7 +157,8 @@ JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_FileCom
         (uint8_t*)dataPtr,
         dataLen,
         &outputSize,
-        &compType
+        &compType,
+        COMP_LEVEL_DEFAULT
     );
 
     jbyteArray result = (*env)->NewByteArray(env, outputSize);
@@ -34,108 +171,361 @@ JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_FileCom
 }
 
 JNIEXPORT jobject JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_compressNative(
-    JNIEnv *env, jclass clazz, jbyteArray data
+    JNIEnv *env, jclass clazz, jbyteArray data, jint level
 ) {
     jsize len = (*env)->GetArrayLength(env, data);
-    printf("DEBUG JNI: compressNative called, length: %d bytes (%.2f MB)\n", 
-           len, len / (1024.0 * 1024.0));
+    DEBUG_LOG("DEBUG JNI: compressNative called, length: %d bytes (%.2f MB), level: %d\n", 
+           len, len / (1024.0 * 1024.0), (int)level);
     
     if(len <= 0) {
-        printf("INFO JNI: Empty data, returning null\n");
+        DEBUG_LOG("INFO JNI: Empty data, returning null\n");
         return NULL;
     }
     
-    jbyte *buffer = (*env)->GetByteArrayElements(env, data, NULL);
+    PinnedArray pin;
+    jbyte *buffer = pinArray(env, data, len, encodeCriticalMax(level), &pin);
     
     if(!buffer) {
         printf("ERROR JNI: Cannot get byte array elements for size: %d\n", len);
         return NULL;
     }
 
-    printf("DEBUG JNI: Got buffer, starting compression...\n");
+    DEBUG_LOG("DEBUG JNI: Got buffer, starting compression...\n");
     
     size_t compressedSize;
     CompressionType compType;
     uint8_t* compressed = NULL;
     
-    compressed = compress((uint8_t*)buffer, (size_t)len, &compressedSize, &compType);
+    compressed = compressParallelOrStore((uint8_t*)buffer, (size_t)len, &compressedSize, &compType, (int)level);
     
-    (*env)->ReleaseByteArrayElements(env, data, buffer, 0);
+    unpinArray(env, &pin, JNI_ABORT);
     
-    if(!compressed) {
+    if(compressedSize == 0) {
         printf("ERROR JNI: Compression returned NULL\n");
         return NULL;
     }
     
-    printf("DEBUG JNI: Compression result: %d -> %zu bytes, type: %d\n", 
+    DEBUG_LOG("DEBUG JNI: Compression result: %d -> %zu bytes, type: %d\n", 
            len, compressedSize, compType);
+    DEBUG_LOG("DEBUG JNI: Native compression completed successfully\n");
+    
+    return newCompressionResult(env, data, compressed, compressedSize, compType);
+}
 
-    jclass resultClass = (*env)->FindClass(env, "com/app/main/root/app/file_compressor/WithCompressionResult");
-    if(!resultClass) {
-        printf("ERROR JNI: Cannot find WithCompressionResult class\n");
+JNIEXPORT jlong JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_compressIntoNative(
+    JNIEnv* env,
+    jclass cls,
+    jobject src,
+    jint srcPosition,
+    jint srcRemaining,
+    jobject dst,
+    jint dstPosition,
+    jint dstRemaining,
+    jint level
+) {
+    uint8_t* srcPtr = (uint8_t*)(*env)->GetDirectBufferAddress(env, src);
+    uint8_t* dstPtr = (uint8_t*)(*env)->GetDirectBufferAddress(env, dst);
+    jlong srcCapacity = (*env)->GetDirectBufferCapacity(env, src);
+    jlong dstCapacity = (*env)->GetDirectBufferCapacity(env, dst);
+    if(!srcPtr || !dstPtr || srcPosition < 0 || srcRemaining <= 0 || dstPosition < 0 || dstRemaining < 0 ||
+       (jlong)srcPosition + srcRemaining > srcCapacity || (jlong)dstPosition + dstRemaining > dstCapacity) {
+        printf("ERROR JNI: Invalid direct buffers for compressInto\n");
+        return -1;
+    }
+
+    size_t compressedSize = 0;
+    CompressionType compType = COMP_NONE;
+    uint8_t* compressed = compressParallelOrStore(
+        srcPtr + srcPosition,
+        (size_t)srcRemaining,
+        &compressedSize,
+        &compType,
+        (int)level
+    );
+    if(compressedSize == 0) {
+        printf("ERROR JNI: Compression into buffer failed\n");
+        return -1;
+    }
+    if(!compressed) return (jlong)COMP_NONE;
+    if(compressedSize > (size_t)dstRemaining) {
         free(compressed);
+        printf("ERROR JNI: Destination too small: %zu > %d\n", compressedSize, (int)dstRemaining);
+        return -1;
+    }
+
+    memcpy(dstPtr + dstPosition, compressed, compressedSize);
+    free(compressed);
+    return (jlong)compressedSize << 8 | (jlong)compType;
+}
+
+/**
+ * Decompress To Array
+ * Outputs up to JNI_CRITICAL_DECODE_MAX decode straight into the new
+ * Java array with both arrays pinned; anything larger decodes into a
+ * native buffer first so the GC is never held off for long.
+ */
+static jbyteArray decompressToArray(
+    JNIEnv* env,
+    jbyteArray data,
+    jint compressionType,
+    int parallel
+) {
+    jsize dataLen = (*env)->GetArrayLength(env, data);
+    PinnedArray src;
+    jbyte* dataPtr = pinArray(env, data, dataLen, JNI_CRITICAL_DECODE_MAX, &src);
+    if(!dataPtr) {
+        printf("ERROR JNI: Cannot get byte array elements for size: %d\n", dataLen);
         return NULL;
     }
-    
-    jmethodID constructor = (*env)->GetMethodID(env, resultClass, "<init>", "([BI)V");
-    if(!constructor) {
-        printf("ERROR JNI: Cannot find WithCompressionResult constructor\n");
-        free(compressed);
+
+    uint64_t decodedSize = 0;
+    int known = decompressedSize((uint8_t*)dataPtr, (size_t)dataLen, (CompressionType)compressionType, &decodedSize) == 0;
+    unpinArray(env, &src, JNI_ABORT);
+    if(!known) {
+        printf("ERROR JNI: Invalid header for type: %d\n", (int)compressionType);
         return NULL;
     }
-    
-    jbyteArray compressedArray = (*env)->NewByteArray(env, (jsize)compressedSize);
-    if(!compressedArray) {
-        printf("ERROR JNI: Cannot create compressed byte array of size: %zu\n", compressedSize);
-        free(compressed);
+    if(decodedSize > 0x7FFFFFFF) {
+        printf("ERROR JNI: Decompressed size too large for a Java array: %llu\n", (unsigned long long)decodedSize);
         return NULL;
     }
-    
-    (*env)->SetByteArrayRegion(env, compressedArray, 0, (jsize)compressedSize, (jbyte*)compressed);
-    free(compressed);
-    
-    printf("DEBUG JNI: Native compression completed successfully\n");
-    
-    jobject result = (*env)->NewObject(env, resultClass, constructor, compressedArray, (jint)compType);
+
+    if(decodedSize <= JNI_CRITICAL_DECODE_MAX) {
+        jbyteArray result = (*env)->NewByteArray(env, (jsize)decodedSize);
+        if(!result) return NULL;
+
+        PinnedArray dst;
+        size_t outputSize = 0;
+        int status = -1;
+        dataPtr = pinArray(env, data, dataLen, JNI_CRITICAL_DECODE_MAX, &src);
+        jbyte* resultPtr = dataPtr ? pinArray(env, result, (jsize)decodedSize, JNI_CRITICAL_DECODE_MAX, &dst) : NULL;
+        if(resultPtr) {
+            status = decompressInto(
+                (uint8_t*)dataPtr,
+                (size_t)dataLen,
+                (uint8_t*)resultPtr,
+                (size_t)decodedSize,
+                &outputSize,
+                (CompressionType)compressionType
+            );
+            unpinArray(env, &dst, 0);
+        }
+        unpinArray(env, &src, JNI_ABORT);
+
+        if(status != 0 || outputSize != decodedSize) {
+            printf("ERROR JNI: Decompression failed for type: %d\n", (int)compressionType);
+            return NULL;
+        }
+        return result;
+    }
+
+    dataPtr = pinArray(env, data, dataLen, 0, &src);
+    if(!dataPtr) return NULL;
+    size_t outputSize = 0;
+    uint8_t* decompressed = parallel
+        ? decompressParallel((uint8_t*)dataPtr, (size_t)dataLen, &outputSize, (CompressionType)compressionType)
+        : decompress((uint8_t*)dataPtr, (size_t)dataLen, &outputSize, (CompressionType)compressionType);
+    unpinArray(env, &src, JNI_ABORT);
+
+    if(!decompressed) {
+        printf("ERROR JNI: Decompression failed for type: %d\n", (int)compressionType);
+        return NULL;
+    }
+    if(outputSize > 0x7FFFFFFF) {
+        printf("ERROR JNI: Decompressed size too large for a Java array: %zu\n", outputSize);
+        free(decompressed);
+        return NULL;
+    }
+
+    jbyteArray result = (*env)->NewByteArray(env, (jsize)outputSize);
+    if(result) {
+        (*env)->SetByteArrayRegion(env, result, 0, (jsize)outputSize, (jbyte*)decompressed);
+    }
+    free(decompressed);
     return result;
 }
 
-JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_FileCompressor_decompress(
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompress(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint compressionType
+) {
+    return decompressToArray(env, data, compressionType, 0);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressParallelNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint compressionType
+) {
+    return decompressToArray(env, data, compressionType, 1);
+}
+
+JNIEXPORT jlong JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressedSizeNative(
     JNIEnv* env,
     jclass cls,
     jbyteArray data,
     jint compressionType
 ) {
     jsize dataLen = (*env)->GetArrayLength(env, data);
-    jbyte* dataPtr = (*env)->GetByteArrayElements(env, data, NULL);
+    PinnedArray pin;
+    jbyte* dataPtr = pinArray(env, data, dataLen, JNI_CRITICAL_DECODE_MAX, &pin);
+    if(!dataPtr) return -1;
 
-    size_t outputSize;
-    uint8_t* decompressed = decompress(
+    uint64_t decodedSize = 0;
+    int result = decompressedSize((uint8_t*)dataPtr, (size_t)dataLen, (CompressionType)compressionType, &decodedSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    if(result != 0 || decodedSize > INT64_MAX) return -1;
+    return (jlong)decodedSize;
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_verifyNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint compressionType
+) {
+    jsize dataLen = (*env)->GetArrayLength(env, data);
+    PinnedArray pin;
+    jbyte* dataPtr = pinArray(env, data, dataLen, JNI_CRITICAL_DECODE_MAX, &pin);
+    if(!dataPtr) return VERIFY_CORRUPT;
+
+    int result = verifyCompressed((uint8_t*)dataPtr, (size_t)dataLen, (CompressionType)compressionType);
+    unpinArray(env, &pin, JNI_ABORT);
+    return result;
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressIntoNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint compressionType,
+    jobject dst,
+    jint position,
+    jint remaining
+) {
+    uint8_t* dstPtr = (uint8_t*)(*env)->GetDirectBufferAddress(env, dst);
+    jlong capacity = (*env)->GetDirectBufferCapacity(env, dst);
+    if(!dstPtr || position < 0 || remaining < 0 || (jlong)position + remaining > capacity) {
+        printf("ERROR JNI: Invalid direct buffer for decompressInto\n");
+        return -1;
+    }
+
+    jsize dataLen = (*env)->GetArrayLength(env, data);
+    PinnedArray pin;
+    jbyte* dataPtr = pinArray(env, data, dataLen > remaining ? dataLen : remaining, JNI_CRITICAL_DECODE_MAX, &pin);
+    if(!dataPtr) return -1;
+
+    size_t outputSize = 0;
+    int result = decompressInto(
         (uint8_t*)dataPtr,
-        dataLen,
+        (size_t)dataLen,
+        dstPtr + position,
+        (size_t)remaining,
         &outputSize,
         (CompressionType)compressionType
     );
+    unpinArray(env, &pin, JNI_ABORT);
 
-    jbyteArray result = (*env)->NewByteArray(env, outputSize);
-    (*env)->SetByteArrayRegion(env, result, 0, outputSize, (jbyte*)decompressed);
+    if(result != 0) {
+        printf("ERROR JNI: decompressInto failed for type: %d\n", (int)compressionType);
+        return -1;
+    }
+    return (jint)outputSize;
+}
 
-    (*env)->ReleaseByteArrayElements(env, data, dataPtr, JNI_ABORT);
-    free(decompressed);
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressDirectNative(
+    JNIEnv* env,
+    jclass cls,
+    jobject src,
+    jint srcPosition,
+    jint srcRemaining,
+    jint compressionType,
+    jobject dst,
+    jint dstPosition,
+    jint dstRemaining
+) {
+    uint8_t* srcPtr = (uint8_t*)(*env)->GetDirectBufferAddress(env, src);
+    uint8_t* dstPtr = (uint8_t*)(*env)->GetDirectBufferAddress(env, dst);
+    jlong srcCapacity = (*env)->GetDirectBufferCapacity(env, src);
+    jlong dstCapacity = (*env)->GetDirectBufferCapacity(env, dst);
+    if(!srcPtr || !dstPtr || srcPosition < 0 || srcRemaining < 0 || dstPosition < 0 || dstRemaining < 0 ||
+       (jlong)srcPosition + srcRemaining > srcCapacity || (jlong)dstPosition + dstRemaining > dstCapacity) {
+        printf("ERROR JNI: Invalid direct buffers for decompressInto\n");
+        return -1;
+    }
+
+    size_t outputSize = 0;
+    int result = decompressInto(
+        srcPtr + srcPosition,
+        (size_t)srcRemaining,
+        dstPtr + dstPosition,
+        (size_t)dstRemaining,
+        &outputSize,
+        (CompressionType)compressionType
+    );
+    if(result != 0) {
+        printf("ERROR JNI: decompressInto failed for type: %d\n", (int)compressionType);
+        return -1;
+    }
+    return (jint)outputSize;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressRangeNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint compressionType,
+    jlong offset,
+    jint length
+) {
+    if(offset < 0 || length < 0) return NULL;
+
+    jsize dataLen = (*env)->GetArrayLength(env, data);
+    PinnedArray pin;
+    jsize criticalMax = compressionType == COMP_FRAME && length <= JNI_CRITICAL_DECODE_MAX
+        ? JNI_CRITICAL_DECODE_MAX
+        : 0;
+    jbyte* dataPtr = pinArray(env, data, dataLen, criticalMax, &pin);
+    if(!dataPtr) return NULL;
+
+    size_t outputSize = 0;
+    uint8_t* range = decompressRange(
+        (uint8_t*)dataPtr,
+        (size_t)dataLen,
+        &outputSize,
+        (CompressionType)compressionType,
+        (uint64_t)offset,
+        (size_t)length
+    );
+    unpinArray(env, &pin, JNI_ABORT);
+
+    if(!range) {
+        printf("ERROR JNI: Range decompression failed at offset %lld\n", (long long)offset);
+        return NULL;
+    }
 
+    jbyteArray result = (*env)->NewByteArray(env, (jsize)outputSize);
+    if(result) {
+        (*env)->SetByteArrayRegion(env, result, 0, (jsize)outputSize, (jbyte*)range);
+    }
+    free(range);
     return result;
 }
 
-JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_FileCompressor_compressFile(
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_compressFile(
     JNIEnv* env,
     jclass cls,
     jstring inputPath,
-    jstring outputPath
+    jstring outputPath,
+    jint level
 ) {
     const char* inPath = (*env)->GetStringUTFChars(env, inputPath, NULL);
     const char* outPath = (*env)->GetStringUTFChars(env, outputPath, NULL);
 
-    int result = compressFile(inPath, outPath);
+    int result = compressFile(inPath, outPath, (int)level);
 
     (*env)->ReleaseStringUTFChars(env, inputPath, inPath);
     (*env)->ReleaseStringUTFChars(env, outputPath, outPath);
@@ -143,7 +533,7 @@ JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_FileCompresso
     return result;
 }
 
-JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_FileCompressor_decompressFile(
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressFile(
     JNIEnv* env,
     jclass cls,
     jstring inputPath,
@@ -160,3 +550,545 @@ JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_FileCompresso
     return result;
 }
 
+
+
+static jbyteArray drainToArray(JNIEnv* env, CompStream* cs) {
+    size_t pending = csPending(cs);
+    if(pending > 0x7FFFFFFF) return NULL;
+
+    jbyteArray result = (*env)->NewByteArray(env, (jsize)pending);
+    if(!result || pending == 0) return result;
+
+    PinnedArray pin;
+    jbyte* dst = pinArray(env, result, (jsize)pending, JNI_CRITICAL_DECODE_MAX, &pin);
+    if(!dst) return NULL;
+    csDrain(cs, (uint8_t*)dst, pending);
+    unpinArray(env, &pin, 0);
+    return result;
+}
+
+JNIEXPORT jlong JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_streamCreate(
+    JNIEnv* env,
+    jclass cls,
+    jint level,
+    jboolean seekable
+) {
+    CompStream* cs = seekable ? csCreateSeekable((int)level) : csCreate((int)level);
+    if(!cs) printf("ERROR JNI: Cannot create stream context\n");
+    return (jlong)(intptr_t)cs;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_streamUpdate(
+    JNIEnv* env,
+    jclass cls,
+    jlong handle,
+    jbyteArray data,
+    jint length
+) {
+    CompStream* cs = (CompStream*)(intptr_t)handle;
+    if(!cs || length < 0 || length > (*env)->GetArrayLength(env, data)) return NULL;
+
+    PinnedArray pin;
+    jbyte* buffer = pinArray(env, data, length, 0, &pin);
+    if(!buffer) return NULL;
+    int result = csUpdate(cs, (uint8_t*)buffer, (size_t)length);
+    unpinArray(env, &pin, JNI_ABORT);
+
+    if(result != 0) {
+        printf("ERROR JNI: Stream update failed\n");
+        return NULL;
+    }
+    return drainToArray(env, cs);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_streamFinish(
+    JNIEnv* env,
+    jclass cls,
+    jlong handle
+) {
+    CompStream* cs = (CompStream*)(intptr_t)handle;
+    if(!cs || csFinish(cs) != 0) {
+        printf("ERROR JNI: Stream finish failed\n");
+        return NULL;
+    }
+    return drainToArray(env, cs);
+}
+
+JNIEXPORT void JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_streamDestroy(
+    JNIEnv* env,
+    jclass cls,
+    jlong handle
+) {
+    csDestroy((CompStream*)(intptr_t)handle);
+}
+
+JNIEXPORT jobject JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_probeNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint length
+) {
+    if(length < 0 || length > (*env)->GetArrayLength(env, data)) return NULL;
+
+    jsize sampleSize = length < PROBE_MAX_BYTES ? length : PROBE_MAX_BYTES;
+    PinnedArray pin;
+    jbyte* sample = pinArray(env, data, sampleSize, PROBE_MAX_BYTES, &pin);
+    if(!sample && sampleSize > 0) return NULL;
+    ProbeResult probe = probeCompressibility((uint8_t*)sample, (size_t)sampleSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    if(!probe.compress) statsSkip(SKIP_PROBE);
+
+    return (*env)->NewObject(
+        env,
+        probeResultClass,
+        probeResultInit,
+        probe.compress ? JNI_TRUE : JNI_FALSE,
+        (jdouble)probe.predictedRatio
+    );
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_dictInit(
+    JNIEnv* env,
+    jclass cls,
+    jstring directory
+) {
+    const char* path = (*env)->GetStringUTFChars(env, directory, NULL);
+    if(!path) return -1;
+    int loaded = dictLoadDirectory(path);
+    (*env)->ReleaseStringUTFChars(env, directory, path);
+    return loaded;
+}
+
+JNIEXPORT jboolean JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_dictAvailable(
+    JNIEnv* env,
+    jclass cls,
+    jint family
+) {
+    return dictForFamily((int)family) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_dictVersionCount(
+    JNIEnv* env,
+    jclass cls,
+    jint family
+) {
+    return (jint)dictVersionCount((int)family);
+}
+
+JNIEXPORT jobject JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_compressWithDictionaryNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint level,
+    jint family
+) {
+    jsize len = (*env)->GetArrayLength(env, data);
+    if(len <= 0) return NULL;
+    PinnedArray pin;
+    jbyte* buffer = pinArray(env, data, len, encodeCriticalMax(level), &pin);
+    if(!buffer) return NULL;
+
+    size_t compressedSize = 0;
+    CompressionType compType = COMP_NONE;
+    uint8_t* compressed = compressWithDictionary(
+        (uint8_t*)buffer,
+        (size_t)len,
+        &compressedSize,
+        &compType,
+        (int)level,
+        (int)family
+    );
+    unpinArray(env, &pin, JNI_ABORT);
+
+    if(compressedSize == 0) {
+        printf("ERROR JNI: Dictionary compression returned NULL\n");
+        return NULL;
+    }
+    return newCompressionResult(env, data, compressed, compressedSize, compType);
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_trainDictionaryNative(
+    JNIEnv* env,
+    jclass cls,
+    jobjectArray samples,
+    jint family,
+    jstring directory
+) {
+    jsize count = (*env)->GetArrayLength(env, samples);
+    size_t* sizes = malloc(sizeof(size_t) * (count > 0 ? (size_t)count : 1));
+    size_t total = 0;
+    for(jsize i = 0; sizes && i < count; i++) {
+        jbyteArray sample = (jbyteArray)(*env)->GetObjectArrayElement(env, samples, i);
+        sizes[i] = sample ? (size_t)(*env)->GetArrayLength(env, sample) : 0;
+        total += sizes[i];
+        (*env)->DeleteLocalRef(env, sample);
+    }
+
+    uint8_t* joined = malloc(total ? total : 1);
+    uint8_t* dict = malloc(DICT_DEFAULT_SIZE);
+    jint id = -1;
+    if(!sizes || !joined || !dict) goto done;
+
+    size_t offset = 0;
+    for(jsize i = 0; i < count; i++) {
+        jbyteArray sample = (jbyteArray)(*env)->GetObjectArrayElement(env, samples, i);
+        if(sample) (*env)->GetByteArrayRegion(env, sample, 0, (jsize)sizes[i], (jbyte*)joined + offset);
+        offset += sizes[i];
+        (*env)->DeleteLocalRef(env, sample);
+    }
+
+    size_t dictSize = dictTrain(joined, sizes, (size_t)count, dict, DICT_DEFAULT_SIZE);
+    const char* path = dictSize ? (*env)->GetStringUTFChars(env, directory, NULL) : NULL;
+    const Dictionary* trained = path ? dictPublish(path, (int)family, dict, dictSize) : NULL;
+    if(path) (*env)->ReleaseStringUTFChars(env, directory, path);
+    if(!trained) {
+        printf("ERROR JNI: Dictionary training failed for family %d\n", (int)family);
+        goto done;
+    }
+    id = (jint)trained->id;
+
+done:
+    free(sizes);
+    free(joined);
+    free(dict);
+    return id;
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_getCompressorStatsNative(
+    JNIEnv* env,
+    jclass cls
+) {
+    uint64_t snapshot[STATS_SNAPSHOT_SIZE];
+    size_t count = statsSnapshot(snapshot, STATS_SNAPSHOT_SIZE);
+    jlongArray result = (*env)->NewLongArray(env, (jsize)count);
+    if(result) {
+        (*env)->SetLongArrayRegion(env, result, 0, (jsize)count, (const jlong*)snapshot);
+    }
+    return result;
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_verifyFileNative(
+    JNIEnv* env,
+    jclass cls,
+    jstring inputPath
+) {
+    const char* inPath = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    int result = verifyFile(inPath);
+    (*env)->ReleaseStringUTFChars(env, inputPath, inPath);
+    return result;
+}
+
+/**
+ * Chunk Records
+ * Packs chunks into a byte[] of CDC_RECORD_SIZE records, taking
+ * ownership of chunks.
+ */
+static jbyteArray newChunkRecords(JNIEnv* env, CdcChunk* chunks, size_t chunkCount) {
+    if(!chunks) return NULL;
+    if(chunkCount > 0x7FFFFFFF / CDC_RECORD_SIZE) {
+        free(chunks);
+        return NULL;
+    }
+    jsize recordsSize = (jsize)(chunkCount * CDC_RECORD_SIZE);
+    jbyteArray result = (*env)->NewByteArray(env, recordsSize);
+    if(result && recordsSize > 0) {
+        PinnedArray pin;
+        jbyte* dst = pinArray(env, result, recordsSize, JNI_CRITICAL_DECODE_MAX, &pin);
+        if(dst) {
+            cdcWriteRecords((uint8_t*)dst, chunks, chunkCount);
+            unpinArray(env, &pin, 0);
+        } else {
+            result = NULL;
+        }
+    }
+    free(chunks);
+    return result;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_chunkNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint minSize,
+    jint avgSize,
+    jint maxSize
+) {
+    CdcParams params;
+    if(minSize < 0 || avgSize < 0 || maxSize < 0 ||
+        cdcParamsInit(&params, (size_t)minSize, (size_t)avgSize, (size_t)maxSize) != 0) {
+        return NULL;
+    }
+
+    jsize len = (*env)->GetArrayLength(env, data);
+    PinnedArray pin;
+    jbyte* buffer = pinArray(env, data, len, JNI_CRITICAL_ENCODE_MAX, &pin);
+    if(!buffer) return NULL;
+
+    size_t chunkCount = 0;
+    CdcChunk* chunks = cdcChunk((uint8_t*)buffer, (size_t)len, &params, &chunkCount);
+    unpinArray(env, &pin, JNI_ABORT);
+    return newChunkRecords(env, chunks, chunkCount);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_chunkFileNative(
+    JNIEnv* env,
+    jclass cls,
+    jstring inputPath,
+    jint minSize,
+    jint avgSize,
+    jint maxSize
+) {
+    CdcParams params;
+    if(minSize < 0 || avgSize < 0 || maxSize < 0 ||
+        cdcParamsInit(&params, (size_t)minSize, (size_t)avgSize, (size_t)maxSize) != 0) {
+        return NULL;
+    }
+
+    const char* inPath = (*env)->GetStringUTFChars(env, inputPath, NULL);
+    if(!inPath) return NULL;
+    size_t chunkCount = 0;
+    CdcChunk* chunks = cdcChunkFile(inPath, &params, &chunkCount);
+    (*env)->ReleaseStringUTFChars(env, inputPath, inPath);
+    return newChunkRecords(env, chunks, chunkCount);
+}
+
+/**
+ * Copy Array
+ * Heap copy of a small array such as a signature or delta, so the
+ * large buffer it is used with can be pinned on its own.
+ */
+static uint8_t* copyArray(JNIEnv* env, jbyteArray array, size_t* size) {
+    jsize len = (*env)->GetArrayLength(env, array);
+    uint8_t* copy = malloc(len > 0 ? (size_t)len : 1);
+    if(!copy) return NULL;
+    (*env)->GetByteArrayRegion(env, array, 0, len, (jbyte*)copy);
+    *size = (size_t)len;
+    return copy;
+}
+
+/**
+ * Owned Array
+ * byte[] copy of buffer, which is freed either way.
+ */
+static jbyteArray newOwnedArray(JNIEnv* env, uint8_t* buffer, size_t size) {
+    if(!buffer) return NULL;
+    jbyteArray result = size <= 0x7FFFFFFF ? (*env)->NewByteArray(env, (jsize)size) : NULL;
+    if(result) {
+        (*env)->SetByteArrayRegion(env, result, 0, (jsize)size, (jbyte*)buffer);
+    }
+    free(buffer);
+    return result;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_signatureNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray base,
+    jint blockSize
+) {
+    if(blockSize < 0) return NULL;
+    jsize len = (*env)->GetArrayLength(env, base);
+    PinnedArray pin;
+    jbyte* basePtr = pinArray(env, base, len, JNI_CRITICAL_ENCODE_MAX, &pin);
+    if(!basePtr) return NULL;
+
+    size_t sigSize = 0;
+    uint8_t* sig = rsSignature((uint8_t*)basePtr, (size_t)len, (uint32_t)blockSize, &sigSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    return newOwnedArray(env, sig, sigSize);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_signatureFileNative(
+    JNIEnv* env,
+    jclass cls,
+    jstring basePath,
+    jint blockSize
+) {
+    if(blockSize < 0) return NULL;
+    const char* path = (*env)->GetStringUTFChars(env, basePath, NULL);
+    if(!path) return NULL;
+    size_t sigSize = 0;
+    uint8_t* sig = rsSignatureFile(path, (uint32_t)blockSize, &sigSize);
+    (*env)->ReleaseStringUTFChars(env, basePath, path);
+    return newOwnedArray(env, sig, sigSize);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_deltaNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray signature,
+    jbyteArray target
+) {
+    size_t sigSize = 0;
+    uint8_t* sig = copyArray(env, signature, &sigSize);
+    if(!sig) return NULL;
+    jsize len = (*env)->GetArrayLength(env, target);
+    PinnedArray pin;
+    jbyte* targetPtr = pinArray(env, target, len, JNI_CRITICAL_ENCODE_MAX, &pin);
+    if(!targetPtr) {
+        free(sig);
+        return NULL;
+    }
+
+    size_t deltaSize = 0;
+    uint8_t* delta = rsDelta(sig, sigSize, (uint8_t*)targetPtr, (size_t)len, &deltaSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    free(sig);
+    return newOwnedArray(env, delta, deltaSize);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_deltaFileNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray signature,
+    jstring targetPath
+) {
+    size_t sigSize = 0;
+    uint8_t* sig = copyArray(env, signature, &sigSize);
+    if(!sig) return NULL;
+    const char* path = (*env)->GetStringUTFChars(env, targetPath, NULL);
+    size_t deltaSize = 0;
+    uint8_t* delta = path ? rsDeltaFile(sig, sigSize, path, &deltaSize) : NULL;
+    if(path) (*env)->ReleaseStringUTFChars(env, targetPath, path);
+    free(sig);
+    return newOwnedArray(env, delta, deltaSize);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_patchNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray base,
+    jbyteArray delta
+) {
+    size_t deltaSize = 0;
+    uint8_t* deltaCopy = copyArray(env, delta, &deltaSize);
+    if(!deltaCopy) return NULL;
+    jsize len = (*env)->GetArrayLength(env, base);
+    PinnedArray pin;
+    jbyte* basePtr = pinArray(env, base, len, 0, &pin);
+    if(!basePtr) {
+        free(deltaCopy);
+        return NULL;
+    }
+
+    size_t outputSize = 0;
+    uint8_t* output = rsPatch((uint8_t*)basePtr, (size_t)len, deltaCopy, deltaSize, &outputSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    free(deltaCopy);
+    return newOwnedArray(env, output, outputSize);
+}
+
+JNIEXPORT jint JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_patchFileNative(
+    JNIEnv* env,
+    jclass cls,
+    jstring basePath,
+    jbyteArray delta,
+    jstring outputPath
+) {
+    size_t deltaSize = 0;
+    uint8_t* deltaCopy = copyArray(env, delta, &deltaSize);
+    if(!deltaCopy) return -1;
+    const char* inPath = (*env)->GetStringUTFChars(env, basePath, NULL);
+    const char* outPath = (*env)->GetStringUTFChars(env, outputPath, NULL);
+
+    int result = inPath && outPath ? rsPatchFile(inPath, deltaCopy, deltaSize, outPath) : -1;
+
+    if(inPath) (*env)->ReleaseStringUTFChars(env, basePath, inPath);
+    if(outPath) (*env)->ReleaseStringUTFChars(env, outputPath, outPath);
+    free(deltaCopy);
+    return result;
+}
+
+JNIEXPORT jobject JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_compressWithBaseNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jint level,
+    jbyteArray base,
+    jlong baseVersion,
+    jint baseDepth,
+    jint maxChain,
+    jint maxPercent
+) {
+    jsize len = (*env)->GetArrayLength(env, data);
+    if(len <= 0) return NULL;
+    size_t baseSize = 0;
+    uint8_t* baseCopy = base ? copyArray(env, base, &baseSize) : NULL;
+    if(base && !baseCopy) return NULL;
+    PinnedArray pin;
+    jbyte* buffer = pinArray(env, data, len, 0, &pin);
+    if(!buffer) {
+        free(baseCopy);
+        return NULL;
+    }
+
+    PatchPolicy policy;
+    policy.maxChain = (int)maxChain;
+    policy.maxPercent = (int)maxPercent;
+    size_t compressedSize = 0;
+    CompressionType compType = COMP_NONE;
+    uint8_t* compressed = compressWithBase(
+        (uint8_t*)buffer,
+        (size_t)len,
+        baseCopy,
+        baseSize,
+        (uint64_t)baseVersion,
+        baseDepth > 0 ? (uint32_t)baseDepth : 0,
+        &policy,
+        &compressedSize,
+        &compType,
+        (int)level
+    );
+    unpinArray(env, &pin, JNI_ABORT);
+    free(baseCopy);
+
+    if(compressedSize == 0) {
+        printf("ERROR JNI: Compression with base returned NULL\n");
+        return NULL;
+    }
+    return newCompressionResult(env, data, compressed, compressedSize, compType);
+}
+
+JNIEXPORT jbyteArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_decompressWithBaseNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data,
+    jbyteArray base
+) {
+    size_t patchSize = 0;
+    uint8_t* patch = copyArray(env, data, &patchSize);
+    if(!patch) return NULL;
+    jsize len = (*env)->GetArrayLength(env, base);
+    PinnedArray pin;
+    jbyte* basePtr = pinArray(env, base, len, 0, &pin);
+    if(!basePtr) {
+        free(patch);
+        return NULL;
+    }
+
+    size_t outputSize = 0;
+    uint8_t* output = patchDecompress(patch, patchSize, (uint8_t*)basePtr, (size_t)len, &outputSize);
+    unpinArray(env, &pin, JNI_ABORT);
+    free(patch);
+    return newOwnedArray(env, output, outputSize);
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_app_main_root_app_file_1compressor_WrapperFileCompressor_patchInfoNative(
+    JNIEnv* env,
+    jclass cls,
+    jbyteArray data
+) {
+    uint8_t header[PATCH_HEADER_SIZE];
+    jsize len = (*env)->GetArrayLength(env, data);
+    if(len < PATCH_HEADER_SIZE) return NULL;
+    (*env)->GetByteArrayRegion(env, data, 0, PATCH_HEADER_SIZE, (jbyte*)header);
+    PatchHeader info;
+    if(patchReadHeader(header, PATCH_HEADER_SIZE, &info) != 0) return NULL;
+
+    jlong values[2] = { (jlong)info.baseVersion, (jlong)info.depth };
+    jlongArray result = (*env)->NewLongArray(env, 2);
+    if(result) {
+        (*env)->SetLongArrayRegion(env, result, 0, 2, values);
+    }
+    return result;
+}
\ No newline at end of file
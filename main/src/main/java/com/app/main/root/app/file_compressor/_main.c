@@ -1,133 +1,387 @@
 #include "_main.h"
 #include "comp.h"
+#include "frame.h"
+#include "comp_stream.h"
+#include "file_io.h"
+#include "bitstream.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
 
+/**
+ * Header Write
+ * Always writes version 2. Returns COMP_HEADER_SIZE.
+ */
+size_t compHeaderWrite(uint8_t* dst, const CompHeader* header) {
+    writeLE32(dst, header->magic);
+    dst[4] = (uint8_t)header->version;
+    dst[5] = (uint8_t)(header->version >> 8);
+    dst[6] = header->compType;
+    dst[7] = header->reserved;
+    writeLE64(dst + 8, header->originalSize);
+    return COMP_HEADER_SIZE;
+}
+
+/**
+ * Header Read
+ * Returns the header size for version 1 or 2, or 0 when data does
+ * not start with a valid header.
+ */
+size_t compHeaderRead(
+    const uint8_t* data,
+    size_t size,
+    CompHeader* header
+) {
+    if(size < COMP_HEADER_SIZE_LEGACY || readLE32(data) != COMP_MAGIC) return 0;
+    header->magic = COMP_MAGIC;
+    header->version = (uint16_t)(data[4] | data[5] << 8);
+    header->compType = data[6];
+    header->reserved = data[7];
+    if(header->version == COMP_HEADER_VERSION_LEGACY) {
+        header->originalSize = readLE32(data + 8);
+        return COMP_HEADER_SIZE_LEGACY;
+    }
+    if(header->version == COMP_HEADER_VERSION && size >= COMP_HEADER_SIZE) {
+        header->originalSize = readLE64(data + 8);
+        return COMP_HEADER_SIZE;
+    }
+    return 0;
+}
+
+static void drainStream(CompStream* cs, FileWriter* out) {
+    for(;;) {
+        size_t available;
+        uint8_t* dst = fwReserve(out, &available);
+        size_t n = csDrain(cs, dst, available);
+        if(n == 0) return;
+        fwCommit(out, n);
+    }
+}
+
 /**
  * Compress
+ * Files that fit one mapping window are compressed whole through
+ * compressParallelOrStore(), which splits them across the thread
+ * pool. Larger ones are mapped a window at a time and streamed
+ * through a CompStream in block-sized slices, draining straight into
+ * the writer's buffer, so memory stays bounded whatever the file
+ * size. Files of STREAM_SEEKABLE_THRESHOLD and above get the seekable
+ * frame, compressed a batch of blocks at a time on the pool, so
+ * ranges can be read back.
  */
-int compressFile(const char* inputPath, const char* outputPath) {
-    FILE* in = fopen(inputPath, "rb");
+int compressFile(const char* inputPath, const char* outputPath, int level) {
+    MappedFile* in = mfOpen(inputPath);
     if(!in) {
         printf("ERROR: Cannot open input file: %s\n", inputPath);
         return -1;
     }
 
-    fseek(in, 0, SEEK_END);
-    size_t fileSize = ftell(in);
-    fseek(in, 0, SEEK_SET);
-
-    uint8_t* data = malloc(fileSize);
-    if(!data) {
-        printf("ERROR: Memory allocation failed for size: %zu\n", fileSize);
-        fclose(in);
-        return -1;
+    uint64_t fileSize = mfSize(in);
+    int whole = fileSize > 0 && fileSize <= FILE_MAP_WINDOW;
+    int seekable = fileSize >= STREAM_SEEKABLE_THRESHOLD;
+    const uint8_t* data = NULL;
+    uint8_t* compressed = NULL;
+    size_t wholeSize = 0;
+    CompressionType wholeType = COMP_NONE;
+    CompStream* cs = NULL;
+    if(whole) {
+        data = mfView(in, 0, (size_t)fileSize);
+        compressed = data ? compressParallelOrStore(data, (size_t)fileSize, &wholeSize, &wholeType, level) : NULL;
+        if(wholeSize == 0) {
+            printf("ERROR: Compression failed\n");
+            mfClose(in);
+            return -3;
+        }
+    } else {
+        cs = seekable ? csCreateSeekable(level) : csCreate(level);
+        if(!cs) {
+            printf("ERROR: Memory allocation failed for stream context\n");
+            mfClose(in);
+            return -1;
+        }
     }
 
-    size_t readSize = fread(data, 1, fileSize, in);
-    fclose(in);
-    
-    if(readSize != fileSize) {
-        printf("ERROR: Read incomplete: %zu != %zu\n", readSize, fileSize);
-        free(data);
-        return -1;
+    FileWriter* out = fwOpen(outputPath);
+    if(!out) {
+        printf("ERROR: Cannot open output file: %s\n", outputPath);
+        free(compressed);
+        csDestroy(cs);
+        mfClose(in);
+        return -2;
     }
 
-    size_t compressedSize;
-    CompressionType compType;
-    uint8_t* compressed = compress(
-        data,
-        fileSize,
-        &compressedSize,
-        &compType
-    );
+    CompHeader header;
+    header.magic = COMP_MAGIC;
+    header.version = COMP_HEADER_VERSION;
+    header.compType = (uint8_t)(whole ? wholeType : seekable ? COMP_FRAME : COMP_STREAM);
+    header.reserved = 0;
+    header.originalSize = fileSize;
+    uint8_t headerBytes[COMP_HEADER_SIZE];
+    fwWrite(out, headerBytes, compHeaderWrite(headerBytes, &header));
+
+    size_t sliceSize = (size_t)1 << STREAM_BLOCK_LOG;
+    int ok = 1;
+    if(whole) ok = fwWrite(out, compressed ? compressed : data, wholeSize) == 0;
+    for(uint64_t offset = 0; !whole && ok && offset < fileSize; offset += FILE_MAP_WINDOW) {
+        size_t windowSize = fileSize - offset < FILE_MAP_WINDOW ? (size_t)(fileSize - offset) : FILE_MAP_WINDOW;
+        const uint8_t* window = mfView(in, offset, windowSize);
+        if(!window) {
+            ok = 0;
+            break;
+        }
+        for(size_t pos = 0; ok && pos < windowSize; pos += sliceSize) {
+            size_t n = windowSize - pos < sliceSize ? windowSize - pos : sliceSize;
+            ok = csUpdate(cs, window + pos, n) == 0;
+            if(ok) drainStream(cs, out);
+        }
+    }
+    if(!whole) {
+        ok = ok && csFinish(cs) == 0;
+        if(ok) drainStream(cs, out);
+    }
+    uint64_t compressedSize = fwWritten(out) - COMP_HEADER_SIZE;
+    free(compressed);
+    mfClose(in);
+    csDestroy(cs);
+    ok = fwClose(out) == 0 && ok;
 
-    if(!compressed) {
+    if(!ok) {
         printf("ERROR: Compression failed\n");
-        free(data);
         return -3;
     }
 
-    CompHeader header;
-    header.magic = COMP_MAGIC;
-    header.version = 0x0001;
-    header.compType = compType;
-    header.reserved = 0;
-    header.originalSize = (uint32_t)fileSize;
+    double ratio = fileSize ? (double)compressedSize / fileSize : 1.0;
+    printf("Compressed %s: %llu -> %llu bytes (%.1f%%)\n",
+           inputPath, (unsigned long long)fileSize, (unsigned long long)compressedSize, ratio * 100);
+    return 0;
+}
 
-    FILE* out = fopen(outputPath, "wb");
-    if(!out) {
-        printf("ERROR: Cannot open output file: %s\n", outputPath);
-        free(data);
-        free(compressed);
-        return -2;
+/**
+ * Open Frame Index
+ * Reads a seekable frame's index from the end of the mapping without
+ * touching its payloads. flags is -1 when the frame has no index, in
+ * which case it must be handled whole.
+ */
+static FrameBlock* openFrameIndex(
+    MappedFile* in,
+    uint64_t frameStart,
+    uint64_t* originalSize,
+    uint32_t* blockCount,
+    int* flags
+) {
+    *flags = -1;
+    uint64_t frameSize = mfSize(in) - frameStart;
+    if(frameSize < FRAME_SEEKABLE_HEADER_SIZE + FRAME_FOOTER_SIZE) return NULL;
+    const uint8_t* head = mfView(in, frameStart, FRAME_SEEKABLE_HEADER_SIZE);
+    if(!head || readLE32(head) != FRAME_MAGIC || head[4] != FRAME_VERSION_SEEKABLE) return NULL;
+    *flags = head[5];
+
+    const uint8_t* footer = mfView(in, mfSize(in) - FRAME_FOOTER_SIZE, FRAME_FOOTER_SIZE);
+    if(!footer || frameReadFooter(footer, originalSize, blockCount) != 0) return NULL;
+    if(*blockCount > frameSize / FRAME_INDEX_ENTRY_SIZE) return NULL;
+
+    size_t tailSize = frameIndexSize(*blockCount, *flags);
+    if(tailSize > frameSize) return NULL;
+    const uint8_t* tail = mfView(in, mfSize(in) - tailSize, tailSize);
+    return tail ? frameParseIndex(tail, *blockCount, *flags, frameSize, originalSize) : NULL;
+}
+
+/**
+ * Map Batch
+ * Maps the payloads of the blocks from first on that decode to at
+ * most FILE_DECODE_BATCH, and fills batch with them rebased onto the
+ * window. Returns the block after the batch, or first on failure.
+ */
+static uint32_t mapBatch(
+    MappedFile* in,
+    uint64_t frameStart,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint32_t first,
+    FrameBlock* batch,
+    const uint8_t** window,
+    size_t* span
+) {
+    *span = 0;
+    uint32_t end = first;
+    while(end < blockCount && blocks[end].originalSize <= FILE_DECODE_BATCH - *span) {
+        *span += blocks[end].originalSize;
+        end++;
     }
+    if(end == first) return first;
 
-    fwrite(&header, sizeof(CompHeader), 1, out);
-    fwrite(compressed, 1, compressedSize, out);
-    fclose(out);
+    const FrameBlock* last = &blocks[end - 1];
+    uint64_t windowSize = last->offset + last->compressedSize - blocks[first].offset;
+    *window = mfView(in, frameStart + blocks[first].offset, (size_t)windowSize);
+    if(!*window) return first;
+    for(uint32_t b = first; b < end; b++) {
+        batch[b - first] = blocks[b];
+        batch[b - first].offset -= blocks[first].offset;
+        batch[b - first].originalOffset -= blocks[first].originalOffset;
+    }
+    return end;
+}
 
-    double ratio = (double)compressedSize / fileSize;
-    printf("Compressed %s: %zu -> %zu bytes (%.1f%%)\n",
-           inputPath, fileSize, compressedSize, ratio * 100);
+/**
+ * Decode Frame File
+ * Decodes a seekable frame a batch of blocks at a time on the shared
+ * pool, so only one batch of input and output is ever resident.
+ * Returns 1 when done, 0 when the frame has no index and must be
+ * decoded whole, or -1 on a corrupt frame.
+ */
+static int decodeFrameFile(
+    MappedFile* in,
+    uint64_t frameStart,
+    FileWriter* out,
+    uint64_t* decodedSize
+) {
+    uint64_t originalSize;
+    uint32_t blockCount;
+    int flags;
+    FrameBlock* blocks = openFrameIndex(in, frameStart, &originalSize, &blockCount, &flags);
+    if(!blocks) return flags < 0 ? 0 : -1;
 
-    free(data);
-    free(compressed);
-    return 0;
+    FrameBlock* batch = malloc(sizeof(FrameBlock) * (blockCount ? blockCount : 1));
+    uint8_t* buffer = malloc(FILE_DECODE_BATCH);
+    int result = batch && buffer ? 1 : -1;
+
+    uint32_t first = 0;
+    while(result == 1 && first < blockCount) {
+        const uint8_t* window = NULL;
+        size_t span = 0;
+        uint32_t end = mapBatch(in, frameStart, blocks, blockCount, first, batch, &window, &span);
+        if(end == first || frameDecodeBlocks(window, batch, end - first, buffer) != 0 ||
+            fwWrite(out, buffer, span) != 0) {
+            result = -1;
+            break;
+        }
+        first = end;
+    }
+    if(result == 1) *decodedSize = originalSize;
+
+    free(blocks);
+    free(batch);
+    free(buffer);
+    return result;
 }
 
 /**
  * Decompress
+ * Seekable frames, which every file above STREAM_SEEKABLE_THRESHOLD
+ * is written as, are decoded a batch of blocks at a time; smaller
+ * and version 1 files are decoded whole from the mapping.
  */
 int decompressFile(const char* inputPath, const char* outputPath) {
-    FILE* in = fopen(inputPath, "rb");
+    MappedFile* in = mfOpen(inputPath);
     if(!in) return -1;
 
+    uint64_t totalSize = mfSize(in);
+    size_t headSize = totalSize < COMP_HEADER_SIZE ? (size_t)totalSize : COMP_HEADER_SIZE;
+    const uint8_t* head = mfView(in, 0, headSize);
     CompHeader header;
-    fread(&header, sizeof(CompHeader), 1, in);
-    if(header.magic != COMP_MAGIC) {
-        fclose(in);
+    size_t headerSize = head ? compHeaderRead(head, headSize, &header) : 0;
+    if(headerSize == 0) {
+        mfClose(in);
         return -2;
     }
+    uint64_t compressedSize = totalSize - headerSize;
 
-    fseek(in, 0, SEEK_END);
-    size_t totalSize = ftell(in);
-    fseek(in, sizeof(CompHeader), SEEK_SET);
-    size_t compressedSize = totalSize - sizeof(CompHeader);
-
-    uint8_t* compressed = malloc(compressedSize);
-    fread(compressed, 1, compressedSize, in);
-    fclose(in);
-
-    size_t decompressedSize;
-    uint8_t* decompressed = decompress(
-        compressed,
-        compressedSize,
-        &decompressedSize,
-        (CompressionType)header.compType
-    );
-    if(decompressedSize != header.originalSize) {
-        printf("Warning: Size mismatch! Expected %u, got %zu\n",
-               header.originalSize, decompressedSize);
-    }
-
-    FILE* out = fopen(outputPath, "wb");
+    FileWriter* out = fwOpen(outputPath);
     if(!out) {
-        free(compressed);
-        free(decompressed);
+        mfClose(in);
         return -3;
     }
 
-    fwrite(decompressed, 1, decompressedSize, out);
-    fclose(out);
+    uint64_t decompressedSize = 0;
+    int framed = header.compType == COMP_FRAME ? decodeFrameFile(in, headerSize, out, &decompressedSize) : 0;
+    if(framed == 0 && compressedSize <= SIZE_MAX) {
+        const uint8_t* compressed = mfView(in, headerSize, (size_t)compressedSize);
+        size_t outputSize = 0;
+        uint8_t* decompressed = compressed ? decompressParallel(
+            compressed,
+            (size_t)compressedSize,
+            &outputSize,
+            (CompressionType)header.compType
+        ) : NULL;
+        if(decompressed && fwWrite(out, decompressed, outputSize) == 0) {
+            decompressedSize = outputSize;
+            framed = 1;
+        }
+        free(decompressed);
+    }
+    mfClose(in);
+    int written = fwClose(out) == 0;
 
-    printf("Decompressed %s: %zu -> %zu bytes\n",
-           inputPath, compressedSize, decompressedSize);
+    if(framed != 1 || !written) {
+        printf("ERROR: Decompression failed\n");
+        return -4;
+    }
+    uint64_t decoded = header.version == COMP_HEADER_VERSION_LEGACY
+        ? (uint32_t)decompressedSize
+        : decompressedSize;
+    if(decoded != header.originalSize) {
+        printf("ERROR: Size mismatch! Expected %llu, got %llu\n",
+               (unsigned long long)header.originalSize, (unsigned long long)decompressedSize);
+        return -5;
+    }
 
-    free(compressed);
-    free(decompressed);
+    printf("Decompressed %s: %llu -> %llu bytes\n",
+           inputPath, (unsigned long long)compressedSize, (unsigned long long)decompressedSize);
     return 0;
+}
+
+/**
+ * Verify
+ * Checks a compressed file's checksums without decoding it or
+ * writing anything; seekable frames are read a batch at a time.
+ * Returns VERIFY_OK, VERIFY_UNCHECKED when the file carries none,
+ * VERIFY_CORRUPT, or -2 when it cannot be opened.
+ */
+int verifyFile(const char* inputPath) {
+    MappedFile* in = mfOpen(inputPath);
+    if(!in) return -2;
+
+    uint64_t totalSize = mfSize(in);
+    size_t headSize = totalSize < COMP_HEADER_SIZE ? (size_t)totalSize : COMP_HEADER_SIZE;
+    const uint8_t* head = mfView(in, 0, headSize);
+    CompHeader header;
+    size_t headerSize = head ? compHeaderRead(head, headSize, &header) : 0;
+    if(headerSize == 0) {
+        mfClose(in);
+        return VERIFY_CORRUPT;
+    }
+
+    uint64_t originalSize;
+    uint32_t blockCount = 0;
+    int flags = -1;
+    FrameBlock* blocks = header.compType == COMP_FRAME
+        ? openFrameIndex(in, headerSize, &originalSize, &blockCount, &flags)
+        : NULL;
+    int result;
+    if(blocks) {
+        FrameBlock* batch = malloc(sizeof(FrameBlock) * (blockCount ? blockCount : 1));
+        result = !batch ? VERIFY_CORRUPT : (flags & FRAME_FLAG_CHECKSUM) ? VERIFY_OK : VERIFY_UNCHECKED;
+        uint32_t first = 0;
+        while(result == VERIFY_OK && first < blockCount) {
+            const uint8_t* window = NULL;
+            size_t span = 0;
+            uint32_t end = mapBatch(in, headerSize, blocks, blockCount, first, batch, &window, &span);
+            if(end == first) result = VERIFY_CORRUPT;
+            else result = frameVerifyBlocks(window, batch, end - first);
+            first = end;
+        }
+        free(batch);
+        free(blocks);
+    } else if(flags >= 0 || totalSize - headerSize > SIZE_MAX) {
+        result = VERIFY_CORRUPT;
+    } else {
+        const uint8_t* compressed = mfView(in, headerSize, (size_t)(totalSize - headerSize));
+        result = compressed
+            ? verifyCompressed(compressed, (size_t)(totalSize - headerSize), (CompressionType)header.compType)
+            : VERIFY_CORRUPT;
+    }
+    mfClose(in);
+    return result;
 }
\ No newline at end of file
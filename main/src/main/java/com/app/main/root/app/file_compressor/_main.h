@@ -1,15 +1,33 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 #define COMP_MAGIC 0x434D5052
+#define COMP_HEADER_VERSION 2
+#define COMP_HEADER_VERSION_LEGACY 1
+#define COMP_HEADER_SIZE 16
+#define COMP_HEADER_SIZE_LEGACY 12
+#define FILE_DECODE_BATCH ((size_t)16 << 20)
 
+/**
+ * File header, little endian: u32 magic, u16 version, u8 type,
+ * u8 reserved, then the original size as a u64 in version 2. Version
+ * 1 files carry a u32 size there and are still read.
+ */
 typedef struct {
     uint32_t magic;
     uint16_t version;
     uint8_t compType;
     uint8_t reserved;
-    uint32_t originalSize;
+    uint64_t originalSize;
 } CompHeader;
 
-int compressFile(const char* inputPath, const char* outputPath);
-int decompressFile(const char* inputPath, const char* outputPath);
\ No newline at end of file
+size_t compHeaderWrite(uint8_t* dst, const CompHeader* header);
+size_t compHeaderRead(
+    const uint8_t* data,
+    size_t size,
+    CompHeader* header
+);
+int compressFile(const char* inputPath, const char* outputPath, int level);
+int decompressFile(const char* inputPath, const char* outputPath);
+int verifyFile(const char* inputPath);
\ No newline at end of file
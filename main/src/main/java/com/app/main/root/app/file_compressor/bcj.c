@@ -0,0 +1,163 @@
+#include "bcj.h"
+#include "bitstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Platform-specific includes and types
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define BCJ_SSE2 1
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#define IS_X86_MS_BYTE(b) ((((b) + 1) & 0xFE) == 0)
+
+static inline int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/**
+ * Find Opcode
+ * Next E8 (call) or E9 (jmp) byte at or after pos and before limit;
+ * 16 bytes per compare with SSE2.
+ */
+static size_t findOpcode(const uint8_t* data, size_t pos, size_t limit) {
+#ifdef BCJ_SSE2
+    const __m128i mask = _mm_set1_epi8((char)0xFE);
+    const __m128i opcode = _mm_set1_epi8((char)0xE8);
+    for(; pos + 16 <= limit; pos += 16) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(data + pos)), mask);
+        uint32_t hits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, opcode));
+        if(hits) return pos + lowestBit(hits);
+    }
+#endif
+    for(; pos < limit; pos++) {
+        if((data[pos] & 0xFE) == 0xE8) return pos;
+    }
+    return limit;
+}
+
+/**
+ * x86
+ * E8/E9 rel32 operands whose top byte is 00 or FF are converted.
+ * The mask tracks E8/E9 bytes seen in the previous three positions,
+ * which are likely operand bytes rather than opcodes; it is what
+ * makes the transform invertible, as decode sees the same mask.
+ */
+static void x86Convert(
+    uint8_t* data,
+    size_t size,
+    uint32_t ip,
+    int encoding
+) {
+    if(size < 5) return;
+    size_t limit = size - 4;
+    size_t pos = 0;
+    uint32_t mask = 0;
+    ip += 5;
+
+    for(;;) {
+        size_t found = findOpcode(data, pos, limit);
+        size_t distance = found - pos;
+        pos = found;
+        if(pos >= limit) return;
+
+        uint8_t* p = data + pos;
+        if(distance > 2) {
+            mask = 0;
+        } else {
+            mask >>= distance;
+            if(mask != 0 && (mask > 4 || mask == 3 || IS_X86_MS_BYTE(p[(mask >> 1) + 1]))) {
+                mask = (mask >> 1) | 4;
+                pos++;
+                continue;
+            }
+        }
+
+        if(!IS_X86_MS_BYTE(p[4])) {
+            mask = (mask >> 1) | 4;
+            pos++;
+            continue;
+        }
+
+        uint32_t value = readLE32(p + 1);
+        uint32_t cur = ip + (uint32_t)pos;
+        value = encoding ? value + cur : value - cur;
+        if(mask != 0) {
+            unsigned shift = (mask & 6) << 2;
+            if(IS_X86_MS_BYTE((uint8_t)(value >> shift))) {
+                value ^= ((uint32_t)0x100 << shift) - 1;
+                value = encoding ? value + cur : value - cur;
+            }
+            mask = 0;
+        }
+        p[1] = (uint8_t)value;
+        p[2] = (uint8_t)(value >> 8);
+        p[3] = (uint8_t)(value >> 16);
+        p[4] = (uint8_t)(0 - ((value >> 24) & 1));
+        pos += 5;
+    }
+}
+
+void bcjX86Encode(uint8_t* data, size_t size, uint32_t pos) {
+    x86Convert(data, size, pos, 1);
+}
+
+void bcjX86Decode(uint8_t* data, size_t size, uint32_t pos) {
+    x86Convert(data, size, pos, 0);
+}
+
+/**
+ * ARM64
+ * BL immediates (26 bit, in words) and ADRP immediates within
+ * +-512 MB (in pages) are converted; instructions are 4-byte aligned
+ * relative to pos.
+ */
+static void arm64Convert(
+    uint8_t* data,
+    size_t size,
+    uint32_t pos,
+    int encoding
+) {
+    for(size_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t pc = pos + (uint32_t)i;
+        uint32_t instr = readLE32(data + i);
+
+        if((instr >> 26) == 0x25) {
+            uint32_t offset = pc >> 2;
+            if(!encoding) offset = 0U - offset;
+            instr = 0x94000000 | ((instr + offset) & 0x03FFFFFF);
+            writeLE32(data + i, instr);
+        } else if((instr & 0x9F000000) == 0x90000000) {
+            uint32_t src = ((instr >> 29) & 3) | ((instr >> 3) & 0x001FFFFC);
+            if((src + 0x00020000) & 0x001C0000) continue;
+
+            uint32_t offset = pc >> 12;
+            if(!encoding) offset = 0U - offset;
+            uint32_t dest = src + offset;
+            instr &= 0x9000001F;
+            instr |= (dest & 3) << 29;
+            instr |= (dest & 0x0003FFFC) << 3;
+            instr |= (0U - (dest & 0x00020000)) & 0x00E00000;
+            writeLE32(data + i, instr);
+        }
+    }
+}
+
+void bcjArm64Encode(uint8_t* data, size_t size, uint32_t pos) {
+    arm64Convert(data, size, pos, 1);
+}
+
+void bcjArm64Decode(uint8_t* data, size_t size, uint32_t pos) {
+    arm64Convert(data, size, pos, 0);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Branch converters (BCJ).
+ * Relative call and branch targets are rewritten as absolute
+ * addresses, so repeated calls to one function become repeated byte
+ * strings the match finder can use. pos is the stream position of
+ * data[0]; encode and decode must use the same value. Both convert
+ * in place and are exact inverses of each other.
+ */
+void bcjX86Encode(uint8_t* data, size_t size, uint32_t pos);
+void bcjX86Decode(uint8_t* data, size_t size, uint32_t pos);
+void bcjArm64Encode(uint8_t* data, size_t size, uint32_t pos);
+void bcjArm64Decode(uint8_t* data, size_t size, uint32_t pos);
\ No newline at end of file
@@ -0,0 +1,510 @@
+#include "corpus.h"
+#include "../comp.h"
+#include "../frame.h"
+#include "../comp_stream.h"
+#include "../dict.h"
+#include "../thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define BENCH_VERSION 1
+#define BENCH_MIN_TIME 0.5
+#define BENCH_MAX_ITERATIONS 64
+#define BENCH_DICT_RECORD 2048
+#define BENCH_STREAM_SLICE (1024 * 1024)
+
+/**
+ * Mode
+ * One benchmarked entry point. Every CompressionType appears once;
+ * "auto" and "parallel" are compress() and compressParallel(), the
+ * paths uploads actually take; "block" is compressBlock() over the
+ * whole file, reporting the codec the block trial picked. Modes without levels run once with
+ * level 0, FRAME runs once per block size.
+ */
+typedef enum {
+    RUN_CODEC,
+    RUN_NONE,
+    RUN_FRAME,
+    RUN_STREAM,
+    RUN_DICT,
+    RUN_BLOCK,
+    RUN_AUTO,
+    RUN_PARALLEL
+} RunKind;
+
+typedef struct {
+    const char* name;
+    CompressionType type;
+    RunKind kind;
+    int usesLevel;
+} Mode;
+
+static const Mode modes[] = {
+    { "none", COMP_NONE, RUN_NONE, 0 },
+    { "rl", COMP_RL, RUN_CODEC, 0 },
+    { "delta", COMP_DELTA, RUN_CODEC, 0 },
+    { "sw", COMP_SW, RUN_CODEC, 1 },
+    { "bp", COMP_BP, RUN_CODEC, 0 },
+    { "sw2", COMP_SW2, RUN_CODEC, 1 },
+    { "lzh", COMP_LZH, RUN_CODEC, 1 },
+    { "lza", COMP_LZA, RUN_CODEC, 1 },
+    { "frame", COMP_FRAME, RUN_FRAME, 1 },
+    { "stream", COMP_STREAM, RUN_STREAM, 1 },
+    { "filter", COMP_FILTER, RUN_CODEC, 1 },
+    { "dict", COMP_DICT, RUN_DICT, 1 },
+    { "block", COMP_NONE, RUN_BLOCK, 1 },
+    { "auto", COMP_NONE, RUN_AUTO, 1 },
+    { "parallel", COMP_NONE, RUN_PARALLEL, 1 }
+};
+#define MODE_COUNT (int)(sizeof(modes) / sizeof(modes[0]))
+
+typedef struct {
+    size_t size;
+    uint64_t seed;
+    double minTime;
+    int levels[COMP_LEVEL_MAX + 1];
+    int levelCount;
+    const char* modeFilter;
+    const char* corpusFilter;
+    const char* output;
+    const char* corpusDir;
+} Options;
+
+/**
+ * Sample
+ * Compressed output of one run. Dictionary runs compress many small
+ * records, so a sample holds one buffer per record.
+ */
+typedef struct {
+    uint8_t** parts;
+    size_t* partSizes;
+    size_t* originalSizes;
+    CompressionType* types;
+    size_t count;
+    size_t total;
+} Sample;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Peak RSS
+ * VmHWM from /proc, reset before every run through clear_refs so
+ * each result has its own peak; getrusage where that is unavailable,
+ * which only ever grows.
+ */
+static void resetPeakRss(void) {
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if(!f) return;
+    fputs("5", f);
+    fclose(f);
+}
+
+static long readStatusKb(const char* field) {
+    FILE* f = fopen("/proc/self/status", "r");
+    char line[256];
+    long value = -1;
+    size_t length = strlen(field);
+    while(f && fgets(line, sizeof(line), f)) {
+        if(strncmp(line, field, length) == 0) {
+            value = strtol(line + length, NULL, 10);
+            break;
+        }
+    }
+    if(f) fclose(f);
+    return value;
+}
+
+static long peakRssKb(void) {
+    long peak = readStatusKb("VmHWM:");
+    if(peak >= 0) return peak;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void freeSample(Sample* sample) {
+    for(size_t i = 0; sample->parts && i < sample->count; i++) free(sample->parts[i]);
+    free(sample->parts);
+    free(sample->partSizes);
+    free(sample->originalSizes);
+    free(sample->types);
+    memset(sample, 0, sizeof(*sample));
+}
+
+static int allocSample(Sample* sample, size_t count) {
+    memset(sample, 0, sizeof(*sample));
+    sample->parts = calloc(count, sizeof(uint8_t*));
+    sample->partSizes = calloc(count, sizeof(size_t));
+    sample->originalSizes = calloc(count, sizeof(size_t));
+    sample->types = calloc(count, sizeof(CompressionType));
+    sample->count = count;
+    return sample->parts && sample->partSizes && sample->originalSizes && sample->types;
+}
+
+static uint8_t* streamCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    *outputSize = 0;
+    CompStream* cs = csCreate(level);
+    if(!cs) return NULL;
+    int ok = 1;
+    for(size_t pos = 0; ok && pos < size; pos += BENCH_STREAM_SLICE) {
+        size_t length = size - pos < BENCH_STREAM_SLICE ? size - pos : BENCH_STREAM_SLICE;
+        ok = csUpdate(cs, data + pos, length) == 0;
+    }
+    ok = ok && csFinish(cs) == 0;
+    size_t pending = ok ? csPending(cs) : 0;
+    uint8_t* output = ok ? malloc(pending ? pending : 1) : NULL;
+    if(output) *outputSize = csDrain(cs, output, pending);
+    csDestroy(cs);
+    return output;
+}
+
+/**
+ * Compress Once
+ * Fills sample with the output of one mode over one file. Returns 0,
+ * 1 when the mode does not apply to the file, -1 on failure.
+ */
+static int compressOnce(
+    const Mode* mode,
+    const CorpusFile* file,
+    const Dictionary* dict,
+    int level,
+    int blockLog,
+    Sample* sample
+) {
+    if(mode->kind == RUN_DICT) {
+        size_t records = file->size / 2 / BENCH_DICT_RECORD;
+        if(!dict || records == 0 || !allocSample(sample, records)) return dict && records ? -1 : 1;
+        const uint8_t* base = file->data + file->size - records * BENCH_DICT_RECORD;
+        for(size_t r = 0; r < records; r++) {
+            sample->originalSizes[r] = BENCH_DICT_RECORD;
+            sample->types[r] = COMP_DICT;
+            sample->parts[r] = dictCompress(base + r * BENCH_DICT_RECORD, BENCH_DICT_RECORD, &sample->partSizes[r], dict, level);
+            if(!sample->parts[r]) return -1;
+            sample->total += sample->partSizes[r];
+        }
+        return 0;
+    }
+
+    if(!allocSample(sample, 1)) return -1;
+    size_t outputSize = 0;
+    CompressionType type = mode->type;
+    uint8_t* output = NULL;
+    switch(mode->kind) {
+        case RUN_NONE:
+            output = storedCopy(file->data, file->size, &outputSize);
+            break;
+        case RUN_CODEC:
+            output = compressWithType(mode->type, file->data, file->size, &outputSize, level);
+            if(!output && mode->type == COMP_FILTER) return 1;
+            break;
+        case RUN_FRAME:
+            output = frameCompress(file->data, file->size, &outputSize, level, blockLog);
+            break;
+        case RUN_STREAM:
+            output = streamCompress(file->data, file->size, &outputSize, level);
+            break;
+        case RUN_BLOCK:
+            output = compressBlock(file->data, file->size, &outputSize, &type, level);
+            break;
+        case RUN_AUTO:
+            output = compress(file->data, file->size, &outputSize, &type, level);
+            break;
+        case RUN_PARALLEL:
+            output = compressParallel(file->data, file->size, &outputSize, &type, level);
+            break;
+        default:
+            break;
+    }
+    if(!output) return -1;
+    sample->parts[0] = output;
+    sample->partSizes[0] = outputSize;
+    sample->originalSizes[0] = file->size;
+    sample->types[0] = type;
+    sample->total = outputSize;
+    return 0;
+}
+
+/**
+ * Decompress Once
+ * decompressInto() every part into dst; verify compares the result
+ * with the original.
+ */
+static int decompressOnce(
+    const Sample* sample,
+    const uint8_t* original,
+    uint8_t* dst,
+    int verify
+) {
+    size_t offset = 0;
+    for(size_t p = 0; p < sample->count; p++) {
+        size_t outputSize = 0;
+        if(decompressInto(sample->parts[p], sample->partSizes[p], dst + offset,
+                          sample->originalSizes[p], &outputSize, sample->types[p]) != 0 ||
+           outputSize != sample->originalSizes[p]) {
+            return -1;
+        }
+        offset += outputSize;
+    }
+    return verify && memcmp(dst, original, offset) != 0 ? -1 : 0;
+}
+
+/**
+ * Verify Once
+ * verifyCompressed() over every part. Returns 1 when every part
+ * carries checksums and they match.
+ */
+static int verifyOnce(const Sample* sample) {
+    for(size_t p = 0; p < sample->count; p++) {
+        if(verifyCompressed(sample->parts[p], sample->partSizes[p], sample->types[p]) != VERIFY_OK) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Train
+ * Dictionary for a text-like file from its first half, in
+ * BENCH_DICT_RECORD sized records; the second half is what RUN_DICT
+ * measures, so the dictionary never saw it.
+ */
+static const Dictionary* trainDictionary(const CorpusFile* file) {
+    if(!file->dictFamily) return NULL;
+    size_t records = file->size / 2 / BENCH_DICT_RECORD;
+    size_t* sizes = malloc(sizeof(size_t) * (records ? records : 1));
+    uint8_t* dict = malloc(DICT_DEFAULT_SIZE);
+    const Dictionary* registered = NULL;
+    if(sizes && dict && records) {
+        for(size_t r = 0; r < records; r++) sizes[r] = BENCH_DICT_RECORD;
+        size_t dictSize = dictTrain(file->data, sizes, records, dict, DICT_DEFAULT_SIZE);
+        if(dictSize) registered = dictRegister(dictNextId(file->dictFamily), dict, dictSize);
+    }
+    free(sizes);
+    free(dict);
+    return registered;
+}
+
+static void runMode(
+    FILE* out,
+    const Options* options,
+    const Mode* mode,
+    const CorpusFile* file,
+    const Dictionary* dict,
+    int level,
+    int blockLog
+) {
+    uint8_t* dst = malloc(file->size ? file->size : 1);
+    if(!dst) return;
+
+    resetPeakRss();
+    long baseRss = readStatusKb("VmRSS:");
+    Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    double compressBest = 1e30;
+    int iterations = 0;
+    int status = 0;
+    double started = now();
+    while(iterations < BENCH_MAX_ITERATIONS && (iterations == 0 || now() - started < options->minTime)) {
+        freeSample(&sample);
+        double t0 = now();
+        status = compressOnce(mode, file, dict, level, blockLog, &sample);
+        double elapsed = now() - t0;
+        if(status != 0) break;
+        if(elapsed < compressBest) compressBest = elapsed;
+        iterations++;
+    }
+    if(status == 1) {
+        freeSample(&sample);
+        free(dst);
+        return;
+    }
+
+    size_t inputSize = 0;
+    for(size_t p = 0; p < sample.count; p++) inputSize += sample.originalSizes[p];
+    const uint8_t* original = file->data + file->size - inputSize;
+    int ok = status == 0 && decompressOnce(&sample, original, dst, 1) == 0;
+    double decompressBest = 1e30;
+    started = now();
+    for(int i = 0; ok && i < BENCH_MAX_ITERATIONS && (i == 0 || now() - started < options->minTime); i++) {
+        double t0 = now();
+        decompressOnce(&sample, NULL, dst, 0);
+        double elapsed = now() - t0;
+        if(elapsed < decompressBest) decompressBest = elapsed;
+    }
+    int checked = ok && verifyOnce(&sample);
+    double verifyBest = 1e30;
+    started = now();
+    for(int i = 0; checked && i < BENCH_MAX_ITERATIONS && (i == 0 || now() - started < options->minTime); i++) {
+        double t0 = now();
+        verifyOnce(&sample);
+        double elapsed = now() - t0;
+        if(elapsed < verifyBest) verifyBest = elapsed;
+    }
+    long peakRss = peakRssKb();
+
+    int resultType = sample.count ? (int)sample.types[0] : -1;
+    fprintf(out,
+        "{\"corpus\":\"%s\",\"mode\":\"%s\",\"type\":%d,\"level\":%d,\"block_log\":%d,"
+        "\"input\":%zu,\"compressed\":%zu,\"ratio\":%.4f,"
+        "\"compress_mbps\":%.2f,\"decompress_mbps\":%.2f,\"verify_mbps\":%.2f,"
+        "\"peak_rss_kb\":%ld,\"rss_delta_kb\":%ld,\"iterations\":%d,\"ok\":%s}\n",
+        file->name, mode->name, resultType, mode->usesLevel ? level : 0, blockLog,
+        inputSize, sample.total, inputSize ? (double)sample.total / inputSize : 0.0,
+        ok ? inputSize / compressBest / 1e6 : 0.0, ok ? inputSize / decompressBest / 1e6 : 0.0,
+        checked ? sample.total / verifyBest / 1e6 : 0.0,
+        peakRss, baseRss >= 0 && peakRss >= baseRss ? peakRss - baseRss : -1, iterations,
+        ok ? "true" : "false");
+    fflush(out);
+    fprintf(stderr, "%-10s %-8s L%d B%-2d %6.2f%% %9.2f MB/s %9.2f MB/s %s\n",
+        file->name, mode->name, mode->usesLevel ? level : 0, blockLog,
+        inputSize ? 100.0 * sample.total / inputSize : 0.0,
+        ok ? inputSize / compressBest / 1e6 : 0.0, ok ? inputSize / decompressBest / 1e6 : 0.0,
+        ok ? "" : "FAILED");
+
+    freeSample(&sample);
+    free(dst);
+}
+
+static int matches(const char* filter, const char* name) {
+    if(!filter) return 1;
+    size_t length = strlen(name);
+    for(const char* p = filter; *p; ) {
+        const char* end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if(n == length && strncmp(p, name, n) == 0) return 1;
+        if(!end) break;
+        p = end + 1;
+    }
+    return 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --size BYTES       corpus file size (default %d)\n"
+        "  --seed N           corpus seed (default 0x%llx)\n"
+        "  --levels L,L,...   levels to run (default %d..%d)\n"
+        "  --modes M,M,...    none,rl,delta,sw,bp,sw2,lzh,lza,frame,stream,filter,dict,block,\n"
+        "                     auto,parallel\n"
+        "  --corpus C,C,...   text,json,logs,source,pcm,bitmap,random,exe_x86,\n"
+        "                     exe_arm64,samples\n"
+        "  --min-time SEC     minimum timed duration per measurement (default %.1f)\n"
+        "  --out FILE         JSON lines output (default stdout)\n"
+        "  --write-corpus DIR write the corpus files and exit\n",
+        program, CORPUS_DEFAULT_SIZE, (unsigned long long)CORPUS_DEFAULT_SEED,
+        COMP_LEVEL_MIN, COMP_LEVEL_MAX, BENCH_MIN_TIME);
+}
+
+static int parseOptions(int argc, char** argv, Options* options) {
+    memset(options, 0, sizeof(*options));
+    options->size = CORPUS_DEFAULT_SIZE;
+    options->seed = CORPUS_DEFAULT_SEED;
+    options->minTime = BENCH_MIN_TIME;
+    for(int level = COMP_LEVEL_MIN; level <= COMP_LEVEL_MAX; level++) {
+        options->levels[options->levelCount++] = level;
+    }
+
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if(!value) {
+            usage(argv[0]);
+            return -1;
+        }
+        if(strcmp(arg, "--size") == 0) {
+            options->size = (size_t)strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--seed") == 0) {
+            options->seed = strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--min-time") == 0) {
+            options->minTime = strtod(value, NULL);
+        } else if(strcmp(arg, "--modes") == 0) {
+            options->modeFilter = value;
+        } else if(strcmp(arg, "--corpus") == 0) {
+            options->corpusFilter = value;
+        } else if(strcmp(arg, "--out") == 0) {
+            options->output = value;
+        } else if(strcmp(arg, "--write-corpus") == 0) {
+            options->corpusDir = value;
+        } else if(strcmp(arg, "--levels") == 0) {
+            options->levelCount = 0;
+            for(char* p = (char*)value; *p && options->levelCount <= COMP_LEVEL_MAX; ) {
+                int level = (int)strtol(p, &p, 10);
+                if(level < COMP_LEVEL_MIN || level > COMP_LEVEL_MAX) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                options->levels[options->levelCount++] = level;
+                if(*p == ',') p++;
+                else break;
+            }
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    return options->size > 0 && options->levelCount > 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if(parseOptions(argc, argv, &options) != 0) return 2;
+
+    CorpusFile files[CORPUS_MAX_FILES];
+    int fileCount = corpusGenerate(files, CORPUS_MAX_FILES, options.size, options.seed);
+    if(fileCount < 0) {
+        printf("ERROR BENCH: Cannot allocate corpus\n");
+        return 1;
+    }
+    if(options.corpusDir) {
+        int result = corpusWrite(files, fileCount, options.corpusDir);
+        corpusFree(files, fileCount);
+        return result == 0 ? 0 : 1;
+    }
+
+    FILE* out = options.output ? fopen(options.output, "w") : stdout;
+    if(!out) {
+        printf("ERROR BENCH: Cannot open %s\n", options.output);
+        corpusFree(files, fileCount);
+        return 1;
+    }
+    fprintf(out, "{\"bench\":%d,\"seed\":%llu,\"size\":%zu,\"threads\":%d,\"min_time\":%.3f}\n",
+        BENCH_VERSION, (unsigned long long)options.seed, options.size,
+        tpThreadCount(tpShared()) + 1, options.minTime);
+    fprintf(stderr, "threads: %d\n", tpThreadCount(tpShared()) + 1);
+
+    for(int f = 0; f < fileCount; f++) {
+        if(!matches(options.corpusFilter, files[f].name)) continue;
+        const Dictionary* dict = matches(options.modeFilter, "dict") ? trainDictionary(&files[f]) : NULL;
+        for(int m = 0; m < MODE_COUNT; m++) {
+            const Mode* mode = &modes[m];
+            if(!matches(options.modeFilter, mode->name)) continue;
+            int levelCount = mode->usesLevel ? options.levelCount : 1;
+            for(int l = 0; l < levelCount; l++) {
+                int level = mode->usesLevel ? options.levels[l] : COMP_LEVEL_DEFAULT;
+                if(mode->kind != RUN_FRAME) {
+                    runMode(out, &options, mode, &files[f], dict, level, 0);
+                    continue;
+                }
+                for(int blockLog = FRAME_MIN_BLOCK_LOG; blockLog <= FRAME_MAX_BLOCK_LOG; blockLog++) {
+                    runMode(out, &options, mode, &files[f], dict, level, blockLog);
+                }
+            }
+        }
+    }
+
+    if(out != stdout) fclose(out);
+    corpusFree(files, fileCount);
+    return 0;
+}
\ No newline at end of file
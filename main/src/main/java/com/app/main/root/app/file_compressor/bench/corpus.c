@@ -0,0 +1,539 @@
+#include "corpus.h"
+#include "../dict.h"
+#include "../bitstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    uint64_t state;
+} Writer;
+
+static uint64_t next(Writer* w) {
+    uint64_t z = (w->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint32_t below(Writer* w, uint32_t n) {
+    return (uint32_t)((next(w) >> 32) * n >> 32);
+}
+
+/**
+ * Draw
+ * Fills values[i] with below(bound[i]) in order; generators draw
+ * into locals before formatting, as argument evaluation order is
+ * unspecified and would make the corpus compiler-dependent.
+ */
+static void draw(Writer* w, uint32_t* values, const uint32_t* bounds, int count) {
+    for(int i = 0; i < count; i++) values[i] = below(w, bounds[i]);
+}
+
+/**
+ * Zipf
+ * Index in [0, n) skewed towards 0, close enough to word and
+ * identifier frequencies for compression purposes.
+ */
+static uint32_t zipf(Writer* w, uint32_t n) {
+    double u = (double)(next(w) >> 11) / 9007199254740992.0;
+    return (uint32_t)(n * u * u * u);
+}
+
+static int full(const Writer* w) {
+    return w->size >= w->capacity;
+}
+
+static void put(Writer* w, const void* data, size_t length) {
+    size_t room = w->capacity - w->size;
+    if(length > room) length = room;
+    memcpy(w->data + w->size, data, length);
+    w->size += length;
+}
+
+static void putText(Writer* w, const char* text) {
+    put(w, text, strlen(text));
+}
+
+static void putf(Writer* w, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(n > 0) put(w, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+}
+
+static void putByte(Writer* w, uint8_t value) {
+    put(w, &value, 1);
+}
+
+static void putLE16(Writer* w, uint16_t value) {
+    uint8_t b[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    put(w, b, 2);
+}
+
+static void putLE32(Writer* w, uint32_t value) {
+    uint8_t b[4];
+    writeLE32(b, value);
+    put(w, b, 4);
+}
+
+static const char* words[] = {
+    "the", "of", "and", "to", "a", "in", "is", "it", "that", "was", "for", "on", "are", "with",
+    "as", "be", "this", "have", "from", "or", "by", "one", "had", "not", "but", "what", "all",
+    "were", "when", "we", "there", "can", "an", "your", "which", "their", "said", "if", "do",
+    "will", "each", "about", "how", "up", "out", "them", "then", "she", "many", "some", "so",
+    "these", "would", "other", "into", "has", "more", "her", "two", "like", "him", "see", "time",
+    "could", "no", "make", "than", "first", "been", "its", "who", "now", "people", "my", "made",
+    "over", "did", "down", "only", "way", "find", "use", "may", "water", "long", "little",
+    "very", "after", "words", "called", "just", "where", "most", "know", "get", "through",
+    "back", "much", "before", "go", "good", "new", "write", "our", "used", "me", "man", "too",
+    "any", "day", "same", "right", "look", "think", "also", "around", "another", "came",
+    "come", "work", "three", "word", "must", "because", "does", "part", "even", "place",
+    "well", "such", "here", "take", "why", "things", "help", "put", "years", "different",
+    "away", "again", "off", "went", "old", "number", "great", "tell", "men", "say", "small",
+    "every", "found", "still", "between", "name", "should", "home", "big", "give", "air",
+    "line", "set", "own", "under", "read", "last", "never", "us", "left", "end", "along",
+    "while", "might", "next", "sound", "below", "saw", "something", "thought", "both", "few",
+    "those", "always", "looked", "show", "large", "often", "together", "asked", "house",
+    "world", "going", "want", "school", "important", "until", "form", "food", "keep",
+    "children", "feet", "land", "side", "without", "boy", "once", "animals", "life", "enough",
+    "took", "sometimes", "four", "head", "above", "kind", "began", "almost", "live", "page",
+    "got", "earth", "need", "far", "hand", "high", "year", "mother", "light", "parts",
+    "country", "father", "let", "night", "following", "picture", "being", "study", "second",
+    "eyes", "soon", "times", "story", "boys", "since", "white", "days", "ever", "paper",
+    "hard", "near", "sentence", "better", "best", "across", "during", "today", "others"
+};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static const char* names[] = {
+    "alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi", "ivan", "judy",
+    "mallory", "niaj", "olivia", "peggy", "rupert", "sybil", "trent", "victor", "walter", "zoe"
+};
+#define NAME_COUNT (sizeof(names) / sizeof(names[0]))
+
+static void genText(Writer* w) {
+    while(!full(w)) {
+        int sentences = 3 + (int)below(w, 6);
+        for(int s = 0; s < sentences && !full(w); s++) {
+            int length = 6 + (int)below(w, 15);
+            for(int i = 0; i < length; i++) {
+                const char* word = words[zipf(w, WORD_COUNT)];
+                if(i == 0) {
+                    putByte(w, (uint8_t)(word[0] - 'a' + 'A'));
+                    putText(w, word + 1);
+                } else {
+                    putByte(w, ' ');
+                    putText(w, word);
+                }
+                if(i > 2 && i < length - 2 && below(w, 12) == 0) putByte(w, ',');
+            }
+            putText(w, s + 1 < sentences ? ". " : ".");
+        }
+        putText(w, "\n\n");
+    }
+}
+
+static void genJson(Writer* w) {
+    static const char* tags[] = { "alpha", "beta", "prod", "staging", "internal", "archived", "shared" };
+    static const char* plans[] = { "free", "pro", "team", "enterprise" };
+    uint32_t id = 100000;
+    putText(w, "[\n");
+    while(!full(w)) {
+        static const uint32_t bounds[] = { NAME_COUNT, 7, 10000, 1000, 4, 1000, 100, 12, 28, 24, 60, 60 };
+        uint32_t v[12];
+        draw(w, v, bounds, 12);
+        uint32_t plan = zipf(w, 4);
+        uint32_t tag0 = zipf(w, 7);
+        uint32_t tag1 = zipf(w, 7);
+        const char* name = names[v[0]];
+        id += 1 + v[1];
+        putf(w, "  {\"id\": %u, \"user\": \"%s_%u\", \"email\": \"%s.%u@example.com\", ",
+             id, name, v[2], name, v[3]);
+        putf(w, "\"active\": %s, \"plan\": \"%s\", \"score\": %u.%02u, ",
+             v[4] ? "true" : "false", plans[plan], v[5], v[6]);
+        putf(w, "\"tags\": [\"%s\", \"%s\"], \"created\": \"2024-%02u-%02uT%02u:%02u:%02uZ\"},\n",
+             tags[tag0], tags[tag1], 1 + v[7], 1 + v[8], v[9], v[10], v[11]);
+    }
+}
+
+static void genLogs(Writer* w) {
+    static const char* levels[] = { "INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR" };
+    static const char* loggers[] = {
+        "c.a.m.r.a._service.FileService", "c.a.m.r.a._data.FileUploader",
+        "c.a.m.r.a._data.FileDownloader", "c.a.m.r.a._db.CommandQueryManager",
+        "o.s.web.servlet.DispatcherServlet", "c.zaxxer.hikari.pool.HikariPool"
+    };
+    static const char* messages[] = {
+        "Upload complete file_id=%u size=%u ms=%u",
+        "Download served file_id=%u range=0-%u ms=%u",
+        "Compression type=%u ratio=0.%02u ms=%u",
+        "Query GET_FILE_INFO rows=%u ms=%u user_id=%u",
+        "Connection acquired from pool active=%u idle=%u waiting=%u",
+        "Request GET /api/files/%u status=200 bytes=%u ms=%u"
+    };
+    uint32_t ms = 0;
+    while(!full(w)) {
+        static const uint32_t bounds[] = { 900, 10, 500000, 1 << 24, 2000 };
+        uint32_t v[5];
+        draw(w, v, bounds, 5);
+        uint32_t level = zipf(w, 6);
+        uint32_t logger = zipf(w, 6);
+        uint32_t message = zipf(w, 6);
+        ms += v[0];
+        putf(w, "2024-03-12 %02u:%02u:%02u.%03u %s [http-nio-8080-exec-%u] %s - ",
+             (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000,
+             levels[level], 1 + v[1], loggers[logger]);
+        putf(w, messages[message], v[2], v[3], v[4]);
+        putText(w, "\n");
+        if(level == 5) {
+            putText(w, "java.io.IOException: Connection reset by peer\n"
+                     "\tat sun.nio.ch.SocketDispatcher.read0(Native Method)\n"
+                     "\tat sun.nio.ch.SocketDispatcher.read(SocketDispatcher.java:47)\n"
+                     "\tat sun.nio.ch.IOUtil.readIntoNativeBuffer(IOUtil.java:330)\n");
+        }
+    }
+}
+
+static void genSource(Writer* w) {
+    static const char* types[] = { "int", "size_t", "uint8_t*", "const uint8_t*", "uint32_t", "void" };
+    static const char* verbs[] = { "read", "write", "parse", "encode", "decode", "find", "update", "flush" };
+    static const char* nouns[] = { "Block", "Header", "Table", "Buffer", "Stream", "Index", "Match", "Entry" };
+    static const char* vars[] = { "data", "size", "pos", "length", "offset", "count", "value", "op" };
+    while(!full(w)) {
+        static const uint32_t bounds[] = { 8, 8, 8, 8, 8 };
+        uint32_t v[5];
+        const char* type = types[zipf(w, 6)];
+        draw(w, v, bounds, 5);
+        putf(w, "/**\n * %s %s\n */\nstatic %s %s%s(\n    const uint8_t* data,\n    size_t size,\n    size_t* %s\n) {\n",
+             verbs[v[0]], nouns[v[1]], type, verbs[v[2]], nouns[v[3]], vars[v[4]]);
+        int statements = 2 + (int)below(w, 8);
+        for(int s = 0; s < statements; s++) {
+            const char* a = vars[zipf(w, 8)];
+            const char* b = vars[zipf(w, 8)];
+            const char* c = vars[below(w, 8)];
+            uint32_t constant = below(w, 64);
+            switch(below(w, 5)) {
+                case 0: putf(w, "    size_t %s = %s + %u;\n", a, b, constant); break;
+                case 1: putf(w, "    if(%s >= %s) return %s;\n", a, b, strcmp(type, "void") ? "0" : ""); break;
+                case 2: putf(w, "    for(size_t i = 0; i < %s; i++) {\n        %s += data[i];\n    }\n", a, b); break;
+                case 3: putf(w, "    %s = readLE32(data + %s);\n", a, b); break;
+                default: putf(w, "    memcpy(%s, data + %s, %s);\n", a, b, c); break;
+            }
+        }
+        putText(w, strcmp(type, "void") ? "    return 0;\n}\n\n" : "}\n\n");
+    }
+}
+
+/**
+ * PCM
+ * 44.1 kHz 16-bit stereo WAV: a few drifting partials and a little
+ * noise, so the delta filter has something to work with.
+ */
+static void genPcm(Writer* w) {
+    size_t frames = (w->capacity > 44 ? w->capacity - 44 : 0) / 4;
+    putText(w, "RIFF");
+    putLE32(w, (uint32_t)(36 + frames * 4));
+    putText(w, "WAVEfmt ");
+    putLE32(w, 16);
+    putLE16(w, 1);
+    putLE16(w, 2);
+    putLE32(w, 44100);
+    putLE32(w, 44100 * 4);
+    putLE16(w, 4);
+    putLE16(w, 16);
+    putText(w, "data");
+    putLE32(w, (uint32_t)(frames * 4));
+
+    double phase[3] = { 0, 0, 0 };
+    double base[3] = { 220.0, 330.0, 440.0 };
+    for(size_t f = 0; f < frames && !full(w); f++) {
+        double sample = 0;
+        for(int p = 0; p < 3; p++) {
+            double freq = base[p] * (1.0 + 0.05 * sin((double)f / 88200.0 * (p + 1)));
+            phase[p] += 2.0 * M_PI * freq / 44100.0;
+            sample += sin(phase[p]) * (6000.0 / (p + 1));
+        }
+        int noise = (int)below(w, 64) - 32;
+        int left = (int)sample + noise;
+        int right = (int)(sample * 0.8) - noise;
+        putLE16(w, (uint16_t)(int16_t)left);
+        putLE16(w, (uint16_t)(int16_t)right);
+    }
+}
+
+/**
+ * Samples
+ * Headerless little-endian 16-bit sensor readings, a slow random
+ * walk with jitter, for the stride detector rather than a file
+ * header to find.
+ */
+static void genSamples(Writer* w) {
+    int value = 0;
+    while(!full(w)) {
+        value += (int)below(w, 33) - 16;
+        if(value > 20000 || value < -20000) value /= 2;
+        putLE16(w, (uint16_t)(int16_t)(value + (int)below(w, 8)));
+    }
+}
+
+/**
+ * Bitmap
+ * 24-bit BMP of gradients and filled circles with sensor-like noise.
+ */
+static void genBitmap(Writer* w) {
+    uint32_t width = 1024;
+    uint32_t stride = width * 3;
+    uint32_t height = (uint32_t)((w->capacity > 54 ? w->capacity - 54 : 0) / stride);
+    if(height == 0) height = 1;
+    putText(w, "BM");
+    putLE32(w, 54 + stride * height);
+    putLE32(w, 0);
+    putLE32(w, 54);
+    putLE32(w, 40);
+    putLE32(w, width);
+    putLE32(w, height);
+    putLE16(w, 1);
+    putLE16(w, 24);
+    putLE32(w, 0);
+    putLE32(w, stride * height);
+    putLE32(w, 2835);
+    putLE32(w, 2835);
+    putLE32(w, 0);
+    putLE32(w, 0);
+
+    uint32_t cx[8], cy[8], radius[8];
+    uint8_t color[8][3];
+    for(int c = 0; c < 8; c++) {
+        cx[c] = below(w, width);
+        cy[c] = below(w, height);
+        radius[c] = 20 + below(w, 120);
+        for(int k = 0; k < 3; k++) color[c][k] = (uint8_t)below(w, 256);
+    }
+    for(uint32_t y = 0; y < height && !full(w); y++) {
+        for(uint32_t x = 0; x < width; x++) {
+            int rgb[3] = { (int)(x * 255 / width), (int)(y * 255 / height), (int)((x + y) & 0xFF) };
+            for(int c = 0; c < 8; c++) {
+                int dx = (int)x - (int)cx[c];
+                int dy = (int)y - (int)cy[c];
+                if((uint32_t)(dx * dx + dy * dy) < radius[c] * radius[c]) {
+                    for(int k = 0; k < 3; k++) rgb[k] = color[c][k];
+                }
+            }
+            for(int k = 0; k < 3; k++) {
+                int v = rgb[k] + (int)below(w, 5) - 2;
+                putByte(w, (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v));
+            }
+        }
+    }
+}
+
+static void genRandom(Writer* w) {
+    while(!full(w)) {
+        uint8_t b[8];
+        uint64_t v = next(w);
+        for(int i = 0; i < 8; i++) b[i] = (uint8_t)(v >> (i * 8));
+        put(w, b, 8);
+    }
+}
+
+static void putElfHeader(Writer* w, uint16_t machine) {
+    static const uint8_t ident[16] = { 0x7F, 'E', 'L', 'F', 2, 1, 1, 0 };
+    put(w, ident, 16);
+    putLE16(w, 2);
+    putLE16(w, machine);
+    putLE32(w, 1);
+    while(w->size < 64) putByte(w, 0);
+}
+
+/**
+ * Executable Strings
+ * The last fifth of an executable image is a string table.
+ */
+static void putStrings(Writer* w) {
+    while(!full(w)) {
+        uint32_t mangled = below(w, 3);
+        uint32_t first = zipf(w, WORD_COUNT);
+        uint32_t second = zipf(w, WORD_COUNT);
+        putf(w, "%s%s_%s", mangled ? "" : "_Z", words[first], words[second]);
+        putByte(w, 0);
+    }
+}
+
+/**
+ * x86-64
+ * ELF image of functions built from common instruction encodings,
+ * with E8 calls to earlier function entry points so that the BCJ
+ * filter sees realistic relative targets.
+ */
+static void genX86(Writer* w) {
+    static const uint8_t ops[][4] = {
+        { 0x48, 0x8B, 0x45, 0xF8 }, { 0x48, 0x89, 0x7D, 0xE8 }, { 0x8B, 0x45, 0xFC, 0x90 },
+        { 0x48, 0x83, 0xC0, 0x01 }, { 0x48, 0x39, 0xC2, 0x90 }, { 0x31, 0xC0, 0x90, 0x90 },
+        { 0x48, 0x8D, 0x04, 0x07 }, { 0x0F, 0xB6, 0x04, 0x07 }
+    };
+    uint32_t entries[1024];
+    size_t entryCount = 0;
+    size_t codeEnd = w->capacity - w->capacity / 5;
+    putElfHeader(w, 62);
+    while(w->size + 64 < codeEnd) {
+        while(w->size & 15) putByte(w, 0xCC);
+        if(entryCount < 1024) entries[entryCount++] = (uint32_t)w->size;
+        static const uint8_t prologue[] = { 0x55, 0x48, 0x89, 0xE5, 0x48, 0x83, 0xEC };
+        put(w, prologue, sizeof(prologue));
+        putByte(w, (uint8_t)(16 * (1 + below(w, 4))));
+        int body = 4 + (int)below(w, 24);
+        for(int i = 0; i < body && w->size + 16 < codeEnd; i++) {
+            uint32_t kind = below(w, 10);
+            if(kind < 2 && entryCount > 1) {
+                uint32_t target = entries[entryCount - 1 - zipf(w, (uint32_t)entryCount - 1)];
+                putByte(w, 0xE8);
+                putLE32(w, target - (uint32_t)(w->size + 4));
+            } else if(kind == 2) {
+                putByte(w, (uint8_t)(0x70 + below(w, 16)));
+                putByte(w, (uint8_t)below(w, 0x40));
+            } else {
+                put(w, ops[below(w, 8)], 4);
+            }
+        }
+        putByte(w, 0xC9);
+        putByte(w, 0xC3);
+    }
+    while(w->size < codeEnd) putByte(w, 0xCC);
+    putStrings(w);
+}
+
+/**
+ * ARM64
+ * Same layout with fixed-width instructions, BL to earlier entry
+ * points and the odd ADRP.
+ */
+static void genArm64(Writer* w) {
+    static const uint32_t ops[] = {
+        0xF94007E0, 0xF90007E0, 0x91000400, 0xEB01001F, 0x52800000,
+        0xAA0103E0, 0x8B010000, 0x39400000, 0xB9400000, 0x54000001
+    };
+    uint32_t entries[1024];
+    size_t entryCount = 0;
+    size_t codeEnd = (w->capacity - w->capacity / 5) & ~(size_t)3;
+    putElfHeader(w, 183);
+    while(w->size + 64 < codeEnd) {
+        if(entryCount < 1024) entries[entryCount++] = (uint32_t)w->size;
+        putLE32(w, 0xA9BF7BFD);
+        putLE32(w, 0x910003FD);
+        int body = 4 + (int)below(w, 24);
+        for(int i = 0; i < body && w->size + 16 < codeEnd; i++) {
+            uint32_t kind = below(w, 10);
+            if(kind < 2 && entryCount > 1) {
+                uint32_t target = entries[entryCount - 1 - zipf(w, (uint32_t)entryCount - 1)];
+                putLE32(w, 0x94000000 | (((target - (uint32_t)w->size) >> 2) & 0x03FFFFFF));
+            } else if(kind == 2) {
+                uint32_t page = below(w, 64);
+                uint32_t reg = below(w, 8);
+                putLE32(w, 0x90000000 | (page & 3) << 29 | (page >> 2) << 5 | reg);
+            } else {
+                uint32_t op = ops[below(w, 10)];
+                putLE32(w, op | below(w, 8));
+            }
+        }
+        putLE32(w, 0xA8C17BFD);
+        putLE32(w, 0xD65F03C0);
+    }
+    while(w->size < codeEnd) putLE32(w, 0xD503201F);
+    putStrings(w);
+}
+
+typedef struct {
+    const char* name;
+    void (*generate)(Writer* w);
+    int dictFamily;
+} Generator;
+
+static const Generator generators[] = {
+    { "text", genText, DICT_FAMILY_TEXT },
+    { "json", genJson, DICT_FAMILY_JSON },
+    { "logs", genLogs, DICT_FAMILY_TEXT },
+    { "source", genSource, DICT_FAMILY_TEXT },
+    { "pcm", genPcm, 0 },
+    { "bitmap", genBitmap, 0 },
+    { "random", genRandom, 0 },
+    { "exe_x86", genX86, 0 },
+    { "exe_arm64", genArm64, 0 },
+    { "samples", genSamples, 0 }
+};
+
+/**
+ * Generate
+ * One file per generator, each exactly size bytes; each generator
+ * gets its own stream derived from the seed, so adding one does not
+ * change the others. Returns the file count, -1 on allocation failure.
+ */
+int corpusGenerate(
+    CorpusFile* files,
+    int maxFiles,
+    size_t size,
+    uint64_t seed
+) {
+    int count = 0;
+    for(size_t g = 0; g < sizeof(generators) / sizeof(generators[0]) && count < maxFiles; g++) {
+        Writer w;
+        w.data = malloc(size ? size : 1);
+        w.size = 0;
+        w.capacity = size;
+        w.state = seed ^ (0xD1B54A32D192ED03ULL * (g + 1));
+        if(!w.data) {
+            corpusFree(files, count);
+            return -1;
+        }
+        generators[g].generate(&w);
+        while(!full(&w)) putByte(&w, 0);
+
+        files[count].name = generators[g].name;
+        files[count].data = w.data;
+        files[count].size = w.size;
+        files[count].dictFamily = generators[g].dictFamily;
+        count++;
+    }
+    return count;
+}
+
+void corpusFree(CorpusFile* files, int count) {
+    for(int i = 0; i < count; i++) {
+        free(files[i].data);
+        files[i].data = NULL;
+    }
+}
+
+/**
+ * Write
+ * Dumps the corpus as <directory>/<name>.bin for other tools.
+ */
+int corpusWrite(
+    const CorpusFile* files,
+    int count,
+    const char* directory
+) {
+    char path[1024];
+    for(int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/%s.bin", directory, files[i].name);
+        FILE* out = fopen(path, "wb");
+        if(!out) {
+            printf("ERROR BENCH: Cannot open %s\n", path);
+            return -1;
+        }
+        size_t written = fwrite(files[i].data, 1, files[i].size, out);
+        fclose(out);
+        if(written != files[i].size) return -1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define CORPUS_MAX_FILES 16
+#define CORPUS_DEFAULT_SIZE (1024 * 1024)
+#define CORPUS_DEFAULT_SEED 0x5EEDC0DEULL
+
+/**
+ * Synthetic benchmark corpus. Every file is generated from the seed
+ * alone, so the same seed and size give the same files from run to
+ * run; only the PCM partials go through libm. dictFamily is the
+ * DICT_FAMILY_* the file would get from its MIME type, or 0.
+ */
+typedef struct {
+    const char* name;
+    uint8_t* data;
+    size_t size;
+    int dictFamily;
+} CorpusFile;
+
+int corpusGenerate(
+    CorpusFile* files,
+    int maxFiles,
+    size_t size,
+    uint64_t seed
+);
+void corpusFree(CorpusFile* files, int count);
+int corpusWrite(
+    const CorpusFile* files,
+    int count,
+    const char* directory
+);
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "corpus.h"
+#include "../chunker.h"
+#include "../thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <openssl/evp.h>
+
+#define DEDUP_VERSION 1
+#define DEDUP_DEFAULT_SIZE (4 * 1024 * 1024)
+#define DEDUP_DEFAULT_VERSIONS 8
+#define DEDUP_DEFAULT_EDITS 4
+#define DEDUP_MAX_EDIT 256
+#define DEDUP_MIN_TIME 0.5
+#define DEDUP_MAX_ITERATIONS 64
+
+typedef struct {
+    size_t size;
+    uint64_t seed;
+    int versions;
+    int edits;
+    size_t minSize;
+    size_t avgSize;
+    size_t maxSize;
+    double minTime;
+    const char* corpusFilter;
+    const char* output;
+} Options;
+
+/**
+ * Version
+ * One revision of a corpus file. Version 0 is the corpus file itself;
+ * each later one applies a few inserts, deletes and overwrites to the
+ * one before, the way documents and sources change between saves.
+ */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} Version;
+
+/**
+ * Chunk Set
+ * Open-addressed set of chunk hashes; it measures what a store keeping
+ * each unique chunk once would hold.
+ */
+typedef struct {
+    uint8_t (*keys)[CDC_HASH_SIZE];
+    uint8_t* used;
+    size_t mask;
+    size_t uniqueBytes;
+    size_t uniqueCount;
+} ChunkSet;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static size_t randomBelow(uint64_t* state, size_t n) {
+    return n ? (size_t)(nextRandom(state) % n) : 0;
+}
+
+/**
+ * Edit
+ * Next version of prev: edits random inserts, deletes or overwrites of
+ * 1..DEDUP_MAX_EDIT bytes at random positions. Inserted and overwritten
+ * bytes are copied from elsewhere in the file so they look like it.
+ */
+static int editVersion(
+    const Version* prev,
+    Version* next,
+    int edits,
+    uint64_t* state
+) {
+    next->data = malloc(prev->size + (size_t)edits * DEDUP_MAX_EDIT + 1);
+    if(!next->data) return -1;
+    memcpy(next->data, prev->data, prev->size);
+    next->size = prev->size;
+
+    for(int e = 0; e < edits; e++) {
+        int kind = (int)randomBelow(state, 3);
+        size_t length = 1 + randomBelow(state, DEDUP_MAX_EDIT);
+        size_t pos = randomBelow(state, next->size + 1);
+        size_t from = randomBelow(state, next->size + 1);
+        if(length > next->size - from) length = next->size - from;
+        if(kind == 0) {
+            if(from < pos && length > pos - from) length = pos - from;
+            memmove(next->data + pos + length, next->data + pos, next->size - pos);
+            memmove(next->data + pos, next->data + (from >= pos ? from + length : from), length);
+            next->size += length;
+        } else if(kind == 1) {
+            if(length > next->size - pos) length = next->size - pos;
+            memmove(next->data + pos, next->data + pos + length, next->size - pos - length);
+            next->size -= length;
+        } else {
+            if(length > next->size - pos) length = next->size - pos;
+            memmove(next->data + pos, next->data + from, length);
+        }
+    }
+    return 0;
+}
+
+static int setInit(ChunkSet* set, size_t expected) {
+    size_t capacity = 64;
+    while(capacity < expected * 2) capacity *= 2;
+    memset(set, 0, sizeof(*set));
+    set->keys = malloc(sizeof(*set->keys) * capacity);
+    set->used = calloc(capacity, 1);
+    set->mask = capacity - 1;
+    return set->keys && set->used ? 0 : -1;
+}
+
+static void setFree(ChunkSet* set) {
+    free(set->keys);
+    free(set->used);
+    memset(set, 0, sizeof(*set));
+}
+
+static void setAdd(ChunkSet* set, const uint8_t* hash, size_t length) {
+    uint64_t key;
+    memcpy(&key, hash, sizeof(key));
+    for(size_t slot = (size_t)key & set->mask; ; slot = (slot + 1) & set->mask) {
+        if(!set->used[slot]) {
+            set->used[slot] = 1;
+            memcpy(set->keys[slot], hash, CDC_HASH_SIZE);
+            set->uniqueBytes += length;
+            set->uniqueCount++;
+            return;
+        }
+        if(memcmp(set->keys[slot], hash, CDC_HASH_SIZE) == 0) return;
+    }
+}
+
+/**
+ * Content-Defined
+ * Chunks every version and counts the chunks a store would keep.
+ * Returns the chunk total, 0 on failure.
+ */
+static size_t dedupContentDefined(
+    const Version* versions,
+    int count,
+    const CdcParams* params,
+    ChunkSet* set
+) {
+    size_t total = 0;
+    for(int v = 0; v < count; v++) {
+        size_t chunkCount = 0;
+        CdcChunk* chunks = cdcChunk(versions[v].data, versions[v].size, params, &chunkCount);
+        if(!chunks) return 0;
+        for(size_t c = 0; c < chunkCount; c++) setAdd(set, chunks[c].hash, chunks[c].length);
+        total += chunkCount;
+        free(chunks);
+    }
+    return total;
+}
+
+/**
+ * Fixed-Size
+ * Same with blocks of blockSize, the baseline content-defined chunking
+ * has to beat: one inserted byte shifts every block after it.
+ */
+static size_t dedupFixed(
+    const Version* versions,
+    int count,
+    size_t blockSize,
+    ChunkSet* set
+) {
+    size_t total = 0;
+    uint8_t hash[CDC_HASH_SIZE];
+    for(int v = 0; v < count; v++) {
+        for(size_t pos = 0; pos < versions[v].size; pos += blockSize) {
+            size_t length = versions[v].size - pos < blockSize ? versions[v].size - pos : blockSize;
+            if(!EVP_Digest(versions[v].data + pos, length, hash, NULL, EVP_sha256(), NULL)) return 0;
+            setAdd(set, hash, length);
+            total++;
+        }
+    }
+    return total;
+}
+
+static double bestBoundaries(const Version* version, const CdcParams* params, double minTime) {
+    double best = 1e30;
+    double started = now();
+    for(int i = 0; i < DEDUP_MAX_ITERATIONS && (i == 0 || now() - started < minTime); i++) {
+        size_t chunkCount = 0;
+        double t0 = now();
+        uint32_t* lengths = cdcBoundaries(version->data, version->size, params, &chunkCount);
+        double elapsed = now() - t0;
+        if(!lengths) return 0.0;
+        free(lengths);
+        if(elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static double bestChunk(const Version* version, const CdcParams* params, double minTime) {
+    double best = 1e30;
+    double started = now();
+    for(int i = 0; i < DEDUP_MAX_ITERATIONS && (i == 0 || now() - started < minTime); i++) {
+        size_t chunkCount = 0;
+        double t0 = now();
+        CdcChunk* chunks = cdcChunk(version->data, version->size, params, &chunkCount);
+        double elapsed = now() - t0;
+        if(!chunks) return 0.0;
+        free(chunks);
+        if(elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static void runFile(
+    FILE* out,
+    const Options* options,
+    const CdcParams* params,
+    const CorpusFile* file,
+    uint64_t seed
+) {
+    Version* versions = calloc((size_t)options->versions, sizeof(Version));
+    if(!versions) return;
+    versions[0].data = file->data;
+    versions[0].size = file->size;
+    uint64_t state = seed;
+    int built = 1;
+    size_t logical = file->size;
+    while(built < options->versions && editVersion(&versions[built - 1], &versions[built], options->edits, &state) == 0) {
+        logical += versions[built].size;
+        built++;
+    }
+
+    ChunkSet cdcSet;
+    ChunkSet fixedSet;
+    memset(&cdcSet, 0, sizeof(cdcSet));
+    memset(&fixedSet, 0, sizeof(fixedSet));
+    size_t expected = logical / params->minSize + 1;
+    int ok = built == options->versions &&
+        setInit(&cdcSet, expected) == 0 && setInit(&fixedSet, logical / params->avgSize + 1) == 0;
+    size_t cdcChunks = ok ? dedupContentDefined(versions, built, params, &cdcSet) : 0;
+    size_t fixedChunks = ok ? dedupFixed(versions, built, params->avgSize, &fixedSet) : 0;
+    ok = ok && (logical == 0 || (cdcChunks > 0 && fixedChunks > 0));
+    double boundaryBest = ok ? bestBoundaries(&versions[0], params, options->minTime) : 0.0;
+    double chunkBest = ok ? bestChunk(&versions[0], params, options->minTime) : 0.0;
+    ok = ok && boundaryBest > 0.0 && chunkBest > 0.0;
+
+    double cdcRatio = ok && cdcSet.uniqueBytes ? (double)logical / cdcSet.uniqueBytes : 0.0;
+    double fixedRatio = ok && fixedSet.uniqueBytes ? (double)logical / fixedSet.uniqueBytes : 0.0;
+    fprintf(out,
+        "{\"corpus\":\"%s\",\"versions\":%d,\"edits\":%d,\"min\":%zu,\"avg\":%zu,\"max\":%zu,"
+        "\"logical\":%zu,\"cdc_chunks\":%zu,\"cdc_unique\":%zu,\"cdc_ratio\":%.4f,"
+        "\"fixed_chunks\":%zu,\"fixed_unique\":%zu,\"fixed_ratio\":%.4f,"
+        "\"boundary_mbps\":%.2f,\"chunk_mbps\":%.2f,\"ok\":%s}\n",
+        file->name, built, options->edits, params->minSize, params->avgSize, params->maxSize,
+        logical, cdcChunks, ok ? cdcSet.uniqueBytes : 0, cdcRatio,
+        fixedChunks, ok ? fixedSet.uniqueBytes : 0, fixedRatio,
+        ok ? file->size / boundaryBest / 1e6 : 0.0, ok ? file->size / chunkBest / 1e6 : 0.0,
+        ok ? "true" : "false");
+    fflush(out);
+    fprintf(stderr, "%-10s cdc %6.2fx fixed %6.2fx %9.2f MB/s %9.2f MB/s %s\n",
+        file->name, cdcRatio, fixedRatio,
+        ok ? file->size / boundaryBest / 1e6 : 0.0, ok ? file->size / chunkBest / 1e6 : 0.0,
+        ok ? "" : "FAILED");
+
+    setFree(&cdcSet);
+    setFree(&fixedSet);
+    for(int v = 1; v < built; v++) free(versions[v].data);
+    free(versions);
+}
+
+static int matches(const char* filter, const char* name) {
+    if(!filter) return 1;
+    size_t length = strlen(name);
+    for(const char* p = filter; *p; ) {
+        const char* end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if(n == length && strncmp(p, name, n) == 0) return 1;
+        if(!end) break;
+        p = end + 1;
+    }
+    return 0;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --size BYTES       base file size (default %d)\n"
+        "  --seed N           corpus and edit seed (default 0x%llx)\n"
+        "  --versions N       versions per file, base included (default %d)\n"
+        "  --edits N          edits between versions (default %d)\n"
+        "  --min BYTES        minimum chunk size (default %d)\n"
+        "  --avg BYTES        average chunk size, also the fixed block size (default %d)\n"
+        "  --max BYTES        maximum chunk size (default %d)\n"
+        "  --corpus C,C,...   text,json,logs,source,pcm,bitmap,random,exe_x86,exe_arm64\n"
+        "  --min-time SEC     minimum timed duration per measurement (default %.1f)\n"
+        "  --out FILE         JSON lines output (default stdout)\n",
+        program, DEDUP_DEFAULT_SIZE, (unsigned long long)CORPUS_DEFAULT_SEED,
+        DEDUP_DEFAULT_VERSIONS, DEDUP_DEFAULT_EDITS,
+        CDC_MIN_SIZE_DEFAULT, CDC_AVG_SIZE_DEFAULT, CDC_MAX_SIZE_DEFAULT, DEDUP_MIN_TIME);
+}
+
+static int parseOptions(int argc, char** argv, Options* options) {
+    memset(options, 0, sizeof(*options));
+    options->size = DEDUP_DEFAULT_SIZE;
+    options->seed = CORPUS_DEFAULT_SEED;
+    options->versions = DEDUP_DEFAULT_VERSIONS;
+    options->edits = DEDUP_DEFAULT_EDITS;
+    options->minTime = DEDUP_MIN_TIME;
+
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if(!value) {
+            usage(argv[0]);
+            return -1;
+        }
+        if(strcmp(arg, "--size") == 0) {
+            options->size = (size_t)strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--seed") == 0) {
+            options->seed = strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--versions") == 0) {
+            options->versions = (int)strtol(value, NULL, 10);
+        } else if(strcmp(arg, "--edits") == 0) {
+            options->edits = (int)strtol(value, NULL, 10);
+        } else if(strcmp(arg, "--min") == 0) {
+            options->minSize = (size_t)strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--avg") == 0) {
+            options->avgSize = (size_t)strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--max") == 0) {
+            options->maxSize = (size_t)strtoull(value, NULL, 0);
+        } else if(strcmp(arg, "--min-time") == 0) {
+            options->minTime = strtod(value, NULL);
+        } else if(strcmp(arg, "--corpus") == 0) {
+            options->corpusFilter = value;
+        } else if(strcmp(arg, "--out") == 0) {
+            options->output = value;
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    return options->size > 0 && options->versions > 0 && options->edits >= 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if(parseOptions(argc, argv, &options) != 0) return 2;
+    CdcParams params;
+    if(cdcParamsInit(&params, options.minSize, options.avgSize, options.maxSize) != 0) return 2;
+
+    CorpusFile files[CORPUS_MAX_FILES];
+    int fileCount = corpusGenerate(files, CORPUS_MAX_FILES, options.size, options.seed);
+    if(fileCount < 0) {
+        printf("ERROR BENCH: Cannot allocate corpus\n");
+        return 1;
+    }
+
+    FILE* out = options.output ? fopen(options.output, "w") : stdout;
+    if(!out) {
+        printf("ERROR BENCH: Cannot open %s\n", options.output);
+        corpusFree(files, fileCount);
+        return 1;
+    }
+    fprintf(out, "{\"dedup\":%d,\"seed\":%llu,\"size\":%zu,\"threads\":%d,\"min_time\":%.3f}\n",
+        DEDUP_VERSION, (unsigned long long)options.seed, options.size,
+        tpThreadCount(tpShared()) + 1, options.minTime);
+
+    for(int f = 0; f < fileCount; f++) {
+        if(!matches(options.corpusFilter, files[f].name)) continue;
+        runFile(out, &options, &params, &files[f], options.seed ^ (0xA0761D6478BD642FULL * (uint64_t)(f + 1)));
+    }
+
+    if(out != stdout) fclose(out);
+    corpusFree(files, fileCount);
+    return 0;
+}
\ No newline at end of file
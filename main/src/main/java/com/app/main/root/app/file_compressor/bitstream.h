@@ -0,0 +1,214 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * LSB-first bit I/O shared by the entropy coders.
+ * The writer flushes whole bytes as it goes; the reader refills a
+ * 64-bit buffer eight bytes at a time while it can and feeds
+ * zeros past the end, counting them in overrun so the caller can
+ * reject truncated streams.
+ */
+typedef struct {
+    uint8_t* ptr;
+    uint8_t* start;
+    uint8_t* end;
+    uint64_t bits;
+    int count;
+    int overflow;
+} BitWriter;
+
+typedef struct {
+    const uint8_t* ptr;
+    const uint8_t* end;
+    uint64_t bits;
+    int count;
+    size_t overrun;
+} BitReader;
+
+static inline uint32_t readLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void writeLE32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static inline void writeLE64(uint8_t* p, uint64_t value) {
+    writeLE32(p, (uint32_t)value);
+    writeLE32(p + 4, (uint32_t)(value >> 32));
+}
+
+static inline uint64_t readLE64(const uint8_t* p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) |
+        ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+        ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+        ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void bwInit(BitWriter* bw, uint8_t* dst, size_t capacity) {
+    bw->ptr = dst;
+    bw->start = dst;
+    bw->end = dst + capacity;
+    bw->bits = 0;
+    bw->count = 0;
+    bw->overflow = 0;
+}
+
+/**
+ * nbits must be <= 32.
+ */
+static inline void bwPut(BitWriter* bw, uint32_t value, int nbits) {
+    bw->bits |= (uint64_t)value << bw->count;
+    bw->count += nbits;
+    while(bw->count >= 8) {
+        if(bw->ptr < bw->end) *bw->ptr++ = (uint8_t)bw->bits;
+        else bw->overflow = 1;
+        bw->bits >>= 8;
+        bw->count -= 8;
+    }
+}
+
+static inline size_t bwFinish(BitWriter* bw) {
+    if(bw->count > 0) bwPut(bw, 0, 8 - bw->count);
+    return (size_t)(bw->ptr - bw->start);
+}
+
+static inline void brRefill(BitReader* br) {
+    if(br->end - br->ptr >= 8) {
+        br->bits |= readLE64(br->ptr) << br->count;
+        br->ptr += (63 - br->count) >> 3;
+        br->count |= 56;
+        return;
+    }
+    while(br->count <= 56) {
+        uint64_t b = 0;
+        if(br->ptr < br->end) b = *br->ptr++;
+        else br->overrun++;
+        br->bits |= b << br->count;
+        br->count += 8;
+    }
+}
+
+static inline void brInit(BitReader* br, const uint8_t* src, size_t size) {
+    br->ptr = src;
+    br->end = src + size;
+    br->bits = 0;
+    br->count = 0;
+    br->overrun = 0;
+    brRefill(br);
+}
+
+static inline uint32_t brPeek(const BitReader* br, int nbits) {
+    return (uint32_t)(br->bits & (((uint64_t)1 << nbits) - 1));
+}
+
+static inline void brSkip(BitReader* br, int nbits) {
+    br->bits >>= nbits;
+    br->count -= nbits;
+}
+
+/**
+ * nbits must be <= 32 and the buffer refilled beforehand.
+ */
+static inline uint32_t brRead(BitReader* br, int nbits) {
+    uint32_t value = brPeek(br, nbits);
+    brSkip(br, nbits);
+    return value;
+}
+
+/**
+ * True once the reader has consumed bits that were never written.
+ */
+static inline int brOverrun(const BitReader* br) {
+    return br->overrun * 8 > (size_t)br->count;
+}
+
+/**
+ * Backward reader for the ANS coders, which emit symbols in reverse.
+ * The writer finishes the stream with a single 1 bit; reading starts
+ * just below it at the end of the buffer and walks toward the start,
+ * taking the most recently written bits first. The window is the
+ * last (up to) eight bytes before ptr, right-aligned, and consumed
+ * counts bits taken from its top; a short stream is treated as if
+ * padded with already-consumed zero bytes.
+ */
+typedef struct {
+    const uint8_t* start;
+    const uint8_t* ptr;
+    uint64_t bits;
+    int consumed;
+} BitReaderBack;
+
+static inline void brbLoad(BitReaderBack* br) {
+    size_t available = (size_t)(br->ptr - br->start);
+    if(available >= 8) {
+        br->bits = readLE64(br->ptr - 8);
+        return;
+    }
+    br->bits = 0;
+    for(size_t i = 0; i < available; i++) {
+        br->bits |= (uint64_t)br->start[i] << (8 * i);
+    }
+}
+
+/**
+ * Returns 0 if the stream is empty or has no end marker.
+ */
+static inline int brbInit(BitReaderBack* br, const uint8_t* src, size_t size) {
+    br->start = src;
+    br->ptr = src + size;
+    br->consumed = 0;
+    if(size == 0 || src[size - 1] == 0) return 0;
+
+    int marker = 7;
+    while(!(src[size - 1] >> marker)) marker--;
+    size_t available = size < 8 ? size : 8;
+    brbLoad(br);
+    br->consumed = (int)(8 - available) * 8 + 8 - marker;
+    return 1;
+}
+
+/**
+ * Steps the window back over whole consumed bytes; afterwards at
+ * least 57 bits can be read unless the start has been reached.
+ */
+static inline void brbReload(BitReaderBack* br) {
+    size_t window = (size_t)(br->ptr - br->start) < 8 ? (size_t)(br->ptr - br->start) : 8;
+    int skip = br->consumed - (int)(8 - window) * 8;
+    if(skip < 8) return;
+
+    size_t back = (size_t)skip >> 3;
+    size_t limit = (size_t)(br->ptr - br->start) - window;
+    if(back > limit) back = limit;
+    br->ptr -= back;
+    br->consumed -= (int)back * 8;
+    brbLoad(br);
+}
+
+/**
+ * nbits must be <= 57 and the reader reloaded beforehand.
+ */
+static inline uint32_t brbRead(BitReaderBack* br, int nbits) {
+    if(nbits == 0) return 0;
+    uint64_t value = (br->bits << (br->consumed & 63)) >> (64 - nbits);
+    if(br->consumed >= 64) value = 0;
+    br->consumed += nbits;
+    return (uint32_t)value;
+}
+
+/**
+ * True when every bit down to the start of the buffer was read.
+ */
+static inline int brbFinished(const BitReaderBack* br) {
+    return (size_t)(br->ptr - br->start) <= 8 && br->consumed == 64;
+}
+
+static inline int brbOverrun(const BitReaderBack* br) {
+    return br->consumed > 64;
+}
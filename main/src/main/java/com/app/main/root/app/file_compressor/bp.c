@@ -1,18 +1,60 @@
 #include "bp.h"
+#include "varint.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
+#define BP_COUNT_TABLE_MAX (1 << 20)
+#define BP_MIN_MERGES_PER_PASS 256
+
+typedef struct {
+    uint32_t key;
+    uint32_t count;
+} PairCandidate;
+
+static uint32_t pairKey(uint16_t left, uint16_t right) {
+    return ((uint32_t)left << 16) | right;
+}
+
+static uint32_t hashPair(uint32_t key, uint32_t mask) {
+    return (key * 2654435761u >> 7) & mask;
+}
+
+static uint32_t tableSizeFor(size_t entries, uint32_t limit) {
+    uint32_t size = 1024;
+    while(size < limit && size < entries * 2) size <<= 1;
+    return size;
+}
+
+static int compareCandidates(const void* a, const void* b) {
+    const PairCandidate* x = (const PairCandidate*)a;
+    const PairCandidate* y = (const PairCandidate*)b;
+    if(x->count != y->count) return x->count > y->count ? -1 : 1;
+    return x->key < y->key ? -1 : (x->key > y->key ? 1 : 0);
+}
+
 /**
  * Create
  */
 BytePairCompressor* bpCreate(int maxVocabSize) {
+    if(maxVocabSize < 256) maxVocabSize = 256;
+    if(maxVocabSize > BP_MAX_VOCAB) maxVocabSize = BP_MAX_VOCAB;
+
     BytePairCompressor* comp = malloc(sizeof(BytePairCompressor));
-    comp->pairs = malloc(sizeof(BytePair) * maxVocabSize);
+    if(!comp) return NULL;
+    comp->maxPairs = maxVocabSize - 256;
+    comp->pairs = malloc(sizeof(BytePair) * (comp->maxPairs ? comp->maxPairs : 1));
+    comp->passEnds = malloc(sizeof(int) * BP_MAX_PASSES);
     comp->pairCount = 0;
-    comp->maxPairs = maxVocabSize;
-    comp->dict = 0;
+    comp->passCount = 0;
+    comp->dict = NULL;
+    comp->dictLengths = NULL;
+    comp->dictSize = 0;
+    if(!comp->pairs || !comp->passEnds) {
+        bpDestroy(comp);
+        return NULL;
+    }
     return comp;
 }
 
@@ -22,36 +64,156 @@ BytePairCompressor* bpCreate(int maxVocabSize) {
 void bpDestroy(BytePairCompressor* comp) {
     if(comp) {
         free(comp->pairs);
+        free(comp->passEnds);
         free(comp->dict);
+        free(comp->dictLengths);
         free(comp);
     }
 }
 
+/**
+ * Apply Pass
+ * Replaces, left to right, every adjacent pair that is one of this
+ * pass's merges. Returns the new token count.
+ */
+static size_t applyPass(
+    uint16_t* tokens,
+    size_t count,
+    const BytePair* merges,
+    int mergeCount
+) {
+    uint32_t size = tableSizeFor((size_t)mergeCount, BP_MAX_VOCAB * 2);
+    uint32_t mask = size - 1;
+    uint32_t* keys = malloc(sizeof(uint32_t) * size);
+    uint16_t* values = malloc(sizeof(uint16_t) * size);
+    uint8_t* used = calloc(size, 1);
+    if(!keys || !values || !used) {
+        free(keys);
+        free(values);
+        free(used);
+        return count;
+    }
+
+    for(int m = 0; m < mergeCount; m++) {
+        uint32_t key = pairKey(merges[m].pair[0], merges[m].pair[1]);
+        uint32_t h = hashPair(key, mask);
+        while(used[h]) h = (h + 1) & mask;
+        used[h] = 1;
+        keys[h] = key;
+        values[h] = merges[m].token;
+    }
+
+    size_t out = 0;
+    size_t i = 0;
+    while(i + 1 < count) {
+        uint32_t key = pairKey(tokens[i], tokens[i + 1]);
+        uint32_t h = hashPair(key, mask);
+        while(used[h] && keys[h] != key) h = (h + 1) & mask;
+        if(used[h]) {
+            tokens[out++] = values[h];
+            i += 2;
+        } else {
+            tokens[out++] = tokens[i++];
+        }
+    }
+    if(i < count) tokens[out++] = tokens[i];
+
+    free(keys);
+    free(values);
+    free(used);
+    return out;
+}
+
+/**
+ * Count Pairs
+ * Learns the merges for data. Each pass counts adjacent token pairs
+ * in an open-addressed table, merges the most frequent ones (tokens
+ * stay within BP_MAX_TOKEN_LENGTH bytes) and rewrites the stream;
+ * training stops when the vocabulary is full or no pair repeats
+ * often enough to pay for its dictionary entry.
+ */
 void countPairs(
     BytePairCompressor* comp,
     const uint8_t* data,
     size_t size
 ) {
-    int pairCounts[65536] = {0};
-
-    for(size_t i = 0; i < size - 1; i++) {
-        uint16_t pair = (data[i] << 8) | data[i+1];
-        pairCounts[pair]++;
-    }
-    
-    for(int i = 0; i < 65536 && comp->pairCount < comp->maxPairs; i++) {
-        if(pairCounts[i] > 10) {
-            comp->pairs[comp->pairCount].pair[0] = i >> 8;
-            comp->pairs[comp->pairCount].pair[1] = i & 0xFF;
-            comp->pairs[comp->pairCount].token = 256 + comp->pairCount;
-            comp->pairs[comp->pairCount].count = pairCounts[i];
+    comp->pairCount = 0;
+    comp->passCount = 0;
+    if(size < 2 || comp->maxPairs == 0) return;
+
+    uint16_t* tokens = malloc(sizeof(uint16_t) * size);
+    uint8_t* lengths = malloc(BP_MAX_VOCAB);
+    uint32_t tableSize = tableSizeFor(size, BP_COUNT_TABLE_MAX);
+    uint32_t mask = tableSize - 1;
+    uint32_t* keys = malloc(sizeof(uint32_t) * tableSize);
+    uint32_t* counts = malloc(sizeof(uint32_t) * tableSize);
+    PairCandidate* candidates = malloc(sizeof(PairCandidate) * tableSize);
+    if(!tokens || !lengths || !keys || !counts || !candidates) goto done;
+
+    for(size_t i = 0; i < size; i++) tokens[i] = data[i];
+    for(int t = 0; t < 256; t++) lengths[t] = 1;
+    size_t count = size;
+
+    while(comp->passCount < BP_MAX_PASSES && comp->pairCount < comp->maxPairs) {
+        memset(counts, 0, sizeof(uint32_t) * tableSize);
+        uint32_t filled = 0;
+        for(size_t i = 0; i + 1 < count; i++) {
+            uint32_t key = pairKey(tokens[i], tokens[i + 1]);
+            uint32_t h = hashPair(key, mask);
+            while(counts[h] && keys[h] != key) h = (h + 1) & mask;
+            if(counts[h]) {
+                counts[h]++;
+            } else if(filled < tableSize / 4 * 3) {
+                keys[h] = key;
+                counts[h] = 1;
+                filled++;
+            }
+        }
+
+        int candidateCount = 0;
+        for(uint32_t h = 0; h < tableSize; h++) {
+            if(counts[h] < BP_MIN_PAIR_COUNT) continue;
+            uint16_t left = (uint16_t)(keys[h] >> 16);
+            uint16_t right = (uint16_t)keys[h];
+            if(lengths[left] + lengths[right] > BP_MAX_TOKEN_LENGTH) continue;
+            candidates[candidateCount].key = keys[h];
+            candidates[candidateCount].count = counts[h];
+            candidateCount++;
+        }
+        if(candidateCount == 0) break;
+        qsort(candidates, candidateCount, sizeof(PairCandidate), compareCandidates);
+
+        int take = candidateCount / 4;
+        if(take < BP_MIN_MERGES_PER_PASS) take = BP_MIN_MERGES_PER_PASS;
+        if(take > candidateCount) take = candidateCount;
+        if(take > comp->maxPairs - comp->pairCount) take = comp->maxPairs - comp->pairCount;
+
+        int first = comp->pairCount;
+        for(int c = 0; c < take; c++) {
+            BytePair* p = &comp->pairs[comp->pairCount];
+            p->pair[0] = (uint16_t)(candidates[c].key >> 16);
+            p->pair[1] = (uint16_t)candidates[c].key;
+            p->token = (uint16_t)(256 + comp->pairCount);
+            p->count = (int)candidates[c].count;
+            lengths[p->token] = (uint8_t)(lengths[p->pair[0]] + lengths[p->pair[1]]);
             comp->pairCount++;
         }
+        comp->passEnds[comp->passCount++] = comp->pairCount;
+        count = applyPass(tokens, count, comp->pairs + first, take);
     }
+
+done:
+    free(tokens);
+    free(lengths);
+    free(keys);
+    free(counts);
+    free(candidates);
 }
 
 /**
  * Compress
+ * Replays the learned passes over data, then ranks the surviving
+ * tokens by frequency so the common ones take one varint byte.
  */
 uint8_t* bpCompress(
     BytePairCompressor* comp,
@@ -59,41 +221,175 @@ uint8_t* bpCompress(
     size_t size,
     size_t* outputSize
 ) {
-    if(size < 2) {
-        uint8_t* output = malloc(size);
-        memcpy(output, data, size);
-        *outputSize = size;
-        return output;
-    }
-
-    uint8_t* outputBuffer = malloc(size * 2);
-    size_t outIdx = 0;
-
-    for(size_t i = 0; i < size;) {
-        if(i < size - 1) {
-            uint8_t b1 = data[i];
-            uint8_t b2 = data[i+1];
-
-            int found = 0;
-            for(int j = 0; j < comp->pairCount; j++) {
-                if(comp->pairs[j].pair[0] == b1 && comp->pairs[j].pair[1] == b2) {
-                    outputBuffer[outIdx++] = 0xFF;
-                    outputBuffer[outIdx++] = comp->pairs[j].token - 256;
-                    i += 2;
-                    found = 1;
-                    break;
-                }
-            }
-            if(!found) {
-                outputBuffer[outIdx++] = data[i++];
-            }
+    *outputSize = 0;
+    if(size == 0) return NULL;
+
+    uint16_t* tokens = malloc(sizeof(uint16_t) * size);
+    uint32_t* freqs = calloc(BP_MAX_VOCAB, sizeof(uint32_t));
+    uint16_t* rankOf = malloc(sizeof(uint16_t) * BP_MAX_VOCAB);
+    PairCandidate* ranked = malloc(sizeof(PairCandidate) * BP_MAX_VOCAB);
+    uint8_t* output = NULL;
+    if(!tokens || !freqs || !rankOf || !ranked) goto done;
+
+    for(size_t i = 0; i < size; i++) tokens[i] = data[i];
+    size_t count = size;
+    int first = 0;
+    for(int p = 0; p < comp->passCount; p++) {
+        count = applyPass(tokens, count, comp->pairs + first, comp->passEnds[p] - first);
+        first = comp->passEnds[p];
+    }
+
+    for(size_t i = 0; i < count; i++) freqs[tokens[i]]++;
+    int rankCount = 0;
+    for(uint32_t t = 0; t < 256 + (uint32_t)comp->pairCount; t++) {
+        if(!freqs[t]) continue;
+        ranked[rankCount].key = t;
+        ranked[rankCount].count = freqs[t];
+        rankCount++;
+    }
+    qsort(ranked, rankCount, sizeof(PairCandidate), compareCandidates);
+    for(int r = 0; r < rankCount; r++) rankOf[ranked[r].key] = (uint16_t)r;
+
+    size_t total = varintSize(size) + varintSize(comp->pairCount);
+    for(int m = 0; m < comp->pairCount; m++) {
+        total += varintSize(comp->pairs[m].pair[0]) + varintSize(comp->pairs[m].pair[1]);
+    }
+    total += varintSize(rankCount);
+    for(int r = 0; r < rankCount; r++) total += varintSize(ranked[r].key);
+    total += varintSize(count);
+    for(size_t i = 0; i < count; i++) total += varintSize(rankOf[tokens[i]]);
+
+    output = malloc(total);
+    if(!output) goto done;
+
+    uint8_t* op = output;
+    op += varintPut(op, size);
+    op += varintPut(op, comp->pairCount);
+    for(int m = 0; m < comp->pairCount; m++) {
+        op += varintPut(op, comp->pairs[m].pair[0]);
+        op += varintPut(op, comp->pairs[m].pair[1]);
+    }
+    op += varintPut(op, rankCount);
+    for(int r = 0; r < rankCount; r++) op += varintPut(op, ranked[r].key);
+    op += varintPut(op, count);
+    for(size_t i = 0; i < count; i++) op += varintPut(op, rankOf[tokens[i]]);
+    *outputSize = (size_t)(op - output);
+
+done:
+    free(tokens);
+    free(freqs);
+    free(rankOf);
+    free(ranked);
+    return output;
+}
+
+/**
+ * Decompress Into
+ * Rebuilds the merge list from the stream into a direct token table
+ * of BP_MAX_TOKEN_LENGTH-byte expansions, so each symbol is one
+ * lookup and one fixed-size copy. Fails when the decoded size
+ * exceeds capacity.
+ */
+int bpDecompressInto(
+    BytePairCompressor* comp,
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+    uint16_t* rankTokens = NULL;
+    uint64_t decodedSize, mergeCount, rankCount, symbolCount, value;
+    size_t n;
+
+    if(!(n = varintGet(ip, end, &decodedSize)) || decodedSize > capacity) goto corrupt;
+    ip += n;
+    if(!(n = varintGet(ip, end, &mergeCount))) goto corrupt;
+    ip += n;
+    if(mergeCount > BP_MAX_VOCAB - 256) goto corrupt;
+
+    if(!comp->dict) {
+        comp->dict = malloc((size_t)BP_MAX_VOCAB * BP_MAX_TOKEN_LENGTH);
+        comp->dictLengths = malloc(BP_MAX_VOCAB);
+        if(!comp->dict || !comp->dictLengths) goto corrupt;
+    }
+    uint8_t* dict = comp->dict;
+    uint8_t* lengths = comp->dictLengths;
+    for(int t = 0; t < 256; t++) {
+        dict[t * BP_MAX_TOKEN_LENGTH] = (uint8_t)t;
+        lengths[t] = 1;
+    }
+    comp->dictSize = 256;
+
+    for(uint64_t m = 0; m < mergeCount; m++) {
+        uint64_t left, right;
+        if(!(n = varintGet(ip, end, &left))) goto corrupt;
+        ip += n;
+        if(!(n = varintGet(ip, end, &right))) goto corrupt;
+        ip += n;
+        if(left >= (uint64_t)comp->dictSize || right >= (uint64_t)comp->dictSize) goto corrupt;
+        if(lengths[left] + lengths[right] > BP_MAX_TOKEN_LENGTH) goto corrupt;
+
+        uint8_t* entry = dict + (size_t)comp->dictSize * BP_MAX_TOKEN_LENGTH;
+        memcpy(entry, dict + left * BP_MAX_TOKEN_LENGTH, lengths[left]);
+        memcpy(entry + lengths[left], dict + right * BP_MAX_TOKEN_LENGTH, lengths[right]);
+        lengths[comp->dictSize] = (uint8_t)(lengths[left] + lengths[right]);
+        comp->dictSize++;
+    }
+
+    if(!(n = varintGet(ip, end, &rankCount))) goto corrupt;
+    ip += n;
+    if(rankCount > (uint64_t)comp->dictSize) goto corrupt;
+    rankTokens = malloc(sizeof(uint16_t) * (rankCount ? (size_t)rankCount : 1));
+    if(!rankTokens) goto corrupt;
+    for(uint64_t r = 0; r < rankCount; r++) {
+        if(!(n = varintGet(ip, end, &value))) goto corrupt;
+        ip += n;
+        if(value >= (uint64_t)comp->dictSize) goto corrupt;
+        rankTokens[r] = (uint16_t)value;
+    }
+
+    if(!(n = varintGet(ip, end, &symbolCount))) goto corrupt;
+    ip += n;
+    if(symbolCount > (uint64_t)(end - ip) || symbolCount > decodedSize) goto corrupt;
+
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + decodedSize;
+    for(uint64_t s = 0; s < symbolCount; s++) {
+        uint64_t rank;
+        if(ip < end && *ip < 0x80) {
+            rank = *ip++;
         } else {
-            outputBuffer[outIdx++] = data[i++];
+            if(!(n = varintGet(ip, end, &rank))) goto corrupt;
+            ip += n;
         }
+        if(rank >= rankCount) goto corrupt;
+
+        uint16_t token = rankTokens[rank];
+        const uint8_t* expansion = dict + (size_t)token * BP_MAX_TOKEN_LENGTH;
+        size_t length = lengths[token];
+        if(opEnd - op >= BP_MAX_TOKEN_LENGTH) {
+            memcpy(op, expansion, BP_MAX_TOKEN_LENGTH);
+        } else if((size_t)(opEnd - op) >= length) {
+            memcpy(op, expansion, length);
+        } else {
+            goto corrupt;
+        }
+        op += length;
     }
+    if(op != opEnd || ip != end) goto corrupt;
+
+    free(rankTokens);
+    *outputSize = (size_t)decodedSize;
+    return 0;
 
-    *outputSize = outIdx;
-    return outputBuffer;
+corrupt:
+    printf("ERROR BP: Corrupt or truncated stream\n");
+    free(rankTokens);
+    return -1;
 }
 
 /**
@@ -105,24 +401,15 @@ uint8_t* bpDecompress(
     size_t size,
     size_t* outputSize
 ) {
-    uint8_t* outputBuffer = malloc(size * 2);
-    size_t outIdx = 0;
-
-    for(size_t i = 0; i < size; i++) {
-        if(data[i] == 0xFF && i + 1 < size) {
-            uint8_t tokenIdx = data[++i];
-            if(tokenIdx < comp->pairCount) {
-                outputBuffer[outIdx++] = comp->pairs[tokenIdx].pair[0];
-                outputBuffer[outIdx++] = comp->pairs[tokenIdx].pair[1];
-            } else {
-                outputBuffer[outIdx++] = 0xFF;
-                outputBuffer[outIdx++] = tokenIdx;
-            }
-        } else {
-            outputBuffer[outIdx++] = data[i];
-        }
-    }
+    *outputSize = 0;
+    uint64_t decodedSize;
+    if(!varintGet(data, data + size, &decodedSize) || decodedSize > SIZE_MAX) return NULL;
 
-    *outputSize = outIdx;
-    return outputBuffer;
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(bpDecompressInto(comp, data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
 }
\ No newline at end of file
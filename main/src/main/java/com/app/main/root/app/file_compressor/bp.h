@@ -2,6 +2,23 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#define BP_MAX_VOCAB 65536
+#define BP_MAX_TOKEN_LENGTH 16
+#define BP_MAX_PASSES 32
+#define BP_MIN_PAIR_COUNT 10
+
+/**
+ * Byte pair encoding with a 16-bit vocabulary.
+ * Tokens 0-255 are bytes; token 256 + k is merge k, the
+ * concatenation of two earlier tokens. countPairs learns the merges
+ * in passes, bpCompress replays them and writes the merge list in
+ * front of the token stream, so bpDecompress needs nothing but the
+ * stream.
+ *
+ * Stream: varint decoded size, merge count, (left, right) per merge,
+ * rank count, token per rank (most frequent first), symbol count,
+ * then one varint rank per symbol.
+ */
 typedef struct {
     uint16_t pair[2];
     uint16_t token;
@@ -12,26 +29,37 @@ typedef struct {
     BytePair* pairs;
     int pairCount;
     int maxPairs;
+    int* passEnds;
+    int passCount;
     uint8_t* dict;
+    uint8_t* dictLengths;
     int dictSize;
 } BytePairCompressor;
 
 BytePairCompressor* bpCreate(int maxVocabSize);
 void bpDestroy(BytePairCompressor* comp);
 void countPairs(
-    BytePairCompressor* comp, 
-    const uint8_t* data, 
+    BytePairCompressor* comp,
+    const uint8_t* data,
     size_t size
 );
 uint8_t* bpCompress(
     BytePairCompressor* comp,
-    const uint8_t* data, 
+    const uint8_t* data,
     size_t size,
     size_t* outputSize
 );
 uint8_t* bpDecompress(
-    BytePairCompressor* comp, 
+    BytePairCompressor* comp,
     const uint8_t* data,
-    size_t size, 
+    size_t size,
+    size_t* outputSize
+);
+int bpDecompressInto(
+    BytePairCompressor* comp,
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
     size_t* outputSize
 );
\ No newline at end of file
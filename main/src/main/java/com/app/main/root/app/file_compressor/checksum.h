@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * CRC32C (Castagnoli), as used for frame block checksums. Runs on
+ * the SSE4.2 or ARMv8 CRC instructions where available, with a table
+ * fallback; both give the same result.
+ */
+int crc32cHardware(void);
+uint32_t crc32c(uint32_t crc, const uint8_t* data, size_t size);
\ No newline at end of file
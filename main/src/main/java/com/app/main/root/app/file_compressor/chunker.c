@@ -0,0 +1,484 @@
+#include "chunker.h"
+#include "thread_pool.h"
+#include "file_io.h"
+#include "bitstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#define CDC_SEGMENT ((size_t)4 << 20)
+#define CDC_LANES 4
+#define CDC_NORMALIZATION 2
+
+static const uint64_t gear[256] = {
+    0xEFDC98F12BCAE9DDULL, 0x9BA68B6C426345EAULL, 0x67CD8F57E517EA45ULL,
+    0xC08E369A69B26072ULL, 0xABD46172073451B8ULL, 0x61960E589522A7EBULL,
+    0x25313513AAA290E4ULL, 0x4E3BD15F47BF9F93ULL, 0xC95DDD6E743CB83AULL,
+    0x039AC26D9A379B35ULL, 0x9E57C337FCE10467ULL, 0x357A8560F7A5F337ULL,
+    0xE28CE825D33F95C5ULL, 0x704DE5B80E755A11ULL, 0x397DD32BABA902DAULL,
+    0xA435929C8B653588ULL, 0x3C0EC8F5363A99F1ULL, 0xEF310B3B7FB42184ULL,
+    0xA48B9FCEFDA00D25ULL, 0x988C837C96EAD250ULL, 0x77B5767056D93493ULL,
+    0x1393B59A5D2183F5ULL, 0x6AED32328BEE4CBFULL, 0xD3280F5CF0414EDAULL,
+    0x14E8218817E1C347ULL, 0x0277BC27F6D97B60ULL, 0x800A609CD8DE7379ULL,
+    0x351A4DB061B8B422ULL, 0x2593DD08B87A99D8ULL, 0x9258FCAA6AF01EEFULL,
+    0x1725A19AA35EC168ULL, 0x1412A9B932E4F3DBULL, 0x2FDBF7F5F14485C0ULL,
+    0x1F7C95B3ADD35533ULL, 0xD837CC159E1613BDULL, 0x20EE63D3CE39184FULL,
+    0xE238015FFE14716AULL, 0x495082870A9A84C1ULL, 0xBF36A88028901D68ULL,
+    0x6381C0F11F7AC773ULL, 0x2828A80F0CE6FF55ULL, 0xAFF83AE984C60169ULL,
+    0x569FAA6FB1CCCBDAULL, 0x78F741683D91AD2BULL, 0xD0AD95E315E57A84ULL,
+    0xA1C7A5EA40058E12ULL, 0x19440BA974849EBDULL, 0x86F4462657044B1AULL,
+    0xDFA22C7C4E95B2EEULL, 0x4DE8728390AB624BULL, 0xE95F9C31B097A283ULL,
+    0x7AA25B5A1DD8C9A6ULL, 0x2A44C8C3A1FAD622ULL, 0xA40F6028A963F38EULL,
+    0x6228F92568E2C11CULL, 0x1745EE852640EE0CULL, 0xE3CE39B857844DC3ULL,
+    0x7A409377121D92A5ULL, 0x55F19004B8A25814ULL, 0xAB8E58F63AF54FF9ULL,
+    0x5C3A924C5B898705ULL, 0xD9B740E51F692AAEULL, 0xE07A184F0F2CA133ULL,
+    0x040B597274CDCB52ULL, 0xCA477109AD8DDE33ULL, 0x8BF8D84FAD4282EAULL,
+    0x9227F8B6FF4CEE26ULL, 0xA7634F1257B433E1ULL, 0x17A1F2557E9D3E87ULL,
+    0xD592E1345F708A1EULL, 0xFA800089539A36BBULL, 0x248609C41F4CD622ULL,
+    0x2843C9C6B9815679ULL, 0x8DF5CF4F9D57C93CULL, 0xC28A0FC4F6AAE6F1ULL,
+    0x662766A9902C5B32ULL, 0x491A59FBCB9928A8ULL, 0xC6810766B2085AA2ULL,
+    0x579B3D84D459E915ULL, 0xB9FCB5EBF411620EULL, 0x82438670250CD853ULL,
+    0x78311B846CED89BDULL, 0x62B47BA50A9C8CA2ULL, 0x5760548BB39E0A3CULL,
+    0x74A2881F28194227ULL, 0x4981BA4B5CCC22C7ULL, 0x4DD7E078D1AE3F6AULL,
+    0xAF8B0E7D503F4B65ULL, 0x9AD441E868547612ULL, 0x6CB546FEE93BA1E1ULL,
+    0x277BD686C21DB3CEULL, 0x27B2C7E5BAC8B021ULL, 0xD672262E34EFEC9FULL,
+    0xCC3ED5CAD58E570FULL, 0xBC12A84405DA4FCCULL, 0xBF1D212DDDD2EB65ULL,
+    0x28241F58DADB883DULL, 0x02B65D637E6FF2E6ULL, 0x118FEC0C83950A9AULL,
+    0x4219AD8C68371EEDULL, 0xA003938AE5C0A007ULL, 0x2172A864DA306F17ULL,
+    0x992A6D28F0CED090ULL, 0x1321221D3AF4E076ULL, 0xE7F29A50F014DE42ULL,
+    0xB81C61F9026BA69AULL, 0xADC4DD0C5D2ACA5DULL, 0xE06219B02BE36ADDULL,
+    0x595F7CF4045021E2ULL, 0xB32A5282B92AF6D5ULL, 0x5B6C5B604E8C2DC2ULL,
+    0xEBF2E303037B4221ULL, 0x38896B378B226DB8ULL, 0x1059EFF23890D31FULL,
+    0x59A4DA06B8790377ULL, 0x6F32CBFC85C88B1EULL, 0x1AA835585D23B129ULL,
+    0x2559A88E9C784B31ULL, 0x9896B756BBA63EDAULL, 0xF1D0F116E711859EULL,
+    0xD092DCDB37CCDB2CULL, 0x2D98C13DC17953E8ULL, 0x91FFC23628E42A8EULL,
+    0x94AAEE01195F74FDULL, 0x8F63063BD3B3CC80ULL, 0xE696DF0388CAB22FULL,
+    0x242066D2D1AC0A99ULL, 0x56F256765C98DFBEULL, 0xFFCFA9B47B75A289ULL,
+    0x4AB939F1D893DCDFULL, 0x1DEC4D272A5B6162ULL, 0xD547B77E6025A30FULL,
+    0x38960C8F6875F861ULL, 0xBD995338B361FB39ULL, 0x63ABAFFA40B1F01EULL,
+    0xCF1577868F3CA1FEULL, 0x876B07A102F28BB3ULL, 0x6240AFB2EBEC42B3ULL,
+    0x746E852235763208ULL, 0x097FC7D85ABBC5ADULL, 0x152292328BDCD6B8ULL,
+    0x0B76E2BB64D713C8ULL, 0x6A312454334402E3ULL, 0x70CD21170D575253ULL,
+    0x2D4D1C187C0713CFULL, 0xD0B36056C37352B2ULL, 0xA49BC6CB084D17F8ULL,
+    0x6D83BB617B20531CULL, 0x2353E1CEC74CA81DULL, 0x34A014579478FEA4ULL,
+    0x5591F76152BDE62BULL, 0x7DD41CDA39D1AE8FULL, 0xE3FD7A40AAC2968DULL,
+    0x0630E40E263A81EBULL, 0x82E6D546010965C3ULL, 0xB674269917A30137ULL,
+    0xA360518158A6273BULL, 0x1954D95BBF23DB7CULL, 0xFD3A0A6DFC094485ULL,
+    0x461F452963347783ULL, 0x276566B5D0A001BDULL, 0x85DB3985B0ADFA1AULL,
+    0x1A53CB6EEA6A2C32ULL, 0xB480346F9A4DDECEULL, 0x2172E7D75C2FA980ULL,
+    0x9AE2E71A3C468B37ULL, 0x70502DFBB9429BC9ULL, 0x7823AA34A7511DE0ULL,
+    0x4141F827AAFAC5A7ULL, 0x7CB537BCC6EC899FULL, 0xBE91D157B5BE0AECULL,
+    0x045AF061E311D36EULL, 0xB3E5DA7596A66DCFULL, 0xEF24E968708F3E63ULL,
+    0x01F6A63D5FE17BF5ULL, 0x01B6EB7D49D0D294ULL, 0xDC38329ED9DB6E77ULL,
+    0xEC14DFC64AE34A5FULL, 0x65F57EC26C9EE3D7ULL, 0xC1374FBD54C5F310ULL,
+    0x8E930FC093F2EA09ULL, 0xD0379E9303DB3883ULL, 0xC381BFE206845DF3ULL,
+    0x1CDD063F3250FD2EULL, 0x71B7DEB5E0DC5D2BULL, 0x6FD22D330E3208AFULL,
+    0x8D1BE5590C0EDDDBULL, 0x5B69497644F125A8ULL, 0xD358714966975D49ULL,
+    0x668B724FC5615D0BULL, 0xEB02BFECC6799D39ULL, 0xB434954E5BD2E009ULL,
+    0x481EAC44D1616226ULL, 0xA1B43FB27FBA6CD9ULL, 0x2A5E1462575755EAULL,
+    0xF32E3BA00FC5A69EULL, 0x65530BD676C8F697ULL, 0xD0F52CB77D5A4964ULL,
+    0xD65D8417CEDC66CBULL, 0xAF7D69AFB30ADE1BULL, 0x45760196FE504C6FULL,
+    0x96242D71430C229DULL, 0xD93F1C6A68887127ULL, 0x227624C179F6224AULL,
+    0x9BC47FC66A735A00ULL, 0xA49814E2394C5BC2ULL, 0x33D443B76CF27D45ULL,
+    0xFD20D549CD0D9643ULL, 0x2ACA7E80572C93DCULL, 0xC15B10C3BBD40D51ULL,
+    0xB390B9C9C4495492ULL, 0x2104DF31C4223F13ULL, 0x4B63143E43FF3899ULL,
+    0x3B5DFC013B571D50ULL, 0x1D3A253623A41107ULL, 0xE05D14ED52C9D240ULL,
+    0x04058C3F17573A40ULL, 0x62BFC9F7640CF4F1ULL, 0x77BBEC6E763E6B6BULL,
+    0x6A0082ECA4E45619ULL, 0x0584B36957BABA02ULL, 0x9EF681DC9F42CBF3ULL,
+    0x6D11C44F47F4B5F2ULL, 0x62E37E60AD3534C6ULL, 0x2E9C31CC11E949A0ULL,
+    0x147ABFFA3C355E8DULL, 0x44B163800665D982ULL, 0x09AB3C520571E613ULL,
+    0x1AAB53926139F19FULL, 0xDBE573F09EA21BB9ULL, 0x690E94376B9BC981ULL,
+    0x5C17EAE50A9ED349ULL, 0x72085730170F6A39ULL, 0x6632E502F99C4585ULL,
+    0x5C62DC2BBC67EBEBULL, 0xF41C643C9AA136BEULL, 0x1DB63C9FD798B177ULL,
+    0x7CF001109E9F53E4ULL, 0x0B9368BD46D01B9FULL, 0x995543A47AADCF9AULL,
+    0xE4E4A7CF8E0E19DBULL, 0xCAC80F0D2A45A97BULL, 0x17940C398928E474ULL,
+    0x15900C4FCC201F25ULL, 0x4BC8250D5B4E5C12ULL, 0x4807583F4E448F75ULL,
+    0xF6C5FAA641BA6A79ULL, 0xCE42161021943B91ULL, 0xADD2278B6EA94491ULL,
+    0x6083AB6CF00DD5A2ULL, 0x01DBDB1ECAD6471BULL, 0xAD8C1FBBFB91235CULL,
+    0x5B322E9A4DC81E3EULL, 0x3209E99F19DA536FULL, 0xAA80ABDE1C0077DFULL,
+    0x42D21385D63458BAULL
+};
+
+typedef struct {
+    uint64_t* cuts;
+    size_t count;
+    size_t capacity;
+    int failed;
+} CutList;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    uint64_t maskS;
+    uint64_t maskL;
+    CutList* lists;
+} CdcScanJob;
+
+typedef struct {
+    const uint8_t* data;
+    uint64_t base;
+    CdcChunk* chunks;
+    TpFlag failed;
+} CdcHashJob;
+
+/**
+ * Top bits only: bit k of the gear hash depends on the last k + 1
+ * bytes, so only the high bits see the whole window.
+ */
+static uint64_t topMask(int bits) {
+    return bits > 0 ? ~0ULL << (64 - bits) : 0;
+}
+
+static int floorLog2(size_t value) {
+    int log = 0;
+    while(value >>= 1) log++;
+    return log;
+}
+
+/**
+ * Params Init
+ * Zero sizes take the defaults. Returns 0, or -1 unless
+ * CDC_MIN_SIZE_LIMIT <= min <= avg <= max <= CDC_MAX_SIZE_LIMIT.
+ */
+int cdcParamsInit(
+    CdcParams* params,
+    size_t minSize,
+    size_t avgSize,
+    size_t maxSize
+) {
+    params->minSize = minSize ? minSize : CDC_MIN_SIZE_DEFAULT;
+    params->avgSize = avgSize ? avgSize : CDC_AVG_SIZE_DEFAULT;
+    params->maxSize = maxSize ? maxSize : CDC_MAX_SIZE_DEFAULT;
+    if(params->minSize < CDC_MIN_SIZE_LIMIT || params->minSize > params->avgSize ||
+        params->avgSize > params->maxSize || params->maxSize > CDC_MAX_SIZE_LIMIT) {
+        printf("ERROR CDC: Invalid chunk sizes %zu/%zu/%zu\n",
+               params->minSize, params->avgSize, params->maxSize);
+        return -1;
+    }
+    return 0;
+}
+
+static void pushCut(CutList* list, uint64_t cut, int strong) {
+    if(list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        uint64_t* cuts = realloc(list->cuts, sizeof(uint64_t) * capacity);
+        if(!cuts) {
+            list->failed = 1;
+            return;
+        }
+        list->cuts = cuts;
+        list->capacity = capacity;
+    }
+    list->cuts[list->count++] = cut << 1 | (strong ? 1 : 0);
+}
+
+static void appendCuts(CutList* dst, const CutList* src) {
+    for(size_t c = 0; c < src->count; c++) pushCut(dst, src->cuts[c] >> 1, (int)(src->cuts[c] & 1));
+    dst->failed |= src->failed;
+}
+
+/**
+ * Hash state just before pos, from the CDC_WINDOW - 1 bytes in
+ * front of it; older bytes have been shifted out by the time pos
+ * is added.
+ */
+static uint64_t warmHash(const uint8_t* data, size_t pos) {
+    uint64_t h = 0;
+    for(size_t i = pos > CDC_WINDOW - 1 ? pos - (CDC_WINDOW - 1) : 0; i < pos; i++) {
+        h = (h << 1) + gear[data[i]];
+    }
+    return h;
+}
+
+#define CDC_STEP(h, list, pos) do { \
+    h = (h << 1) + gear[data[pos]]; \
+    if(!(h & maskL)) pushCut(list, (uint64_t)(pos) + 1, !(h & maskS)); \
+} while(0)
+
+/**
+ * Records every position in [from, to) whose hash passes the loose
+ * mask, flagged when it also passes the strict one. The range runs
+ * as CDC_LANES stretches with independent hashes, so their gear
+ * updates overlap instead of waiting on each other.
+ */
+static void scanRange(
+    const uint8_t* data,
+    size_t from,
+    size_t to,
+    uint64_t maskS,
+    uint64_t maskL,
+    CutList* out
+) {
+    size_t stretch = (to - from) / CDC_LANES;
+    if(stretch < CDC_WINDOW) {
+        uint64_t h = warmHash(data, from);
+        for(size_t i = from; i < to; i++) CDC_STEP(h, out, i);
+        return;
+    }
+
+    CutList lanes[CDC_LANES - 1];
+    memset(lanes, 0, sizeof(lanes));
+    size_t p0 = from;
+    size_t p1 = from + stretch;
+    size_t p2 = from + 2 * stretch;
+    size_t p3 = from + 3 * stretch;
+    uint64_t h0 = warmHash(data, p0);
+    uint64_t h1 = warmHash(data, p1);
+    uint64_t h2 = warmHash(data, p2);
+    uint64_t h3 = warmHash(data, p3);
+    for(size_t j = 0; j < stretch; j++) {
+        CDC_STEP(h0, out, p0 + j);
+        CDC_STEP(h1, &lanes[0], p1 + j);
+        CDC_STEP(h2, &lanes[1], p2 + j);
+        CDC_STEP(h3, &lanes[2], p3 + j);
+    }
+    for(size_t i = from + CDC_LANES * stretch; i < to; i++) CDC_STEP(h3, &lanes[2], i);
+
+    for(int l = 0; l < CDC_LANES - 1; l++) {
+        appendCuts(out, &lanes[l]);
+        free(lanes[l].cuts);
+    }
+}
+
+static void scanSegmentTask(void* arg, size_t index) {
+    CdcScanJob* job = (CdcScanJob*)arg;
+    size_t from = index * CDC_SEGMENT;
+    size_t to = job->size - from < CDC_SEGMENT ? job->size : from + CDC_SEGMENT;
+    scanRange(job->data, from, to, job->maskS, job->maskL, &job->lists[index]);
+}
+
+/**
+ * Cut Chunks
+ * Candidate cuts are scanned per CDC_SEGMENT on the shared pool and
+ * then resolved in order. Unless final, data past the last cut is
+ * left for the next call; consumed reports where that cut is.
+ */
+static uint32_t* cutChunks(
+    const uint8_t* data,
+    size_t size,
+    const CdcParams* params,
+    int final,
+    size_t* chunkCount,
+    size_t* consumed
+) {
+    *chunkCount = 0;
+    *consumed = 0;
+    int bits = floorLog2(params->avgSize);
+    size_t segments = (size + CDC_SEGMENT - 1) / CDC_SEGMENT;
+    CdcScanJob job;
+    job.data = data;
+    job.size = size;
+    job.maskS = topMask(bits + CDC_NORMALIZATION);
+    job.maskL = topMask(bits - CDC_NORMALIZATION);
+    job.lists = calloc(segments ? segments : 1, sizeof(CutList));
+    uint32_t* lengths = malloc(sizeof(uint32_t) * (size / params->minSize + 1));
+    if(!job.lists || !lengths) {
+        free(job.lists);
+        free(lengths);
+        return NULL;
+    }
+    tpRun(tpShared(), scanSegmentTask, &job, segments);
+
+    CutList all;
+    memset(&all, 0, sizeof(all));
+    for(size_t s = 0; s < segments; s++) {
+        appendCuts(&all, &job.lists[s]);
+        free(job.lists[s].cuts);
+    }
+    free(job.lists);
+    if(all.failed) {
+        free(all.cuts);
+        free(lengths);
+        return NULL;
+    }
+
+    size_t start = 0;
+    size_t c = 0;
+    size_t count = 0;
+    while(start < size) {
+        size_t lo = start + params->minSize;
+        size_t mid = start + params->avgSize;
+        size_t hi = start + params->maxSize;
+        while(c < all.count && (all.cuts[c] >> 1) < lo) c++;
+
+        size_t cut = 0;
+        for(size_t k = c; k < all.count && (all.cuts[k] >> 1) <= hi; k++) {
+            if((all.cuts[k] >> 1) >= mid || (all.cuts[k] & 1)) {
+                cut = (size_t)(all.cuts[k] >> 1);
+                break;
+            }
+        }
+        if(!cut) {
+            if(hi <= size) cut = hi;
+            else if(final) cut = size;
+            else break;
+        }
+        lengths[count++] = (uint32_t)(cut - start);
+        start = cut;
+    }
+    free(all.cuts);
+
+    *chunkCount = count;
+    *consumed = start;
+    return lengths;
+}
+
+/**
+ * Boundaries
+ * Chunk lengths only, in order, without hashing.
+ */
+uint32_t* cdcBoundaries(
+    const uint8_t* data,
+    size_t size,
+    const CdcParams* params,
+    size_t* chunkCount
+) {
+    size_t consumed;
+    return cutChunks(data, size, params, 1, chunkCount, &consumed);
+}
+
+static void hashChunkTask(void* arg, size_t index) {
+    CdcHashJob* job = (CdcHashJob*)arg;
+    CdcChunk* chunk = &job->chunks[index];
+    const uint8_t* content = job->data + (chunk->offset - job->base);
+    if(!EVP_Digest(content, chunk->length, chunk->hash, NULL, EVP_sha256(), NULL)) {
+        printf("ERROR CDC: SHA-256 failed\n");
+        tpFlagSet(&job->failed);
+    }
+}
+
+/**
+ * Fills count chunks at the end of *chunks from lengths, with
+ * offsets from base, and hashes them on the shared pool.
+ */
+static int addChunks(
+    CdcChunk** chunks,
+    size_t* chunkCount,
+    size_t* capacity,
+    const uint8_t* data,
+    uint64_t base,
+    const uint32_t* lengths,
+    size_t count
+) {
+    if(*chunkCount + count > *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 64;
+        while(grown < *chunkCount + count) grown *= 2;
+        CdcChunk* resized = realloc(*chunks, sizeof(CdcChunk) * grown);
+        if(!resized) return -1;
+        *chunks = resized;
+        *capacity = grown;
+    }
+
+    CdcChunk* added = *chunks + *chunkCount;
+    uint64_t offset = base;
+    for(size_t c = 0; c < count; c++) {
+        added[c].offset = offset;
+        added[c].length = lengths[c];
+        offset += lengths[c];
+    }
+
+    CdcHashJob job;
+    job.data = data;
+    job.base = base;
+    job.chunks = added;
+    job.failed = 0;
+    tpRun(tpShared(), hashChunkTask, &job, count);
+    if(tpFlagTest(&job.failed)) return -1;
+    *chunkCount += count;
+    return 0;
+}
+
+/**
+ * Chunk
+ * Boundaries and SHA-256 hashes of an in-memory buffer.
+ */
+CdcChunk* cdcChunk(
+    const uint8_t* data,
+    size_t size,
+    const CdcParams* params,
+    size_t* chunkCount
+) {
+    *chunkCount = 0;
+    size_t count = 0;
+    size_t consumed;
+    uint32_t* lengths = cutChunks(data, size, params, 1, &count, &consumed);
+    if(!lengths) return NULL;
+
+    CdcChunk* chunks = malloc(sizeof(CdcChunk) * (count ? count : 1));
+    size_t capacity = count ? count : 1;
+    size_t added = 0;
+    if(chunks && addChunks(&chunks, &added, &capacity, data, 0, lengths, count) != 0) {
+        free(chunks);
+        chunks = NULL;
+    }
+    free(lengths);
+    if(chunks) *chunkCount = added;
+    return chunks;
+}
+
+/**
+ * Chunk File
+ * Maps the file a FILE_MAP_WINDOW at a time, each view starting at
+ * the last cut, so memory stays at one window whatever the file size
+ * and the chunks match cdcChunk() over the whole file.
+ */
+CdcChunk* cdcChunkFile(
+    const char* path,
+    const CdcParams* params,
+    size_t* chunkCount
+) {
+    *chunkCount = 0;
+    MappedFile* in = mfOpen(path);
+    if(!in) {
+        printf("ERROR CDC: Cannot open input file: %s\n", path);
+        return NULL;
+    }
+
+    uint64_t fileSize = mfSize(in);
+    CdcChunk* chunks = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint64_t pos = 0;
+    int ok = 1;
+    while(ok && pos < fileSize) {
+        size_t windowSize = fileSize - pos < FILE_MAP_WINDOW ? (size_t)(fileSize - pos) : FILE_MAP_WINDOW;
+        int final = pos + windowSize == fileSize;
+        const uint8_t* window = mfView(in, pos, windowSize);
+        size_t cut = 0;
+        size_t consumed = 0;
+        uint32_t* lengths = window ? cutChunks(window, windowSize, params, final, &cut, &consumed) : NULL;
+        ok = lengths && consumed > 0 &&
+            addChunks(&chunks, &count, &capacity, window, pos, lengths, cut) == 0;
+        free(lengths);
+        pos += consumed;
+    }
+    mfClose(in);
+
+    if(!ok) {
+        free(chunks);
+        return NULL;
+    }
+    if(!chunks) chunks = malloc(sizeof(CdcChunk));
+    *chunkCount = count;
+    return chunks;
+}
+
+/**
+ * Write Records
+ * dst needs chunkCount * CDC_RECORD_SIZE bytes.
+ */
+size_t cdcWriteRecords(
+    uint8_t* dst,
+    const CdcChunk* chunks,
+    size_t chunkCount
+) {
+    uint8_t* op = dst;
+    for(size_t c = 0; c < chunkCount; c++) {
+        writeLE64(op, chunks[c].offset);
+        writeLE32(op + 8, chunks[c].length);
+        memcpy(op + 12, chunks[c].hash, CDC_HASH_SIZE);
+        op += CDC_RECORD_SIZE;
+    }
+    return (size_t)(op - dst);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define CDC_MIN_SIZE_DEFAULT (16 * 1024)
+#define CDC_AVG_SIZE_DEFAULT (64 * 1024)
+#define CDC_MAX_SIZE_DEFAULT (256 * 1024)
+#define CDC_MIN_SIZE_LIMIT 64
+#define CDC_MAX_SIZE_LIMIT (4 * 1024 * 1024)
+#define CDC_WINDOW 64
+#define CDC_HASH_SIZE 32
+#define CDC_RECORD_SIZE (12 + CDC_HASH_SIZE)
+
+/**
+ * Content-defined chunking (FastCDC) for deduplication.
+ * A gear hash over the last CDC_WINDOW bytes picks cut points, so an
+ * edit only moves the boundaries next to it and the chunks around it
+ * keep their hashes across versions of a file. Cuts use normalized
+ * chunking: a stricter mask below avgSize, a looser one above it,
+ * never before minSize and always at maxSize.
+ *
+ * Since minSize is at least CDC_WINDOW, every cut depends only on
+ * bytes of its own chunk; chunking a file in pieces that start at
+ * a boundary gives the same chunks as chunking it whole.
+ *
+ * Chunks carry the SHA-256 of their content. Records, as returned
+ * to Java: u64 offset, u32 length, 32-byte hash, little endian.
+ */
+typedef struct {
+    size_t minSize;
+    size_t avgSize;
+    size_t maxSize;
+} CdcParams;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+    uint8_t hash[CDC_HASH_SIZE];
+} CdcChunk;
+
+int cdcParamsInit(
+    CdcParams* params,
+    size_t minSize,
+    size_t avgSize,
+    size_t maxSize
+);
+uint32_t* cdcBoundaries(
+    const uint8_t* data,
+    size_t size,
+    const CdcParams* params,
+    size_t* chunkCount
+);
+CdcChunk* cdcChunk(
+    const uint8_t* data,
+    size_t size,
+    const CdcParams* params,
+    size_t* chunkCount
+);
+CdcChunk* cdcChunkFile(
+    const char* path,
+    const CdcParams* params,
+    size_t* chunkCount
+);
+size_t cdcWriteRecords(
+    uint8_t* dst,
+    const CdcChunk* chunks,
+    size_t chunkCount
+);
\ No newline at end of file
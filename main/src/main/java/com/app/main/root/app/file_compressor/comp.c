@@ -2,7 +2,18 @@
 #include "bp.h"
 #include "rl.h"
 #include "sliding_window.h"
+#include "sw2.h"
+#include "lzh.h"
+#include "lza.h"
 #include "delta.h"
+#include "filter.h"
+#include "dict.h"
+#include "patch.h"
+#include "frame.h"
+#include "comp_stream.h"
+#include "varint.h"
+#include "stats.h"
+#include "debug.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,8 +21,17 @@
 #include <ctype.h>
 
 CompressionType detectBestCompression(const uint8_t* data, size_t size) {
-    if(size < 100) return COMP_NONE;
-    printf("DEBUG C: detectBestCompression for %zu bytes\n", size);
+    if(size < 100) {
+        statsSkip(SKIP_TOO_SMALL);
+        return COMP_NONE;
+    }
+    DEBUG_LOG("DEBUG C: detectBestCompression for %zu bytes\n", size);
+
+    FilterChain chain;
+    if(filterDetect(data, size, &chain)) {
+        DEBUG_LOG("DEBUG C: Detected filterable format, using filter chain\n");
+        return COMP_FILTER;
+    }
     
     int isLikelyVideo = 0;
     int isLikelyImage = 0;
@@ -20,19 +40,20 @@ CompressionType detectBestCompression(const uint8_t* data, size_t size) {
         if(data[0] == 0x00 && data[1] == 0x00 && 
             (data[2] == 0x01 || data[2] == 0xBA || data[2] == 0xB3)) {
             isLikelyVideo = 1;
-            printf("DEBUG C: Detected likely video format\n");
+            DEBUG_LOG("DEBUG C: Detected likely video format\n");
         }
         if(data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G') {
             isLikelyImage = 1;
-            printf("DEBUG C: Detected PNG format\n");
+            DEBUG_LOG("DEBUG C: Detected PNG format\n");
         }
         if(data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
             isLikelyImage = 1;
-            printf("DEBUG C: Detected JPEG format\n");
+            DEBUG_LOG("DEBUG C: Detected JPEG format\n");
         }
     }
     if(isLikelyVideo || isLikelyImage) {
-        printf("DEBUG C: Skipping compression for video/image format\n");
+        DEBUG_LOG("DEBUG C: Skipping compression for video/image format\n");
+        statsSkip(SKIP_MEDIA);
         return COMP_NONE;
     }
     
@@ -52,8 +73,8 @@ CompressionType detectBestCompression(const uint8_t* data, size_t size) {
     textBytes += byteFreq['\t'] + byteFreq['\n'] + byteFreq['\r'];
     
     if(textBytes * 100 / sampleSize > 70) {
-        printf("DEBUG C: High text content, using Byte Pair compression\n");
-        return COMP_BP;
+        DEBUG_LOG("DEBUG C: High text content, using LZ Huffman compression\n");
+        return COMP_LZH;
     }
 
     int runCount = 0;
@@ -61,7 +82,7 @@ CompressionType detectBestCompression(const uint8_t* data, size_t size) {
         if(data[i] == data[i-1]) runCount++;
     }
     if(runCount * 100 / sampleSize > 20) {
-        printf("DEBUG C: High run count, using Run-Length compression\n");
+        DEBUG_LOG("DEBUG C: High run count, using Run-Length compression\n");
         return COMP_RL;
     }
 
@@ -70,13 +91,99 @@ CompressionType detectBestCompression(const uint8_t* data, size_t size) {
         int delta = abs((int)data[i] - (int)data[i-1]);
         if(delta < 16) smallDeltas++;
     }
-    if(smallDeltas * 100 / sampleSize > 60) {
-        printf("DEBUG C: High small deltas, using Delta compression\n");
-        return COMP_DELTA;
+    if(smallDeltas * 100 / sampleSize > 60 && filterDetectStride(data, size, &chain)) {
+        DEBUG_LOG("DEBUG C: High small deltas, using stride delta filter\n");
+        return COMP_FILTER;
     }
 
-    printf("DEBUG C: Default to Sliding Window compression\n");
-    return COMP_SW;
+    DEBUG_LOG("DEBUG C: Default to LZ Huffman compression\n");
+    return COMP_LZH;
+}
+
+static uint8_t* encode(
+    CompressionType type,
+    const uint8_t* data,
+    size_t size,
+    size_t* compressedSize,
+    int level,
+    int verbose
+) {
+    *compressedSize = 0;
+    switch(type) {
+        case COMP_RL:
+            if(verbose) DEBUG_LOG("DEBUG C: Using RL compression\n");
+            return rlCompress(data, size, compressedSize);
+        case COMP_DELTA:
+            if(verbose) DEBUG_LOG("DEBUG C: Using Delta compression\n");
+            return deltaCompress(data, size, compressedSize);
+        case COMP_SW:
+            if(verbose) DEBUG_LOG("DEBUG C: Using Sliding Window compression\n");
+            return swCompress(data, size, compressedSize, level);
+        case COMP_SW2:
+            if(verbose) DEBUG_LOG("DEBUG C: Using Sliding Window v2 compression\n");
+            return sw2Compress(
+                data,
+                size,
+                compressedSize,
+                level,
+                lzWindowLogForLevel(level, size)
+            );
+        case COMP_LZH:
+            if(verbose) DEBUG_LOG("DEBUG C: Using LZ Huffman compression\n");
+            return lzhCompress(data, size, compressedSize, level);
+        case COMP_LZA:
+            if(verbose) DEBUG_LOG("DEBUG C: Using LZ ANS compression\n");
+            return lzaCompress(data, size, compressedSize, level);
+        case COMP_FILTER:
+            if(verbose) DEBUG_LOG("DEBUG C: Using filtered compression\n");
+            return filterCompress(data, size, compressedSize, level);
+        case COMP_BP: {
+            if(verbose) DEBUG_LOG("DEBUG C: Using Byte Pair compression\n");
+            BytePairCompressor* comp = bpCreate(BP_MAX_VOCAB);
+            if(!comp) return NULL;
+            countPairs(comp, data, size);
+            uint8_t* compressed = bpCompress(comp, data, size, compressedSize);
+            bpDestroy(comp);
+            return compressed;
+        }
+        default:
+            printf("ERROR C: Unknown compression type: %d\n", type);
+            return NULL;
+    }
+}
+
+/**
+ * Run Codec
+ * Single entry to every whole-buffer encoder; verbose logs the choice
+ * and every run is counted in the codec stats.
+ */
+static uint8_t* runCodec(
+    CompressionType type,
+    const uint8_t* data,
+    size_t size,
+    size_t* compressedSize,
+    int level,
+    int verbose
+) {
+    uint64_t start = statsNow();
+    uint8_t* compressed = encode(type, data, size, compressedSize, level, verbose);
+    statsRecord(type, size, compressed ? *compressedSize : 0, start);
+    return compressed;
+}
+
+/**
+ * Compress With Type
+ * Runs the given whole-buffer codec (RL through LZA, or FILTER) with
+ * no detection and no stored fallback, for benchmarks and tests.
+ */
+uint8_t* compressWithType(
+    CompressionType type,
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    return runCodec(type, data, size, outputSize, level, 0);
 }
 
 /**
@@ -86,7 +193,8 @@ uint8_t* compress(
     const uint8_t* data,
     size_t size,
     size_t* outputSize,
-    CompressionType* usedType
+    CompressionType* usedType,
+    int level
 ) {
     if(size == 0) {
         *outputSize = 0;
@@ -94,10 +202,13 @@ uint8_t* compress(
         return NULL;
     }
 
-    printf("DEBUG C: compress called with size: %zu bytes (%.2f MB)\n", 
-           size, size / (1024.0 * 1024.0));
+    DEBUG_LOG("DEBUG C: compress called with size: %zu bytes (%.2f MB), level: %d\n", 
+           size, size / (1024.0 * 1024.0), level);
     
-    if(size > 10 * 1024 * 1024) {
+    CompressionType bestType = detectBestCompression(data, size);
+    DEBUG_LOG("DEBUG C: Best compression type: %d\n", bestType);
+
+    if(size > 10 * 1024 * 1024 && bestType != COMP_FILTER) {
         int binaryLikelihood = 0;
         for(int i = 0; i < 100 && i < size; i++) {
             if(data[i] < 32 && data[i] != '\t' && data[i] != '\n' && data[i] != '\r') {
@@ -105,7 +216,8 @@ uint8_t* compress(
             }
         }
         if(binaryLikelihood > 80) {
-            printf("DEBUG C: Large binary file detected, skipping compression\n");
+            DEBUG_LOG("DEBUG C: Large binary file detected, skipping compression\n");
+            statsSkip(SKIP_BINARY);
             uint8_t* result = (uint8_t*)malloc(size);
             if(!result) return NULL;
             memcpy(result, data, size);
@@ -115,11 +227,8 @@ uint8_t* compress(
         }
     }
     
-    CompressionType bestType = detectBestCompression(data, size);
-    printf("DEBUG C: Best compression type: %d\n", bestType);
-    
     if(bestType == COMP_NONE) {
-        printf("DEBUG C: Using NO compression\n");
+        DEBUG_LOG("DEBUG C: Using NO compression\n");
         uint8_t* result = (uint8_t*)malloc(size);
         if(!result) {
             printf("ERROR C: malloc failed for size: %zu\n", size);
@@ -133,44 +242,12 @@ uint8_t* compress(
         return result;
     }
     
+    if(bestType == COMP_LZH && level >= COMP_LEVEL_MAX) {
+        bestType = COMP_LZA;
+    }
     *usedType = bestType;
-    uint8_t* compressed = NULL;
     size_t compressedSize = 0;
-
-    switch(bestType) {
-        case COMP_RL:
-            printf("DEBUG C: Using RL compression\n");
-            compressed = rlCompress(data, size, &compressedSize);
-            break;
-        case COMP_DELTA:
-            printf("DEBUG C: Using Delta compression\n");
-            compressed = deltaCompress(data, size, &compressedSize);
-            break;
-        case COMP_SW:
-            printf("DEBUG C: Using Sliding Window compression\n");
-            compressed = swCompress(data, size, &compressedSize);
-            break;
-        case COMP_BP: {
-            printf("DEBUG C: Using Byte Pair compression\n");
-            BytePairCompressor* comp = bpCreate(256);
-            countPairs(comp, data, size);
-            compressed = bpCompress(comp, data, size, &compressedSize);
-            bpDestroy(comp);
-            break;
-        }
-        default:
-            printf("ERROR C: Unknown compression type: %d\n", bestType);
-            compressed = (uint8_t*)malloc(size);
-            if(!compressed) {
-                *outputSize = 0;
-                *usedType = COMP_NONE;
-                return NULL;
-            }
-            memcpy(compressed, data, size);
-            compressedSize = size;
-            *usedType = COMP_NONE;
-            break;
-    }
+    uint8_t* compressed = runCodec(bestType, data, size, &compressedSize, level, 1);
     if(!compressed) {
         printf("ERROR C: Compression algorithm returned NULL\n");
         *outputSize = 0;
@@ -178,12 +255,13 @@ uint8_t* compress(
         return NULL;
     }
 
-    printf("DEBUG C: Compressed size: %zu bytes (%.2f MB), ratio: %.2f%%\n", 
+    DEBUG_LOG("DEBUG C: Compressed size: %zu bytes (%.2f MB), ratio: %.2f%%\n", 
            compressedSize, compressedSize / (1024.0 * 1024.0),
            (double)compressedSize / size * 100.0);
 
     if(compressedSize >= size * 0.98) {
-        printf("DEBUG C: Compression not beneficial (<2%% reduction), returning original\n");
+        DEBUG_LOG("DEBUG C: Compression not beneficial (<2%% reduction), returning original\n");
+        statsFallback(bestType);
         free(compressed);
         uint8_t* result = (uint8_t*)malloc(size);
         if(!result) {
@@ -203,32 +281,406 @@ uint8_t* compress(
 }
 
 /**
- * Decompress
+ * Trial Filtered
+ * Size of the sample through the chain and LZH at the fastest level,
+ * header included; 0 when the chain does not fit the sample.
  */
-uint8_t* decompress(
+static size_t trialFiltered(
+    const FilterChain* chain,
+    const uint8_t* sample,
+    size_t sampleSize
+) {
+    uint8_t* filtered = filterEncode(sample, sampleSize, chain);
+    if(!filtered) return 0;
+    size_t trialSize = 0;
+    uint8_t* trial = runCodec(COMP_LZH, filtered, sampleSize, &trialSize, COMP_LEVEL_MIN, 0);
+    free(trial);
+    free(filtered);
+    return trial ? trialSize + 2 + (size_t)chain->count * 4 : 0;
+}
+
+/**
+ * Select Codec
+ * Trial-compresses TRIAL_SAMPLES evenly spaced slices of the block
+ * with each candidate at the fastest level and keeps the smallest;
+ * COMP_NONE when nothing saves 2% on the sample. With filters set,
+ * COMP_FILTER joins the trial when the block opens with a filterable
+ * header (executables, PCM WAV, BMP) or its samples delta well.
+ */
+static CompressionType selectCodec(
+    const uint8_t* data,
+    size_t size,
+    int level,
+    int filters
+) {
+    static const CompressionType candidates[] = { COMP_RL, COMP_LZH };
+    if(size < 100) {
+        statsSkip(SKIP_TOO_SMALL);
+        return COMP_NONE;
+    }
+
+    size_t sliceSize = size / TRIAL_SAMPLES < TRIAL_SAMPLE_SIZE ? size / TRIAL_SAMPLES : TRIAL_SAMPLE_SIZE;
+    size_t sampleSize = sliceSize * TRIAL_SAMPLES;
+    uint8_t* sample = malloc(sampleSize);
+    if(!sample) return COMP_LZH;
+    for(int i = 0; i < TRIAL_SAMPLES; i++) {
+        size_t from = (size - sliceSize) / (TRIAL_SAMPLES - 1) * i;
+        memcpy(sample + sliceSize * i, data + from, sliceSize);
+    }
+
+    CompressionType best = COMP_NONE;
+    size_t bestSize = (size_t)(sampleSize * 0.98);
+    for(size_t c = 0; c < sizeof(candidates) / sizeof(candidates[0]); c++) {
+        size_t trialSize = 0;
+        uint8_t* trial = runCodec(candidates[c], sample, sampleSize, &trialSize, COMP_LEVEL_MIN, 0);
+        if(trial && trialSize < bestSize) {
+            best = candidates[c];
+            bestSize = trialSize;
+        }
+        free(trial);
+    }
+
+    FilterChain chain;
+    if(filters && (filterDetect(data, size, &chain) || filterDetectStride(data, size, &chain))) {
+        size_t trialSize = trialFiltered(&chain, sample, sampleSize);
+        if(trialSize && trialSize < bestSize) {
+            best = COMP_FILTER;
+            bestSize = trialSize;
+        }
+    }
+    free(sample);
+
+    if(best == COMP_NONE) statsSkip(SKIP_TRIAL);
+    if(best == COMP_LZH && level >= COMP_LEVEL_MAX) best = COMP_LZA;
+    return best;
+}
+
+/**
+ * Select Block Compression
+ */
+CompressionType selectBlockCompression(
+    const uint8_t* data,
+    size_t size,
+    int level
+) {
+    return selectCodec(data, size, level, 1);
+}
+
+static uint8_t* blockOrStore(
     const uint8_t* data,
     size_t size,
     size_t* outputSize,
+    CompressionType* usedType,
+    int level,
+    int filters
+) {
+    *outputSize = 0;
+    *usedType = COMP_NONE;
+    if(size == 0) return NULL;
+
+    CompressionType type = selectCodec(data, size, level, filters);
+    size_t compressedSize = 0;
+    uint8_t* compressed = type == COMP_NONE ? NULL : runCodec(type, data, size, &compressedSize, level, 0);
+    if(compressed && compressedSize < size * 0.98) {
+        *outputSize = compressedSize;
+        *usedType = type;
+        return compressed;
+    }
+
+    if(type != COMP_NONE) statsFallback(type);
+    free(compressed);
+    *outputSize = size;
+    return NULL;
+}
+
+/**
+ * Compress Block Or Store
+ * Per-block counterpart of compress() for the frame engines: the
+ * codec comes from trial compression instead of whole-file
+ * heuristics. A block that does not shrink comes back as NULL with
+ * COMP_NONE and *outputSize == size, so callers that can point at
+ * the input skip the copy; NULL with *outputSize 0 is a failure.
+ */
+uint8_t* compressBlockOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    return blockOrStore(data, size, outputSize, usedType, level, 1);
+}
+
+/**
+ * Compress Unfiltered Or Store
+ * compressBlockOrStore() without COMP_FILTER among the candidates,
+ * for payloads that are already filtered or whose container only
+ * takes the plain codecs.
+ */
+uint8_t* compressUnfilteredOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    return blockOrStore(data, size, outputSize, usedType, level, 0);
+}
+
+/**
+ * Stored Copy
+ * Heap copy of a stored input, for callers that must own the result.
+ */
+uint8_t* storedCopy(const uint8_t* data, size_t size, size_t* outputSize) {
+    uint8_t* stored = (uint8_t*)malloc(size ? size : 1);
+    if(!stored) {
+        *outputSize = 0;
+        return NULL;
+    }
+    memcpy(stored, data, size);
+    *outputSize = size;
+    return stored;
+}
+
+/**
+ * Compress Block
+ * As compressBlockOrStore(), but a stored block is returned as a copy.
+ */
+uint8_t* compressBlock(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    uint8_t* compressed = compressBlockOrStore(data, size, outputSize, usedType, level);
+    if(compressed || *outputSize == 0) return compressed;
+    return storedCopy(data, size, outputSize);
+}
+
+/**
+ * Max Decoded Size
+ * Most a stream of size bytes can decode to under each format's
+ * limits: SW tokens are 5 bytes for at most 256, BP symbols expand to
+ * at most BP_MAX_TOKEN_LENGTH, and an LZ sequence codes at most
+ * 64 KB of match behind a length that alone takes 15 extra bits.
+ * RL, frames, streams and patches bound themselves from their
+ * structure; filters defer to their inner type.
+ */
+static uint64_t maxDecodedSize(size_t size, CompressionType compType) {
+    switch(compType) {
+        case COMP_SW:
+            return (uint64_t)size * COMP_SW_MAX_EXPANSION;
+        case COMP_BP:
+            return (uint64_t)size * BP_MAX_TOKEN_LENGTH;
+        case COMP_SW2:
+        case COMP_LZH:
+        case COMP_LZA:
+        case COMP_DICT:
+            return (uint64_t)size * COMP_LZ_MAX_EXPANSION;
+        default:
+            return UINT64_MAX;
+    }
+}
+
+static int readDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    CompressionType compType,
+    uint64_t* decodedSize
+) {
+    const uint8_t* end = data + size;
+    switch(compType) {
+        case COMP_NONE:
+        case COMP_DELTA:
+            *decodedSize = size;
+            return 0;
+        case COMP_RL:
+            return rlDecodedSize(data, size, decodedSize);
+        case COMP_SW:
+            return swDecodedSize(data, size, decodedSize);
+        case COMP_SW2:
+            return size >= 2 && varintGet(data + 1, end, decodedSize) ? 0 : -1;
+        case COMP_BP:
+        case COMP_LZH:
+        case COMP_LZA:
+            return varintGet(data, end, decodedSize) ? 0 : -1;
+        case COMP_FRAME:
+            return frameOriginalSize(data, size, decodedSize);
+        case COMP_STREAM:
+            return streamDecodedSize(data, size, decodedSize);
+        case COMP_FILTER:
+            return filterDecodedSize(data, size, decodedSize);
+        case COMP_DICT:
+            return dictDecodedSize(data, size, decodedSize);
+        case COMP_PATCH:
+            return patchDecodedSize(data, size, decodedSize);
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Decompressed Size
+ * Exact decoded size from the stream header, without decoding, so
+ * the output can be allocated up front. Sizes the input could not
+ * decode to are rejected here, before anything is allocated for them.
+ * Returns 0, or -1 when the header is malformed.
+ */
+int decompressedSize(
+    const uint8_t* data,
+    size_t size,
+    CompressionType compType,
+    uint64_t* decodedSize
+) {
+    *decodedSize = 0;
+    if(readDecodedSize(data, size, compType, decodedSize) != 0) return -1;
+    if(*decodedSize > maxDecodedSize(size, compType)) {
+        printf("ERROR C: Decoded size %llu exceeds the limit for %zu bytes of type %d\n",
+               (unsigned long long)*decodedSize, size, (int)compType);
+        *decodedSize = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Verify
+ * Checks the checksums a stream carries without decoding it; frames
+ * and streams, also inside a filter, have them per block. Returns
+ * VERIFY_OK, VERIFY_UNCHECKED when there are none, or VERIFY_CORRUPT.
+ */
+int verifyCompressed(
+    const uint8_t* data,
+    size_t size,
     CompressionType compType
 ) {
     switch(compType) {
+        case COMP_FRAME:
+            return frameVerify(data, size);
+        case COMP_STREAM:
+            return streamVerify(data, size);
+        case COMP_FILTER:
+            return filterVerify(data, size);
+        default:
+            return VERIFY_UNCHECKED;
+    }
+}
+
+/**
+ * Decompress Into
+ * Decodes straight into a caller-owned buffer. Returns 0, or -1 on
+ * corrupt input or when the decoded size exceeds capacity; dst
+ * contents are undefined after a failure.
+ */
+int decompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize,
+    CompressionType compType
+) {
+    *outputSize = 0;
+    switch(compType) {
+        case COMP_NONE:
+            if(size > capacity) return -1;
+            memcpy(dst, data, size);
+            *outputSize = size;
+            return 0;
         case COMP_RL:
-            return rlDecompress(data, size, outputSize);
+            return rlDecompressInto(data, size, dst, capacity, outputSize);
         case COMP_DELTA:
-            return deltaDecompress(data, size, outputSize);
+            return deltaDecompressInto(data, size, dst, capacity, outputSize);
         case COMP_SW:
-            return swDecompress(data, size, outputSize);
+            return swDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_SW2:
+            return sw2DecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_LZH:
+            return lzhDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_LZA:
+            return lzaDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_FRAME:
+            return frameDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_STREAM:
+            return streamDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_FILTER:
+            return filterDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_DICT:
+            return dictDecompressInto(data, size, dst, capacity, outputSize);
+        case COMP_PATCH:
+            printf("ERROR C: Patch needs its base version\n");
+            return -1;
         case COMP_BP: {
-            BytePairCompressor* comp = bpCreate(256);
-            uint8_t* decompressed = bpDecompress(comp, data, size, outputSize);
+            BytePairCompressor* comp = bpCreate(BP_MAX_VOCAB);
+            if(!comp) return -1;
+            int result = bpDecompressInto(comp, data, size, dst, capacity, outputSize);
             bpDestroy(comp);
-            return decompressed;
+            return result;
         }
-        case COMP_NONE:
         default:
-            *outputSize = size;
-            uint8_t* output = malloc(size);
-            memcpy(output, data, size);
-            return output;
+            printf("ERROR C: Unknown compression type: %d\n", (int)compType);
+            return -1;
+    }
+}
+
+/**
+ * Decompress
+ * Sizes the output exactly from the stream header and decodes into
+ * it with decompressInto().
+ */
+uint8_t* decompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType compType
+) {
+    *outputSize = 0;
+    uint64_t decodedSize = 0;
+    if(decompressedSize(data, size, compType, &decodedSize) != 0 || decodedSize > SIZE_MAX) {
+        printf("ERROR C: Cannot read decoded size for type: %d\n", (int)compType);
+        return NULL;
+    }
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) {
+        printf("ERROR C: malloc failed for size: %llu\n", (unsigned long long)decodedSize);
+        return NULL;
+    }
+    if(decompressInto(data, size, output, (size_t)decodedSize, outputSize, compType) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+/**
+ * Decompress Range
+ * Original bytes [offset, offset + length), clipped to the end of
+ * the data. Frames decode only the blocks covering the range; other
+ * types have no index and are decoded whole first.
+ */
+uint8_t* decompressRange(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType compType,
+    uint64_t offset,
+    size_t length
+) {
+    if(compType == COMP_FRAME) {
+        return frameDecompressRange(data, size, offset, length, outputSize);
+    }
+
+    size_t decodedSize = 0;
+    uint8_t* decoded = decompress(data, size, &decodedSize, compType);
+    *outputSize = 0;
+    if(!decoded || offset > decodedSize) {
+        free(decoded);
+        return NULL;
     }
+    if(length > decodedSize - offset) length = decodedSize - (size_t)offset;
+    memmove(decoded, decoded + offset, length);
+    *outputSize = length;
+    return decoded;
 }
\ No newline at end of file
@@ -1,13 +1,33 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include "lz_parse.h"
+
+#define COMP_LEVEL_MIN LZ_LEVEL_MIN
+#define COMP_LEVEL_DEFAULT LZ_LEVEL_DEFAULT
+#define COMP_LEVEL_MAX LZ_LEVEL_MAX
+#define TRIAL_SAMPLES 8
+#define TRIAL_SAMPLE_SIZE (8 * 1024)
+#define VERIFY_OK 0
+#define VERIFY_UNCHECKED 1
+#define VERIFY_CORRUPT -1
+#define COMP_LZ_MAX_EXPANSION ((uint64_t)1 << 16)
+#define COMP_SW_MAX_EXPANSION 52
 
 typedef enum {
     COMP_NONE = 0,
     COMP_RL,
     COMP_DELTA,
     COMP_SW,
-    COMP_BP
+    COMP_BP,
+    COMP_SW2,
+    COMP_LZH,
+    COMP_LZA,
+    COMP_FRAME,
+    COMP_STREAM,
+    COMP_FILTER = 11,
+    COMP_DICT,
+    COMP_PATCH
 } CompressionType;
 
 CompressionType detectBestCompression(const uint8_t* data, size_t size);
@@ -15,11 +35,73 @@ uint8_t* compress(
     const uint8_t* data, 
     size_t size, 
     size_t* outputSize, 
-    CompressionType* usedType
+    CompressionType* usedType,
+    int level
+);
+uint8_t* compressWithType(
+    CompressionType type,
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
 );
+CompressionType selectBlockCompression(
+    const uint8_t* data,
+    size_t size,
+    int level
+);
+uint8_t* compressBlockOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
+uint8_t* compressUnfilteredOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
+uint8_t* compressBlock(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
+uint8_t* storedCopy(const uint8_t* data, size_t size, size_t* outputSize);
 uint8_t* decompress(
     const uint8_t* data, 
     size_t size, 
     size_t* outputSize,
     CompressionType compType
 );
+int decompressedSize(
+    const uint8_t* data,
+    size_t size,
+    CompressionType compType,
+    uint64_t* decodedSize
+);
+int decompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize,
+    CompressionType compType
+);
+uint8_t* decompressRange(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType compType,
+    uint64_t offset,
+    size_t length
+);
+int verifyCompressed(
+    const uint8_t* data,
+    size_t size,
+    CompressionType compType
+);
\ No newline at end of file
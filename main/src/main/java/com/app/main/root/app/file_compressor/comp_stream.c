@@ -0,0 +1,483 @@
+#include "comp_stream.h"
+#include "comp.h"
+#include "frame.h"
+#include "thread_pool.h"
+#include "lzh.h"
+#include "lz_parse.h"
+#include "bitstream.h"
+#include "varint.h"
+#include "stats.h"
+#include "checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct CompStream {
+    int level;
+    int windowLog;
+    size_t windowSize;
+    size_t blockSize;
+    size_t batchBlocks;
+    uint8_t* buffer;
+    size_t historySize;
+    size_t fill;
+    uint8_t* output;
+    size_t outputSize;
+    size_t outputCapacity;
+    size_t outputRead;
+    uint64_t totalSize;
+    uint64_t producedSize;
+    int seekable;
+    FrameBlock* blocks;
+    uint32_t blockCount;
+    uint32_t blockCapacity;
+    int started;
+    int finished;
+};
+
+static CompStream* createStream(int level, int seekable) {
+    CompStream* cs = calloc(1, sizeof(CompStream));
+    if(!cs) return NULL;
+
+    cs->level = level;
+    cs->seekable = seekable;
+    if(seekable) {
+        cs->windowLog = 0;
+        cs->windowSize = 0;
+        cs->blockSize = (size_t)1 << frameBlockLogForLevel(level);
+        int threads = tpThreadCount(tpShared()) + 1;
+        cs->batchBlocks = threads < STREAM_SEEKABLE_BATCH_MAX ? (size_t)threads : STREAM_SEEKABLE_BATCH_MAX;
+    } else {
+        cs->windowLog = lzWindowLogForLevel(level, SIZE_MAX);
+        cs->windowSize = (size_t)1 << cs->windowLog;
+        cs->blockSize = (size_t)1 << STREAM_BLOCK_LOG;
+        cs->batchBlocks = 1;
+    }
+    cs->buffer = malloc(cs->windowSize + cs->blockSize * cs->batchBlocks);
+    if(!cs->buffer) {
+        free(cs);
+        return NULL;
+    }
+    return cs;
+}
+
+/**
+ * Create
+ * The window comes from the level alone since the input size is not
+ * known up front.
+ */
+CompStream* csCreate(int level) {
+    return createStream(level, 0);
+}
+
+/**
+ * Create Seekable
+ * Writes a version 2 COMP_FRAME instead: blocks are compressed on
+ * their own with compressBlock() and indexed at the end, so any range
+ * can later be decoded without the blocks before it. Input is
+ * buffered a batch of blocks at a time, one per pool thread, and
+ * each batch is compressed on the shared pool.
+ */
+CompStream* csCreateSeekable(int level) {
+    return createStream(level, 1);
+}
+
+/**
+ * Destroy
+ */
+void csDestroy(CompStream* cs) {
+    if(!cs) return;
+    free(cs->buffer);
+    free(cs->output);
+    free(cs->blocks);
+    free(cs);
+}
+
+static int reserveOutput(CompStream* cs, size_t extra) {
+    if(cs->outputRead > 0 && cs->outputRead == cs->outputSize) {
+        cs->outputRead = 0;
+        cs->outputSize = 0;
+    }
+    if(cs->outputSize + extra <= cs->outputCapacity) return 1;
+
+    if(cs->outputRead > 0) {
+        memmove(cs->output, cs->output + cs->outputRead, cs->outputSize - cs->outputRead);
+        cs->outputSize -= cs->outputRead;
+        cs->outputRead = 0;
+        if(cs->outputSize + extra <= cs->outputCapacity) return 1;
+    }
+
+    size_t capacity = cs->outputCapacity ? cs->outputCapacity * 2 : 64 * 1024;
+    while(capacity < cs->outputSize + extra) capacity *= 2;
+    uint8_t* output = realloc(cs->output, capacity);
+    if(!output) return 0;
+    cs->output = output;
+    cs->outputCapacity = capacity;
+    return 1;
+}
+
+static int writeBlock(
+    CompStream* cs,
+    int kind,
+    const uint8_t* payload,
+    size_t payloadSize,
+    size_t originalSize
+) {
+    if(!reserveOutput(cs, 1 + VARINT_MAX_BYTES * 2 + payloadSize + STREAM_CHECKSUM_SIZE)) return 0;
+    uint8_t* op = cs->output + cs->outputSize;
+    *op++ = (uint8_t)kind;
+    op += varintPut(op, originalSize);
+    op += varintPut(op, payloadSize);
+    memcpy(op, payload, payloadSize);
+    op += payloadSize;
+    writeLE32(op, crc32c(0, payload, payloadSize));
+    op += STREAM_CHECKSUM_SIZE;
+    cs->producedSize += (size_t)(op - cs->output) - cs->outputSize;
+    cs->outputSize = (size_t)(op - cs->output);
+    return 1;
+}
+
+static int writeFrameBlock(
+    CompStream* cs,
+    CompressionType type,
+    const uint8_t* payload,
+    size_t payloadSize,
+    size_t originalSize,
+    uint64_t originalOffset,
+    uint32_t checksum
+) {
+    if(cs->blockCount == cs->blockCapacity) {
+        uint32_t capacity = cs->blockCapacity ? cs->blockCapacity * 2 : 64;
+        FrameBlock* blocks = realloc(cs->blocks, sizeof(FrameBlock) * capacity);
+        if(!blocks) return 0;
+        cs->blocks = blocks;
+        cs->blockCapacity = capacity;
+    }
+    if(!reserveOutput(cs, payloadSize)) return 0;
+
+    FrameBlock* block = &cs->blocks[cs->blockCount++];
+    block->type = type;
+    block->compressedSize = (uint32_t)payloadSize;
+    block->originalSize = (uint32_t)originalSize;
+    block->offset = cs->producedSize;
+    block->originalOffset = originalOffset;
+    block->checksum = checksum;
+    block->hasChecksum = 1;
+    memcpy(cs->output + cs->outputSize, payload, payloadSize);
+    cs->outputSize += payloadSize;
+    cs->producedSize += payloadSize;
+    return 1;
+}
+
+static int flushFrameBatch(CompStream* cs) {
+    size_t count = (cs->fill + cs->blockSize - 1) / cs->blockSize;
+    uint8_t** outputs = calloc(count, sizeof(uint8_t*));
+    size_t* sizes = calloc(count, sizeof(size_t));
+    CompressionType* types = calloc(count, sizeof(CompressionType));
+    uint32_t* checksums = calloc(count, sizeof(uint32_t));
+    int ok = outputs && sizes && types && checksums;
+    if(ok) frameCompressBlocks(cs->buffer, cs->fill, cs->blockSize, cs->level, outputs, sizes, types, checksums);
+
+    uint64_t batchOffset = cs->totalSize - cs->fill;
+    for(size_t b = 0; ok && b < count; b++) {
+        size_t offset = b * cs->blockSize;
+        size_t length = cs->fill - offset < cs->blockSize ? cs->fill - offset : cs->blockSize;
+        const uint8_t* payload = outputs[b] ? outputs[b] : cs->buffer + offset;
+        ok = sizes[b] && writeFrameBlock(cs, types[b], payload, sizes[b], length, batchOffset + offset, checksums[b]);
+    }
+    if(outputs) {
+        for(size_t b = 0; b < count; b++) free(outputs[b]);
+    }
+    free(outputs);
+    free(sizes);
+    free(types);
+    free(checksums);
+    cs->fill = 0;
+    return ok;
+}
+
+/**
+ * Flush Block
+ * Codes the pending block against the history in front of it, then
+ * slides the last window of input to the front of the buffer.
+ */
+static int flushBlock(CompStream* cs) {
+    if(cs->fill == 0) return 1;
+    if(cs->seekable) return flushFrameBatch(cs);
+
+    const uint8_t* block = cs->buffer + cs->historySize;
+    size_t compressedSize = 0;
+    uint64_t start = statsNow();
+    uint8_t* compressed = lzhCompressWithHistory(
+        block,
+        cs->historySize,
+        cs->fill,
+        &compressedSize,
+        cs->level
+    );
+    statsRecord(COMP_STREAM, cs->fill, compressed ? compressedSize : 0, start);
+
+    int ok;
+    if(compressed && compressedSize < cs->fill) {
+        ok = writeBlock(cs, STREAM_BLOCK_LZH, compressed, compressedSize, cs->fill);
+    } else {
+        if(compressed) statsFallback(COMP_STREAM);
+        ok = writeBlock(cs, STREAM_BLOCK_RAW, block, cs->fill, cs->fill);
+    }
+    free(compressed);
+    if(!ok) return 0;
+
+    size_t total = cs->historySize + cs->fill;
+    size_t keep = total < cs->windowSize ? total : cs->windowSize;
+    memmove(cs->buffer, cs->buffer + total - keep, keep);
+    cs->historySize = keep;
+    cs->fill = 0;
+    return 1;
+}
+
+static int writeHeader(CompStream* cs) {
+    if(!reserveOutput(cs, STREAM_HEADER_SIZE)) return 0;
+    uint8_t* op = cs->output + cs->outputSize;
+    size_t headerSize;
+    if(cs->seekable) {
+        headerSize = frameWriteHeader(op, frameBlockLogForLevel(cs->level), FRAME_FLAG_CHECKSUM);
+    } else {
+        writeLE32(op, STREAM_MAGIC);
+        op[4] = STREAM_VERSION_CHECKSUM;
+        op[5] = (uint8_t)cs->windowLog;
+        headerSize = STREAM_HEADER_SIZE;
+    }
+    cs->outputSize += headerSize;
+    cs->producedSize += headerSize;
+    cs->started = 1;
+    return 1;
+}
+
+/**
+ * Update
+ * Accepts any slice size; output becomes available through csDrain
+ * as each block completes.
+ */
+int csUpdate(
+    CompStream* cs,
+    const uint8_t* data,
+    size_t size
+) {
+    if(!cs || cs->finished) return -1;
+    if(!cs->started && !writeHeader(cs)) return -1;
+
+    while(size > 0) {
+        size_t room = cs->blockSize * cs->batchBlocks - cs->fill;
+        size_t take = size < room ? size : room;
+        memcpy(cs->buffer + cs->historySize + cs->fill, data, take);
+        cs->fill += take;
+        cs->totalSize += take;
+        data += take;
+        size -= take;
+        if(cs->fill == cs->blockSize * cs->batchBlocks && !flushBlock(cs)) {
+            printf("ERROR STREAM: Block flush failed\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finish
+ */
+int csFinish(CompStream* cs) {
+    if(!cs || cs->finished) return -1;
+    if(!cs->started && !writeHeader(cs)) return -1;
+    if(!flushBlock(cs)) return -1;
+
+    size_t tailSize = cs->seekable ? frameIndexSize(cs->blockCount, FRAME_FLAG_CHECKSUM) : 1 + VARINT_MAX_BYTES;
+    if(!reserveOutput(cs, tailSize)) return -1;
+    uint8_t* op = cs->output + cs->outputSize;
+    if(cs->seekable) {
+        op += frameWriteIndex(op, cs->blocks, cs->blockCount, cs->totalSize, FRAME_FLAG_CHECKSUM);
+    } else {
+        *op++ = STREAM_BLOCK_END;
+        op += varintPut(op, cs->totalSize);
+    }
+    cs->producedSize += (size_t)(op - cs->output) - cs->outputSize;
+    cs->outputSize = (size_t)(op - cs->output);
+    cs->finished = 1;
+    return 0;
+}
+
+size_t csPending(const CompStream* cs) {
+    return cs ? cs->outputSize - cs->outputRead : 0;
+}
+
+/**
+ * Drain
+ * Copies up to capacity bytes of finished output into dst.
+ */
+size_t csDrain(
+    CompStream* cs,
+    uint8_t* dst,
+    size_t capacity
+) {
+    size_t pending = csPending(cs);
+    size_t n = pending < capacity ? pending : capacity;
+    if(n == 0) return 0;
+    memcpy(dst, cs->output + cs->outputRead, n);
+    cs->outputRead += n;
+    return n;
+}
+
+/**
+ * Decoded Size
+ * Walks the block headers and checks them against the end marker,
+ * so a stream that passes can be decoded without further bounds
+ * checks on its framing. Returns 0, or -1 when it is malformed.
+ */
+int streamDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    if(size < STREAM_HEADER_SIZE || readLE32(data) != STREAM_MAGIC ||
+        (data[4] != STREAM_VERSION && data[4] != STREAM_VERSION_CHECKSUM)) {
+        printf("ERROR STREAM: Not a compression stream\n");
+        return -1;
+    }
+    size_t checksumSize = data[4] == STREAM_VERSION_CHECKSUM ? STREAM_CHECKSUM_SIZE : 0;
+
+    const uint8_t* end = data + size;
+    const uint8_t* ip = data + STREAM_HEADER_SIZE;
+    uint64_t total = 0;
+    uint64_t declared = 0;
+    size_t n;
+    for(;;) {
+        if(ip >= end) goto corrupt;
+        uint8_t kind = *ip++;
+        if(kind == STREAM_BLOCK_END) {
+            if(!(n = varintGet(ip, end, &declared))) goto corrupt;
+            ip += n;
+            break;
+        }
+        uint64_t originalSize = 0, payloadSize = 0;
+        if(kind != STREAM_BLOCK_RAW && kind != STREAM_BLOCK_LZH) goto corrupt;
+        if(!(n = varintGet(ip, end, &originalSize))) goto corrupt;
+        ip += n;
+        if(!(n = varintGet(ip, end, &payloadSize))) goto corrupt;
+        ip += n;
+        if(payloadSize > (uint64_t)(end - ip) || checksumSize > (uint64_t)(end - ip) - payloadSize) goto corrupt;
+        if(originalSize > ((uint64_t)1 << STREAM_BLOCK_LOG) || originalSize > SIZE_MAX - total) goto corrupt;
+        if(kind == STREAM_BLOCK_RAW && payloadSize != originalSize) goto corrupt;
+        ip += payloadSize + checksumSize;
+        total += originalSize;
+    }
+    if(ip != end || total != declared) goto corrupt;
+    *decodedSize = total;
+    return 0;
+
+corrupt:
+    printf("ERROR STREAM: Corrupt or truncated stream\n");
+    return -1;
+}
+
+/**
+ * Decompress Into
+ * Every block decodes with all earlier output as history. Fails when
+ * the decoded size exceeds capacity.
+ */
+int streamDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t total = 0;
+    if(streamDecodedSize(data, size, &total) != 0 || total > capacity) return -1;
+
+    const uint8_t* end = data + size;
+    const uint8_t* ip = data + STREAM_HEADER_SIZE;
+    size_t checksumSize = data[4] == STREAM_VERSION_CHECKSUM ? STREAM_CHECKSUM_SIZE : 0;
+    uint8_t* op = dst;
+    while(*ip != STREAM_BLOCK_END) {
+        uint8_t kind = *ip++;
+        uint64_t originalSize = 0, payloadSize = 0;
+        ip += varintGet(ip, end, &originalSize);
+        ip += varintGet(ip, end, &payloadSize);
+
+        if(checksumSize && crc32c(0, ip, (size_t)payloadSize) != readLE32(ip + payloadSize)) {
+            printf("ERROR STREAM: Checksum mismatch at input offset %zu\n", (size_t)(ip - data));
+            return -1;
+        }
+        if(kind == STREAM_BLOCK_RAW) {
+            memcpy(op, ip, (size_t)payloadSize);
+        } else {
+            size_t blockSize = 0;
+            int result = lzhDecompressWithHistory(
+                ip,
+                (size_t)payloadSize,
+                op,
+                (size_t)originalSize,
+                (size_t)(op - dst),
+                &blockSize
+            );
+            if(result != 0 || blockSize != originalSize) {
+                printf("ERROR STREAM: Corrupt block at input offset %zu\n", (size_t)(ip - data));
+                return -1;
+            }
+        }
+        op += originalSize;
+        ip += payloadSize + checksumSize;
+    }
+
+    *outputSize = (size_t)total;
+    return 0;
+}
+
+/**
+ * Verify
+ * Checks every block payload against its checksum without decoding.
+ * Returns VERIFY_OK, VERIFY_UNCHECKED for a version 1 stream, or
+ * VERIFY_CORRUPT.
+ */
+int streamVerify(const uint8_t* data, size_t size) {
+    uint64_t total = 0;
+    if(streamDecodedSize(data, size, &total) != 0) return VERIFY_CORRUPT;
+    if(data[4] != STREAM_VERSION_CHECKSUM) return VERIFY_UNCHECKED;
+
+    const uint8_t* end = data + size;
+    const uint8_t* ip = data + STREAM_HEADER_SIZE;
+    while(*ip != STREAM_BLOCK_END) {
+        uint64_t originalSize = 0, payloadSize = 0;
+        ip++;
+        ip += varintGet(ip, end, &originalSize);
+        ip += varintGet(ip, end, &payloadSize);
+        if(crc32c(0, ip, (size_t)payloadSize) != readLE32(ip + payloadSize)) {
+            printf("ERROR STREAM: Checksum mismatch at input offset %zu\n", (size_t)(ip - data));
+            return VERIFY_CORRUPT;
+        }
+        ip += payloadSize + STREAM_CHECKSUM_SIZE;
+    }
+    return VERIFY_OK;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* streamDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t total = 0;
+    if(streamDecodedSize(data, size, &total) != 0) return NULL;
+
+    uint8_t* output = malloc(total ? (size_t)total : 1);
+    if(!output) return NULL;
+    if(streamDecompressInto(data, size, output, (size_t)total, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
\ No newline at end of file
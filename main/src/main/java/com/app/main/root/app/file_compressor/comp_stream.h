@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define STREAM_MAGIC 0x4D545343
+#define STREAM_VERSION 1
+#define STREAM_VERSION_CHECKSUM 2
+#define STREAM_HEADER_SIZE 6
+#define STREAM_CHECKSUM_SIZE 4
+#define STREAM_BLOCK_LOG 20
+#define STREAM_BLOCK_RAW 0
+#define STREAM_BLOCK_LZH 1
+#define STREAM_BLOCK_END 0xFF
+#define STREAM_SEEKABLE_THRESHOLD ((uint64_t)32 << 20)
+#define STREAM_SEEKABLE_BATCH_MAX 16
+
+/**
+ * Streaming compressor (COMP_STREAM).
+ * Input is fed in arbitrary slices and cut into STREAM_BLOCK_LOG
+ * blocks; each block is LZH-coded with the previous window of input
+ * as history, so matches cross slice and block boundaries while the
+ * context only ever holds one window plus one block.
+ *
+ * Header: u32 magic "CSTM", u8 version, u8 window log.
+ * Blocks: u8 kind, varint original size, varint payload size, payload.
+ * STREAM_BLOCK_END carries a varint total size and ends the stream.
+ * Version 2, written by default, follows each payload with its
+ * CRC32C; version 1 streams without it are still read.
+ *
+ * csCreateSeekable produces a seekable COMP_FRAME instead, for
+ * inputs of STREAM_SEEKABLE_THRESHOLD and above. Its blocks are
+ * compressed in batches of up to STREAM_SEEKABLE_BATCH_MAX on the
+ * shared thread pool.
+ */
+typedef struct CompStream CompStream;
+
+CompStream* csCreate(int level);
+CompStream* csCreateSeekable(int level);
+void csDestroy(CompStream* cs);
+int csUpdate(
+    CompStream* cs,
+    const uint8_t* data,
+    size_t size
+);
+int csFinish(CompStream* cs);
+size_t csPending(const CompStream* cs);
+size_t csDrain(
+    CompStream* cs,
+    uint8_t* dst,
+    size_t capacity
+);
+uint8_t* streamDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int streamVerify(const uint8_t* data, size_t size);
+int streamDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+);
+int streamDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdio.h>
+
+/**
+ * Debug Log
+ * Progress output on stdout, compiled in only with -DCOMP_DEBUG
+ * (build.bat debug). Arguments stay type-checked either way.
+ */
+#ifdef COMP_DEBUG
+    #define COMP_DEBUG_ENABLED 1
+#else
+    #define COMP_DEBUG_ENABLED 0
+#endif
+
+#define DEBUG_LOG(...) do { if(COMP_DEBUG_ENABLED) printf(__VA_ARGS__); } while(0)
\ No newline at end of file
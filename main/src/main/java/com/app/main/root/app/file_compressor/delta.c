@@ -29,6 +29,24 @@ uint8_t* deltaCompress(
     return outputBuffer;
 }
 
+/**
+ * Decompress Into
+ * The output is exactly as long as the input.
+ */
+int deltaDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    if(size > capacity) return -1;
+    deltaDecodeStride(data, dst, size, 1, 1);
+    *outputSize = size;
+    return 0;
+}
+
 /**
  * Decompress
  */
@@ -37,20 +55,190 @@ uint8_t* deltaDecompress(
     size_t size,
     size_t* outputSize
 ) {
-    if(size == 0) {
-        *outputSize = 0;
-        return NULL;
-    }
+    *outputSize = 0;
+    if(size == 0) return NULL;
 
     uint8_t* outputBuffer = malloc(size);
-    outputBuffer[0] = data[0];
+    if(!outputBuffer) return NULL;
+    deltaDecompressInto(data, size, outputBuffer, size, outputSize);
+    return outputBuffer;
+}
 
-    for(size_t i = 1; i < size; i++) {
-        int16_t val = (int16_t)outputBuffer[i-1] + (int8_t)data[i];
-        outputBuffer[i] = (uint8_t)(val & 0xFF);
+
+// Platform-specific includes and types
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define DELTA_SSE2 1
+#endif
+
+static uint32_t loadSample(const uint8_t* p, int width) {
+    if(width == 1) return p[0];
+    if(width == 2) return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void storeSample(uint8_t* p, uint32_t value, int width) {
+    p[0] = (uint8_t)value;
+    if(width >= 2) p[1] = (uint8_t)(value >> 8);
+    if(width == 4) {
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
     }
+}
 
-    *outputSize = size;
-    return outputBuffer;
+#ifdef DELTA_SSE2
+static inline __m128i addLanes(__m128i a, __m128i b, int width) {
+    if(width == 1) return _mm_add_epi8(a, b);
+    if(width == 2) return _mm_add_epi16(a, b);
+    return _mm_add_epi32(a, b);
+}
+
+static inline __m128i subLanes(__m128i a, __m128i b, int width) {
+    if(width == 1) return _mm_sub_epi8(a, b);
+    if(width == 2) return _mm_sub_epi16(a, b);
+    return _mm_sub_epi32(a, b);
+}
+
+/**
+ * Shift Left
+ * _mm_slli_si128 takes an immediate; the stride is fixed for a whole
+ * call, so the switch is always predicted.
+ */
+static inline __m128i shiftLeft(__m128i v, size_t bytes) {
+    switch(bytes) {
+        case 1: return _mm_slli_si128(v, 1);
+        case 2: return _mm_slli_si128(v, 2);
+        case 3: return _mm_slli_si128(v, 3);
+        case 4: return _mm_slli_si128(v, 4);
+        case 5: return _mm_slli_si128(v, 5);
+        case 6: return _mm_slli_si128(v, 6);
+        case 7: return _mm_slli_si128(v, 7);
+        case 8: return _mm_slli_si128(v, 8);
+        case 9: return _mm_slli_si128(v, 9);
+        case 10: return _mm_slli_si128(v, 10);
+        case 11: return _mm_slli_si128(v, 11);
+        case 12: return _mm_slli_si128(v, 12);
+        case 13: return _mm_slli_si128(v, 13);
+        case 14: return _mm_slli_si128(v, 14);
+        case 15: return _mm_slli_si128(v, 15);
+        default: return _mm_setzero_si128();
+    }
+}
+
+static inline __m128i shiftRight(__m128i v, size_t bytes) {
+    switch(bytes) {
+        case 0: return v;
+        case 1: return _mm_srli_si128(v, 1);
+        case 2: return _mm_srli_si128(v, 2);
+        case 3: return _mm_srli_si128(v, 3);
+        case 4: return _mm_srli_si128(v, 4);
+        case 5: return _mm_srli_si128(v, 5);
+        case 6: return _mm_srli_si128(v, 6);
+        case 7: return _mm_srli_si128(v, 7);
+        case 8: return _mm_srli_si128(v, 8);
+        case 9: return _mm_srli_si128(v, 9);
+        case 10: return _mm_srli_si128(v, 10);
+        case 11: return _mm_srli_si128(v, 11);
+        case 12: return _mm_srli_si128(v, 12);
+        case 13: return _mm_srli_si128(v, 13);
+        case 14: return _mm_srli_si128(v, 14);
+        case 15: return _mm_srli_si128(v, 15);
+        default: return _mm_setzero_si128();
+    }
 }
 
+static inline __m128i replicate(__m128i v, size_t stride) {
+    for(size_t shift = stride; shift < 16; shift *= 2) v = _mm_or_si128(v, shiftLeft(v, shift));
+    return v;
+}
+#endif
+
+/**
+ * Encode Stride
+ * Both operands are read from src, so every 16 bytes are one
+ * unaligned subtract at the sample width.
+ */
+void deltaEncodeStride(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    int width,
+    size_t channels
+) {
+    size_t stride = (size_t)width * channels;
+    size_t end = size - size % (size_t)width;
+    if(stride >= end) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    memcpy(dst, src, stride);
+    size_t i = stride;
+#ifdef DELTA_SSE2
+    for(; i + 16 <= end; i += 16) {
+        __m128i cur = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i prev = _mm_loadu_si128((const __m128i*)(src + i - stride));
+        _mm_storeu_si128((__m128i*)(dst + i), subLanes(cur, prev, width));
+    }
+#endif
+    for(; i < end; i += width) {
+        storeSample(dst + i, loadSample(src + i, width) - loadSample(src + i - stride, width), width);
+    }
+    memcpy(dst + end, src + end, size - end);
+}
+
+/**
+ * Decode Stride
+ * Strides of 16 bytes and more are a plain vertical add against
+ * earlier output. Shorter strides take a log-step prefix sum inside
+ * each vector, shifting by stride, 2 * stride, ..., then add the last
+ * stride bytes of output, kept in a register and replicated across
+ * the vector; the vector then advances by the largest multiple of
+ * stride that fits, and the bytes past it are rewritten by the next
+ * step.
+ */
+void deltaDecodeStride(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    int width,
+    size_t channels
+) {
+    size_t stride = (size_t)width * channels;
+    size_t end = size - size % (size_t)width;
+    if(stride >= end) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    memcpy(dst, src, stride);
+    size_t i = stride;
+#ifdef DELTA_SSE2
+    if(stride >= 16) {
+        for(; i + 16 <= end; i += 16) {
+            __m128i delta = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i prev = _mm_loadu_si128((const __m128i*)(dst + i - stride));
+            _mm_storeu_si128((__m128i*)(dst + i), addLanes(delta, prev, width));
+        }
+    } else {
+        size_t step = 16 - 16 % stride;
+        uint8_t maskBytes[16] = {0};
+        uint8_t firstBytes[16] = {0};
+        memset(maskBytes, 0xFF, stride);
+        memcpy(firstBytes, dst, stride);
+        __m128i mask = _mm_loadu_si128((const __m128i*)maskBytes);
+        __m128i carry = replicate(_mm_loadu_si128((const __m128i*)firstBytes), stride);
+        for(; i + 16 <= end; i += step) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+            for(size_t shift = stride; shift < 16; shift *= 2) v = addLanes(v, shiftLeft(v, shift), width);
+            v = addLanes(v, carry, width);
+            _mm_storeu_si128((__m128i*)(dst + i), v);
+            carry = replicate(_mm_and_si128(shiftRight(v, step - stride), mask), stride);
+        }
+    }
+#endif
+    for(; i < end; i += width) {
+        storeSample(dst + i, loadSample(src + i, width) + loadSample(dst + i - stride, width), width);
+    }
+    memcpy(dst + end, src + end, size - end);
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#define DELTA_MAX_WIDTH 4
+
 uint8_t* deltaCompress(
     const uint8_t* data, 
     size_t size, 
@@ -11,4 +13,34 @@ uint8_t* deltaDecompress(
     const uint8_t* data, 
     size_t size, 
     size_t* outputSize
+);
+int deltaDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+
+/**
+ * Strided delta over interleaved samples.
+ * Samples are width bytes (1, 2 or 4, little endian) and every
+ * sample is coded against the one channels samples before it, with
+ * wrap-around arithmetic at the sample width; the first channels
+ * samples and any trailing partial sample pass through. dst and src
+ * must not overlap.
+ */
+void deltaEncodeStride(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    int width,
+    size_t channels
+);
+void deltaDecodeStride(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t size,
+    int width,
+    size_t channels
 );
\ No newline at end of file
@@ -0,0 +1,586 @@
+#include "dict.h"
+#include "frame.h"
+#include "lzh.h"
+#include "bitstream.h"
+#include "varint.h"
+#include "stats.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Platform-specific includes and types
+#ifdef _WIN32
+    #include <windows.h>
+    typedef SRWLOCK lock_t;
+    #define LOCK_INITIALIZER SRWLOCK_INIT
+    #define LOCK(l) AcquireSRWLockExclusive(&(l))
+    #define UNLOCK(l) ReleaseSRWLockExclusive(&(l))
+#else
+    #include <pthread.h>
+    #include <dirent.h>
+    typedef pthread_mutex_t lock_t;
+    #define LOCK_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+    #define LOCK(l) pthread_mutex_lock(&(l))
+    #define UNLOCK(l) pthread_mutex_unlock(&(l))
+#endif
+
+#define DICT_DMER 8
+#define DICT_SEGMENT_SIZE 256
+#define DICT_HASH_LOG 20
+#define DICT_NO_DMER UINT32_MAX
+#define DICT_MIN_SAMPLES 8
+#define DICT_MAX_TRAINING (8 * 1024 * 1024)
+
+static const char* familyNames[DICT_FAMILY_COUNT] = { "none", "json", "xml", "csv", "text" };
+
+static lock_t registryLock = LOCK_INITIALIZER;
+static lock_t publishLock = LOCK_INITIALIZER;
+static Dictionary* registry[DICT_MAX_ENTRIES];
+static int registryCount = 0;
+
+static uint32_t fnv1a(const uint8_t* data, size_t size) {
+    uint32_t hash = 0x811C9DC5;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static inline uint32_t hashDmer(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return (uint32_t)((value * 0x9E3779B185EBCA87ULL) >> (64 - DICT_HASH_LOG));
+}
+
+typedef struct {
+    size_t start;
+    size_t length;
+    uint64_t score;
+} DictSegment;
+
+static int compareSegments(const void* a, const void* b) {
+    const DictSegment* x = (const DictSegment*)a;
+    const DictSegment* y = (const DictSegment*)b;
+    if(x->score != y->score) return x->score < y->score ? -1 : 1;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/**
+ * Best Segment
+ * Slides a DICT_SEGMENT_SIZE window over [begin, end) and returns the
+ * start of the window whose distinct dmers have the highest summed
+ * frequency; active counts dmer occurrences inside the window.
+ */
+static uint64_t bestSegment(
+    const uint32_t* dmers,
+    const uint32_t* freq,
+    uint32_t* active,
+    size_t begin,
+    size_t end,
+    size_t* bestStart
+) {
+    const size_t span = DICT_SEGMENT_SIZE - DICT_DMER + 1;
+    uint64_t score = 0;
+    uint64_t best = 0;
+    size_t left = begin;
+    *bestStart = begin;
+
+    for(size_t p = begin; p < end; p++) {
+        uint32_t h = dmers[p];
+        if(h != DICT_NO_DMER && active[h]++ == 0) score += freq[h];
+        if(p - left + 1 > span) {
+            h = dmers[left++];
+            if(h != DICT_NO_DMER && --active[h] == 0) score -= freq[h];
+        }
+        if(p - left + 1 == span && score > best) {
+            best = score;
+            *bestStart = left;
+        }
+    }
+    while(left < end) {
+        uint32_t h = dmers[left++];
+        if(h != DICT_NO_DMER) active[h]--;
+    }
+    return best;
+}
+
+/**
+ * Train
+ * COVER-style segment selection over the concatenated samples:
+ * dmers are scored by how many samples contain them, the input is
+ * split into one epoch per segment slot and each epoch contributes
+ * its best segment, after which that segment's dmers score zero so
+ * later epochs pick different content. Segments are laid out with
+ * the highest scores last, nearest the data and at the shortest
+ * offsets. Returns the dictionary size, 0 when the samples are too
+ * few or share nothing.
+ */
+size_t dictTrain(
+    const uint8_t* samples,
+    const size_t* sampleSizes,
+    size_t sampleCount,
+    uint8_t* dict,
+    size_t capacity
+) {
+    if(sampleCount < DICT_MIN_SAMPLES || capacity < DICT_SEGMENT_SIZE) return 0;
+    if(capacity > DICT_MAX_SIZE) capacity = DICT_MAX_SIZE;
+
+    size_t total = 0;
+    size_t used = 0;
+    while(used < sampleCount && total + sampleSizes[used] <= DICT_MAX_TRAINING) {
+        total += sampleSizes[used++];
+    }
+    if(used < DICT_MIN_SAMPLES || total < DICT_SEGMENT_SIZE) return 0;
+
+    const size_t tableSize = (size_t)1 << DICT_HASH_LOG;
+    uint32_t* dmers = malloc(total * sizeof(uint32_t));
+    uint32_t* freq = calloc(tableSize, sizeof(uint32_t));
+    uint32_t* stamp = calloc(tableSize, sizeof(uint32_t));
+    size_t epochs = capacity / DICT_SEGMENT_SIZE;
+    DictSegment* segments = malloc(epochs * sizeof(DictSegment));
+    size_t dictSize = 0;
+    if(!dmers || !freq || !stamp || !segments) goto done;
+
+    size_t pos = 0;
+    for(size_t s = 0; s < used; s++) {
+        size_t end = pos + sampleSizes[s];
+        for(; pos < end; pos++) {
+            if(end - pos < DICT_DMER) {
+                dmers[pos] = DICT_NO_DMER;
+                continue;
+            }
+            uint32_t h = hashDmer(samples + pos);
+            dmers[pos] = h;
+            if(stamp[h] != (uint32_t)s + 1) {
+                stamp[h] = (uint32_t)s + 1;
+                freq[h]++;
+            }
+        }
+    }
+    for(size_t h = 0; h < tableSize; h++) {
+        if(freq[h] < 2) freq[h] = 0;
+    }
+    memset(stamp, 0, tableSize * sizeof(uint32_t));
+
+    size_t epochSize = total / epochs;
+    if(epochSize < DICT_SEGMENT_SIZE) {
+        epochSize = DICT_SEGMENT_SIZE;
+        epochs = total / epochSize;
+    }
+
+    size_t segmentCount = 0;
+    for(size_t e = 0; e < epochs; e++) {
+        size_t begin = e * epochSize;
+        size_t end = e + 1 == epochs ? total : begin + epochSize;
+        size_t start;
+        uint64_t score = bestSegment(dmers, freq, stamp, begin, end, &start);
+        if(score == 0) continue;
+
+        size_t length = total - start < DICT_SEGMENT_SIZE ? total - start : DICT_SEGMENT_SIZE;
+        for(size_t p = start; p + DICT_DMER <= start + length; p++) {
+            if(dmers[p] != DICT_NO_DMER) freq[dmers[p]] = 0;
+        }
+        segments[segmentCount].start = start;
+        segments[segmentCount].length = length;
+        segments[segmentCount].score = score;
+        segmentCount++;
+    }
+
+    qsort(segments, segmentCount, sizeof(DictSegment), compareSegments);
+    for(size_t i = 0; i < segmentCount; i++) {
+        memcpy(dict + dictSize, samples + segments[i].start, segments[i].length);
+        dictSize += segments[i].length;
+    }
+    DEBUG_LOG("DEBUG C: Trained %zu byte dictionary from %zu samples (%zu bytes)\n",
+           dictSize, used, total);
+
+done:
+    free(dmers);
+    free(freq);
+    free(stamp);
+    free(segments);
+    return dictSize;
+}
+
+/**
+ * Register
+ * Adds a dictionary to the process-wide registry. Entries are never
+ * removed, so returned pointers stay valid without holding the lock;
+ * registering a known id returns the existing entry.
+ */
+const Dictionary* dictRegister(
+    uint32_t id,
+    const uint8_t* data,
+    size_t size
+) {
+    if(size == 0 || size > DICT_MAX_SIZE || (id & 0xFF) == 0 || (id & 0xFF) >= DICT_FAMILY_COUNT) {
+        return NULL;
+    }
+
+    Dictionary* entry = NULL;
+    LOCK(registryLock);
+    for(int i = 0; i < registryCount; i++) {
+        if(registry[i]->id == id) {
+            entry = registry[i];
+            goto unlock;
+        }
+    }
+    if(registryCount == DICT_MAX_ENTRIES) goto unlock;
+
+    entry = malloc(sizeof(Dictionary));
+    uint8_t* copy = malloc(size);
+    if(!entry || !copy) {
+        free(entry);
+        free(copy);
+        entry = NULL;
+        goto unlock;
+    }
+    memcpy(copy, data, size);
+    entry->id = id;
+    entry->checksum = fnv1a(copy, size);
+    entry->size = size;
+    entry->data = copy;
+    registry[registryCount++] = entry;
+    DEBUG_LOG("DEBUG C: Registered %s dictionary v%u (%zu bytes)\n",
+           familyNames[id & 0xFF], id >> 8, size);
+
+unlock:
+    UNLOCK(registryLock);
+    return entry;
+}
+
+const Dictionary* dictFind(uint32_t id) {
+    const Dictionary* entry = NULL;
+    LOCK(registryLock);
+    for(int i = 0; i < registryCount; i++) {
+        if(registry[i]->id == id) {
+            entry = registry[i];
+            break;
+        }
+    }
+    UNLOCK(registryLock);
+    return entry;
+}
+
+/**
+ * For Family
+ * Latest version trained for the family, NULL when there is none.
+ */
+const Dictionary* dictForFamily(int family) {
+    const Dictionary* entry = NULL;
+    LOCK(registryLock);
+    for(int i = 0; i < registryCount; i++) {
+        if((int)(registry[i]->id & 0xFF) == family && (!entry || registry[i]->id > entry->id)) {
+            entry = registry[i];
+        }
+    }
+    UNLOCK(registryLock);
+    return entry;
+}
+
+int dictVersionCount(int family) {
+    int count = 0;
+    LOCK(registryLock);
+    for(int i = 0; i < registryCount; i++) {
+        if((int)(registry[i]->id & 0xFF) == family) count++;
+    }
+    UNLOCK(registryLock);
+    return count;
+}
+
+uint32_t dictNextId(int family) {
+    const Dictionary* latest = dictForFamily(family);
+    uint32_t version = latest ? (latest->id >> 8) + 1 : 1;
+    return version << 8 | (uint32_t)family;
+}
+
+/**
+ * Save
+ * Writes <family>-<version>.dict into directory. Returns 0, or -1
+ * with any partial file removed.
+ */
+int dictSave(
+    const char* directory,
+    const Dictionary* dict
+) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s-%u.dict", directory, familyNames[dict->id & 0xFF], dict->id >> 8);
+    FILE* file = fopen(path, "wb");
+    if(!file) {
+        printf("ERROR DICT: Cannot write %s\n", path);
+        return -1;
+    }
+
+    uint8_t header[DICT_FILE_HEADER_SIZE];
+    writeLE32(header, DICT_MAGIC);
+    writeLE32(header + 4, dict->id);
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+        fwrite(dict->data, 1, dict->size, file) == dict->size;
+    ok = fclose(file) == 0 && ok;
+    if(!ok) {
+        printf("ERROR DICT: Cannot write %s\n", path);
+        remove(path);
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * Publish
+ * Saves a trained dictionary as the next version of its family and
+ * registers it only once the file is written, so no upload is coded
+ * with a dictionary that a restart would not load again. Publishing
+ * is serialised so two trainings never claim the same version, and
+ * refused once the family holds DICT_MAX_VERSIONS. Returns the
+ * registered entry, or NULL with nothing registered.
+ */
+const Dictionary* dictPublish(
+    const char* directory,
+    int family,
+    const uint8_t* data,
+    size_t size
+) {
+    if(size == 0 || size > DICT_MAX_SIZE || family <= 0 || family >= DICT_FAMILY_COUNT) return NULL;
+
+    LOCK(publishLock);
+    if(dictVersionCount(family) >= DICT_MAX_VERSIONS) {
+        printf("ERROR DICT: %s already has %d dictionary versions, keeping the current one\n",
+               familyNames[family], DICT_MAX_VERSIONS);
+        UNLOCK(publishLock);
+        return NULL;
+    }
+    Dictionary candidate;
+    candidate.id = dictNextId(family);
+    candidate.checksum = fnv1a(data, size);
+    candidate.size = size;
+    candidate.data = (uint8_t*)data;
+    const Dictionary* entry = dictSave(directory, &candidate) == 0
+        ? dictRegister(candidate.id, data, size)
+        : NULL;
+    UNLOCK(publishLock);
+    return entry;
+}
+
+static int loadFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if(!file) return 0;
+
+    const size_t capacity = DICT_FILE_HEADER_SIZE + DICT_MAX_SIZE + 1;
+    uint8_t* buffer = malloc(capacity);
+    size_t size = buffer ? fread(buffer, 1, capacity, file) : 0;
+    fclose(file);
+    int loaded = 0;
+    if(size <= DICT_FILE_HEADER_SIZE || size >= capacity || readLE32(buffer) != DICT_MAGIC) {
+        printf("ERROR DICT: Invalid dictionary file %s\n", path);
+    } else {
+        loaded = dictRegister(readLE32(buffer + 4), buffer + DICT_FILE_HEADER_SIZE, size - DICT_FILE_HEADER_SIZE) != NULL;
+    }
+    free(buffer);
+    return loaded;
+}
+
+/**
+ * Load Directory
+ * Registers every *.dict file in directory; returns how many loaded.
+ */
+int dictLoadDirectory(const char* directory) {
+    char path[1024];
+    int loaded = 0;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    snprintf(path, sizeof(path), "%s\\*.dict", directory);
+    HANDLE find = FindFirstFileA(path, &entry);
+    if(find == INVALID_HANDLE_VALUE) return 0;
+    do {
+        snprintf(path, sizeof(path), "%s\\%s", directory, entry.cFileName);
+        loaded += loadFile(path);
+    } while(FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    DIR* dir = opendir(directory);
+    if(!dir) return 0;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if(length <= 5 || strcmp(entry->d_name + length - 5, ".dict") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        loaded += loadFile(path);
+    }
+    closedir(dir);
+#endif
+    DEBUG_LOG("DEBUG C: Loaded %d dictionaries from %s\n", loaded, directory);
+    return loaded;
+}
+
+/**
+ * Compress
+ * LZH with the dictionary as history: data is coded as if it
+ * followed the dictionary content. Inputs are at most
+ * DICT_MAX_INPUT, which bounds the decoder's allocation.
+ */
+uint8_t* dictCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    const Dictionary* dict,
+    int level
+) {
+    *outputSize = 0;
+    if(size == 0 || size > DICT_MAX_INPUT) return NULL;
+    uint8_t* window = malloc(dict->size + size);
+    if(!window) return NULL;
+    memcpy(window, dict->data, dict->size);
+    memcpy(window + dict->size, data, size);
+
+    size_t payloadSize = 0;
+    uint8_t* payload = lzhCompressWithHistory(window + dict->size, dict->size, size, &payloadSize, level);
+    free(window);
+    if(!payload) return NULL;
+
+    uint8_t* output = malloc(DICT_HEADER_SIZE + payloadSize);
+    if(output) {
+        writeLE32(output, dict->id);
+        writeLE32(output + 4, dict->checksum);
+        memcpy(output + DICT_HEADER_SIZE, payload, payloadSize);
+        *outputSize = DICT_HEADER_SIZE + payloadSize;
+    }
+    free(payload);
+    return output;
+}
+
+/**
+ * Decoded Size
+ */
+int dictDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    if(size <= DICT_HEADER_SIZE) return -1;
+    return varintGet(data + DICT_HEADER_SIZE, data + size, decodedSize) ? 0 : -1;
+}
+
+/**
+ * Decode Window
+ * Returns the dictionary followed by the decoded data. Fails when
+ * the dictionary named in the header is not loaded or its content
+ * does not match the checksum.
+ */
+static uint8_t* decodeWindow(
+    const uint8_t* data,
+    size_t size,
+    size_t capacity,
+    const Dictionary** used,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize = 0;
+    if(dictDecodedSize(data, size, &decodedSize) != 0 || decodedSize == 0 ||
+        decodedSize > DICT_MAX_INPUT) goto corrupt;
+    if(decodedSize > capacity) return NULL;
+
+    uint32_t id = readLE32(data);
+    const Dictionary* dict = dictFind(id);
+    if(!dict) {
+        printf("ERROR DICT: Dictionary %s v%u is not loaded\n",
+               familyNames[(id & 0xFF) < DICT_FAMILY_COUNT ? id & 0xFF : 0], id >> 8);
+        return NULL;
+    }
+    if(dict->checksum != readLE32(data + 4)) {
+        printf("ERROR DICT: Dictionary checksum mismatch for id %08x\n", id);
+        return NULL;
+    }
+
+    uint8_t* window = malloc(dict->size + (size_t)decodedSize);
+    if(!window) return NULL;
+    memcpy(window, dict->data, dict->size);
+    size_t written = 0;
+    if(lzhDecompressWithHistory(data + DICT_HEADER_SIZE, size - DICT_HEADER_SIZE, window + dict->size,
+        (size_t)decodedSize, dict->size, &written) != 0 || written != decodedSize) {
+        free(window);
+        goto corrupt;
+    }
+    *used = dict;
+    *outputSize = written;
+    return window;
+
+corrupt:
+    printf("ERROR DICT: Corrupt or truncated data\n");
+    return NULL;
+}
+
+/**
+ * Decompress Into
+ * Decodes next to the dictionary and copies out, as matches need the
+ * dictionary directly in front of the output; inputs are small.
+ */
+int dictDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    const Dictionary* dict = NULL;
+    size_t written = 0;
+    uint8_t* window = decodeWindow(data, size, capacity, &dict, &written);
+    *outputSize = 0;
+    if(!window) return -1;
+    memcpy(dst, window + dict->size, written);
+    free(window);
+    *outputSize = written;
+    return 0;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* dictDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    const Dictionary* dict = NULL;
+    uint8_t* window = decodeWindow(data, size, DICT_MAX_INPUT, &dict, outputSize);
+    if(!window) return NULL;
+    memmove(window, window + dict->size, *outputSize);
+    return window;
+}
+
+/**
+ * Compress With Dictionary
+ * compressParallelOrStore() unless the family has a dictionary and
+ * the input is at most DICT_MAX_INPUT; then whichever of the two is
+ * smaller, so a poor dictionary never makes a file larger. Stored
+ * input comes back as NULL with COMP_NONE, without a copy.
+ */
+uint8_t* compressWithDictionary(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level,
+    int family
+) {
+    uint8_t* plain = compressParallelOrStore(data, size, outputSize, usedType, level);
+    const Dictionary* dict = dictForFamily(family);
+    if(*outputSize == 0 || !dict || size > DICT_MAX_INPUT) return plain;
+
+    size_t dictSize = 0;
+    uint64_t start = statsNow();
+    uint8_t* withDict = dictCompress(data, size, &dictSize, dict, level);
+    statsRecord(COMP_DICT, size, withDict ? dictSize : 0, start);
+    if(!withDict || dictSize >= *outputSize) {
+        free(withDict);
+        return plain;
+    }
+
+    DEBUG_LOG("DEBUG C: Dictionary %s v%u: %zu -> %zu bytes\n",
+           familyNames[family], dict->id >> 8, *outputSize, dictSize);
+    free(plain);
+    *outputSize = dictSize;
+    *usedType = COMP_DICT;
+    return withDict;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "comp.h"
+
+#define DICT_MAGIC 0x43494443
+#define DICT_FILE_HEADER_SIZE 8
+#define DICT_HEADER_SIZE 8
+#define DICT_DEFAULT_SIZE (32 * 1024)
+#define DICT_MAX_SIZE (64 * 1024)
+#define DICT_MAX_INPUT (128 * 1024)
+#define DICT_MAX_ENTRIES 256
+#define DICT_FAMILY_JSON 1
+#define DICT_FAMILY_XML 2
+#define DICT_FAMILY_CSV 3
+#define DICT_FAMILY_TEXT 4
+#define DICT_FAMILY_COUNT 5
+#define DICT_MAX_VERSIONS (DICT_MAX_ENTRIES / (DICT_FAMILY_COUNT - 1))
+
+/**
+ * Shared dictionaries for small inputs (COMP_DICT).
+ * A dictionary is trained per MIME family from sample files and
+ * primes the LZ window, so even a first occurrence can be a match.
+ * The ID keeps the family in its low 8 bits and a version above it;
+ * files stay decodable as long as the dictionary they name is
+ * loaded, so older versions are kept next to newer ones and never
+ * evicted. Each family gets an equal share of the registry,
+ * DICT_MAX_VERSIONS; once a family has that many, publishing fails
+ * and its newest version stays in use.
+ *
+ * Dictionary file: u32 magic "CDIC", u32 id, content.
+ * Header: u32 dictionary id, u32 FNV-1a of the dictionary content;
+ * an LZH payload coded with the dictionary as history follows.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t checksum;
+    size_t size;
+    uint8_t* data;
+} Dictionary;
+
+size_t dictTrain(
+    const uint8_t* samples,
+    const size_t* sampleSizes,
+    size_t sampleCount,
+    uint8_t* dict,
+    size_t capacity
+);
+const Dictionary* dictRegister(
+    uint32_t id,
+    const uint8_t* data,
+    size_t size
+);
+const Dictionary* dictFind(uint32_t id);
+const Dictionary* dictForFamily(int family);
+int dictVersionCount(int family);
+uint32_t dictNextId(int family);
+int dictSave(
+    const char* directory,
+    const Dictionary* dict
+);
+const Dictionary* dictPublish(
+    const char* directory,
+    int family,
+    const uint8_t* data,
+    size_t size
+);
+int dictLoadDirectory(const char* directory);
+uint8_t* dictCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    const Dictionary* dict,
+    int level
+);
+uint8_t* dictDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int dictDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+);
+int dictDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+uint8_t* compressWithDictionary(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level,
+    int family
+);
\ No newline at end of file
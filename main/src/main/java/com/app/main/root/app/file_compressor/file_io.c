@@ -0,0 +1,276 @@
+#include "file_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Platform-specific includes and types
+#ifdef _WIN32
+    #include <windows.h>
+    #include <malloc.h>
+    #define ALIGNED_ALLOC(p, a, n) (((p) = _aligned_malloc((n), (a))) != NULL)
+    #define ALIGNED_FREE(p) _aligned_free(p)
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define ALIGNED_ALLOC(p, a, n) (posix_memalign((void**)&(p), (a), (n)) == 0)
+    #define ALIGNED_FREE(p) free(p)
+#endif
+
+struct MappedFile {
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    uint64_t size;
+    uint8_t* view;
+    size_t viewSize;
+};
+
+struct FileWriter {
+    FILE* file;
+    uint8_t* buffer;
+    size_t fill;
+    uint64_t written;
+    int failed;
+};
+
+static const uint8_t emptyView[1] = { 0 };
+
+/**
+ * Open
+ * Returns NULL when the file cannot be opened; an empty file opens
+ * with nothing mapped.
+ */
+MappedFile* mfOpen(const char* path) {
+    MappedFile* mf = calloc(1, sizeof(MappedFile));
+    if(!mf) return NULL;
+
+#ifdef _WIN32
+    mf->file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    LARGE_INTEGER size;
+    if(mf->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mf->file, &size)) {
+        if(mf->file != INVALID_HANDLE_VALUE) CloseHandle(mf->file);
+        free(mf);
+        return NULL;
+    }
+    mf->size = (uint64_t)size.QuadPart;
+    if(mf->size > 0) {
+        mf->mapping = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(!mf->mapping) {
+            CloseHandle(mf->file);
+            free(mf);
+            return NULL;
+        }
+    }
+#else
+    mf->fd = open(path, O_RDONLY);
+    struct stat st;
+    if(mf->fd < 0 || fstat(mf->fd, &st) != 0) {
+        if(mf->fd >= 0) close(mf->fd);
+        free(mf);
+        return NULL;
+    }
+    mf->size = (uint64_t)st.st_size;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(mf->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+    return mf;
+}
+
+/**
+ * Size
+ */
+uint64_t mfSize(const MappedFile* mf) {
+    return mf->size;
+}
+
+static void unmapView(MappedFile* mf) {
+    if(!mf->view) return;
+#ifdef _WIN32
+    UnmapViewOfFile(mf->view);
+#else
+    munmap(mf->view, mf->viewSize);
+#endif
+    mf->view = NULL;
+    mf->viewSize = 0;
+}
+
+/**
+ * View
+ * Maps [offset, offset + length) and returns a pointer to offset,
+ * valid until the next mfView() or mfClose(). NULL when the range
+ * lies outside the file or cannot be mapped.
+ */
+const uint8_t* mfView(
+    MappedFile* mf,
+    uint64_t offset,
+    size_t length
+) {
+    if(offset > mf->size || length > mf->size - offset) {
+        printf("ERROR IO: View outside the file\n");
+        return NULL;
+    }
+    unmapView(mf);
+    if(length == 0) return emptyView;
+
+    uint64_t base = offset & ~(FILE_MAP_ALIGN - 1);
+    size_t lead = (size_t)(offset - base);
+    if(length > SIZE_MAX - lead) return NULL;
+    size_t viewSize = lead + length;
+
+#ifdef _WIN32
+    uint8_t* view = MapViewOfFile(
+        mf->mapping,
+        FILE_MAP_READ,
+        (DWORD)(base >> 32),
+        (DWORD)base,
+        viewSize
+    );
+    if(!view) {
+        printf("ERROR IO: MapViewOfFile failed: %lu\n", GetLastError());
+        return NULL;
+    }
+#else
+    uint8_t* view = mmap(NULL, viewSize, PROT_READ, MAP_PRIVATE, mf->fd, (off_t)base);
+    if(view == MAP_FAILED) {
+        printf("ERROR IO: mmap failed for size: %zu\n", viewSize);
+        return NULL;
+    }
+    madvise(view, viewSize, MADV_SEQUENTIAL);
+#endif
+    mf->view = view;
+    mf->viewSize = viewSize;
+    return view + lead;
+}
+
+/**
+ * Close
+ */
+void mfClose(MappedFile* mf) {
+    if(!mf) return;
+    unmapView(mf);
+#ifdef _WIN32
+    if(mf->mapping) CloseHandle(mf->mapping);
+    CloseHandle(mf->file);
+#else
+    close(mf->fd);
+#endif
+    free(mf);
+}
+
+/**
+ * Open
+ * stdio buffering is turned off; every write already comes in
+ * FILE_WRITE_BUFFER pieces.
+ */
+FileWriter* fwOpen(const char* path) {
+    FileWriter* fw = calloc(1, sizeof(FileWriter));
+    if(!fw) return NULL;
+    if(!ALIGNED_ALLOC(fw->buffer, FILE_WRITE_ALIGN, FILE_WRITE_BUFFER)) {
+        free(fw);
+        return NULL;
+    }
+    fw->file = fopen(path, "wb");
+    if(!fw->file) {
+        ALIGNED_FREE(fw->buffer);
+        free(fw);
+        return NULL;
+    }
+    setvbuf(fw->file, NULL, _IONBF, 0);
+    return fw;
+}
+
+static void flushWriter(FileWriter* fw) {
+    if(fw->fill == 0) return;
+    if(!fw->failed && fwrite(fw->buffer, 1, fw->fill, fw->file) != fw->fill) {
+        printf("ERROR IO: Write failed\n");
+        fw->failed = 1;
+    }
+    fw->fill = 0;
+}
+
+/**
+ * Reserve
+ * Returns the free tail of the buffer, flushing it first when full.
+ */
+uint8_t* fwReserve(FileWriter* fw, size_t* available) {
+    if(fw->fill == FILE_WRITE_BUFFER) flushWriter(fw);
+    *available = FILE_WRITE_BUFFER - fw->fill;
+    return fw->buffer + fw->fill;
+}
+
+/**
+ * Commit
+ */
+void fwCommit(FileWriter* fw, size_t length) {
+    fw->fill += length;
+    fw->written += length;
+}
+
+/**
+ * Write
+ * Returns 0, or -1 once a write has failed.
+ */
+int fwWrite(
+    FileWriter* fw,
+    const uint8_t* data,
+    size_t length
+) {
+    while(length > 0 && !fw->failed) {
+        if(fw->fill == 0 && length >= FILE_WRITE_BUFFER) {
+            size_t direct = length - length % FILE_WRITE_BUFFER;
+            if(fwrite(data, 1, direct, fw->file) != direct) {
+                printf("ERROR IO: Write failed\n");
+                fw->failed = 1;
+                break;
+            }
+            fw->written += direct;
+            data += direct;
+            length -= direct;
+            continue;
+        }
+        size_t available;
+        uint8_t* dst = fwReserve(fw, &available);
+        size_t n = length < available ? length : available;
+        memcpy(dst, data, n);
+        fwCommit(fw, n);
+        data += n;
+        length -= n;
+    }
+    return fw->failed ? -1 : 0;
+}
+
+/**
+ * Written
+ */
+uint64_t fwWritten(const FileWriter* fw) {
+    return fw->written;
+}
+
+/**
+ * Close
+ * Flushes and closes the file. Returns 0, or -1 when any write
+ * failed.
+ */
+int fwClose(FileWriter* fw) {
+    if(!fw) return -1;
+    flushWriter(fw);
+    if(fclose(fw->file) != 0) fw->failed = 1;
+    int result = fw->failed ? -1 : 0;
+    ALIGNED_FREE(fw->buffer);
+    free(fw);
+    return result;
+}
\ No newline at end of file
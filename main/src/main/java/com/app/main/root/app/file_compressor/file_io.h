@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define FILE_MAP_WINDOW ((size_t)16 << 20)
+#define FILE_MAP_ALIGN ((uint64_t)64 << 10)
+#define FILE_WRITE_BUFFER ((size_t)4 << 20)
+#define FILE_WRITE_ALIGN 4096
+
+/**
+ * Read-only file mapping for sequential passes over large files.
+ * Only one view is mapped at a time; mfView() drops the previous
+ * one, so resident memory follows the view size rather than the
+ * file size. Views are aligned down to FILE_MAP_ALIGN, which is the
+ * allocation granularity on Windows and a page multiple elsewhere,
+ * and are advised for sequential access.
+ */
+typedef struct MappedFile MappedFile;
+
+MappedFile* mfOpen(const char* path);
+uint64_t mfSize(const MappedFile* mf);
+const uint8_t* mfView(
+    MappedFile* mf,
+    uint64_t offset,
+    size_t length
+);
+void mfClose(MappedFile* mf);
+
+/**
+ * Buffered file writer. Output collects in a FILE_WRITE_ALIGN aligned
+ * buffer of FILE_WRITE_BUFFER bytes and reaches the file in whole
+ * buffers; large writes made while the buffer is empty go straight
+ * through. fwReserve()/fwCommit() let a producer fill the buffer in
+ * place. A failed write is latched and reported by fwClose().
+ */
+typedef struct FileWriter FileWriter;
+
+FileWriter* fwOpen(const char* path);
+uint8_t* fwReserve(FileWriter* fw, size_t* available);
+void fwCommit(FileWriter* fw, size_t length);
+int fwWrite(
+    FileWriter* fw,
+    const uint8_t* data,
+    size_t length
+);
+uint64_t fwWritten(const FileWriter* fw);
+int fwClose(FileWriter* fw);
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include "filter.h"
+#include "frame.h"
+#include "delta.h"
+#include "bcj.h"
+#include "probe.h"
+#include "bitstream.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define FILTER_HEADER_MAX (2 + FILTER_MAX_CHAIN * (2 + VARINT_MAX_BYTES * 2))
+
+static int addFilter(
+    FilterChain* chain,
+    int filter,
+    int width,
+    size_t channels,
+    size_t start
+) {
+    if(chain->count == FILTER_MAX_CHAIN) return 0;
+    FilterSpec* spec = &chain->filters[chain->count++];
+    spec->filter = filter;
+    spec->width = width;
+    spec->channels = channels;
+    spec->start = start;
+    return 1;
+}
+
+static int addDelta(
+    FilterChain* chain,
+    int bits,
+    size_t channels,
+    size_t start
+) {
+    if(channels == 0 || channels > 16) return 0;
+    switch(bits) {
+        case 8: return addFilter(chain, FILTER_DELTA, 1, channels, start);
+        case 16: return addFilter(chain, FILTER_DELTA, 2, channels, start);
+        case 24: return addFilter(chain, FILTER_DELTA, 1, channels * 3, start);
+        case 32: return addFilter(chain, FILTER_DELTA, 4, channels, start);
+        default: return 0;
+    }
+}
+
+/**
+ * WAV
+ * Integer PCM only; walks the RIFF chunks for fmt and data.
+ */
+static int detectWav(const uint8_t* data, size_t size, FilterChain* chain) {
+    if(size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) return 0;
+
+    int bits = 0;
+    size_t channels = 0;
+    size_t pos = 12;
+    while(pos + 8 <= size) {
+        uint32_t chunkSize = readLE32(data + pos + 4);
+        if(memcmp(data + pos, "fmt ", 4) == 0 && chunkSize >= 16 && pos + 24 <= size) {
+            uint16_t format = (uint16_t)(data[pos + 8] | data[pos + 9] << 8);
+            if(format != 1 && format != 0xFFFE) return 0;
+            channels = (size_t)(data[pos + 10] | data[pos + 11] << 8);
+            bits = data[pos + 22] | data[pos + 23] << 8;
+        } else if(memcmp(data + pos, "data", 4) == 0) {
+            return bits && addDelta(chain, bits, channels, pos + 8);
+        }
+        pos += 8 + (size_t)chunkSize + (chunkSize & 1);
+    }
+    return 0;
+}
+
+/**
+ * BMP
+ * Uncompressed 16, 24 and 32 bit pixels; palette images are left
+ * alone.
+ */
+static int detectBmp(const uint8_t* data, size_t size, FilterChain* chain) {
+    if(size < 54 || data[0] != 'B' || data[1] != 'M') return 0;
+
+    uint32_t pixelOffset = readLE32(data + 10);
+    uint32_t headerSize = readLE32(data + 14);
+    int bits = data[28] | data[29] << 8;
+    uint32_t compression = readLE32(data + 30);
+    if(headerSize < 40 || pixelOffset >= size || (compression != 0 && compression != 3)) return 0;
+    if(bits == 16) return addDelta(chain, 16, 1, pixelOffset);
+    if(bits == 24) return addDelta(chain, 8, 3, pixelOffset);
+    if(bits == 32) return addDelta(chain, 8, 4, pixelOffset);
+    return 0;
+}
+
+static int addBcj(FilterChain* chain, int isArm64) {
+    return addFilter(chain, isArm64 ? FILTER_BCJ_ARM64 : FILTER_BCJ_X86, 0, 0, 0);
+}
+
+/**
+ * Executable
+ * ELF e_machine, PE Machine or Mach-O cputype picks the branch
+ * converter; the filter covers the whole file, as headers and data
+ * sections rarely contain convertible patterns.
+ */
+static int detectExecutable(const uint8_t* data, size_t size, FilterChain* chain) {
+    if(size < 64) return 0;
+
+    if(data[0] == 0x7F && data[1] == 'E' && data[2] == 'L' && data[3] == 'F') {
+        if(data[5] != 1) return 0;
+        uint16_t machine = (uint16_t)(data[18] | data[19] << 8);
+        if(machine == 3 || machine == 62) return addBcj(chain, 0);
+        if(machine == 183) return addBcj(chain, 1);
+        return 0;
+    }
+    if(data[0] == 'M' && data[1] == 'Z') {
+        uint32_t peOffset = readLE32(data + 0x3C);
+        if(peOffset > size - 6 || memcmp(data + peOffset, "PE\0\0", 4) != 0) return 0;
+        uint16_t machine = (uint16_t)(data[peOffset + 4] | data[peOffset + 5] << 8);
+        if(machine == 0x014C || machine == 0x8664) return addBcj(chain, 0);
+        if(machine == 0xAA64) return addBcj(chain, 1);
+        return 0;
+    }
+    uint32_t magic = readLE32(data);
+    if(magic == 0xFEEDFACE || magic == 0xFEEDFACF) {
+        uint32_t cpu = readLE32(data + 4);
+        if(cpu == 7 || cpu == 0x01000007) return addBcj(chain, 0);
+        if(cpu == 0x0100000C) return addBcj(chain, 1);
+    }
+    return 0;
+}
+
+/**
+ * Detect
+ * Builds a filter chain from the file header; 0 when none applies.
+ */
+int filterDetect(
+    const uint8_t* data,
+    size_t size,
+    FilterChain* chain
+) {
+    memset(chain, 0, sizeof(*chain));
+    return detectWav(data, size, chain) ||
+        detectBmp(data, size, chain) ||
+        detectExecutable(data, size, chain);
+}
+
+static double strideEntropy(const uint8_t* data, size_t size) {
+    uint32_t counts[256];
+    probeHistogram(data, size, counts);
+    return probeOrder0Entropy(counts, size);
+}
+
+/**
+ * Stride
+ * Headerless numeric data, such as raw PCM, pixels or sensor
+ * samples: the sample layout whose delta has the lowest order-0
+ * entropy over the first FILTER_STRIDE_PROBE bytes, when that is
+ * under FILTER_STRIDE_GAIN of the raw bytes' entropy.
+ */
+int filterDetectStride(
+    const uint8_t* data,
+    size_t size,
+    FilterChain* chain
+) {
+    static const struct { int width; size_t channels; } layouts[] = {
+        { 1, 1 }, { 1, 3 }, { 1, 4 }, { 2, 1 }, { 2, 2 }, { 4, 1 }
+    };
+    memset(chain, 0, sizeof(*chain));
+    size_t probe = size < FILTER_STRIDE_PROBE ? size : FILTER_STRIDE_PROBE;
+    if(probe < 256) return 0;
+    uint8_t* scratch = malloc(probe);
+    if(!scratch) return 0;
+
+    int best = -1;
+    double bestBits = strideEntropy(data, probe) * FILTER_STRIDE_GAIN;
+    for(int l = 0; l < (int)(sizeof(layouts) / sizeof(layouts[0])); l++) {
+        deltaEncodeStride(data, scratch, probe, layouts[l].width, layouts[l].channels);
+        double bits = strideEntropy(scratch, probe);
+        if(bits < bestBits) {
+            best = l;
+            bestBits = bits;
+        }
+    }
+    free(scratch);
+
+    return best >= 0 && addFilter(chain, FILTER_DELTA, layouts[best].width, layouts[best].channels, 0);
+}
+
+/**
+ * Apply
+ * Runs one filter over buffer[start..size); delta filters need a
+ * second buffer and swap the two.
+ */
+static void applyFilter(
+    const FilterSpec* spec,
+    uint8_t** buffer,
+    uint8_t** scratch,
+    size_t size
+) {
+    uint8_t* src = *buffer + spec->start;
+    size_t length = size - spec->start;
+    uint32_t pos = (uint32_t)spec->start;
+    switch(spec->filter) {
+        case FILTER_DELTA: {
+            memcpy(*scratch, *buffer, spec->start);
+            deltaEncodeStride(src, *scratch + spec->start, length, spec->width, spec->channels);
+            uint8_t* swap = *buffer;
+            *buffer = *scratch;
+            *scratch = swap;
+            break;
+        }
+        case FILTER_BCJ_X86:
+            bcjX86Encode(src, length, pos);
+            break;
+        case FILTER_BCJ_ARM64:
+            bcjArm64Encode(src, length, pos);
+            break;
+    }
+}
+
+/**
+ * Encode
+ * Returns the filtered copy of the input, the same size.
+ */
+uint8_t* filterEncode(
+    const uint8_t* data,
+    size_t size,
+    const FilterChain* chain
+) {
+    uint8_t* buffer = malloc(size ? size : 1);
+    uint8_t* scratch = malloc(size ? size : 1);
+    if(!buffer || !scratch) {
+        free(buffer);
+        free(scratch);
+        return NULL;
+    }
+    memcpy(buffer, data, size);
+
+    for(int i = 0; i < chain->count; i++) {
+        if(chain->filters[i].start > size) {
+            free(buffer);
+            free(scratch);
+            return NULL;
+        }
+        applyFilter(&chain->filters[i], &buffer, &scratch, size);
+    }
+    free(scratch);
+    return buffer;
+}
+
+/**
+ * Unfilter
+ * Reverses the chain in place, last filter first; only delta
+ * filters need a scratch copy of their input.
+ */
+static int unfilter(
+    const FilterChain* chain,
+    uint8_t* data,
+    size_t size
+) {
+    uint8_t* scratch = NULL;
+    for(int i = chain->count - 1; i >= 0; i--) {
+        const FilterSpec* spec = &chain->filters[i];
+        if(spec->start > size) {
+            free(scratch);
+            return -1;
+        }
+        uint8_t* src = data + spec->start;
+        size_t length = size - spec->start;
+        uint32_t pos = (uint32_t)spec->start;
+        switch(spec->filter) {
+            case FILTER_DELTA:
+                if(!scratch && !(scratch = malloc(size ? size : 1))) return -1;
+                memcpy(scratch, src, length);
+                deltaDecodeStride(scratch, src, length, spec->width, spec->channels);
+                break;
+            case FILTER_BCJ_X86:
+                bcjX86Decode(src, length, pos);
+                break;
+            case FILTER_BCJ_ARM64:
+                bcjArm64Decode(src, length, pos);
+                break;
+        }
+    }
+    free(scratch);
+    return 0;
+}
+
+/**
+ * Wrap
+ * Prefixes an inner payload with the filter chain header.
+ */
+uint8_t* filterWrap(
+    const FilterChain* chain,
+    CompressionType innerType,
+    const uint8_t* inner,
+    size_t innerSize,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint8_t* output = malloc(FILTER_HEADER_MAX + innerSize);
+    if(!output) return NULL;
+
+    uint8_t* op = output;
+    *op++ = (uint8_t)chain->count;
+    for(int i = 0; i < chain->count; i++) {
+        const FilterSpec* spec = &chain->filters[i];
+        *op++ = (uint8_t)spec->filter;
+        if(spec->filter == FILTER_DELTA) {
+            *op++ = (uint8_t)spec->width;
+            op += varintPut(op, spec->channels);
+        }
+        op += varintPut(op, spec->start);
+    }
+    *op++ = (uint8_t)innerType;
+    memcpy(op, inner, innerSize);
+    op += innerSize;
+
+    *outputSize = (size_t)(op - output);
+    return output;
+}
+
+/**
+ * Compress
+ * Whole-buffer COMP_FILTER: the chain from the file header or, for
+ * headerless blocks, the sample stride, then
+ * compressUnfilteredOrStore() on the filtered data. NULL when no
+ * filter applies.
+ */
+uint8_t* filterCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    *outputSize = 0;
+    FilterChain chain;
+    if(!filterDetect(data, size, &chain) && !filterDetectStride(data, size, &chain)) return NULL;
+
+    uint8_t* filtered = filterEncode(data, size, &chain);
+    if(!filtered) return NULL;
+    size_t innerSize = 0;
+    CompressionType innerType = COMP_NONE;
+    uint8_t* inner = compressUnfilteredOrStore(filtered, size, &innerSize, &innerType, level);
+    uint8_t* wrapped = innerSize
+        ? filterWrap(&chain, innerType, inner ? inner : filtered, innerSize, outputSize)
+        : NULL;
+    free(inner);
+    free(filtered);
+    return wrapped;
+}
+
+static size_t parseChain(
+    const uint8_t* data,
+    const uint8_t* end,
+    FilterChain* chain
+) {
+    const uint8_t* ip = data;
+    uint64_t value = 0;
+    size_t n;
+    if(ip >= end) return 0;
+    chain->count = *ip++;
+    if(chain->count < 1 || chain->count > FILTER_MAX_CHAIN) return 0;
+
+    for(int i = 0; i < chain->count; i++) {
+        FilterSpec* spec = &chain->filters[i];
+        memset(spec, 0, sizeof(*spec));
+        if(ip >= end) return 0;
+        spec->filter = *ip++;
+        if(spec->filter == FILTER_DELTA) {
+            if(ip >= end) return 0;
+            spec->width = *ip++;
+            if(spec->width != 1 && spec->width != 2 && spec->width != DELTA_MAX_WIDTH) return 0;
+            if(!(n = varintGet(ip, end, &value)) || value == 0 || value > SIZE_MAX / DELTA_MAX_WIDTH) return 0;
+            spec->channels = (size_t)value;
+            ip += n;
+        } else if(spec->filter != FILTER_BCJ_X86 && spec->filter != FILTER_BCJ_ARM64) {
+            return 0;
+        }
+        if(!(n = varintGet(ip, end, &value)) || value > SIZE_MAX) return 0;
+        spec->start = (size_t)value;
+        ip += n;
+    }
+    return (size_t)(ip - data);
+}
+
+static size_t parseHeader(
+    const uint8_t* data,
+    size_t size,
+    FilterChain* chain,
+    CompressionType* innerType
+) {
+    size_t headerSize = parseChain(data, data + size, chain);
+    if(!headerSize || headerSize >= size) return 0;
+    *innerType = (CompressionType)data[headerSize];
+    if(*innerType == COMP_FILTER || *innerType > COMP_STREAM) return 0;
+    return headerSize + 1;
+}
+
+/**
+ * Inner Type
+ * Reads the inner codec of a filtered payload. Returns 0, or -1 when
+ * the header is corrupt.
+ */
+int filterInnerType(
+    const uint8_t* data,
+    size_t size,
+    CompressionType* innerType
+) {
+    FilterChain chain;
+    return parseHeader(data, size, &chain, innerType) ? 0 : -1;
+}
+
+/**
+ * Decoded Size
+ * Filters keep the size, so this is the size of the inner stream.
+ */
+int filterDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    FilterChain chain;
+    CompressionType innerType;
+    size_t headerSize = parseHeader(data, size, &chain, &innerType);
+    if(!headerSize) return -1;
+    return decompressedSize(data + headerSize, size - headerSize, innerType, decodedSize);
+}
+
+/**
+ * Verify
+ */
+int filterVerify(const uint8_t* data, size_t size) {
+    FilterChain chain;
+    CompressionType innerType;
+    size_t headerSize = parseHeader(data, size, &chain, &innerType);
+    if(!headerSize) return VERIFY_CORRUPT;
+    return verifyCompressed(data + headerSize, size - headerSize, innerType);
+}
+
+/**
+ * Decompress Into
+ * The inner stream decodes straight into dst and is unfiltered
+ * there; an inner frame may not hold filtered blocks of its own.
+ */
+int filterDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    FilterChain chain;
+    CompressionType innerType;
+    size_t headerSize = parseHeader(data, size, &chain, &innerType);
+    if(!headerSize) goto corrupt;
+
+    size_t filteredSize = 0;
+    int result = innerType == COMP_FRAME
+        ? frameDecompressUnfilteredInto(data + headerSize, size - headerSize, dst, capacity, &filteredSize)
+        : decompressInto(data + headerSize, size - headerSize, dst, capacity, &filteredSize, innerType);
+    if(result != 0) return -1;
+    if(unfilter(&chain, dst, filteredSize) != 0) goto corrupt;
+    *outputSize = filteredSize;
+    return 0;
+
+corrupt:
+    printf("ERROR FILTER: Corrupt or truncated header\n");
+    return -1;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* filterDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize = 0;
+    if(filterDecodedSize(data, size, &decodedSize) != 0 || decodedSize > SIZE_MAX) {
+        printf("ERROR FILTER: Corrupt or truncated header\n");
+        return NULL;
+    }
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(filterDecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "comp.h"
+
+#define FILTER_DELTA 1
+#define FILTER_BCJ_X86 2
+#define FILTER_BCJ_ARM64 3
+#define FILTER_MAX_CHAIN 4
+#define FILTER_STRIDE_PROBE (64 * 1024)
+#define FILTER_STRIDE_GAIN 0.9
+
+/**
+ * Pre-filtered payload (COMP_FILTER).
+ * The input runs through a chain of reversible filters and the
+ * result is compressed by an inner codec; decoding undoes the
+ * filters in reverse order.
+ *
+ * Header: u8 filter count, then per filter u8 id and its parameters,
+ * then u8 inner type; the inner payload follows.
+ * FILTER_DELTA: u8 sample width, varint channels, varint start.
+ * FILTER_BCJ_X86, FILTER_BCJ_ARM64: varint start.
+ * The first start bytes (a file header) pass through unchanged.
+ */
+typedef struct {
+    int filter;
+    int width;
+    size_t channels;
+    size_t start;
+} FilterSpec;
+
+typedef struct {
+    int count;
+    FilterSpec filters[FILTER_MAX_CHAIN];
+} FilterChain;
+
+int filterDetect(
+    const uint8_t* data,
+    size_t size,
+    FilterChain* chain
+);
+int filterDetectStride(
+    const uint8_t* data,
+    size_t size,
+    FilterChain* chain
+);
+uint8_t* filterEncode(
+    const uint8_t* data,
+    size_t size,
+    const FilterChain* chain
+);
+uint8_t* filterWrap(
+    const FilterChain* chain,
+    CompressionType innerType,
+    const uint8_t* inner,
+    size_t innerSize,
+    size_t* outputSize
+);
+uint8_t* filterCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+);
+uint8_t* filterDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int filterVerify(const uint8_t* data, size_t size);
+int filterInnerType(
+    const uint8_t* data,
+    size_t size,
+    CompressionType* innerType
+);
+int filterDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+);
+int filterDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
\ No newline at end of file
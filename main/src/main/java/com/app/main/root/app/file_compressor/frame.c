@@ -0,0 +1,859 @@
+#include "frame.h"
+#include "thread_pool.h"
+#include "bitstream.h"
+#include "filter.h"
+#include "stats.h"
+#include "checksum.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t blockSize;
+    int level;
+    uint8_t** outputs;
+    size_t* outputSizes;
+    CompressionType* types;
+    uint32_t* checksums;
+    int filters;
+} FrameCompressJob;
+
+/**
+ * Block size: 1 MB up to level 6, 4 MB above, where the match
+ * window is wide enough to use the extra context.
+ */
+int frameBlockLogForLevel(int level) {
+    return level >= 7 ? FRAME_MAX_BLOCK_LOG : FRAME_MIN_BLOCK_LOG;
+}
+
+static void compressBlockTask(void* arg, size_t index) {
+    FrameCompressJob* job = (FrameCompressJob*)arg;
+    size_t offset = index * job->blockSize;
+    size_t length = job->size - offset < job->blockSize ? job->size - offset : job->blockSize;
+    uint8_t* (*compressor)(const uint8_t*, size_t, size_t*, CompressionType*, int) =
+        job->filters ? compressBlockOrStore : compressUnfilteredOrStore;
+    job->outputs[index] = compressor(
+        job->data + offset,
+        length,
+        &job->outputSizes[index],
+        &job->types[index],
+        job->level
+    );
+    const uint8_t* payload = job->outputs[index] ? job->outputs[index] : job->data + offset;
+    job->checksums[index] = crc32c(0, payload, job->outputSizes[index]);
+}
+
+/**
+ * Without filters, blocks skip the COMP_FILTER trial; that is how
+ * data that already went through a filter chain is framed.
+ */
+static void compressBlocks(
+    const uint8_t* data,
+    size_t size,
+    size_t blockSize,
+    int level,
+    uint8_t** outputs,
+    size_t* outputSizes,
+    CompressionType* types,
+    uint32_t* checksums,
+    int filters
+) {
+    FrameCompressJob job;
+    job.data = data;
+    job.size = size;
+    job.blockSize = blockSize;
+    job.level = level;
+    job.outputs = outputs;
+    job.outputSizes = outputSizes;
+    job.types = types;
+    job.checksums = checksums;
+    job.filters = filters;
+    size_t blockCount = (size + blockSize - 1) / blockSize;
+    ThreadPool* pool = tpShared();
+    DEBUG_LOG("DEBUG C: Frame compress %zu blocks of %zu bytes on %d threads\n",
+           blockCount, blockSize, tpThreadCount(pool) + 1);
+    tpRun(pool, compressBlockTask, &job, blockCount);
+}
+
+/**
+ * Compress Blocks
+ * Compresses the blockSize blocks of data on the shared pool.
+ * outputs[b] is NULL when block b is stored as is, and
+ * outputSizes[b] is 0 when it failed.
+ */
+void frameCompressBlocks(
+    const uint8_t* data,
+    size_t size,
+    size_t blockSize,
+    int level,
+    uint8_t** outputs,
+    size_t* outputSizes,
+    CompressionType* types,
+    uint32_t* checksums
+) {
+    compressBlocks(data, size, blockSize, level, outputs, outputSizes, types, checksums, 1);
+}
+
+/**
+ * Write Header
+ */
+size_t frameWriteHeader(
+    uint8_t* dst,
+    int blockLog,
+    int flags
+) {
+    writeLE32(dst, FRAME_MAGIC);
+    dst[4] = FRAME_VERSION_SEEKABLE;
+    dst[5] = (uint8_t)flags;
+    dst[6] = (uint8_t)blockLog;
+    dst[7] = 0;
+    return FRAME_SEEKABLE_HEADER_SIZE;
+}
+
+static size_t indexEntrySize(int flags) {
+    return FRAME_INDEX_ENTRY_SIZE + (flags & FRAME_FLAG_CHECKSUM ? FRAME_CHECKSUM_SIZE : 0);
+}
+
+size_t frameIndexSize(uint32_t blockCount, int flags) {
+    size_t checksum = flags & FRAME_FLAG_CHECKSUM ? FRAME_CHECKSUM_SIZE : 0;
+    return (size_t)blockCount * indexEntrySize(flags) + checksum + FRAME_FOOTER_SIZE;
+}
+
+/**
+ * Write Index
+ * Trailing index and footer; dst needs frameIndexSize(blockCount,
+ * flags), with flags as given to frameWriteHeader().
+ */
+size_t frameWriteIndex(
+    uint8_t* dst,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint64_t originalSize,
+    int flags
+) {
+    uint8_t* op = dst;
+    for(uint32_t b = 0; b < blockCount; b++) {
+        writeLE64(op, blocks[b].offset);
+        writeLE64(op + 8, blocks[b].originalOffset);
+        writeLE32(op + 16, blocks[b].compressedSize);
+        op[20] = (uint8_t)blocks[b].type;
+        op[21] = op[22] = op[23] = 0;
+        if(flags & FRAME_FLAG_CHECKSUM) writeLE32(op + FRAME_INDEX_ENTRY_SIZE, blocks[b].checksum);
+        op += indexEntrySize(flags);
+    }
+    uint8_t* footer = op + (flags & FRAME_FLAG_CHECKSUM ? FRAME_CHECKSUM_SIZE : 0);
+    writeLE64(footer, originalSize);
+    writeLE32(footer + 8, blockCount);
+    writeLE32(footer + 12, FRAME_INDEX_MAGIC);
+    if(flags & FRAME_FLAG_CHECKSUM) {
+        writeLE32(op, crc32c(crc32c(0, dst, (size_t)(op - dst)), footer, 12));
+    }
+    return (size_t)(footer + FRAME_FOOTER_SIZE - dst);
+}
+
+static uint8_t* compressFrame(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level,
+    int blockLog,
+    int filters
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+    if(blockLog < FRAME_MIN_BLOCK_LOG) blockLog = FRAME_MIN_BLOCK_LOG;
+    if(blockLog > FRAME_MAX_BLOCK_LOG) blockLog = FRAME_MAX_BLOCK_LOG;
+
+    size_t blockSize = (size_t)1 << blockLog;
+    size_t blockCount = (size + blockSize - 1) / blockSize;
+    if(blockCount > 0xFFFFFFFFu) return NULL;
+
+    FrameCompressJob job;
+    job.outputs = calloc(blockCount, sizeof(uint8_t*));
+    job.outputSizes = calloc(blockCount, sizeof(size_t));
+    job.types = calloc(blockCount, sizeof(CompressionType));
+    job.checksums = calloc(blockCount, sizeof(uint32_t));
+    FrameBlock* blocks = malloc(sizeof(FrameBlock) * blockCount);
+    uint8_t* output = NULL;
+    if(!job.outputs || !job.outputSizes || !job.types || !job.checksums || !blocks) goto done;
+
+    compressBlocks(data, size, blockSize, level, job.outputs, job.outputSizes, job.types, job.checksums, filters);
+
+    size_t total = FRAME_SEEKABLE_HEADER_SIZE;
+    for(size_t b = 0; b < blockCount; b++) {
+        if(job.outputSizes[b] == 0) {
+            printf("ERROR C: Frame block %zu failed to compress\n", b);
+            goto done;
+        }
+        blocks[b].type = job.types[b];
+        blocks[b].compressedSize = (uint32_t)job.outputSizes[b];
+        blocks[b].originalSize = (uint32_t)(size - b * blockSize < blockSize ? size - b * blockSize : blockSize);
+        blocks[b].offset = total;
+        blocks[b].originalOffset = (uint64_t)b * blockSize;
+        blocks[b].checksum = job.checksums[b];
+        blocks[b].hasChecksum = 1;
+        total += job.outputSizes[b];
+    }
+    total += frameIndexSize((uint32_t)blockCount, FRAME_FLAG_CHECKSUM);
+
+    output = malloc(total);
+    if(!output) goto done;
+
+    uint8_t* op = output + frameWriteHeader(output, blockLog, FRAME_FLAG_CHECKSUM);
+    for(size_t b = 0; b < blockCount; b++) {
+        const uint8_t* payload = job.outputs[b] ? job.outputs[b] : data + b * blockSize;
+        memcpy(op, payload, job.outputSizes[b]);
+        op += job.outputSizes[b];
+    }
+    op += frameWriteIndex(op, blocks, (uint32_t)blockCount, size, FRAME_FLAG_CHECKSUM);
+    *outputSize = total;
+
+done:
+    if(job.outputs) {
+        for(size_t b = 0; b < blockCount; b++) free(job.outputs[b]);
+    }
+    free(job.outputs);
+    free(job.outputSizes);
+    free(job.types);
+    free(job.checksums);
+    free(blocks);
+    return output;
+}
+
+/**
+ * Compress
+ */
+uint8_t* frameCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level,
+    int blockLog
+) {
+    return compressFrame(data, size, outputSize, level, blockLog, 1);
+}
+
+/**
+ * Block Type
+ * Blocks hold a single-buffer codec or a filtered one, never another
+ * container; decompressBlockInto() holds the inner codec of a
+ * filtered block to the same rule, so containers never nest, and
+ * rejects filtered blocks in a frame that a filter wraps.
+ */
+static int blockTypeValid(uint8_t type) {
+    return type < COMP_FRAME || type == COMP_FILTER;
+}
+
+static FrameBlock* parseTable(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+) {
+    if(size < FRAME_HEADER_SIZE) return NULL;
+    uint64_t original = readLE64(data + 8);
+    uint32_t count = readLE32(data + 16);
+    if((uint64_t)count * FRAME_ENTRY_SIZE > size - FRAME_HEADER_SIZE) return NULL;
+
+    FrameBlock* blocks = malloc(sizeof(FrameBlock) * (count ? count : 1));
+    if(!blocks) return NULL;
+
+    const uint8_t* entry = data + FRAME_HEADER_SIZE;
+    uint64_t offset = FRAME_HEADER_SIZE + (uint64_t)count * FRAME_ENTRY_SIZE;
+    uint64_t decoded = 0;
+    for(uint32_t b = 0; b < count; b++) {
+        blocks[b].type = (CompressionType)entry[0];
+        blocks[b].compressedSize = readLE32(entry + 4);
+        blocks[b].originalSize = readLE32(entry + 8);
+        blocks[b].offset = offset;
+        blocks[b].originalOffset = decoded;
+        blocks[b].checksum = 0;
+        blocks[b].hasChecksum = 0;
+        if(!blockTypeValid(entry[0])) {
+            free(blocks);
+            return NULL;
+        }
+        offset += blocks[b].compressedSize;
+        decoded += blocks[b].originalSize;
+        entry += FRAME_ENTRY_SIZE;
+    }
+    if(offset != size || decoded != original) {
+        free(blocks);
+        return NULL;
+    }
+
+    *originalSize = original;
+    *blockCount = count;
+    return blocks;
+}
+
+/**
+ * Read Footer
+ * Reads the original size and block count from a version 2 footer.
+ * Returns 0, or -1 when it carries no index magic.
+ */
+int frameReadFooter(
+    const uint8_t* footer,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+) {
+    if(readLE32(footer + 12) != FRAME_INDEX_MAGIC) return -1;
+    *originalSize = readLE64(footer);
+    *blockCount = readLE32(footer + 8);
+    return 0;
+}
+
+/**
+ * Parse Index
+ * Validates a version 2 index from the last frameIndexSize(blockCount,
+ * flags) bytes of a frame of frameSize bytes, so a frame on disk can
+ * be opened without reading its payloads.
+ */
+FrameBlock* frameParseIndex(
+    const uint8_t* tail,
+    uint32_t blockCount,
+    int flags,
+    uint64_t frameSize,
+    uint64_t* originalSize
+) {
+    if(flags & ~FRAME_FLAG_CHECKSUM) return NULL;
+    size_t entrySize = indexEntrySize(flags);
+    uint64_t entriesSize = (uint64_t)blockCount * entrySize;
+    uint64_t indexSize = entriesSize + (flags & FRAME_FLAG_CHECKSUM ? FRAME_CHECKSUM_SIZE : 0);
+    if(frameSize < FRAME_SEEKABLE_HEADER_SIZE + FRAME_FOOTER_SIZE ||
+        indexSize > frameSize - FRAME_SEEKABLE_HEADER_SIZE - FRAME_FOOTER_SIZE) return NULL;
+
+    const uint8_t* footer = tail + indexSize;
+    uint64_t original;
+    uint32_t count;
+    if(frameReadFooter(footer, &original, &count) != 0 || count != blockCount) return NULL;
+    if((flags & FRAME_FLAG_CHECKSUM) &&
+        crc32c(crc32c(0, tail, (size_t)entriesSize), footer, 12) != readLE32(tail + entriesSize)) {
+        printf("ERROR C: Frame index checksum mismatch\n");
+        return NULL;
+    }
+
+    FrameBlock* blocks = malloc(sizeof(FrameBlock) * (count ? count : 1));
+    if(!blocks) return NULL;
+
+    const uint8_t* entry = tail;
+    uint64_t offset = FRAME_SEEKABLE_HEADER_SIZE;
+    for(uint32_t b = 0; b < count; b++) {
+        blocks[b].offset = readLE64(entry);
+        blocks[b].originalOffset = readLE64(entry + 8);
+        blocks[b].compressedSize = readLE32(entry + 16);
+        blocks[b].type = (CompressionType)entry[20];
+        blocks[b].hasChecksum = (flags & FRAME_FLAG_CHECKSUM) != 0;
+        blocks[b].checksum = blocks[b].hasChecksum ? readLE32(entry + FRAME_INDEX_ENTRY_SIZE) : 0;
+        uint64_t next = b + 1 < count ? readLE64(entry + entrySize + 8) : original;
+        if(!blockTypeValid(entry[20]) || blocks[b].offset != offset ||
+            next < blocks[b].originalOffset || next - blocks[b].originalOffset > 0xFFFFFFFFu ||
+            (b == 0 && blocks[b].originalOffset != 0)) {
+            free(blocks);
+            return NULL;
+        }
+        blocks[b].originalSize = (uint32_t)(next - blocks[b].originalOffset);
+        offset += blocks[b].compressedSize;
+        entry += entrySize;
+    }
+    if(offset != frameSize - indexSize - FRAME_FOOTER_SIZE || (count == 0 && original != 0)) {
+        free(blocks);
+        return NULL;
+    }
+
+    *originalSize = original;
+    return blocks;
+}
+
+static FrameBlock* parseIndex(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+) {
+    if(size < FRAME_SEEKABLE_HEADER_SIZE + FRAME_FOOTER_SIZE) return NULL;
+    uint64_t original;
+    uint32_t count;
+    int flags = data[5];
+    if(frameReadFooter(data + size - FRAME_FOOTER_SIZE, &original, &count) != 0) return NULL;
+    if((uint64_t)count * indexEntrySize(flags) > size - FRAME_SEEKABLE_HEADER_SIZE - FRAME_FOOTER_SIZE) return NULL;
+
+    size_t tailSize = frameIndexSize(count, flags);
+    if(tailSize > size) return NULL;
+    FrameBlock* blocks = frameParseIndex(data + size - tailSize, count, flags, size, originalSize);
+    if(blocks) *blockCount = count;
+    return blocks;
+}
+
+/**
+ * Parse
+ * Validates the header and block table or index against size and
+ * returns the blocks with their payload and original offsets, or NULL.
+ */
+FrameBlock* frameParse(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+) {
+    FrameBlock* blocks = NULL;
+    if(size >= FRAME_SEEKABLE_HEADER_SIZE && readLE32(data) == FRAME_MAGIC) {
+        if(data[4] == FRAME_VERSION_SEEKABLE) {
+            blocks = parseIndex(data, size, originalSize, blockCount);
+        } else if(data[4] == FRAME_VERSION) {
+            blocks = parseTable(data, size, originalSize, blockCount);
+        }
+    }
+    if(!blocks) printf("ERROR C: Not a valid compression frame\n");
+    return blocks;
+}
+
+typedef struct {
+    const uint8_t* data;
+    const FrameBlock* blocks;
+    uint32_t first;
+    uint64_t offset;
+    size_t length;
+    uint8_t* output;
+    int filters;
+    TpFlag failed;
+} FrameDecompressJob;
+
+/**
+ * Decompress Block Into
+ * Decodes one block in place at its final offset.
+ */
+static int decompressBlockInto(
+    const uint8_t* data,
+    const FrameBlock* block,
+    uint8_t* dst,
+    int filters
+) {
+    if(block->type == COMP_NONE && block->compressedSize != block->originalSize) return -1;
+    if(block->hasChecksum && crc32c(0, data + block->offset, block->compressedSize) != block->checksum) {
+        printf("ERROR C: Frame block checksum mismatch\n");
+        return -1;
+    }
+    if(block->type == COMP_FILTER && !filters) {
+        printf("ERROR C: Filtered block inside a filtered frame\n");
+        return -1;
+    }
+    CompressionType innerType = COMP_NONE;
+    if(block->type == COMP_FILTER &&
+        (filterInnerType(data + block->offset, block->compressedSize, &innerType) != 0 ||
+        innerType >= COMP_FRAME)) {
+        printf("ERROR C: Frame block holds a nested container\n");
+        return -1;
+    }
+    size_t blockSize = 0;
+    int result = decompressInto(
+        data + block->offset,
+        block->compressedSize,
+        dst,
+        block->originalSize,
+        &blockSize,
+        block->type
+    );
+    if(result != 0 || blockSize != block->originalSize) return -1;
+    return 0;
+}
+
+/**
+ * Blocks wholly inside the range decode straight into the output;
+ * the partial ones at either edge decode aside and copy their slice.
+ */
+static void decompressBlockTask(void* arg, size_t index) {
+    FrameDecompressJob* job = (FrameDecompressJob*)arg;
+    if(tpFlagTest(&job->failed)) return;
+
+    const FrameBlock* block = &job->blocks[job->first + index];
+    uint64_t blockEnd = block->originalOffset + block->originalSize;
+    uint64_t rangeEnd = job->offset + job->length;
+    uint64_t from = block->originalOffset > job->offset ? block->originalOffset : job->offset;
+    uint64_t to = blockEnd < rangeEnd ? blockEnd : rangeEnd;
+    uint8_t* dst = job->output + (from - job->offset);
+
+    int result;
+    if(from == block->originalOffset && to == blockEnd) {
+        result = decompressBlockInto(job->data, block, dst, job->filters);
+    } else {
+        uint8_t* scratch = malloc(block->originalSize ? block->originalSize : 1);
+        result = scratch ? decompressBlockInto(job->data, block, scratch, job->filters) : -1;
+        if(result == 0) memcpy(dst, scratch + (from - block->originalOffset), (size_t)(to - from));
+        free(scratch);
+    }
+    if(result != 0) {
+        printf("ERROR C: Frame block %u failed to decompress\n", job->first + (uint32_t)index);
+        tpFlagSet(&job->failed);
+    }
+}
+
+/**
+ * Decodes [offset, offset + length) into dst on the shared pool,
+ * touching only the blocks that overlap the range.
+ */
+static int decodeRange(
+    const uint8_t* data,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint64_t offset,
+    size_t length,
+    uint8_t* dst,
+    int filters
+) {
+    if(length == 0) return 0;
+
+    uint32_t lo = 0;
+    uint32_t hi = blockCount;
+    while(hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(blocks[mid].originalOffset <= offset) lo = mid;
+        else hi = mid;
+    }
+    uint32_t last = lo;
+    while(last + 1 < blockCount && blocks[last + 1].originalOffset < offset + length) last++;
+
+    FrameDecompressJob job;
+    job.data = data;
+    job.blocks = blocks;
+    job.first = lo;
+    job.offset = offset;
+    job.length = length;
+    job.output = dst;
+    job.filters = filters;
+    job.failed = 0;
+    tpRun(tpShared(), decompressBlockTask, &job, (size_t)(last - lo) + 1);
+    return tpFlagTest(&job.failed) ? -1 : 0;
+}
+
+/**
+ * Decode Blocks
+ * Decodes consecutive blocks into dst on the shared pool. Offsets are
+ * taken relative to data and dst, with the first block at original
+ * offset 0, so a caller can feed a frame through in windows.
+ */
+int frameDecodeBlocks(
+    const uint8_t* data,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint8_t* dst
+) {
+    if(blockCount == 0) return 0;
+    const FrameBlock* last = &blocks[blockCount - 1];
+    return decodeRange(data, blocks, blockCount, 0, (size_t)(last->originalOffset + last->originalSize), dst, 1);
+}
+
+static int decompressFrameInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize,
+    int filters
+) {
+    *outputSize = 0;
+    uint64_t originalSize;
+    uint32_t blockCount;
+    FrameBlock* blocks = frameParse(data, size, &originalSize, &blockCount);
+    if(!blocks) return -1;
+
+    int result = -1;
+    if(originalSize <= capacity) {
+        result = decodeRange(data, blocks, blockCount, 0, (size_t)originalSize, dst, filters);
+    }
+    free(blocks);
+    if(result != 0) return -1;
+    *outputSize = (size_t)originalSize;
+    return 0;
+}
+
+/**
+ * Decompress Into
+ * Blocks are decoded concurrently, each straight into its offset in
+ * dst, which must hold the original size of the frame.
+ */
+int frameDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    return decompressFrameInto(data, size, dst, capacity, outputSize, 1);
+}
+
+/**
+ * Decompress Unfiltered Into
+ * As frameDecompressInto(), for the inner frame of a COMP_FILTER
+ * payload: a filtered block there would undo a filter twice, so it
+ * is rejected.
+ */
+int frameDecompressUnfilteredInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    return decompressFrameInto(data, size, dst, capacity, outputSize, 0);
+}
+
+typedef struct {
+    const uint8_t* data;
+    const FrameBlock* blocks;
+    TpFlag failed;
+} FrameVerifyJob;
+
+static void verifyBlockTask(void* arg, size_t index) {
+    FrameVerifyJob* job = (FrameVerifyJob*)arg;
+    const FrameBlock* block = &job->blocks[index];
+    if(crc32c(0, job->data + block->offset, block->compressedSize) != block->checksum) {
+        printf("ERROR C: Frame block checksum mismatch at offset %llu\n",
+               (unsigned long long)block->originalOffset);
+        tpFlagSet(&job->failed);
+    }
+}
+
+/**
+ * Verify Blocks
+ * Checks block payloads against their checksums on the shared pool;
+ * offsets are relative to data as in frameDecodeBlocks().
+ */
+int frameVerifyBlocks(
+    const uint8_t* data,
+    const FrameBlock* blocks,
+    uint32_t blockCount
+) {
+    FrameVerifyJob job;
+    job.data = data;
+    job.blocks = blocks;
+    job.failed = 0;
+    tpRun(tpShared(), verifyBlockTask, &job, blockCount);
+    return tpFlagTest(&job.failed) ? VERIFY_CORRUPT : VERIFY_OK;
+}
+
+/**
+ * Verify
+ * Checks the index and every block payload against their checksums
+ * without decoding anything.
+ */
+int frameVerify(const uint8_t* data, size_t size) {
+    uint64_t originalSize;
+    uint32_t blockCount;
+    FrameBlock* blocks = frameParse(data, size, &originalSize, &blockCount);
+    if(!blocks) return VERIFY_CORRUPT;
+    int result = VERIFY_UNCHECKED;
+    if(data[4] == FRAME_VERSION_SEEKABLE && (data[5] & FRAME_FLAG_CHECKSUM)) {
+        result = frameVerifyBlocks(data, blocks, blockCount);
+    }
+    free(blocks);
+    return result;
+}
+
+/**
+ * Original Size
+ * Reads the decoded size from the frame header or footer without
+ * validating the blocks, but rejects one the blocks could not hold:
+ * more than block count << block log, or more blocks than fit.
+ */
+int frameOriginalSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize
+) {
+    if(size < FRAME_SEEKABLE_HEADER_SIZE || readLE32(data) != FRAME_MAGIC || data[6] > FRAME_MAX_BLOCK_LOG) return -1;
+    uint64_t original;
+    uint32_t count;
+    size_t entrySize;
+    if(data[4] == FRAME_VERSION_SEEKABLE && size >= FRAME_SEEKABLE_HEADER_SIZE + FRAME_FOOTER_SIZE) {
+        original = readLE64(data + size - FRAME_FOOTER_SIZE);
+        count = readLE32(data + size - FRAME_FOOTER_SIZE + 8);
+        entrySize = FRAME_INDEX_ENTRY_SIZE;
+    } else if(data[4] == FRAME_VERSION && size >= FRAME_HEADER_SIZE) {
+        original = readLE64(data + 8);
+        count = readLE32(data + 16);
+        entrySize = FRAME_ENTRY_SIZE;
+    } else {
+        return -1;
+    }
+    if(count > size / entrySize || original > ((uint64_t)count << data[6])) return -1;
+    *originalSize = original;
+    return 0;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* frameDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t originalSize;
+    if(frameOriginalSize(data, size, &originalSize) != 0 || originalSize > SIZE_MAX) return NULL;
+
+    uint8_t* output = malloc(originalSize ? (size_t)originalSize : 1);
+    if(!output) return NULL;
+    if(frameDecompressInto(data, size, output, (size_t)originalSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+/**
+ * Decompress Range
+ * Returns original bytes [offset, offset + length), clipped to the
+ * end of the frame; only the blocks covering them are decoded.
+ */
+uint8_t* frameDecompressRange(
+    const uint8_t* data,
+    size_t size,
+    uint64_t offset,
+    size_t length,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t originalSize;
+    uint32_t blockCount;
+    FrameBlock* blocks = frameParse(data, size, &originalSize, &blockCount);
+    if(!blocks) return NULL;
+    if(offset > originalSize) {
+        free(blocks);
+        return NULL;
+    }
+    if(length > originalSize - offset) length = (size_t)(originalSize - offset);
+
+    uint8_t* output = malloc(length ? length : 1);
+    if(!output || decodeRange(data, blocks, blockCount, offset, length, output, 1) != 0) {
+        free(output);
+        free(blocks);
+        return NULL;
+    }
+    free(blocks);
+    *outputSize = length;
+    return output;
+}
+
+/**
+ * Compress Framed
+ * Inputs larger than one block are split into a frame, smaller ones
+ * are compressed as a single block. Either way the codec is picked
+ * per block by trial compression, without COMP_FILTER when filters
+ * is 0. Stored results follow the compressBlockOrStore() contract.
+ */
+static uint8_t* compressFramed(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level,
+    int filters
+) {
+    int blockLog = frameBlockLogForLevel(level);
+    if(size <= ((size_t)1 << blockLog)) {
+        return filters
+            ? compressBlockOrStore(data, size, outputSize, usedType, level)
+            : compressUnfilteredOrStore(data, size, outputSize, usedType, level);
+    }
+
+    *outputSize = 0;
+    *usedType = COMP_NONE;
+    size_t frameSize = 0;
+    uint8_t* frame = compressFrame(data, size, &frameSize, level, blockLog, filters);
+
+    if(!frame || frameSize >= size * 0.98) {
+        DEBUG_LOG("DEBUG C: Frame not beneficial, storing original\n");
+        if(frame) statsFallback(COMP_FRAME);
+        free(frame);
+        *outputSize = size;
+        return NULL;
+    }
+
+    DEBUG_LOG("DEBUG C: Frame size: %zu bytes, ratio: %.2f%%\n",
+           frameSize, (double)frameSize / size * 100.0);
+    *outputSize = frameSize;
+    *usedType = COMP_FRAME;
+    return frame;
+}
+
+/**
+ * Compress Parallel Or Store
+ * Entry point for whole uploads. Inputs with a recognised header
+ * (PCM WAV, uncompressed BMP, ELF/PE/Mach-O executables) go through
+ * their filter chain once and are framed without per-block filters,
+ * falling back to the plain frame only when that does not shrink;
+ * everything else is framed as is. Input that does not shrink is
+ * reported as stored without a copy, as in compressBlockOrStore().
+ */
+uint8_t* compressParallelOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    FilterChain chain;
+    uint8_t* filtered = filterDetect(data, size, &chain) ? filterEncode(data, size, &chain) : NULL;
+    if(!filtered) return compressFramed(data, size, outputSize, usedType, level, 1);
+
+    size_t innerSize = 0;
+    CompressionType innerType = COMP_NONE;
+    uint8_t* inner = compressFramed(filtered, size, &innerSize, &innerType, level, 0);
+    free(filtered);
+    *outputSize = 0;
+    *usedType = COMP_NONE;
+    if(innerSize == 0) return NULL;
+
+    size_t wrappedSize = 0;
+    uint8_t* wrapped = inner ? filterWrap(&chain, innerType, inner, innerSize, &wrappedSize) : NULL;
+    free(inner);
+    if(!wrapped || wrappedSize >= size) {
+        DEBUG_LOG("DEBUG C: Filter %d not beneficial, framing unfiltered\n", chain.filters[0].filter);
+        free(wrapped);
+        return compressFramed(data, size, outputSize, usedType, level, 1);
+    }
+
+    DEBUG_LOG("DEBUG C: Filter %d: %zu -> %zu bytes\n",
+           chain.filters[0].filter, size, wrappedSize);
+    *outputSize = wrappedSize;
+    *usedType = COMP_FILTER;
+    return wrapped;
+}
+
+/**
+ * Compress Parallel
+ * As compressParallelOrStore(), but stored input is returned as a copy.
+ */
+uint8_t* compressParallel(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    uint8_t* compressed = compressParallelOrStore(data, size, outputSize, usedType, level);
+    if(compressed || *outputSize == 0) return compressed;
+    return storedCopy(data, size, outputSize);
+}
+
+/**
+ * Decompress Parallel
+ * Download-side counterpart of compressParallel: frames decode on
+ * the shared pool into one exact-size buffer, anything else goes
+ * through decompress().
+ */
+uint8_t* decompressParallel(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType compType
+) {
+    if(compType == COMP_FRAME) return frameDecompress(data, size, outputSize);
+    return decompress(data, size, outputSize, compType);
+}
\ No newline at end of file
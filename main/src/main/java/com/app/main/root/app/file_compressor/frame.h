@@ -0,0 +1,165 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "comp.h"
+
+#define FRAME_MAGIC 0x4D524643
+#define FRAME_INDEX_MAGIC 0x58494643
+#define FRAME_VERSION 1
+#define FRAME_VERSION_SEEKABLE 2
+#define FRAME_MIN_BLOCK_LOG 20
+#define FRAME_MAX_BLOCK_LOG 22
+#define FRAME_HEADER_SIZE 20
+#define FRAME_ENTRY_SIZE 12
+#define FRAME_SEEKABLE_HEADER_SIZE 8
+#define FRAME_INDEX_ENTRY_SIZE 24
+#define FRAME_FOOTER_SIZE 16
+#define FRAME_CHECKSUM_SIZE 4
+#define FRAME_FLAG_CHECKSUM 0x01
+
+/**
+ * Framed container for block-parallel compression (COMP_FRAME).
+ * Every block is compressed independently with compressBlock(), so
+ * blocks can be produced and consumed on separate threads, and any
+ * byte range can be decoded from the blocks that cover it.
+ *
+ * Version 2, written by default (little endian):
+ * header u32 magic "CFRM", u8 version, u8 flags, u8 block log,
+ * u8 reserved; block payloads in order; a trailing index with, per
+ * block, u64 compressed offset, u64 original offset, u32 compressed
+ * size, u8 type and 3 reserved bytes; a footer with u64 original
+ * size, u32 block count and u32 magic "CFIX". The index sits at the
+ * end so frames can be written as a stream.
+ *
+ * With FRAME_FLAG_CHECKSUM, each index entry is followed by the
+ * CRC32C of its block payload, and the index by a CRC32C over the
+ * entries and the first 12 footer bytes, so bit rot anywhere past
+ * the header is caught before a block is decoded.
+ *
+ * Version 1 (read only): header u32 magic, u8 version, u8 flags,
+ * u8 block log, u8 reserved, u64 original size, u32 block count;
+ * a leading table of u8 type, 3 reserved bytes, u32 compressed size,
+ * u32 original size per block; then the payloads.
+ */
+typedef struct {
+    CompressionType type;
+    uint32_t compressedSize;
+    uint32_t originalSize;
+    uint64_t offset;
+    uint64_t originalOffset;
+    uint32_t checksum;
+    int hasChecksum;
+} FrameBlock;
+
+int frameBlockLogForLevel(int level);
+size_t frameWriteHeader(
+    uint8_t* dst,
+    int blockLog,
+    int flags
+);
+size_t frameIndexSize(uint32_t blockCount, int flags);
+size_t frameWriteIndex(
+    uint8_t* dst,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint64_t originalSize,
+    int flags
+);
+void frameCompressBlocks(
+    const uint8_t* data,
+    size_t size,
+    size_t blockSize,
+    int level,
+    uint8_t** outputs,
+    size_t* outputSizes,
+    CompressionType* types,
+    uint32_t* checksums
+);
+uint8_t* frameCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level,
+    int blockLog
+);
+FrameBlock* frameParse(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+);
+int frameReadFooter(
+    const uint8_t* footer,
+    uint64_t* originalSize,
+    uint32_t* blockCount
+);
+FrameBlock* frameParseIndex(
+    const uint8_t* tail,
+    uint32_t blockCount,
+    int flags,
+    uint64_t frameSize,
+    uint64_t* originalSize
+);
+int frameDecodeBlocks(
+    const uint8_t* data,
+    const FrameBlock* blocks,
+    uint32_t blockCount,
+    uint8_t* dst
+);
+int frameVerifyBlocks(
+    const uint8_t* data,
+    const FrameBlock* blocks,
+    uint32_t blockCount
+);
+int frameVerify(const uint8_t* data, size_t size);
+int frameOriginalSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* originalSize
+);
+int frameDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+int frameDecompressUnfilteredInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+uint8_t* frameDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+uint8_t* frameDecompressRange(
+    const uint8_t* data,
+    size_t size,
+    uint64_t offset,
+    size_t length,
+    size_t* outputSize
+);
+uint8_t* compressParallelOrStore(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
+uint8_t* compressParallel(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
+uint8_t* decompressParallel(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    CompressionType compType
+);
\ No newline at end of file
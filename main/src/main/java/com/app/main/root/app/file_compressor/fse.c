@@ -0,0 +1,333 @@
+#include "fse.h"
+#include "lz_codes.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/**
+ * Spread
+ * Scatters each symbol's slots over the table with an odd step so
+ * equal symbols do not cluster.
+ */
+static void spreadSymbols(
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog,
+    uint8_t* spread
+) {
+    uint32_t tableSize = 1u << tableLog;
+    uint32_t mask = tableSize - 1;
+    uint32_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+    uint32_t pos = 0;
+    for(int s = 0; s < symbolCount; s++) {
+        for(uint32_t i = 0; i < norm[s]; i++) {
+            spread[pos] = (uint8_t)s;
+            pos = (pos + step) & mask;
+        }
+    }
+}
+
+/**
+ * Optimal Table Log
+ * Small inputs get small tables; the table must still hold every
+ * symbol that occurs.
+ */
+int fseOptimalTableLog(
+    const uint32_t* freqs,
+    int symbolCount,
+    size_t total,
+    int maxLog
+) {
+    int distinct = 0;
+    for(int s = 0; s < symbolCount; s++) distinct += freqs[s] != 0;
+
+    int minLog = lzHighBit((uint32_t)distinct) + 1;
+    if(minLog < FSE_MIN_TABLE_LOG) minLog = FSE_MIN_TABLE_LOG;
+
+    int tableLog = maxLog;
+    int sizeLog = lzHighBit(total > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)total) - 1;
+    if(sizeLog < tableLog) tableLog = sizeLog;
+    if(tableLog < minLog) tableLog = minLog;
+    return tableLog;
+}
+
+/**
+ * Normalize Counts
+ * Scales to 1 << tableLog with every present symbol keeping at least
+ * one slot; rounding error is settled on the most frequent symbols.
+ */
+void fseNormalizeCounts(
+    const uint32_t* freqs,
+    int symbolCount,
+    size_t total,
+    int tableLog,
+    uint16_t* norm
+) {
+    int32_t tableSize = 1 << tableLog;
+    int32_t sum = 0;
+    int largest = 0;
+    for(int s = 0; s < symbolCount; s++) {
+        norm[s] = 0;
+        if(!freqs[s]) continue;
+
+        uint64_t scaled = (((uint64_t)freqs[s] << tableLog) + total / 2) / total;
+        norm[s] = (uint16_t)(scaled ? scaled : 1);
+        sum += norm[s];
+        if(norm[s] > norm[largest]) largest = s;
+    }
+
+    int32_t diff = tableSize - sum;
+    if(diff >= 0) {
+        norm[largest] = (uint16_t)(norm[largest] + diff);
+        return;
+    }
+    while(diff < 0) {
+        largest = 0;
+        for(int s = 1; s < symbolCount; s++) {
+            if(norm[s] > norm[largest]) largest = s;
+        }
+        int32_t take = norm[largest] - 1;
+        if(take > -diff) take = -diff;
+        norm[largest] = (uint16_t)(norm[largest] - take);
+        diff += take;
+    }
+}
+
+/**
+ * Write / Read Counts
+ * [tableLog][varint symbol count] then a varint per symbol; a zero
+ * is followed by the number of further zeros.
+ */
+size_t fseWriteCounts(
+    uint8_t* dst,
+    size_t capacity,
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog
+) {
+    int used = symbolCount;
+    while(used > 0 && !norm[used - 1]) used--;
+    if(capacity < 1 + VARINT_MAX_BYTES + (size_t)used * 3) return 0;
+
+    size_t n = 0;
+    dst[n++] = (uint8_t)tableLog;
+    n += varintPut(dst + n, (uint64_t)used);
+    for(int s = 0; s < used;) {
+        if(norm[s]) {
+            n += varintPut(dst + n, norm[s]);
+            s++;
+            continue;
+        }
+        int run = 1;
+        while(s + run < used && !norm[s + run]) run++;
+        n += varintPut(dst + n, 0);
+        n += varintPut(dst + n, (uint64_t)(run - 1));
+        s += run;
+    }
+    return n;
+}
+
+size_t fseReadCounts(
+    const uint8_t* src,
+    const uint8_t* end,
+    uint16_t* norm,
+    int symbolCount,
+    int maxLog,
+    int* tableLog
+) {
+    const uint8_t* ip = src;
+    if(ip >= end) return 0;
+    int log = *ip++;
+    if(log < FSE_MIN_TABLE_LOG || log > maxLog) return 0;
+
+    uint64_t used;
+    size_t n = varintGet(ip, end, &used);
+    if(!n || used > (uint64_t)symbolCount) return 0;
+    ip += n;
+
+    memset(norm, 0, sizeof(uint16_t) * symbolCount);
+    uint64_t sum = 0;
+    for(uint64_t s = 0; s < used;) {
+        uint64_t value;
+        if(!(n = varintGet(ip, end, &value))) return 0;
+        ip += n;
+        if(value) {
+            if(value > (1u << log)) return 0;
+            norm[s++] = (uint16_t)value;
+            sum += value;
+            continue;
+        }
+        uint64_t run;
+        if(!(n = varintGet(ip, end, &run))) return 0;
+        ip += n;
+        if(run >= used - s) return 0;
+        s += run + 1;
+    }
+    if(sum != (1u << log)) return 0;
+
+    *tableLog = log;
+    return (size_t)(ip - src);
+}
+
+/**
+ * Build Encode Table
+ */
+void fseBuildCTable(
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog,
+    FseCTable* table
+) {
+    uint32_t tableSize = 1u << tableLog;
+    uint8_t spread[1 << FSE_MAX_TABLE_LOG];
+    uint32_t cumul[FSE_MAX_SYMBOLS + 1];
+
+    table->tableLog = tableLog;
+    spreadSymbols(norm, symbolCount, tableLog, spread);
+
+    cumul[0] = 0;
+    for(int s = 0; s < symbolCount; s++) cumul[s + 1] = cumul[s] + norm[s];
+    for(uint32_t u = 0; u < tableSize; u++) {
+        table->stateTable[cumul[spread[u]]++] = (uint16_t)(tableSize + u);
+    }
+
+    uint32_t start = 0;
+    for(int s = 0; s < symbolCount; s++) {
+        uint32_t count = norm[s];
+        FseSymbolTransform* t = &table->symbols[s];
+        if(!count) {
+            t->deltaNbBits = ((uint32_t)(tableLog + 1) << 16) - tableSize;
+            t->deltaFindState = 0;
+            continue;
+        }
+        uint32_t maxBitsOut = (uint32_t)tableLog - (uint32_t)lzHighBit(count - 1);
+        t->deltaNbBits = (maxBitsOut << 16) - (count << maxBitsOut);
+        t->deltaFindState = (int32_t)start - (int32_t)count;
+        start += count;
+    }
+}
+
+/**
+ * Build Decode Table
+ */
+void fseBuildDTable(
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog,
+    FseDTable* table
+) {
+    uint32_t tableSize = 1u << tableLog;
+    uint8_t spread[1 << FSE_MAX_TABLE_LOG];
+    uint32_t next[FSE_MAX_SYMBOLS];
+
+    table->tableLog = tableLog;
+    spreadSymbols(norm, symbolCount, tableLog, spread);
+    for(int s = 0; s < symbolCount; s++) next[s] = norm[s];
+
+    for(uint32_t u = 0; u < tableSize; u++) {
+        uint8_t s = spread[u];
+        uint32_t state = next[s]++;
+        int nbBits = tableLog - lzHighBit(state);
+        table->entries[u].symbol = s;
+        table->entries[u].nbBits = (uint8_t)nbBits;
+        table->entries[u].newState = (uint16_t)((state << nbBits) - tableSize);
+    }
+}
+
+/**
+ * Compress Bytes
+ * [counts][bitstream]. FSE_STATES states take turns symbol by
+ * symbol, so the decoder's table lookups do not wait on each other.
+ * Returns 0 if dst is too small.
+ */
+size_t fseCompressBytes(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity
+) {
+    uint32_t freqs[256] = {0};
+    uint16_t norm[256];
+    for(size_t i = 0; i < size; i++) freqs[data[i]]++;
+
+    int tableLog = fseOptimalTableLog(freqs, 256, size, 11);
+    fseNormalizeCounts(freqs, 256, size, tableLog, norm);
+    size_t n = fseWriteCounts(dst, capacity, norm, 256, tableLog);
+    if(!n) return 0;
+
+    FseCTable* table = malloc(sizeof(FseCTable));
+    if(!table) return 0;
+    fseBuildCTable(norm, 256, tableLog, table);
+
+    uint32_t state[FSE_STATES];
+    for(int k = 0; k < FSE_STATES; k++) state[k] = 1u << tableLog;
+
+    BitWriter bw;
+    bwInit(&bw, dst + n, capacity - n);
+    for(size_t i = size; i-- > 0;) {
+        fseEncodeSymbol(&bw, &state[i % FSE_STATES], table, data[i]);
+    }
+    for(int k = FSE_STATES - 1; k >= 0; k--) fseFlushState(&bw, state[k], table);
+    bwPut(&bw, 1, 1);
+    n += bwFinish(&bw);
+    free(table);
+    return bw.overflow ? 0 : n;
+}
+
+/**
+ * Decompress Bytes
+ * srcSize must be exact: the bitstream is read back from its end.
+ * Returns srcSize, or 0 on corrupt input.
+ */
+size_t fseDecompressBytes(
+    const uint8_t* src,
+    size_t srcSize,
+    uint8_t* dst,
+    size_t dstSize
+) {
+    uint16_t norm[256];
+    int tableLog;
+    size_t n = fseReadCounts(src, src + srcSize, norm, 256, FSE_MAX_TABLE_LOG, &tableLog);
+    if(!n) return 0;
+
+    FseDTable* table = malloc(sizeof(FseDTable));
+    if(!table) return 0;
+    fseBuildDTable(norm, 256, tableLog, table);
+
+    BitReaderBack br;
+    if(!brbInit(&br, src + n, srcSize - n)) {
+        free(table);
+        return 0;
+    }
+
+    uint32_t state[FSE_STATES];
+    for(int k = 0; k < FSE_STATES; k++) {
+        brbReload(&br);
+        state[k] = brbRead(&br, tableLog);
+    }
+
+    const FseDEntry* entries = table->entries;
+    size_t i = 0;
+    for(; i + FSE_STATES <= dstSize; i += FSE_STATES) {
+        brbReload(&br);
+        for(int k = 0; k < FSE_STATES; k++) {
+            FseDEntry e = entries[state[k]];
+            dst[i + k] = e.symbol;
+            state[k] = e.newState + brbRead(&br, e.nbBits);
+        }
+    }
+    for(; i < dstSize; i++) {
+        brbReload(&br);
+        uint32_t* s = &state[i % FSE_STATES];
+        FseDEntry e = entries[*s];
+        dst[i] = e.symbol;
+        *s = e.newState + brbRead(&br, e.nbBits);
+    }
+    free(table);
+
+    int ok = brbFinished(&br);
+    for(int k = 0; k < FSE_STATES; k++) ok &= state[k] == 0;
+    return ok ? srcSize : 0;
+}
\ No newline at end of file
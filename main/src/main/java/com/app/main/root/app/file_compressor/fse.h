@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "bitstream.h"
+
+#define FSE_MIN_TABLE_LOG 5
+#define FSE_MAX_TABLE_LOG 12
+#define FSE_MAX_SYMBOLS 256
+#define FSE_STATES 4
+
+/**
+ * Table-based ANS (FSE). Symbol probabilities are normalized to
+ * 1 << tableLog slots, so a symbol costs a fractional number of
+ * bits. The encoder runs backward and writes forward; the decoder
+ * reads the stream with a BitReaderBack.
+ */
+typedef struct {
+    int32_t deltaFindState;
+    uint32_t deltaNbBits;
+} FseSymbolTransform;
+
+typedef struct {
+    int tableLog;
+    uint16_t stateTable[1 << FSE_MAX_TABLE_LOG];
+    FseSymbolTransform symbols[FSE_MAX_SYMBOLS];
+} FseCTable;
+
+typedef struct {
+    uint16_t newState;
+    uint8_t symbol;
+    uint8_t nbBits;
+} FseDEntry;
+
+typedef struct {
+    int tableLog;
+    FseDEntry entries[1 << FSE_MAX_TABLE_LOG];
+} FseDTable;
+
+int fseOptimalTableLog(
+    const uint32_t* freqs,
+    int symbolCount,
+    size_t total,
+    int maxLog
+);
+void fseNormalizeCounts(
+    const uint32_t* freqs,
+    int symbolCount,
+    size_t total,
+    int tableLog,
+    uint16_t* norm
+);
+size_t fseWriteCounts(
+    uint8_t* dst,
+    size_t capacity,
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog
+);
+size_t fseReadCounts(
+    const uint8_t* src,
+    const uint8_t* end,
+    uint16_t* norm,
+    int symbolCount,
+    int maxLog,
+    int* tableLog
+);
+void fseBuildCTable(
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog,
+    FseCTable* table
+);
+void fseBuildDTable(
+    const uint16_t* norm,
+    int symbolCount,
+    int tableLog,
+    FseDTable* table
+);
+
+size_t fseCompressBytes(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity
+);
+size_t fseDecompressBytes(
+    const uint8_t* src,
+    size_t srcSize,
+    uint8_t* dst,
+    size_t dstSize
+);
+
+/**
+ * Encoder states live in [tableSize, 2 * tableSize) and start at
+ * tableSize; decoder states are the matching table index, so a
+ * clean stream ends with every decoder state back at 0.
+ */
+static inline void fseEncodeSymbol(
+    BitWriter* bw,
+    uint32_t* state,
+    const FseCTable* table,
+    uint32_t symbol
+) {
+    FseSymbolTransform t = table->symbols[symbol];
+    int nbBits = (int)((*state + t.deltaNbBits) >> 16);
+    bwPut(bw, *state & ((1u << nbBits) - 1), nbBits);
+    *state = table->stateTable[(int32_t)(*state >> nbBits) + t.deltaFindState];
+}
+
+static inline void fseFlushState(BitWriter* bw, uint32_t state, const FseCTable* table) {
+    bwPut(bw, state - (1u << table->tableLog), table->tableLog);
+}
+
+static inline uint32_t fsePeekSymbol(uint32_t state, const FseDTable* table) {
+    return table->entries[state].symbol;
+}
+
+static inline void fseUpdateState(BitReaderBack* br, uint32_t* state, const FseDTable* table) {
+    FseDEntry e = table->entries[*state];
+    *state = e.newState + brbRead(br, e.nbBits);
+}
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include "huffman.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define HUF_INVALID 0xFFFF
+
+typedef struct {
+    uint32_t freq;
+    int16_t symbol;
+    int16_t parent;
+} HufNode;
+
+static int compareNodes(const void* a, const void* b) {
+    const HufNode* x = (const HufNode*)a;
+    const HufNode* y = (const HufNode*)b;
+    if(x->freq != y->freq) return x->freq < y->freq ? -1 : 1;
+    return x->symbol - y->symbol;
+}
+
+/**
+ * Limit Lengths
+ * Clamps to HUF_MAX_BITS, then lengthens the deepest codes that are
+ * still short until the Kraft sum fits, and finally shortens codes
+ * again while there is room so the code stays complete.
+ */
+static void limitLengths(uint8_t* lengths, int symbolCount) {
+    const uint32_t full = 1u << HUF_MAX_BITS;
+    uint32_t total = 0;
+    for(int i = 0; i < symbolCount; i++) {
+        if(!lengths[i]) continue;
+        if(lengths[i] > HUF_MAX_BITS) lengths[i] = HUF_MAX_BITS;
+        total += full >> lengths[i];
+    }
+
+    while(total > full) {
+        int pick = -1;
+        for(int i = 0; i < symbolCount; i++) {
+            if(lengths[i] && lengths[i] < HUF_MAX_BITS &&
+                (pick < 0 || lengths[i] > lengths[pick])) {
+                pick = i;
+            }
+        }
+        if(pick < 0) break;
+        total -= full >> (lengths[pick] + 1);
+        lengths[pick]++;
+    }
+
+    int changed = 1;
+    while(total < full && changed) {
+        changed = 0;
+        for(int i = 0; i < symbolCount && total < full; i++) {
+            if(lengths[i] > 1 && total + (full >> lengths[i]) <= full) {
+                total += full >> lengths[i];
+                lengths[i]--;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Build Lengths
+ */
+void hufBuildLengths(
+    const uint32_t* freqs,
+    int symbolCount,
+    uint8_t* lengths
+) {
+    HufNode nodes[HUF_MAX_SYMBOLS * 2];
+    int leafCount = 0;
+
+    memset(lengths, 0, symbolCount);
+    for(int i = 0; i < symbolCount; i++) {
+        if(freqs[i]) {
+            nodes[leafCount].freq = freqs[i];
+            nodes[leafCount].symbol = (int16_t)i;
+            nodes[leafCount].parent = -1;
+            leafCount++;
+        }
+    }
+    if(leafCount == 0) return;
+    if(leafCount == 1) {
+        lengths[nodes[0].symbol] = 1;
+        return;
+    }
+
+    qsort(nodes, leafCount, sizeof(HufNode), compareNodes);
+
+    int nodeCount = leafCount;
+    int leaf = 0;
+    int inner = leafCount;
+    while(nodeCount - inner + (leafCount - leaf) > 1) {
+        int pick[2];
+        for(int k = 0; k < 2; k++) {
+            if(leaf < leafCount && (inner >= nodeCount || nodes[leaf].freq <= nodes[inner].freq)) {
+                pick[k] = leaf++;
+            } else {
+                pick[k] = inner++;
+            }
+        }
+        nodes[nodeCount].freq = nodes[pick[0]].freq + nodes[pick[1]].freq;
+        nodes[nodeCount].symbol = -1;
+        nodes[nodeCount].parent = -1;
+        nodes[pick[0]].parent = (int16_t)nodeCount;
+        nodes[pick[1]].parent = (int16_t)nodeCount;
+        nodeCount++;
+    }
+
+    uint8_t depth[HUF_MAX_SYMBOLS * 2];
+    depth[nodeCount - 1] = 0;
+    for(int i = nodeCount - 2; i >= 0; i--) {
+        int d = depth[nodes[i].parent] + 1;
+        depth[i] = (uint8_t)(d > 255 ? 255 : d);
+    }
+    for(int i = 0; i < leafCount; i++) {
+        lengths[nodes[i].symbol] = depth[i];
+    }
+
+    limitLengths(lengths, symbolCount);
+}
+
+/**
+ * Build Codes
+ * Canonical order: shorter codes first, ties by symbol.
+ */
+void hufBuildCodes(
+    const uint8_t* lengths,
+    int symbolCount,
+    HufCode* codes
+) {
+    uint32_t lengthCount[HUF_MAX_BITS + 1] = {0};
+    uint32_t nextCode[HUF_MAX_BITS + 1] = {0};
+    for(int i = 0; i < symbolCount; i++) lengthCount[lengths[i]]++;
+    lengthCount[0] = 0;
+
+    uint32_t code = 0;
+    for(int len = 1; len <= HUF_MAX_BITS; len++) {
+        code = (code + lengthCount[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+
+    for(int i = 0; i < symbolCount; i++) {
+        int len = lengths[i];
+        codes[i].length = (uint8_t)len;
+        codes[i].code = 0;
+        if(!len) continue;
+
+        uint32_t canonical = nextCode[len]++;
+        uint32_t reversed = 0;
+        for(int b = 0; b < len; b++) {
+            reversed = (reversed << 1) | ((canonical >> b) & 1);
+        }
+        codes[i].code = (uint16_t)reversed;
+    }
+}
+
+/**
+ * Write / Read Lengths
+ * Two 4-bit lengths per byte.
+ */
+size_t hufWriteLengths(
+    uint8_t* dst,
+    const uint8_t* lengths,
+    int symbolCount
+) {
+    size_t n = 0;
+    for(int i = 0; i < symbolCount; i += 2) {
+        uint8_t hi = i + 1 < symbolCount ? lengths[i + 1] : 0;
+        dst[n++] = (uint8_t)(lengths[i] | (hi << 4));
+    }
+    return n;
+}
+
+size_t hufReadLengths(
+    const uint8_t* src,
+    const uint8_t* end,
+    uint8_t* lengths,
+    int symbolCount
+) {
+    size_t n = (size_t)(symbolCount + 1) / 2;
+    if((size_t)(end - src) < n) return 0;
+
+    for(int i = 0; i < symbolCount; i += 2) {
+        uint8_t b = src[i / 2];
+        lengths[i] = b & 0x0F;
+        if(i + 1 < symbolCount) lengths[i + 1] = b >> 4;
+    }
+    for(int i = 0; i < symbolCount; i++) {
+        if(lengths[i] > HUF_MAX_BITS) return 0;
+    }
+    return n;
+}
+
+/**
+ * Build Decode Table
+ * Entries not covered by any code keep symbol HUF_INVALID.
+ */
+int hufBuildDecodeTable(
+    const uint8_t* lengths,
+    int symbolCount,
+    HufEntry* table
+) {
+    HufCode codes[HUF_MAX_SYMBOLS];
+    uint32_t total = 0;
+    for(int i = 0; i < symbolCount; i++) {
+        if(lengths[i]) total += HUF_TABLE_SIZE >> lengths[i];
+    }
+    if(total > HUF_TABLE_SIZE) return 0;
+
+    for(int i = 0; i < HUF_TABLE_SIZE; i++) {
+        table[i].symbol = HUF_INVALID;
+        table[i].length = 0;
+    }
+
+    hufBuildCodes(lengths, symbolCount, codes);
+    for(int s = 0; s < symbolCount; s++) {
+        int len = codes[s].length;
+        if(!len) continue;
+        for(uint32_t idx = codes[s].code; idx < HUF_TABLE_SIZE; idx += 1u << len) {
+            table[idx].symbol = (uint16_t)s;
+            table[idx].length = (uint8_t)len;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Build Decode Table (two symbols)
+ * After the first code, the remaining bits of the index are looked
+ * up again; if a whole second code fits, both symbols come out of
+ * one lookup.
+ */
+void hufBuildDecodeTable2(
+    const HufEntry* table,
+    HufEntry2* table2
+) {
+    for(uint32_t idx = 0; idx < HUF_TABLE_SIZE; idx++) {
+        HufEntry first = table[idx];
+        HufEntry2* e = &table2[idx];
+        if(first.symbol == HUF_INVALID) {
+            e->count = 0;
+            e->length = 0;
+            continue;
+        }
+
+        e->symbols[0] = (uint8_t)first.symbol;
+        e->symbols[1] = 0;
+        e->length = first.length;
+        e->count = 1;
+
+        int remaining = HUF_MAX_BITS - first.length;
+        HufEntry second = table[idx >> first.length];
+        if(second.symbol != HUF_INVALID && second.length <= remaining) {
+            e->symbols[1] = (uint8_t)second.symbol;
+            e->length = (uint8_t)(first.length + second.length);
+            e->count = 2;
+        }
+    }
+}
+
+/**
+ * Compress Bytes
+ * [lengths: 128 bytes][3 x u32 stream sizes][4 bitstreams]. The
+ * input is split into HUF_STREAMS equal segments, each coded on its
+ * own stream so the decoder can run the lookups side by side.
+ * Returns 0 if dst is too small.
+ */
+size_t hufCompressBytes(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity
+) {
+    uint32_t freqs[256] = {0};
+    uint8_t lengths[256];
+    HufCode codes[256];
+
+    for(size_t i = 0; i < size; i++) freqs[data[i]]++;
+    hufBuildLengths(freqs, 256, lengths);
+    hufBuildCodes(lengths, 256, codes);
+
+    size_t headerSize = 128 + 4 * (HUF_STREAMS - 1);
+    if(capacity < headerSize) return 0;
+    size_t n = hufWriteLengths(dst, lengths, 256);
+    uint8_t* jumpTable = dst + n;
+    n = headerSize;
+
+    size_t segment = (size + HUF_STREAMS - 1) / HUF_STREAMS;
+    for(int k = 0; k < HUF_STREAMS; k++) {
+        size_t from = segment * k < size ? segment * k : size;
+        size_t to = from + segment < size ? from + segment : size;
+
+        BitWriter bw;
+        bwInit(&bw, dst + n, capacity - n);
+        for(size_t i = from; i < to; i++) {
+            HufCode c = codes[data[i]];
+            bwPut(&bw, c.code, c.length);
+        }
+        size_t streamSize = bwFinish(&bw);
+        if(bw.overflow) return 0;
+        if(k < HUF_STREAMS - 1) writeLE32(jumpTable + 4 * k, (uint32_t)streamSize);
+        n += streamSize;
+    }
+    return n;
+}
+
+/**
+ * Decompress Bytes
+ * Decodes exactly dstSize symbols. The four streams are stepped in
+ * lockstep so their table lookups overlap, two symbols per lookup
+ * where the table allows. srcSize must be the exact size returned
+ * by hufCompressBytes, since the last stream runs to the end.
+ * Returns srcSize, or 0 on corrupt input.
+ */
+size_t hufDecompressBytes(
+    const uint8_t* src,
+    size_t srcSize,
+    uint8_t* dst,
+    size_t dstSize
+) {
+    uint8_t lengths[256];
+    size_t n = hufReadLengths(src, src + srcSize, lengths, 256);
+    size_t headerSize = 128 + 4 * (HUF_STREAMS - 1);
+    if(!n || srcSize < headerSize) return 0;
+
+    size_t streamSize[HUF_STREAMS];
+    size_t total = headerSize;
+    for(int k = 0; k < HUF_STREAMS - 1; k++) {
+        streamSize[k] = readLE32(src + n + 4 * k);
+        total += streamSize[k];
+        if(total > srcSize) return 0;
+    }
+
+    HufEntry* table = malloc(sizeof(HufEntry) * HUF_TABLE_SIZE);
+    HufEntry2* table2 = malloc(sizeof(HufEntry2) * HUF_TABLE_SIZE);
+    if(!table || !table2 || !hufBuildDecodeTable(lengths, 256, table)) {
+        free(table);
+        free(table2);
+        return 0;
+    }
+    hufBuildDecodeTable2(table, table2);
+
+    BitReader br[HUF_STREAMS];
+    uint8_t* op[HUF_STREAMS];
+    uint8_t* opEnd[HUF_STREAMS];
+    size_t segment = (dstSize + HUF_STREAMS - 1) / HUF_STREAMS;
+    const uint8_t* ip = src + headerSize;
+    for(int k = 0; k < HUF_STREAMS; k++) {
+        size_t from = segment * k < dstSize ? segment * k : dstSize;
+        size_t to = from + segment < dstSize ? from + segment : dstSize;
+        size_t length = k < HUF_STREAMS - 1 ? streamSize[k] : srcSize - total;
+        brInit(&br[k], ip, length);
+        ip += length;
+        op[k] = dst + from;
+        opEnd[k] = dst + to;
+    }
+
+    int ok = 1;
+    for(;;) {
+        int room = 1;
+        for(int k = 0; k < HUF_STREAMS; k++) room &= opEnd[k] - op[k] >= 8;
+        if(!room) break;
+
+        for(int k = 0; k < HUF_STREAMS; k++) brRefill(&br[k]);
+        for(int step = 0; step < 4; step++) {
+            for(int k = 0; k < HUF_STREAMS; k++) {
+                HufEntry2 e = table2[brPeek(&br[k], HUF_MAX_BITS)];
+                op[k][0] = e.symbols[0];
+                op[k][1] = e.symbols[1];
+                op[k] += e.count;
+                brSkip(&br[k], e.length);
+                ok &= e.count != 0;
+            }
+        }
+        if(!ok) break;
+    }
+    for(int k = 0; ok && k < HUF_STREAMS; k++) {
+        while(op[k] < opEnd[k]) {
+            brRefill(&br[k]);
+            HufEntry e = table[brPeek(&br[k], HUF_MAX_BITS)];
+            if(e.symbol == HUF_INVALID) {
+                ok = 0;
+                break;
+            }
+            *op[k]++ = (uint8_t)e.symbol;
+            brSkip(&br[k], e.length);
+        }
+        if(brOverrun(&br[k])) ok = 0;
+    }
+
+    free(table);
+    free(table2);
+    return ok ? srcSize : 0;
+}
\ No newline at end of file
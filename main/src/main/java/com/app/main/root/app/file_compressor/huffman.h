@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "bitstream.h"
+
+#define HUF_MAX_BITS 11
+#define HUF_TABLE_SIZE (1 << HUF_MAX_BITS)
+#define HUF_MAX_SYMBOLS 256
+#define HUF_STREAMS 4
+
+/**
+ * Canonical Huffman, lengths limited to HUF_MAX_BITS so one table
+ * lookup always resolves a symbol. Codes are stored bit-reversed
+ * for the LSB-first bitstream.
+ */
+typedef struct {
+    uint16_t code;
+    uint8_t length;
+} HufCode;
+
+typedef struct {
+    uint16_t symbol;
+    uint8_t length;
+} HufEntry;
+
+/**
+ * Two-symbol entry for byte alphabets: count symbols (1 or 2)
+ * decoded from length bits.
+ */
+typedef struct {
+    uint8_t symbols[2];
+    uint8_t length;
+    uint8_t count;
+} HufEntry2;
+
+void hufBuildLengths(
+    const uint32_t* freqs,
+    int symbolCount,
+    uint8_t* lengths
+);
+void hufBuildCodes(
+    const uint8_t* lengths,
+    int symbolCount,
+    HufCode* codes
+);
+size_t hufWriteLengths(
+    uint8_t* dst,
+    const uint8_t* lengths,
+    int symbolCount
+);
+size_t hufReadLengths(
+    const uint8_t* src,
+    const uint8_t* end,
+    uint8_t* lengths,
+    int symbolCount
+);
+int hufBuildDecodeTable(
+    const uint8_t* lengths,
+    int symbolCount,
+    HufEntry* table
+);
+void hufBuildDecodeTable2(
+    const HufEntry* table,
+    HufEntry2* table2
+);
+
+size_t hufCompressBytes(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity
+);
+size_t hufDecompressBytes(
+    const uint8_t* src,
+    size_t srcSize,
+    uint8_t* dst,
+    size_t dstSize
+);
+
+static inline uint32_t hufDecodeSymbol(BitReader* br, const HufEntry* table) {
+    HufEntry e = table[brPeek(br, HUF_MAX_BITS)];
+    brSkip(br, e.length);
+    return e.symbol;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ_LENGTH_CODES 44
+#define LZ_OFFSET_CODES 32
+
+/**
+ * Symbols for the entropy-coded LZ formats.
+ * Lengths below 16 are their own code; larger values use code
+ * 12 + highbit(v) followed by highbit(v) extra bits. Offsets use
+ * code highbit(offset) followed by that many extra bits.
+ */
+static inline int lzHighBit(uint32_t v) {
+    int n = 0;
+    while(v >>= 1) n++;
+    return n;
+}
+
+static inline uint32_t lzLengthCode(uint32_t value, int* extraBits) {
+    if(value < 16) {
+        *extraBits = 0;
+        return value;
+    }
+    int hb = lzHighBit(value);
+    *extraBits = hb;
+    return 12 + (uint32_t)hb;
+}
+
+static inline uint32_t lzLengthBase(uint32_t code, int* extraBits) {
+    if(code < 16) {
+        *extraBits = 0;
+        return code;
+    }
+    *extraBits = (int)code - 12;
+    return (uint32_t)1 << (code - 12);
+}
+
+static inline uint32_t lzOffsetCode(uint32_t offset, int* extraBits) {
+    int hb = lzHighBit(offset);
+    *extraBits = hb;
+    return (uint32_t)hb;
+}
+
+static inline uint32_t lzOffsetBase(uint32_t code, int* extraBits) {
+    *extraBits = (int)code;
+    return (uint32_t)1 << code;
+}
\ No newline at end of file
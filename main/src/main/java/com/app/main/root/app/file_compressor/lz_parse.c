@@ -0,0 +1,337 @@
+#include "lz_parse.h"
+#include "match_finder.h"
+#include "lz_codes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define LZ_OPT_CHUNK (1 << 16)
+#define LZ_OPT_MAX_MATCHES 32
+#define LZ_COST_INF 0xFFFFFFFFu
+
+/**
+ * Level table.
+ * 1-3 greedy (1 is a single probe), 4-8 lazy with growing chains,
+ * 9 optimal parsing against the caller's cost model.
+ */
+static const LzLevel levels[LZ_LEVEL_MAX + 1] = {
+    { LZ_GREEDY, 1 },
+    { LZ_GREEDY, 1 },
+    { LZ_GREEDY, 4 },
+    { LZ_GREEDY, 16 },
+    { LZ_LAZY, 16 },
+    { LZ_LAZY, 32 },
+    { LZ_LAZY, 64 },
+    { LZ_LAZY, 128 },
+    { LZ_LAZY, 256 },
+    { LZ_OPTIMAL, 256 }
+};
+
+LzLevel lzGetLevel(int level) {
+    if(level < LZ_LEVEL_MIN) level = LZ_LEVEL_MIN;
+    if(level > LZ_LEVEL_MAX) level = LZ_LEVEL_MAX;
+    return levels[level];
+}
+
+static uint32_t entropyLiteralCost(void* ctx, uint8_t literal) {
+    return ((LzEntropyCost*)ctx)->literalBits[literal];
+}
+
+static uint32_t entropyMatchCost(void* ctx, size_t length, size_t offset) {
+    int lengthExtra;
+    int offsetExtra;
+    lzLengthCode((uint32_t)(length - ((LzEntropyCost*)ctx)->minMatch), &lengthExtra);
+    lzOffsetCode((uint32_t)offset, &offsetExtra);
+    return 14 + (uint32_t)lengthExtra + (uint32_t)offsetExtra;
+}
+
+/**
+ * Entropy Cost Model
+ * The histogram is only gathered when the level parses optimally.
+ */
+LzCostModel lzEntropyCostModel(
+    LzEntropyCost* cost,
+    const uint8_t* data,
+    size_t size,
+    size_t minMatch,
+    int level
+) {
+    LzCostModel model;
+    model.literalCost = entropyLiteralCost;
+    model.matchCost = entropyMatchCost;
+    model.ctx = cost;
+    cost->minMatch = minMatch;
+    if(lzGetLevel(level).strategy != LZ_OPTIMAL) return model;
+
+    size_t freqs[256] = {0};
+    for(size_t i = 0; i < size; i++) freqs[data[i]]++;
+    for(int s = 0; s < 256; s++) {
+        size_t ratio = freqs[s] ? size / freqs[s] : size;
+        if(ratio > 0xFFFFFFFFu) ratio = 0xFFFFFFFFu;
+        cost->literalBits[s] = 1 + (uint32_t)lzHighBit((uint32_t)ratio);
+    }
+    return model;
+}
+
+/**
+ * Window for the wide-window formats: 64 KB at 1-3, 256 KB at 4-6,
+ * 1 MB at 7-8 and 8 MB at 9, never larger than the input needs.
+ */
+int lzWindowLogForLevel(int level, size_t size) {
+    int windowLog =
+        level <= 3 ? 16 :
+        level <= 6 ? 18 :
+        level < LZ_LEVEL_MAX ? 20 : LZ_MAX_WINDOW_LOG;
+    while(windowLog > LZ_MIN_WINDOW_LOG && ((size_t)1 << (windowLog - 1)) >= size) {
+        windowLog--;
+    }
+    return windowLog;
+}
+
+typedef struct {
+    LzSeq* seqs;
+    size_t count;
+    size_t capacity;
+    size_t anchor;
+} SeqBuffer;
+
+static int pushSeq(
+    SeqBuffer* buf,
+    size_t pos,
+    size_t matchLen,
+    size_t offset
+) {
+    if(buf->count == buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity * 2 : 1024;
+        LzSeq* seqs = realloc(buf->seqs, sizeof(LzSeq) * capacity);
+        if(!seqs) return 0;
+        buf->seqs = seqs;
+        buf->capacity = capacity;
+    }
+
+    LzSeq* seq = &buf->seqs[buf->count++];
+    seq->litLen = (uint32_t)(pos - buf->anchor);
+    seq->matchLen = (uint32_t)matchLen;
+    seq->offset = (uint32_t)offset;
+    buf->anchor = pos + matchLen;
+    return 1;
+}
+
+static void insertUpTo(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t* inserted,
+    size_t target,
+    size_t end
+) {
+    while(*inserted < target) {
+        mfInsert(mf, data, *inserted, end);
+        (*inserted)++;
+    }
+}
+
+/**
+ * Greedy / Lazy
+ */
+static int parseGreedy(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t begin,
+    size_t size,
+    const LzParams* params,
+    int lazy,
+    SeqBuffer* out
+) {
+    size_t inserted = begin > mf->windowSize ? begin - mf->windowSize : 0;
+    insertUpTo(mf, data, &inserted, begin, size);
+    size_t i = begin;
+
+    while(i < size) {
+        size_t offset = 0;
+        size_t length = mfFindLongest(mf, data, i, size, params->maxMatch, &offset);
+        if(length < params->minMatch) {
+            insertUpTo(mf, data, &inserted, i + 1, size);
+            i++;
+            continue;
+        }
+
+        while(lazy && i + 1 < size && length < params->maxMatch && length < MF_NICE_LENGTH) {
+            insertUpTo(mf, data, &inserted, i + 1, size);
+            size_t nextOffset = 0;
+            size_t nextLength = mfFindLongest(mf, data, i + 1, size, params->maxMatch, &nextOffset);
+            if(nextLength <= length) break;
+            i++;
+            length = nextLength;
+            offset = nextOffset;
+        }
+
+        if(!pushSeq(out, i, length, offset)) return 0;
+        insertUpTo(mf, data, &inserted, i + length, size);
+        i += length;
+    }
+
+    return 1;
+}
+
+/**
+ * Optimal
+ * Forward shortest-path over LZ_OPT_CHUNK positions at a time:
+ * price[k] is the cheapest cost to reach chunk offset k, and each
+ * node remembers the step that reached it for the backtrack.
+ * A match of MF_NICE_LENGTH or more is taken as-is and the
+ * positions it covers are not expanded.
+ */
+typedef struct {
+    uint32_t price;
+    uint32_t length;
+    uint32_t offset;
+} OptNode;
+
+static int parseOptimal(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t begin,
+    size_t size,
+    const LzParams* params,
+    SeqBuffer* out
+) {
+    const LzCostModel* cost = &params->cost;
+    OptNode* nodes = malloc(sizeof(OptNode) * (LZ_OPT_CHUNK + 1));
+    uint32_t* path = malloc(sizeof(uint32_t) * (LZ_OPT_CHUNK + 1));
+    MfMatch matches[LZ_OPT_MAX_MATCHES];
+    if(!nodes || !path) {
+        free(nodes);
+        free(path);
+        return 0;
+    }
+
+    size_t inserted = begin > mf->windowSize ? begin - mf->windowSize : 0;
+    size_t start = begin;
+    while(start < size) {
+        size_t end = start + LZ_OPT_CHUNK < size ? start + LZ_OPT_CHUNK : size;
+        size_t span = end - start;
+
+        for(size_t k = 0; k <= span; k++) nodes[k].price = LZ_COST_INF;
+        nodes[0].price = 0;
+
+        for(size_t k = 0; k < span; k++) {
+            size_t pos = start + k;
+            uint32_t base = nodes[k].price;
+            insertUpTo(mf, data, &inserted, pos, size);
+
+            uint32_t lit = base + cost->literalCost(cost->ctx, data[pos]);
+            if(lit < nodes[k + 1].price) {
+                nodes[k + 1].price = lit;
+                nodes[k + 1].length = 1;
+                nodes[k + 1].offset = 0;
+            }
+
+            size_t maxLen = params->maxMatch < end - pos ? params->maxMatch : end - pos;
+            size_t found = mfFindAll(mf, data, pos, size, maxLen, matches, LZ_OPT_MAX_MATCHES);
+            size_t minLen = params->minMatch > MF_MIN_MATCH ? params->minMatch : MF_MIN_MATCH;
+            for(size_t m = 0; m < found; m++) {
+                size_t len = matches[m].length;
+                size_t offset = matches[m].offset;
+                for(size_t l = minLen; l <= len; l++) {
+                    if(l > MF_NICE_LENGTH && l < len) l = len;
+                    uint32_t price = base + cost->matchCost(cost->ctx, l, offset);
+                    if(price < nodes[k + l].price) {
+                        nodes[k + l].price = price;
+                        nodes[k + l].length = (uint32_t)l;
+                        nodes[k + l].offset = (uint32_t)offset;
+                    }
+                }
+                minLen = len + 1;
+            }
+
+            if(found > 0 && matches[found - 1].length >= MF_NICE_LENGTH) {
+                k += matches[found - 1].length - 1;
+            }
+        }
+
+        size_t steps = 0;
+        for(size_t k = span; k > 0; k -= nodes[k].length) {
+            path[steps++] = (uint32_t)k;
+        }
+        while(steps > 0) {
+            size_t k = path[--steps];
+            if(nodes[k].offset == 0) continue;
+            size_t pos = start + k - nodes[k].length;
+            if(!pushSeq(out, pos, nodes[k].length, nodes[k].offset)) {
+                free(nodes);
+                free(path);
+                return 0;
+            }
+        }
+
+        start = end;
+    }
+
+    free(nodes);
+    free(path);
+    return 1;
+}
+
+/**
+ * Parse With History
+ * The historySize bytes before data are already coded: matches may
+ * reach back into them, but only data[0..size) is parsed.
+ */
+LzSeq* lzParseWithHistory(
+    const uint8_t* data,
+    size_t historySize,
+    size_t size,
+    const LzParams* params,
+    size_t* seqCount
+) {
+    *seqCount = 0;
+    LzLevel level = lzGetLevel(params->level);
+    if(level.strategy == LZ_OPTIMAL && !params->cost.literalCost) {
+        level.strategy = LZ_LAZY;
+    }
+
+    MatchFinder* mf = mfCreate(params->windowSize, level.maxChain);
+    if(!mf) return NULL;
+
+    const uint8_t* base = data - historySize;
+    size_t end = historySize + size;
+    SeqBuffer out = { NULL, 0, 0, historySize };
+    int ok;
+    switch(level.strategy) {
+        case LZ_OPTIMAL:
+            ok = parseOptimal(mf, base, historySize, end, params, &out);
+            break;
+        case LZ_LAZY:
+            ok = parseGreedy(mf, base, historySize, end, params, 1, &out);
+            break;
+        case LZ_GREEDY:
+        default:
+            ok = parseGreedy(mf, base, historySize, end, params, 0, &out);
+            break;
+    }
+    mfDestroy(mf);
+
+    if(ok && (out.anchor < end || out.count == 0)) {
+        ok = pushSeq(&out, end, 0, 0);
+    }
+    if(!ok) {
+        free(out.seqs);
+        return NULL;
+    }
+
+    *seqCount = out.count;
+    return out.seqs;
+}
+
+/**
+ * Parse
+ */
+LzSeq* lzParse(
+    const uint8_t* data,
+    size_t size,
+    const LzParams* params,
+    size_t* seqCount
+) {
+    return lzParseWithHistory(data, 0, size, params, seqCount);
+}
\ No newline at end of file
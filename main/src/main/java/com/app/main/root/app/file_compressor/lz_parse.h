@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ_LEVEL_MIN 1
+#define LZ_LEVEL_DEFAULT 5
+#define LZ_LEVEL_MAX 9
+#define LZ_MIN_WINDOW_LOG 16
+#define LZ_MAX_WINDOW_LOG 23
+
+typedef enum {
+    LZ_GREEDY = 0,
+    LZ_LAZY,
+    LZ_OPTIMAL
+} LzStrategy;
+
+/**
+ * One parse step: litLen literals copied from the input, then a
+ * match of matchLen bytes at offset. The last sequence may have
+ * matchLen == 0 to carry trailing literals.
+ */
+typedef struct {
+    uint32_t litLen;
+    uint32_t matchLen;
+    uint32_t offset;
+} LzSeq;
+
+/**
+ * Cost model for the optimal parser, in bits.
+ */
+typedef struct {
+    uint32_t (*literalCost)(void* ctx, uint8_t literal);
+    uint32_t (*matchCost)(void* ctx, size_t length, size_t offset);
+    void* ctx;
+} LzCostModel;
+
+/**
+ * Cost model for the entropy-coded formats: literals priced from the
+ * input's order-0 histogram, matches from the lz_codes.h extra bits.
+ */
+typedef struct {
+    uint32_t literalBits[256];
+    size_t minMatch;
+} LzEntropyCost;
+
+typedef struct {
+    size_t windowSize;
+    size_t minMatch;
+    size_t maxMatch;
+    int level;
+    LzCostModel cost;
+} LzParams;
+
+typedef struct {
+    LzStrategy strategy;
+    int maxChain;
+} LzLevel;
+
+LzLevel lzGetLevel(int level);
+LzCostModel lzEntropyCostModel(
+    LzEntropyCost* cost,
+    const uint8_t* data,
+    size_t size,
+    size_t minMatch,
+    int level
+);
+int lzWindowLogForLevel(int level, size_t size);
+LzSeq* lzParse(
+    const uint8_t* data,
+    size_t size,
+    const LzParams* params,
+    size_t* seqCount
+);
+LzSeq* lzParseWithHistory(
+    const uint8_t* data,
+    size_t historySize,
+    size_t size,
+    const LzParams* params,
+    size_t* seqCount
+);
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "lza.h"
+#include "lz_parse.h"
+#include "lz_codes.h"
+#include "fse.h"
+#include "bitstream.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+enum { LZA_LL = 0, LZA_ML, LZA_OF, LZA_STREAMS };
+
+static const int alphabetSize[LZA_STREAMS] = {
+    LZ_LENGTH_CODES,
+    LZ_LENGTH_CODES,
+    LZ_OFFSET_CODES
+};
+static const int maxTableLog[LZA_STREAMS] = {
+    LZA_LENGTH_TABLE_LOG,
+    LZA_LENGTH_TABLE_LOG,
+    LZA_OFFSET_TABLE_LOG
+};
+
+/**
+ * Compress
+ * Sequences are written last first, each in the reverse of the
+ * order the decoder reads it: state bits, then extra bits.
+ */
+uint8_t* lzaCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+
+    LzEntropyCost cost;
+    LzParams params;
+    params.windowSize = (size_t)1 << lzWindowLogForLevel(level, size);
+    params.minMatch = LZA_MIN_MATCH;
+    params.maxMatch = LZA_MAX_MATCH;
+    params.level = level;
+    params.cost = lzEntropyCostModel(&cost, data, size, LZA_MIN_MATCH, level);
+
+    size_t seqCount = 0;
+    LzSeq* seqs = lzParse(data, size, &params, &seqCount);
+    if(!seqs) return NULL;
+
+    size_t literalCount = 0;
+    size_t matchCount = 0;
+    uint32_t freqs[LZA_STREAMS][LZ_LENGTH_CODES] = {{0}};
+    for(size_t s = 0; s < seqCount; s++) {
+        literalCount += seqs[s].litLen;
+        if(!seqs[s].matchLen) continue;
+
+        int extra;
+        freqs[LZA_LL][lzLengthCode(seqs[s].litLen, &extra)]++;
+        freqs[LZA_ML][lzLengthCode(seqs[s].matchLen - LZA_MIN_MATCH, &extra)]++;
+        freqs[LZA_OF][lzOffsetCode(seqs[s].offset, &extra)]++;
+        matchCount++;
+    }
+
+    size_t capacity = 64 + 1024 + literalCount * 2 + matchCount * 16;
+    uint8_t* output = malloc(capacity);
+    uint8_t* literals = malloc(literalCount ? literalCount : 1);
+    FseCTable* tables = malloc(sizeof(FseCTable) * LZA_STREAMS);
+    if(!output || !literals || !tables) goto fail;
+
+    const uint8_t* ip = data;
+    uint8_t* lp = literals;
+    for(size_t s = 0; s < seqCount; s++) {
+        memcpy(lp, ip, seqs[s].litLen);
+        lp += seqs[s].litLen;
+        ip += seqs[s].litLen + seqs[s].matchLen;
+    }
+
+    uint8_t header[VARINT_MAX_BYTES * 4];
+    size_t literalStreamSize = 0;
+    uint8_t* literalStream = output + sizeof(header);
+    if(literalCount > 0) {
+        literalStreamSize = fseCompressBytes(
+            literals,
+            literalCount,
+            literalStream,
+            capacity - sizeof(header)
+        );
+        if(!literalStreamSize || literalStreamSize >= literalCount) {
+            memcpy(literalStream, literals, literalCount);
+            literalStreamSize = literalCount;
+        }
+    }
+    free(literals);
+    literals = NULL;
+
+    size_t headerSize = 0;
+    headerSize += varintPut(header + headerSize, size);
+    headerSize += varintPut(header + headerSize, literalCount);
+    headerSize += varintPut(header + headerSize, matchCount);
+    headerSize += varintPut(header + headerSize, literalStreamSize);
+    memmove(output + headerSize, literalStream, literalStreamSize);
+    memcpy(output, header, headerSize);
+
+    uint8_t* op = output + headerSize + literalStreamSize;
+    if(matchCount > 0) {
+        for(int t = 0; t < LZA_STREAMS; t++) {
+            uint16_t norm[LZ_LENGTH_CODES];
+            int tableLog = fseOptimalTableLog(freqs[t], alphabetSize[t], matchCount, maxTableLog[t]);
+            fseNormalizeCounts(freqs[t], alphabetSize[t], matchCount, tableLog, norm);
+            size_t n = fseWriteCounts(
+                op,
+                capacity - (size_t)(op - output),
+                norm,
+                alphabetSize[t],
+                tableLog
+            );
+            if(!n) goto fail;
+            op += n;
+            fseBuildCTable(norm, alphabetSize[t], tableLog, &tables[t]);
+        }
+
+        uint32_t state[LZA_STREAMS];
+        for(int t = 0; t < LZA_STREAMS; t++) state[t] = 1u << tables[t].tableLog;
+
+        BitWriter bw;
+        bwInit(&bw, op, capacity - (size_t)(op - output));
+        for(size_t s = seqCount; s-- > 0;) {
+            const LzSeq* seq = &seqs[s];
+            if(!seq->matchLen) continue;
+
+            int llExtra, mlExtra, ofExtra;
+            uint32_t matchValue = seq->matchLen - LZA_MIN_MATCH;
+            uint32_t ll = lzLengthCode(seq->litLen, &llExtra);
+            uint32_t ml = lzLengthCode(matchValue, &mlExtra);
+            uint32_t of = lzOffsetCode(seq->offset, &ofExtra);
+
+            fseEncodeSymbol(&bw, &state[LZA_OF], &tables[LZA_OF], of);
+            fseEncodeSymbol(&bw, &state[LZA_ML], &tables[LZA_ML], ml);
+            fseEncodeSymbol(&bw, &state[LZA_LL], &tables[LZA_LL], ll);
+            if(ofExtra) bwPut(&bw, seq->offset - (1u << ofExtra), ofExtra);
+            if(mlExtra) bwPut(&bw, matchValue - (1u << mlExtra), mlExtra);
+            if(llExtra) bwPut(&bw, seq->litLen - (1u << llExtra), llExtra);
+        }
+        for(int t = LZA_STREAMS - 1; t >= 0; t--) fseFlushState(&bw, state[t], &tables[t]);
+        bwPut(&bw, 1, 1);
+        op += bwFinish(&bw);
+        if(bw.overflow) goto fail;
+    }
+
+    free(tables);
+    free(seqs);
+    *outputSize = (size_t)(op - output);
+    return output;
+
+fail:
+    printf("ERROR LZA: Compression failed\n");
+    free(literals);
+    free(tables);
+    free(output);
+    free(seqs);
+    return NULL;
+}
+
+/**
+ * Decompress Into
+ * Returns 0, or -1 on corrupt input or when capacity is too small.
+ */
+int lzaDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+
+    uint64_t header[4];
+    for(int i = 0; i < 4; i++) {
+        size_t n = varintGet(ip, end, &header[i]);
+        if(!n) return -1;
+        ip += n;
+    }
+    uint64_t decodedSize = header[0];
+    uint64_t literalCount = header[1];
+    uint64_t matchCount = header[2];
+    uint64_t literalStreamSize = header[3];
+    if(literalCount > decodedSize || literalStreamSize > (uint64_t)(end - ip)) return -1;
+    if(matchCount > decodedSize / LZA_MIN_MATCH) return -1;
+
+    if(decodedSize > capacity) return -1;
+
+    uint8_t* output = dst;
+    uint8_t* literals = malloc(literalCount ? (size_t)literalCount : 1);
+    FseDTable* tables = malloc(sizeof(FseDTable) * LZA_STREAMS);
+    if(!literals || !tables) goto corrupt;
+
+    if(literalStreamSize == literalCount) {
+        memcpy(literals, ip, (size_t)literalCount);
+    } else if(!fseDecompressBytes(ip, (size_t)literalStreamSize, literals, (size_t)literalCount)) {
+        goto corrupt;
+    }
+    ip += literalStreamSize;
+
+    uint8_t* op = output;
+    uint8_t* opEnd = output + decodedSize;
+    const uint8_t* lp = literals;
+    const uint8_t* lpEnd = literals + literalCount;
+
+    if(matchCount > 0) {
+        for(int t = 0; t < LZA_STREAMS; t++) {
+            uint16_t norm[LZ_LENGTH_CODES];
+            int tableLog;
+            size_t n = fseReadCounts(ip, end, norm, alphabetSize[t], maxTableLog[t], &tableLog);
+            if(!n) goto corrupt;
+            ip += n;
+            fseBuildDTable(norm, alphabetSize[t], tableLog, &tables[t]);
+        }
+
+        BitReaderBack br;
+        if(!brbInit(&br, ip, (size_t)(end - ip))) goto corrupt;
+
+        uint32_t state[LZA_STREAMS];
+        for(int t = 0; t < LZA_STREAMS; t++) {
+            brbReload(&br);
+            state[t] = brbRead(&br, tables[t].tableLog);
+        }
+
+        for(uint64_t s = 0; s < matchCount; s++) {
+            int llExtra, mlExtra, ofExtra;
+            uint32_t ll = fsePeekSymbol(state[LZA_LL], &tables[LZA_LL]);
+            uint32_t ml = fsePeekSymbol(state[LZA_ML], &tables[LZA_ML]);
+            uint32_t of = fsePeekSymbol(state[LZA_OF], &tables[LZA_OF]);
+
+            uint64_t litLen = lzLengthBase(ll, &llExtra);
+            uint64_t matchLen = lzLengthBase(ml, &mlExtra);
+            uint64_t offset = lzOffsetBase(of, &ofExtra);
+            brbReload(&br);
+            litLen += brbRead(&br, llExtra);
+            brbReload(&br);
+            matchLen += brbRead(&br, mlExtra);
+            brbReload(&br);
+            offset += brbRead(&br, ofExtra);
+            matchLen += LZA_MIN_MATCH;
+
+            brbReload(&br);
+            fseUpdateState(&br, &state[LZA_LL], &tables[LZA_LL]);
+            fseUpdateState(&br, &state[LZA_ML], &tables[LZA_ML]);
+            fseUpdateState(&br, &state[LZA_OF], &tables[LZA_OF]);
+
+            if(litLen > (uint64_t)(lpEnd - lp) || litLen > (uint64_t)(opEnd - op)) goto corrupt;
+            memcpy(op, lp, (size_t)litLen);
+            op += litLen;
+            lp += litLen;
+
+            if(offset > (uint64_t)(op - output) || matchLen > (uint64_t)(opEnd - op)) goto corrupt;
+            const uint8_t* src = op - offset;
+            if(offset >= matchLen) {
+                memcpy(op, src, (size_t)matchLen);
+                op += matchLen;
+            } else {
+                for(uint64_t j = 0; j < matchLen; j++) *op++ = *src++;
+            }
+        }
+        if(!brbFinished(&br)) goto corrupt;
+        for(int t = 0; t < LZA_STREAMS; t++) {
+            if(state[t] != 0) goto corrupt;
+        }
+    }
+
+    size_t tail = (size_t)(lpEnd - lp);
+    if(tail != (size_t)(opEnd - op)) goto corrupt;
+    memcpy(op, lp, tail);
+
+    free(literals);
+    free(tables);
+    *outputSize = (size_t)decodedSize;
+    return 0;
+
+corrupt:
+    printf("ERROR LZA: Corrupt or truncated stream\n");
+    free(literals);
+    free(tables);
+    return -1;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* lzaDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize;
+    if(!varintGet(data, data + size, &decodedSize) || decodedSize > SIZE_MAX) return NULL;
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(lzaDecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
\ No newline at end of file
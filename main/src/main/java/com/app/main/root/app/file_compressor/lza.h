@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZA_MIN_MATCH 3
+#define LZA_MAX_MATCH (1 << 16)
+#define LZA_LENGTH_TABLE_LOG 9
+#define LZA_OFFSET_TABLE_LOG 8
+
+/**
+ * LZ + tANS, the high-ratio sibling of LZH.
+ *
+ * Same header and literal/sequence split as LZH, but every stream is
+ * FSE coded: the literal stream with fseCompressBytes (or raw when
+ * that would not be smaller) and the sequences as one backward
+ * bitstream with a state per alphabet (literal run, match length,
+ * offset), after their normalized count tables.
+ */
+uint8_t* lzaCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+);
+uint8_t* lzaDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int lzaDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
\ No newline at end of file
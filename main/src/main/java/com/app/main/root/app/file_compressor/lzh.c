@@ -0,0 +1,317 @@
+#include "lzh.h"
+#include "lz_parse.h"
+#include "lz_codes.h"
+#include "huffman.h"
+#include "bitstream.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/**
+ * Compress With History
+ * Matches may reach into the historySize bytes before data, which
+ * the decoder must already hold in front of its output.
+ */
+uint8_t* lzhCompressWithHistory(
+    const uint8_t* data,
+    size_t historySize,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+
+    LzEntropyCost cost;
+    LzParams params;
+    params.windowSize = (size_t)1 << lzWindowLogForLevel(level, historySize + size);
+    params.minMatch = LZH_MIN_MATCH;
+    params.maxMatch = LZH_MAX_MATCH;
+    params.level = level;
+    params.cost = lzEntropyCostModel(&cost, data, size, LZH_MIN_MATCH, level);
+
+    size_t seqCount = 0;
+    LzSeq* seqs = lzParseWithHistory(data, historySize, size, &params, &seqCount);
+    if(!seqs) return NULL;
+
+    size_t literalCount = 0;
+    size_t matchCount = 0;
+    uint32_t llFreq[LZ_LENGTH_CODES] = {0};
+    uint32_t mlFreq[LZ_LENGTH_CODES] = {0};
+    uint32_t ofFreq[LZ_OFFSET_CODES] = {0};
+    for(size_t s = 0; s < seqCount; s++) {
+        literalCount += seqs[s].litLen;
+        if(!seqs[s].matchLen) continue;
+
+        int extra;
+        llFreq[lzLengthCode(seqs[s].litLen, &extra)]++;
+        mlFreq[lzLengthCode(seqs[s].matchLen - LZH_MIN_MATCH, &extra)]++;
+        ofFreq[lzOffsetCode(seqs[s].offset, &extra)]++;
+        matchCount++;
+    }
+
+    size_t capacity = 64 + 128 + literalCount * 2 + matchCount * 16;
+    uint8_t* output = malloc(capacity);
+    uint8_t* literals = malloc(literalCount ? literalCount : 1);
+    if(!output || !literals) {
+        free(output);
+        free(literals);
+        free(seqs);
+        return NULL;
+    }
+
+    const uint8_t* ip = data;
+    uint8_t* lp = literals;
+    for(size_t s = 0; s < seqCount; s++) {
+        memcpy(lp, ip, seqs[s].litLen);
+        lp += seqs[s].litLen;
+        ip += seqs[s].litLen + seqs[s].matchLen;
+    }
+
+    uint8_t literalHeader[VARINT_MAX_BYTES * 4];
+    size_t literalStreamSize = 0;
+    uint8_t* literalStream = output + sizeof(literalHeader);
+    if(literalCount > 0) {
+        literalStreamSize = hufCompressBytes(
+            literals,
+            literalCount,
+            literalStream,
+            capacity - sizeof(literalHeader)
+        );
+        if(!literalStreamSize) goto fail;
+        if(literalStreamSize >= literalCount) {
+            memcpy(literalStream, literals, literalCount);
+            literalStreamSize = literalCount;
+        }
+    }
+    free(literals);
+    literals = NULL;
+
+    size_t headerSize = 0;
+    headerSize += varintPut(literalHeader + headerSize, size);
+    headerSize += varintPut(literalHeader + headerSize, literalCount);
+    headerSize += varintPut(literalHeader + headerSize, matchCount);
+    headerSize += varintPut(literalHeader + headerSize, literalStreamSize);
+    memmove(output + headerSize, literalStream, literalStreamSize);
+    memcpy(output, literalHeader, headerSize);
+
+    uint8_t* op = output + headerSize + literalStreamSize;
+    if(matchCount > 0) {
+        uint8_t llLen[LZ_LENGTH_CODES], mlLen[LZ_LENGTH_CODES], ofLen[LZ_OFFSET_CODES];
+        HufCode llCode[LZ_LENGTH_CODES], mlCode[LZ_LENGTH_CODES], ofCode[LZ_OFFSET_CODES];
+        hufBuildLengths(llFreq, LZ_LENGTH_CODES, llLen);
+        hufBuildLengths(mlFreq, LZ_LENGTH_CODES, mlLen);
+        hufBuildLengths(ofFreq, LZ_OFFSET_CODES, ofLen);
+        hufBuildCodes(llLen, LZ_LENGTH_CODES, llCode);
+        hufBuildCodes(mlLen, LZ_LENGTH_CODES, mlCode);
+        hufBuildCodes(ofLen, LZ_OFFSET_CODES, ofCode);
+        op += hufWriteLengths(op, llLen, LZ_LENGTH_CODES);
+        op += hufWriteLengths(op, mlLen, LZ_LENGTH_CODES);
+        op += hufWriteLengths(op, ofLen, LZ_OFFSET_CODES);
+
+        BitWriter bw;
+        bwInit(&bw, op, capacity - (size_t)(op - output));
+        for(size_t s = 0; s < seqCount; s++) {
+            const LzSeq* seq = &seqs[s];
+            if(!seq->matchLen) continue;
+
+            int llExtra, mlExtra, ofExtra;
+            uint32_t matchValue = seq->matchLen - LZH_MIN_MATCH;
+            uint32_t ll = lzLengthCode(seq->litLen, &llExtra);
+            uint32_t ml = lzLengthCode(matchValue, &mlExtra);
+            uint32_t of = lzOffsetCode(seq->offset, &ofExtra);
+
+            bwPut(&bw, llCode[ll].code, llCode[ll].length);
+            bwPut(&bw, mlCode[ml].code, mlCode[ml].length);
+            bwPut(&bw, ofCode[of].code, ofCode[of].length);
+            if(llExtra) bwPut(&bw, seq->litLen - (1u << llExtra), llExtra);
+            if(mlExtra) bwPut(&bw, matchValue - (1u << mlExtra), mlExtra);
+            if(ofExtra) bwPut(&bw, seq->offset - (1u << ofExtra), ofExtra);
+        }
+        op += bwFinish(&bw);
+        if(bw.overflow) goto fail;
+    }
+
+    free(seqs);
+    *outputSize = (size_t)(op - output);
+    return output;
+
+fail:
+    printf("ERROR LZH: Output buffer overflow\n");
+    free(literals);
+    free(output);
+    free(seqs);
+    return NULL;
+}
+
+/**
+ * Compress
+ */
+uint8_t* lzhCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+) {
+    return lzhCompressWithHistory(data, 0, size, outputSize, level);
+}
+
+/**
+ * Decompress
+ * Literals are Huffman-decoded in one pass first, then sequences
+ * replay them interleaved with matches into the exact-size output.
+ * A literal stream as long as the literal count is stored raw.
+ * Returns 0, or -1 on corrupt input or when capacity is too small.
+ * Matches may reach historySize bytes back from dst.
+ */
+int lzhDecompressWithHistory(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t historySize,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+
+    uint64_t header[4];
+    for(int i = 0; i < 4; i++) {
+        size_t n = varintGet(ip, end, &header[i]);
+        if(!n) return -1;
+        ip += n;
+    }
+    uint64_t decodedSize = header[0];
+    uint64_t literalCount = header[1];
+    uint64_t matchCount = header[2];
+    uint64_t literalStreamSize = header[3];
+    if(literalCount > decodedSize || literalStreamSize > (uint64_t)(end - ip)) return -1;
+    if(matchCount > decodedSize / LZH_MIN_MATCH) return -1;
+
+    if(decodedSize > capacity) return -1;
+
+    uint8_t* output = dst;
+    uint8_t* literals = malloc(literalCount ? (size_t)literalCount : 1);
+    HufEntry* tables = malloc(sizeof(HufEntry) * HUF_TABLE_SIZE * 3);
+    if(!literals || !tables) goto corrupt;
+
+    if(literalStreamSize == literalCount) {
+        memcpy(literals, ip, (size_t)literalCount);
+    } else if(!hufDecompressBytes(ip, (size_t)literalStreamSize, literals, (size_t)literalCount)) {
+        goto corrupt;
+    }
+    ip += literalStreamSize;
+
+    uint8_t* op = output;
+    uint8_t* opEnd = output + decodedSize;
+    const uint8_t* lp = literals;
+    const uint8_t* lpEnd = literals + literalCount;
+
+    if(matchCount > 0) {
+        uint8_t llLen[LZ_LENGTH_CODES], mlLen[LZ_LENGTH_CODES], ofLen[LZ_OFFSET_CODES];
+        size_t n;
+        if(!(n = hufReadLengths(ip, end, llLen, LZ_LENGTH_CODES))) goto corrupt;
+        ip += n;
+        if(!(n = hufReadLengths(ip, end, mlLen, LZ_LENGTH_CODES))) goto corrupt;
+        ip += n;
+        if(!(n = hufReadLengths(ip, end, ofLen, LZ_OFFSET_CODES))) goto corrupt;
+        ip += n;
+
+        HufEntry* llTable = tables;
+        HufEntry* mlTable = tables + HUF_TABLE_SIZE;
+        HufEntry* ofTable = tables + HUF_TABLE_SIZE * 2;
+        if(!hufBuildDecodeTable(llLen, LZ_LENGTH_CODES, llTable) ||
+            !hufBuildDecodeTable(mlLen, LZ_LENGTH_CODES, mlTable) ||
+            !hufBuildDecodeTable(ofLen, LZ_OFFSET_CODES, ofTable)) {
+            goto corrupt;
+        }
+
+        BitReader br;
+        brInit(&br, ip, (size_t)(end - ip));
+        for(uint64_t s = 0; s < matchCount; s++) {
+            int llExtra, mlExtra, ofExtra;
+            brRefill(&br);
+            uint32_t ll = hufDecodeSymbol(&br, llTable);
+            uint32_t ml = hufDecodeSymbol(&br, mlTable);
+            uint32_t of = hufDecodeSymbol(&br, ofTable);
+            if(ll >= LZ_LENGTH_CODES || ml >= LZ_LENGTH_CODES || of >= LZ_OFFSET_CODES) goto corrupt;
+
+            uint64_t litLen = lzLengthBase(ll, &llExtra);
+            uint64_t matchLen = lzLengthBase(ml, &mlExtra);
+            uint64_t offset = lzOffsetBase(of, &ofExtra);
+            brRefill(&br);
+            if(llExtra) litLen += brRead(&br, llExtra);
+            brRefill(&br);
+            if(mlExtra) matchLen += brRead(&br, mlExtra);
+            if(ofExtra) offset += brRead(&br, ofExtra);
+            matchLen += LZH_MIN_MATCH;
+
+            if(litLen > (uint64_t)(lpEnd - lp) || litLen > (uint64_t)(opEnd - op)) goto corrupt;
+            memcpy(op, lp, (size_t)litLen);
+            op += litLen;
+            lp += litLen;
+
+            if(offset > (uint64_t)(op - output) + historySize || matchLen > (uint64_t)(opEnd - op)) goto corrupt;
+            const uint8_t* src = op - offset;
+            if(offset >= matchLen) {
+                memcpy(op, src, (size_t)matchLen);
+                op += matchLen;
+            } else {
+                for(uint64_t j = 0; j < matchLen; j++) *op++ = *src++;
+            }
+        }
+        if(brOverrun(&br)) goto corrupt;
+    }
+
+    size_t tail = (size_t)(lpEnd - lp);
+    if(tail != (size_t)(opEnd - op)) goto corrupt;
+    memcpy(op, lp, tail);
+
+    free(literals);
+    free(tables);
+    *outputSize = (size_t)decodedSize;
+    return 0;
+
+corrupt:
+    printf("ERROR LZH: Corrupt or truncated stream\n");
+    free(literals);
+    free(tables);
+    return -1;
+}
+
+/**
+ * Decompress Into
+ */
+int lzhDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    return lzhDecompressWithHistory(data, size, dst, capacity, 0, outputSize);
+}
+
+/**
+ * Decompress
+ */
+uint8_t* lzhDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize;
+    if(!varintGet(data, data + size, &decodedSize) || decodedSize > SIZE_MAX) return NULL;
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(lzhDecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
\ No newline at end of file
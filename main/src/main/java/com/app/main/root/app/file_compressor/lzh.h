@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZH_MIN_MATCH 3
+#define LZH_MAX_MATCH (1 << 16)
+
+/**
+ * LZ + canonical Huffman.
+ *
+ * Header: varint decoded size, literal count, sequence count and
+ * literal stream size. The literal stream is hufCompressBytes output,
+ * or the raw literals when that would not be smaller;
+ * sequences follow as one bitstream of (literal run, match length,
+ * offset) codes from lz_codes.h, each alphabet with its own table.
+ * Literals after the last match are implied by the literal count.
+ */
+uint8_t* lzhCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level
+);
+uint8_t* lzhCompressWithHistory(
+    const uint8_t* data,
+    size_t historySize,
+    size_t size,
+    size_t* outputSize,
+    int level
+);
+uint8_t* lzhDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int lzhDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+int lzhDecompressWithHistory(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t historySize,
+    size_t* outputSize
+);
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "match_finder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static inline uint32_t hashAt(const uint8_t* p) {
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (v * 2654435761u) >> (32 - MF_HASH_BITS);
+}
+
+/**
+ * Create
+ */
+MatchFinder* mfCreate(size_t windowSize, int maxChain) {
+    MatchFinder* mf = malloc(sizeof(MatchFinder));
+    if(!mf) return NULL;
+
+    size_t ringSize = 1;
+    while(ringSize < windowSize) ringSize <<= 1;
+
+    mf->head = malloc(sizeof(int32_t) * ((size_t)1 << MF_HASH_BITS));
+    mf->prev = malloc(sizeof(int32_t) * ringSize);
+    if(!mf->head || !mf->prev) {
+        mfDestroy(mf);
+        return NULL;
+    }
+
+    mf->windowSize = windowSize;
+    mf->windowMask = ringSize - 1;
+    mf->maxChain = maxChain > 0 ? maxChain : 1;
+    mfReset(mf);
+    return mf;
+}
+
+/**
+ * Destroy
+ */
+void mfDestroy(MatchFinder* mf) {
+    if(mf) {
+        free(mf->head);
+        free(mf->prev);
+        free(mf);
+    }
+}
+
+void mfReset(MatchFinder* mf) {
+    memset(mf->head, 0xFF, sizeof(int32_t) * ((size_t)1 << MF_HASH_BITS));
+    memset(mf->prev, 0xFF, sizeof(int32_t) * (mf->windowMask + 1));
+}
+
+/**
+ * Insert
+ */
+void mfInsert(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end
+) {
+    if(pos + MF_MIN_MATCH > end) return;
+
+    uint32_t h = hashAt(data + pos);
+    mf->prev[pos & mf->windowMask] = mf->head[h];
+    mf->head[h] = (int32_t)pos;
+}
+
+/**
+ * Find Longest
+ * Walks at most maxChain candidates and returns the longest match
+ * (0 if shorter than MF_MIN_MATCH). Does not insert pos.
+ */
+size_t mfFindLongest(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end,
+    size_t maxLen,
+    size_t* offset
+) {
+    if(pos + MF_MIN_MATCH > end) return 0;
+    if(maxLen > end - pos) maxLen = end - pos;
+    if(maxLen < MF_MIN_MATCH) return 0;
+
+    const uint8_t* cur = data + pos;
+    size_t bestLen = MF_MIN_MATCH - 1;
+    size_t bestOffset = 0;
+    int32_t cand = mf->head[hashAt(cur)];
+    int chain = mf->maxChain;
+
+    while(cand != MF_NO_POS && chain-- > 0) {
+        size_t candPos = (size_t)cand;
+        if(candPos >= pos) break;
+
+        size_t dist = pos - candPos;
+        if(dist > mf->windowSize) break;
+
+        const uint8_t* ref = data + candPos;
+        if(ref[bestLen] == cur[bestLen] && ref[0] == cur[0] && ref[1] == cur[1]) {
+            size_t len = 0;
+            while(len < maxLen && ref[len] == cur[len]) len++;
+            if(len > bestLen) {
+                bestLen = len;
+                bestOffset = dist;
+                if(len >= maxLen || len >= MF_NICE_LENGTH) break;
+            }
+        }
+
+        int32_t next = mf->prev[candPos & mf->windowMask];
+        if(next != MF_NO_POS && (size_t)next >= candPos) break;
+        cand = next;
+    }
+
+    if(bestOffset == 0) return 0;
+    *offset = bestOffset;
+    return bestLen;
+}
+
+/**
+ * Find All
+ * Same walk as mfFindLongest, but records every candidate that
+ * beats the previous best, so lengths come out strictly increasing.
+ * Used by the optimal parser to price each reachable length.
+ */
+size_t mfFindAll(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end,
+    size_t maxLen,
+    MfMatch* matches,
+    size_t maxMatches
+) {
+    if(pos + MF_MIN_MATCH > end) return 0;
+    if(maxLen > end - pos) maxLen = end - pos;
+    if(maxLen < MF_MIN_MATCH) return 0;
+
+    const uint8_t* cur = data + pos;
+    size_t bestLen = MF_MIN_MATCH - 1;
+    size_t count = 0;
+    int32_t cand = mf->head[hashAt(cur)];
+    int chain = mf->maxChain;
+
+    while(cand != MF_NO_POS && chain-- > 0 && count < maxMatches) {
+        size_t candPos = (size_t)cand;
+        if(candPos >= pos) break;
+
+        size_t dist = pos - candPos;
+        if(dist > mf->windowSize) break;
+
+        const uint8_t* ref = data + candPos;
+        if(ref[bestLen] == cur[bestLen] && ref[0] == cur[0] && ref[1] == cur[1]) {
+            size_t len = 0;
+            while(len < maxLen && ref[len] == cur[len]) len++;
+            if(len > bestLen) {
+                bestLen = len;
+                matches[count].length = (uint32_t)len;
+                matches[count].offset = (uint32_t)dist;
+                count++;
+                if(len >= maxLen || len >= MF_NICE_LENGTH) break;
+            }
+        }
+
+        int32_t next = mf->prev[candPos & mf->windowMask];
+        if(next != MF_NO_POS && (size_t)next >= candPos) break;
+        cand = next;
+    }
+
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define MF_HASH_BITS 16
+#define MF_MIN_MATCH 3
+#define MF_NICE_LENGTH 256
+#define MF_NO_POS -1
+
+/**
+ * Hash-chain match finder.
+ * head[] maps a hash of the next MF_MIN_MATCH bytes to the most
+ * recent position, prev[] links each position to the previous one
+ * with the same hash. Positions are absolute indices into the
+ * caller's buffer, prev[] is a ring of windowSize entries.
+ * A search stops early once it finds MF_NICE_LENGTH bytes.
+ */
+typedef struct {
+    uint32_t length;
+    uint32_t offset;
+} MfMatch;
+
+typedef struct {
+    int32_t* head;
+    int32_t* prev;
+    size_t windowSize;
+    size_t windowMask;
+    int maxChain;
+} MatchFinder;
+
+MatchFinder* mfCreate(size_t windowSize, int maxChain);
+void mfDestroy(MatchFinder* mf);
+void mfReset(MatchFinder* mf);
+void mfInsert(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end
+);
+size_t mfFindLongest(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end,
+    size_t maxLen,
+    size_t* offset
+);
+size_t mfFindAll(
+    MatchFinder* mf,
+    const uint8_t* data,
+    size_t pos,
+    size_t end,
+    size_t maxLen,
+    MfMatch* matches,
+    size_t maxMatches
+);
\ No newline at end of file
@@ -0,0 +1,658 @@
+#include "patch.h"
+#include "frame.h"
+#include "checksum.h"
+#include "bitstream.h"
+#include "varint.h"
+#include "stats.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define PATCH_MIN_SCORE 8
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} PatchBuffer;
+
+/**
+ * Policy Default
+ */
+void patchPolicyDefault(PatchPolicy* policy) {
+    policy->maxChain = PATCH_MAX_CHAIN_DEFAULT;
+    policy->maxPercent = PATCH_MAX_PERCENT_DEFAULT;
+}
+
+/**
+ * Suffix Array
+ * SA-IS (Nong, Zhang and Chan): linear time, working in place in the
+ * output array apart from a type bitmap and the buckets. The byte
+ * level reads the input shifted up by one with a virtual 0 sentinel
+ * at the end, so sa[0] is always the empty suffix; deeper levels
+ * read the reduced string of LMS names.
+ */
+static inline int32_t saChar(const void* s, int bytes, int32_t n, int32_t i) {
+    if(bytes) return i == n - 1 ? 0 : (int32_t)((const uint8_t*)s)[i] + 1;
+    return ((const int32_t*)s)[i];
+}
+
+static inline int typeGet(const uint8_t* t, int32_t i) {
+    return (t[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline void typeSet(uint8_t* t, int32_t i, int isS) {
+    if(isS) t[i >> 3] |= (uint8_t)(1 << (i & 7));
+    else t[i >> 3] &= (uint8_t)~(1 << (i & 7));
+}
+
+static inline int isLms(const uint8_t* t, int32_t i) {
+    return i > 0 && typeGet(t, i) && !typeGet(t, i - 1);
+}
+
+static void saBuckets(
+    const void* s,
+    int bytes,
+    int32_t n,
+    int32_t k,
+    int32_t* bkt,
+    int end
+) {
+    memset(bkt, 0, sizeof(int32_t) * ((size_t)k + 1));
+    for(int32_t i = 0; i < n; i++) bkt[saChar(s, bytes, n, i)]++;
+    int32_t sum = 0;
+    for(int32_t i = 0; i <= k; i++) {
+        sum += bkt[i];
+        bkt[i] = end ? sum : sum - bkt[i];
+    }
+}
+
+static void saInduce(
+    const uint8_t* t,
+    int32_t* sa,
+    const void* s,
+    int bytes,
+    int32_t n,
+    int32_t k,
+    int32_t* bkt
+) {
+    saBuckets(s, bytes, n, k, bkt, 0);
+    for(int32_t i = 0; i < n; i++) {
+        int32_t j = sa[i] - 1;
+        if(j >= 0 && !typeGet(t, j)) sa[bkt[saChar(s, bytes, n, j)]++] = j;
+    }
+    saBuckets(s, bytes, n, k, bkt, 1);
+    for(int32_t i = n - 1; i >= 0; i--) {
+        int32_t j = sa[i] - 1;
+        if(j >= 0 && typeGet(t, j)) sa[--bkt[saChar(s, bytes, n, j)]] = j;
+    }
+}
+
+static int saIs(
+    const void* s,
+    int bytes,
+    int32_t* sa,
+    int32_t n,
+    int32_t k
+) {
+    uint8_t* t = calloc((size_t)n / 8 + 1, 1);
+    int32_t* bkt = malloc(sizeof(int32_t) * ((size_t)k + 1));
+    if(!t || !bkt) {
+        free(t);
+        free(bkt);
+        return -1;
+    }
+
+    typeSet(t, n - 1, 1);
+    for(int32_t i = n - 2; i >= 0; i--) {
+        int32_t a = saChar(s, bytes, n, i);
+        int32_t b = saChar(s, bytes, n, i + 1);
+        typeSet(t, i, a < b || (a == b && typeGet(t, i + 1)));
+    }
+
+    saBuckets(s, bytes, n, k, bkt, 1);
+    for(int32_t i = 0; i < n; i++) sa[i] = -1;
+    for(int32_t i = 1; i < n; i++) {
+        if(isLms(t, i)) sa[--bkt[saChar(s, bytes, n, i)]] = i;
+    }
+    saInduce(t, sa, s, bytes, n, k, bkt);
+
+    int32_t n1 = 0;
+    for(int32_t i = 0; i < n; i++) {
+        if(isLms(t, sa[i])) sa[n1++] = sa[i];
+    }
+    for(int32_t i = n1; i < n; i++) sa[i] = -1;
+    int32_t name = 0;
+    int32_t prev = -1;
+    for(int32_t i = 0; i < n1; i++) {
+        int32_t pos = sa[i];
+        int diff = 0;
+        for(int32_t d = 0; d < n; d++) {
+            if(prev == -1 || saChar(s, bytes, n, pos + d) != saChar(s, bytes, n, prev + d) ||
+                typeGet(t, pos + d) != typeGet(t, prev + d)) {
+                diff = 1;
+                break;
+            }
+            if(d > 0 && (isLms(t, pos + d) || isLms(t, prev + d))) break;
+        }
+        if(diff) {
+            name++;
+            prev = pos;
+        }
+        sa[n1 + pos / 2] = name - 1;
+    }
+    for(int32_t i = n - 1, j = n - 1; i >= n1; i--) {
+        if(sa[i] >= 0) sa[j--] = sa[i];
+    }
+
+    int32_t* s1 = sa + n - n1;
+    int result = 0;
+    if(name < n1) {
+        result = saIs(s1, 0, sa, n1, name - 1);
+    } else {
+        for(int32_t i = 0; i < n1; i++) sa[s1[i]] = i;
+    }
+
+    if(result == 0) {
+        saBuckets(s, bytes, n, k, bkt, 1);
+        for(int32_t i = 1, j = 0; i < n; i++) {
+            if(isLms(t, i)) s1[j++] = i;
+        }
+        for(int32_t i = 0; i < n1; i++) sa[i] = s1[sa[i]];
+        for(int32_t i = n1; i < n; i++) sa[i] = -1;
+        for(int32_t i = n1 - 1; i >= 0; i--) {
+            int32_t j = sa[i];
+            sa[i] = -1;
+            sa[--bkt[saChar(s, bytes, n, j)]] = j;
+        }
+        saInduce(t, sa, s, bytes, n, k, bkt);
+    }
+    free(t);
+    free(bkt);
+    return result;
+}
+
+/**
+ * Suffix array of base with the empty suffix first: size + 1
+ * entries, NULL on allocation failure.
+ */
+static int32_t* suffixArray(const uint8_t* base, size_t size) {
+    int32_t n = (int32_t)size + 1;
+    int32_t* sa = malloc(sizeof(int32_t) * (size_t)n);
+    if(!sa) return NULL;
+    if(n == 1) {
+        sa[0] = 0;
+        return sa;
+    }
+    if(saIs(base, 1, sa, n, 256) != 0) {
+        free(sa);
+        return NULL;
+    }
+    return sa;
+}
+
+static int64_t matchLength(
+    const uint8_t* a,
+    int64_t aSize,
+    const uint8_t* b,
+    int64_t bSize
+) {
+    int64_t i = 0;
+    while(i < aSize && i < bSize && a[i] == b[i]) i++;
+    return i;
+}
+
+/**
+ * Longest match of target in base, by binary search over the
+ * suffix array.
+ */
+static int64_t searchBase(
+    const int32_t* sa,
+    const uint8_t* base,
+    int64_t baseSize,
+    const uint8_t* target,
+    int64_t targetSize,
+    int64_t* pos
+) {
+    int64_t st = 0;
+    int64_t en = baseSize;
+    while(en - st >= 2) {
+        int64_t mid = st + (en - st) / 2;
+        int64_t n = baseSize - sa[mid] < targetSize ? baseSize - sa[mid] : targetSize;
+        if(memcmp(base + sa[mid], target, (size_t)n) < 0) st = mid;
+        else en = mid;
+    }
+    int64_t x = matchLength(base + sa[st], baseSize - sa[st], target, targetSize);
+    int64_t y = matchLength(base + sa[en], baseSize - sa[en], target, targetSize);
+    *pos = x > y ? sa[st] : sa[en];
+    return x > y ? x : y;
+}
+
+static void bufferPut(PatchBuffer* buf, const uint8_t* data, size_t length) {
+    if(buf->failed || length == 0) return;
+    if(length > buf->capacity - buf->size) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while(capacity - buf->size < length) capacity *= 2;
+        uint8_t* grown = realloc(buf->data, capacity);
+        if(!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->size, data, length);
+    buf->size += length;
+}
+
+static void putControl(PatchBuffer* control, uint64_t diffLength, uint64_t extraLength, int64_t seek) {
+    uint8_t record[3 * VARINT_MAX_BYTES];
+    size_t n = varintPut(record, diffLength);
+    n += varintPut(record + n, extraLength);
+    n += varintPut(record + n, ((uint64_t)seek << 1) ^ (uint64_t)(seek >> 63));
+    bufferPut(control, record, n);
+}
+
+/**
+ * Diff
+ * bsdiff's matcher: extends exact suffix-array matches forward and
+ * backward into approximate ones as long as more than half the bytes
+ * agree, then splits any overlap between neighbours where it scores
+ * best. diff and extra have room for targetSize bytes between them.
+ */
+static int diffStreams(
+    const uint8_t* base,
+    int64_t baseSize,
+    const uint8_t* target,
+    int64_t targetSize,
+    const int32_t* sa,
+    PatchBuffer* control,
+    uint8_t* diff,
+    size_t* diffSize,
+    uint8_t* extra,
+    size_t* extraSize
+) {
+    int64_t scan = 0;
+    int64_t len = 0;
+    int64_t pos = 0;
+    int64_t lastScan = 0;
+    int64_t lastPos = 0;
+    int64_t lastOffset = 0;
+    *diffSize = 0;
+    *extraSize = 0;
+
+    while(scan < targetSize) {
+        int64_t oldScore = 0;
+        int64_t scsc;
+        for(scsc = scan += len; scan < targetSize; scan++) {
+            len = searchBase(sa, base, baseSize, target + scan, targetSize - scan, &pos);
+            for(; scsc < scan + len; scsc++) {
+                if(scsc + lastOffset < baseSize && base[scsc + lastOffset] == target[scsc]) oldScore++;
+            }
+            if((len == oldScore && len != 0) || len > oldScore + PATCH_MIN_SCORE) break;
+            if(scan + lastOffset < baseSize && base[scan + lastOffset] == target[scan]) oldScore--;
+        }
+        if(len == oldScore && scan != targetSize) continue;
+
+        int64_t s = 0;
+        int64_t best = 0;
+        int64_t lenf = 0;
+        for(int64_t i = 0; lastScan + i < scan && lastPos + i < baseSize; ) {
+            if(base[lastPos + i] == target[lastScan + i]) s++;
+            i++;
+            if(s * 2 - i > best * 2 - lenf) {
+                best = s;
+                lenf = i;
+            }
+        }
+
+        int64_t lenb = 0;
+        if(scan < targetSize) {
+            s = 0;
+            best = 0;
+            for(int64_t i = 1; scan >= lastScan + i && pos >= i; i++) {
+                if(base[pos - i] == target[scan - i]) s++;
+                if(s * 2 - i > best * 2 - lenb) {
+                    best = s;
+                    lenb = i;
+                }
+            }
+        }
+
+        if(lastScan + lenf > scan - lenb) {
+            int64_t overlap = (lastScan + lenf) - (scan - lenb);
+            int64_t lens = 0;
+            s = 0;
+            best = 0;
+            for(int64_t i = 0; i < overlap; i++) {
+                if(target[lastScan + lenf - overlap + i] == base[lastPos + lenf - overlap + i]) s++;
+                if(target[scan - lenb + i] == base[pos - lenb + i]) s--;
+                if(s > best) {
+                    best = s;
+                    lens = i + 1;
+                }
+            }
+            lenf += lens - overlap;
+            lenb -= lens;
+        }
+
+        for(int64_t i = 0; i < lenf; i++) {
+            diff[*diffSize + (size_t)i] = (uint8_t)(target[lastScan + i] - base[lastPos + i]);
+        }
+        *diffSize += (size_t)lenf;
+        int64_t extraLength = (scan - lenb) - (lastScan + lenf);
+        memcpy(extra + *extraSize, target + lastScan + lenf, (size_t)extraLength);
+        *extraSize += (size_t)extraLength;
+        putControl(control, (uint64_t)lenf, (uint64_t)extraLength, (pos - lenb) - (lastPos + lenf));
+
+        lastScan = scan - lenb;
+        lastPos = pos - lenb;
+        lastOffset = pos - scan;
+    }
+    return control->failed ? -1 : 0;
+}
+
+static void writePatchHeader(uint8_t* dst, const PatchHeader* header) {
+    writeLE64(dst, header->baseVersion);
+    writeLE64(dst + 8, header->baseSize);
+    writeLE64(dst + 16, header->targetSize);
+    writeLE32(dst + 24, header->baseChecksum);
+    writeLE32(dst + 28, header->targetChecksum);
+    writeLE32(dst + 32, header->depth);
+    dst[36] = (uint8_t)header->bodyType;
+    dst[37] = dst[38] = dst[39] = 0;
+}
+
+/**
+ * Read Header
+ * Returns 0, or -1 when the header is truncated, names an unknown
+ * body type or claims sizes above PATCH_MAX_SIZE.
+ */
+int patchReadHeader(
+    const uint8_t* data,
+    size_t size,
+    PatchHeader* header
+) {
+    if(size < PATCH_HEADER_SIZE) return -1;
+    header->baseVersion = readLE64(data);
+    header->baseSize = readLE64(data + 8);
+    header->targetSize = readLE64(data + 16);
+    header->baseChecksum = readLE32(data + 24);
+    header->targetChecksum = readLE32(data + 28);
+    header->depth = readLE32(data + 32);
+    header->bodyType = (CompressionType)data[36];
+    if(header->baseSize > PATCH_MAX_SIZE || header->targetSize > PATCH_MAX_SIZE) return -1;
+    return data[36] <= COMP_LZA ? 0 : -1;
+}
+
+/**
+ * Compress
+ * Patch turning base into data. NULL when either side is larger than
+ * PATCH_MAX_SIZE or on allocation failure.
+ */
+uint8_t* patchCompress(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint64_t baseVersion,
+    uint32_t baseDepth,
+    size_t* outputSize,
+    int level
+) {
+    *outputSize = 0;
+    if(size > PATCH_MAX_SIZE || baseSize > PATCH_MAX_SIZE) return NULL;
+
+    int32_t* sa = suffixArray(base, baseSize);
+    uint8_t* streams = malloc(size ? size * 2 : 1);
+    PatchBuffer control;
+    memset(&control, 0, sizeof(control));
+    size_t diffSize = 0;
+    size_t extraSize = 0;
+    int ok = sa && streams &&
+        diffStreams(base, (int64_t)baseSize, data, (int64_t)size, sa, &control,
+                    streams, &diffSize, streams + size, &extraSize) == 0;
+    free(sa);
+
+    PatchBuffer raw;
+    memset(&raw, 0, sizeof(raw));
+    if(ok) {
+        uint8_t sizes[3 * VARINT_MAX_BYTES];
+        size_t n = varintPut(sizes, control.size);
+        n += varintPut(sizes + n, diffSize);
+        n += varintPut(sizes + n, extraSize);
+        bufferPut(&raw, sizes, n);
+        bufferPut(&raw, control.data, control.size);
+        bufferPut(&raw, streams, diffSize);
+        bufferPut(&raw, streams + size, extraSize);
+        ok = !raw.failed;
+    }
+    free(control.data);
+    free(streams);
+
+    size_t bodySize = 0;
+    CompressionType bodyType = COMP_NONE;
+    uint8_t* body = ok ? compressUnfilteredOrStore(raw.data, raw.size, &bodySize, &bodyType, level) : NULL;
+    const uint8_t* bodyData = body ? body : raw.data;
+    uint8_t* output = ok && (body || bodySize == raw.size)
+        ? malloc(PATCH_HEADER_SIZE + VARINT_MAX_BYTES + bodySize)
+        : NULL;
+    if(output) {
+        PatchHeader header;
+        header.baseVersion = baseVersion;
+        header.baseSize = baseSize;
+        header.targetSize = size;
+        header.baseChecksum = crc32c(0, base, baseSize);
+        header.targetChecksum = crc32c(0, data, size);
+        header.depth = baseDepth + 1;
+        header.bodyType = bodyType;
+        writePatchHeader(output, &header);
+        size_t n = PATCH_HEADER_SIZE + varintPut(output + PATCH_HEADER_SIZE, raw.size);
+        memcpy(output + n, bodyData, bodySize);
+        *outputSize = n + bodySize;
+    }
+    free(body);
+    free(raw.data);
+    return output;
+}
+
+/**
+ * Decoded Size
+ */
+int patchDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    PatchHeader header;
+    if(patchReadHeader(data, size, &header) != 0) return -1;
+    *decodedSize = header.targetSize;
+    return 0;
+}
+
+/**
+ * Apply
+ * Replays the control stream: each record adds diffLength bytes of
+ * diff to the base at the current position, copies extraLength bytes
+ * of extra, then seeks the base.
+ */
+static int applyStreams(
+    const uint8_t* raw,
+    size_t rawSize,
+    const uint8_t* base,
+    size_t baseSize,
+    uint8_t* dst,
+    size_t targetSize
+) {
+    const uint8_t* ip = raw;
+    const uint8_t* end = raw + rawSize;
+    uint64_t sizes[3];
+    for(int i = 0; i < 3; i++) {
+        size_t n = varintGet(ip, end, &sizes[i]);
+        if(n == 0) return -1;
+        ip += n;
+    }
+    if(sizes[0] > (uint64_t)(end - ip) || sizes[1] > (uint64_t)(end - ip) - sizes[0] ||
+        sizes[2] != (uint64_t)(end - ip) - sizes[0] - sizes[1]) {
+        return -1;
+    }
+
+    const uint8_t* cp = ip;
+    const uint8_t* controlEnd = cp + sizes[0];
+    const uint8_t* dp = controlEnd;
+    const uint8_t* diffEnd = dp + sizes[1];
+    const uint8_t* ep = diffEnd;
+    size_t op = 0;
+    int64_t basePos = 0;
+    while(cp < controlEnd) {
+        uint64_t diffLength;
+        uint64_t extraLength;
+        uint64_t zigzag;
+        size_t n = varintGet(cp, controlEnd, &diffLength);
+        size_t m = n ? varintGet(cp + n, controlEnd, &extraLength) : 0;
+        size_t k = m ? varintGet(cp + n + m, controlEnd, &zigzag) : 0;
+        if(k == 0) return -1;
+        cp += n + m + k;
+
+        if(diffLength > targetSize - op || diffLength > (uint64_t)(diffEnd - dp)) return -1;
+        if(diffLength > 0 && (basePos < 0 || (uint64_t)basePos > baseSize || diffLength > baseSize - (uint64_t)basePos)) return -1;
+        const uint8_t* from = base + basePos;
+        for(size_t i = 0; i < (size_t)diffLength; i++) dst[op + i] = (uint8_t)(from[i] + dp[i]);
+        op += (size_t)diffLength;
+        dp += diffLength;
+
+        if(extraLength > targetSize - op || extraLength > (uint64_t)(end - ep)) return -1;
+        memcpy(dst + op, ep, (size_t)extraLength);
+        op += (size_t)extraLength;
+        ep += extraLength;
+
+        int64_t seek = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        basePos += (int64_t)diffLength + seek;
+    }
+    return op == targetSize && dp == diffEnd && ep == end ? 0 : -1;
+}
+
+/**
+ * Decompress Into
+ * Returns 0, or -1 when base is not the version the patch was made
+ * against, the patch is corrupt, or the output exceeds capacity.
+ */
+int patchDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    PatchHeader header;
+    if(patchReadHeader(data, size, &header) != 0) {
+        printf("ERROR PATCH: Invalid header\n");
+        return -1;
+    }
+    if(header.baseSize != baseSize || header.baseChecksum != crc32c(0, base, baseSize)) {
+        printf("ERROR PATCH: Base does not match version %llu\n", (unsigned long long)header.baseVersion);
+        return -1;
+    }
+    if(header.targetSize > capacity) return -1;
+
+    uint64_t rawSize = 0;
+    size_t n = varintGet(data + PATCH_HEADER_SIZE, data + size, &rawSize);
+    if(n == 0 || rawSize > SIZE_MAX - 1) return -1;
+    const uint8_t* body = data + PATCH_HEADER_SIZE + n;
+    size_t bodySize = size - PATCH_HEADER_SIZE - n;
+
+    uint8_t* raw = malloc(rawSize ? (size_t)rawSize : 1);
+    size_t decoded = 0;
+    int result = raw &&
+        decompressInto(body, bodySize, raw, (size_t)rawSize, &decoded, header.bodyType) == 0 &&
+        decoded == rawSize &&
+        applyStreams(raw, (size_t)rawSize, base, baseSize, dst, (size_t)header.targetSize) == 0 ? 0 : -1;
+    free(raw);
+    if(result != 0) {
+        printf("ERROR PATCH: Corrupt patch body\n");
+        return -1;
+    }
+    if(crc32c(0, dst, (size_t)header.targetSize) != header.targetChecksum) {
+        printf("ERROR PATCH: Output checksum mismatch\n");
+        return -1;
+    }
+    *outputSize = (size_t)header.targetSize;
+    return 0;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* patchDecompress(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    PatchHeader header;
+    if(patchReadHeader(data, size, &header) != 0 || header.targetSize > SIZE_MAX - 1) return NULL;
+    uint8_t* output = malloc(header.targetSize ? (size_t)header.targetSize : 1);
+    if(!output) return NULL;
+    if(patchDecompressInto(data, size, base, baseSize, output, (size_t)header.targetSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+/**
+ * Compress With Base
+ * compressParallelOrStore() unless a patch against base is allowed
+ * by the policy and pays off: the chain of patches behind the new
+ * version stays within maxChain, and the patch is at most maxPercent
+ * of the plain output. Otherwise the version re-bases to a full copy.
+ * A NULL policy takes the defaults. Stored input comes back as NULL
+ * with COMP_NONE, without a copy.
+ */
+uint8_t* compressWithBase(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint64_t baseVersion,
+    uint32_t baseDepth,
+    const PatchPolicy* policy,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+) {
+    PatchPolicy defaults;
+    if(!policy) {
+        patchPolicyDefault(&defaults);
+        policy = &defaults;
+    }
+    uint8_t* plain = compressParallelOrStore(data, size, outputSize, usedType, level);
+    if(*outputSize == 0 || !base || (int64_t)baseDepth + 1 > policy->maxChain ||
+        size > PATCH_MAX_SIZE || baseSize > PATCH_MAX_SIZE) {
+        return plain;
+    }
+
+    size_t patchSize = 0;
+    uint64_t start = statsNow();
+    uint8_t* patch = patchCompress(data, size, base, baseSize, baseVersion, baseDepth, &patchSize, level);
+    statsRecord(COMP_PATCH, size, patch ? patchSize : 0, start);
+    if(!patch || (uint64_t)patchSize * 100 > (uint64_t)*outputSize * (uint64_t)policy->maxPercent) {
+        free(patch);
+        return plain;
+    }
+
+    DEBUG_LOG("DEBUG C: Patch against version %llu: %zu -> %zu bytes\n",
+           (unsigned long long)baseVersion, *outputSize, patchSize);
+    free(plain);
+    *outputSize = patchSize;
+    *usedType = COMP_PATCH;
+    return patch;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "comp.h"
+
+#define PATCH_HEADER_SIZE 40
+#define PATCH_MAX_SIZE ((size_t)64 << 20)
+#define PATCH_MAX_CHAIN_DEFAULT 8
+#define PATCH_MAX_PERCENT_DEFAULT 50
+
+/**
+ * Binary diff storage of file versions (COMP_PATCH).
+ * Version N is stored as a bsdiff-style patch against version N-1:
+ * a suffix array of the base finds long approximate matches, each
+ * stored as bytewise differences (mostly zeros once the match is
+ * exact) and followed by the bytes that have no match. The control,
+ * diff and extra streams are packed together and compressed with the
+ * block codecs; decoding is one codec pass plus an add loop.
+ *
+ * A patch can only be decoded with its base, which the caller looks
+ * up by the version recorded in the header; decompress() rejects it.
+ * The base is checked against its CRC32C before use and the output
+ * against the target's.
+ *
+ * Header: u64 base version, u64 base size, u64 target size,
+ * u32 base CRC32C, u32 target CRC32C, u32 chain depth, u8 body type,
+ * three zero bytes, then varint raw body size and the body. Raw body:
+ * varint control, diff and extra sizes, then the three streams.
+ * Control: per match varint diff length, varint extra length, zigzag
+ * varint base seek.
+ */
+typedef struct {
+    int maxChain;
+    int maxPercent;
+} PatchPolicy;
+
+typedef struct {
+    uint64_t baseVersion;
+    uint64_t baseSize;
+    uint64_t targetSize;
+    uint32_t baseChecksum;
+    uint32_t targetChecksum;
+    uint32_t depth;
+    CompressionType bodyType;
+} PatchHeader;
+
+void patchPolicyDefault(PatchPolicy* policy);
+int patchReadHeader(
+    const uint8_t* data,
+    size_t size,
+    PatchHeader* header
+);
+uint8_t* patchCompress(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint64_t baseVersion,
+    uint32_t baseDepth,
+    size_t* outputSize,
+    int level
+);
+int patchDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+);
+int patchDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+uint8_t* patchDecompress(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    size_t* outputSize
+);
+uint8_t* compressWithBase(
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* base,
+    size_t baseSize,
+    uint64_t baseVersion,
+    uint32_t baseDepth,
+    const PatchPolicy* policy,
+    size_t* outputSize,
+    CompressionType* usedType,
+    int level
+);
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROBE_MAX_BYTES (64 * 1024)
+#define PROBE_MIN_BYTES 256
+#define PROBE_SKIP_RATIO 0.95
+#define PROBE_HASH_LOG 12
+#define PROBE_MATCH_BITS 1.0
+#define PROBE_ORDER1_MARGIN 0.75
+
+/**
+ * Compressibility probe over the first PROBE_MAX_BYTES of an input.
+ * Combines the order-0 entropy of the byte histogram, a bias
+ * corrected order-1 entropy and the share of 4-byte repeats into a
+ * predicted compressed/original ratio; compress is set when that is
+ * below PROBE_SKIP_RATIO.
+ */
+typedef struct {
+    int compress;
+    double predictedRatio;
+    double order0Bits;
+    double order1Bits;
+    double repeatShare;
+} ProbeResult;
+
+void probeHistogram(
+    const uint8_t* data,
+    size_t size,
+    uint32_t counts[256]
+);
+double probeOrder0Entropy(const uint32_t counts[256], size_t size);
+ProbeResult probeCompressibility(const uint8_t* data, size_t size);
\ No newline at end of file
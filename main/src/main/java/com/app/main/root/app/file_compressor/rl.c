@@ -1,111 +1,401 @@
 #include "rl.h"
+#include "varint.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
+// Platform-specific includes and types
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define RL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RL_SSE2 1
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#define RL_SCAN 32
+
+static inline int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/**
+ * Pair Mask
+ * Bit k is set when p[k] == p[k + 1]; reads RL_SCAN + 1 bytes.
+ */
+static inline uint32_t pairMask(const uint8_t* p) {
+#if defined(RL_AVX2)
+    __m256i a = _mm256_loadu_si256((const __m256i*)p);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(p + 1));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+#elif defined(RL_SSE2)
+    __m128i a0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i b0 = _mm_loadu_si128((const __m128i*)(p + 1));
+    __m128i a1 = _mm_loadu_si128((const __m128i*)(p + 16));
+    __m128i b1 = _mm_loadu_si128((const __m128i*)(p + 17));
+    uint32_t lo = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a0, b0));
+    uint32_t hi = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a1, b1));
+    return lo | hi << 16;
+#else
+    uint32_t mask = 0;
+    for(int k = 0; k < RL_SCAN; k++) mask |= (uint32_t)(p[k] == p[k + 1]) << k;
+    return mask;
+#endif
+}
+
+/**
+ * Value Mask
+ * Bit k is set when p[k] == value; reads RL_SCAN bytes.
+ */
+static inline uint32_t valueMask(const uint8_t* p, uint8_t value) {
+#if defined(RL_AVX2)
+    __m256i a = _mm256_loadu_si256((const __m256i*)p);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, _mm256_set1_epi8((char)value)));
+#elif defined(RL_SSE2)
+    __m128i v = _mm_set1_epi8((char)value);
+    uint32_t lo = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), v));
+    uint32_t hi = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), v));
+    return lo | hi << 16;
+#else
+    uint32_t mask = 0;
+    for(int k = 0; k < RL_SCAN; k++) mask |= (uint32_t)(p[k] == value) << k;
+    return mask;
+#endif
+}
+
+/**
+ * Find Run
+ * Position of the next run of at least RL_MIN_RUN equal bytes at or
+ * after pos, or size. Three overlapping pair masks mark every start
+ * of four equal bytes; only the first RL_SCAN - 2 bits of a window
+ * see all three, so windows advance by that much.
+ */
+static size_t findRun(const uint8_t* data, size_t pos, size_t size) {
+    while(pos + RL_SCAN + 1 <= size) {
+        uint32_t pairs = pairMask(data + pos);
+        uint32_t starts = pairs & (pairs >> 1) & (pairs >> 2) & ((1u << (RL_SCAN - 2)) - 1);
+        if(starts) return pos + lowestBit(starts);
+        pos += RL_SCAN - 2;
+    }
+    for(; pos + RL_MIN_RUN <= size; pos++) {
+        uint8_t v = data[pos];
+        if(data[pos + 1] == v && data[pos + 2] == v && data[pos + 3] == v) return pos;
+    }
+    return size;
+}
+
+static size_t runLength(const uint8_t* data, size_t pos, size_t size) {
+    uint8_t value = data[pos];
+    size_t end = pos + 1;
+    while(end + RL_SCAN <= size) {
+        uint32_t same = valueMask(data + end, value);
+        if(same != 0xFFFFFFFFu) return end + lowestBit(~same) - pos;
+        end += RL_SCAN;
+    }
+    while(end < size && data[end] == value) end++;
+    return end - pos;
+}
+
+static uint8_t* putSequence(
+    uint8_t* op,
+    const uint8_t* literals,
+    size_t litLen,
+    size_t runLen,
+    uint8_t value
+) {
+    size_t runCode = runLen ? runLen - RL_MIN_RUN : 0;
+    *op++ = (uint8_t)((litLen < 15 ? litLen : 15) << 4 | (runCode < 15 ? runCode : 15));
+    if(litLen >= 15) op += varintPut(op, litLen - 15);
+    memcpy(op, literals, litLen);
+    op += litLen;
+    if(runLen) {
+        if(runCode >= 15) op += varintPut(op, runCode - 15);
+        *op++ = value;
+    }
+    return op;
+}
+
 /**
  * Compress
+ * Run boundaries are found RL_SCAN bytes at a time; literals between
+ * runs are copied as they are. A sequence never codes to more than it
+ * consumes unless its literal count needs a third varint byte, hence
+ * the size / 1024 slack.
  */
-uint8_t* rlCompress(const uint8_t* data, size_t size, size_t* outputSize) {
-    if(size == 0) {
-        *outputSize = 0;
+uint8_t* rlCompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+
+    size_t capacity = 2 + VARINT_MAX_BYTES * 2 + 1 + size + size / 1024;
+    uint8_t* output = malloc(capacity);
+    if(!output) {
+        printf("ERROR RL: malloc failed for size: %zu\n", capacity);
         return NULL;
     }
 
-    printf("DEBUG RL: Compressing %zu bytes\n", size);
-    
-    uint8_t* outputBuffer = (uint8_t*)malloc(size * 2);
-    if(!outputBuffer) {
-        printf("ERROR RL: malloc failed for size: %zu\n", size * 2);
-        *outputSize = 0;
-        return NULL;
+    uint8_t* op = output;
+    *op++ = RL_MAGIC0;
+    *op++ = RL_MAGIC1;
+    op += varintPut(op, size);
+
+    size_t pos = 0;
+    while(pos < size) {
+        size_t runStart = findRun(data, pos, size);
+        size_t runLen = runStart < size ? runLength(data, runStart, size) : 0;
+        uint8_t value = runLen ? data[runStart] : 0;
+        op = putSequence(op, data + pos, runStart - pos, runLen, value);
+        pos = runStart + runLen;
     }
-    
-    size_t outIdx = 0;
+
+    *outputSize = (size_t)(op - output);
+    uint8_t* shrunk = realloc(output, *outputSize);
+    return shrunk ? shrunk : output;
+}
+
+/**
+ * Fill
+ * Expands a run with full-width vector stores; the last store is
+ * moved back to end exactly at the run end.
+ */
+static void fillRun(uint8_t* dst, uint8_t value, size_t length) {
+#if defined(RL_AVX2)
+    if(length >= 32) {
+        __m256i v = _mm256_set1_epi8((char)value);
+        size_t i = 0;
+        for(; i + 32 <= length; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), v);
+        if(i < length) _mm256_storeu_si256((__m256i*)(dst + length - 32), v);
+        return;
+    }
+#endif
+#if defined(RL_AVX2) || defined(RL_SSE2)
+    if(length >= 16) {
+        __m128i v = _mm_set1_epi8((char)value);
+        size_t i = 0;
+        for(; i + 16 <= length; i += 16) _mm_storeu_si128((__m128i*)(dst + i), v);
+        if(i < length) _mm_storeu_si128((__m128i*)(dst + length - 16), v);
+        return;
+    }
+#endif
+    memset(dst, value, length);
+}
+
+static size_t legacyDecodedSize(const uint8_t* data, size_t size) {
+    size_t total = 0;
     size_t i = 0;
-    
     while(i < size) {
-        uint8_t current = data[i];
-        size_t runLength = 1;
-        
-        while(i + runLength < size && 
-              runLength < MAX_RUN_LENGTH && 
-              data[i + runLength] == current) {
-            runLength++;
-        }
-        
-        if(runLength > 3 || current == 0xFF) {
-            if(outIdx + 3 >= size * 2) {
-                printf("ERROR RL: Output buffer overflow\n");
-                free(outputBuffer);
-                *outputSize = 0;
-                return NULL;
-            }
-            outputBuffer[outIdx++] = 0xFF;
-            outputBuffer[outIdx++] = (uint8_t)runLength;
-            outputBuffer[outIdx++] = current;
-            i += runLength;
+        if(data[i] == 0xFF && i + 2 < size) {
+            total += data[i + 1];
+            i += 3;
         } else {
-            if(outIdx + runLength >= size * 2) {
-                printf("ERROR RL: Output buffer overflow\n");
-                free(outputBuffer);
-                *outputSize = 0;
-                return NULL;
-            }
-            for(size_t j = 0; j < runLength; j++) {
-                if(current == 0xFF) {
-                    outputBuffer[outIdx++] = 0xFF;
-                    outputBuffer[outIdx++] = 0x01;
-                }
-                outputBuffer[outIdx++] = current;
-            }
-            i += runLength;
+            total++;
+            i++;
         }
     }
-    
-    *outputSize = outIdx;
-    
-    uint8_t* finalBuffer = (uint8_t*)realloc(outputBuffer, outIdx);
-    if(!finalBuffer && outIdx > 0) {
-        finalBuffer = outputBuffer;
-    }
-    
-    printf("DEBUG RL: Compressed %zu -> %zu bytes\n", size, outIdx);
-    return finalBuffer ? finalBuffer : outputBuffer;
+    return total;
 }
 
 /**
- * Decompress
+ * Legacy Decode
+ * Format v1: FF, run, value triplets between raw bytes.
  */
-uint8_t* rlDecompress(
+static int legacyDecompressInto(
     const uint8_t* data,
     size_t size,
+    uint8_t* dst,
+    size_t capacity,
     size_t* outputSize
 ) {
-    if(size == 0) {
-        *outputSize = 0;
-        return NULL;
-    }
-
-    uint8_t* outputBuffer = malloc(size * 256);
-    size_t outIdx = 0;
+    size_t decodedSize = legacyDecodedSize(data, size);
+    if(decodedSize > capacity) return -1;
 
+    uint8_t* op = dst;
     size_t i = 0;
     while(i < size) {
         if(data[i] == 0xFF && i + 2 < size) {
-            uint8_t runLength = data[i+1];
-            uint8_t val = data[i+2];
-            for(int j = 0; j < runLength; j++) {
-                outputBuffer[outIdx++] = val;
-            }
-
+            fillRun(op, data[i + 2], data[i + 1]);
+            op += data[i + 1];
             i += 3;
         } else {
-            outputBuffer[outIdx++] = data[i++];
+            *op++ = data[i++];
+        }
+    }
+    *outputSize = decodedSize;
+    return 0;
+}
+
+static int isLegacy(const uint8_t* data, size_t size) {
+    return size < 2 || data[0] != RL_MAGIC0 || data[1] != RL_MAGIC1;
+}
+
+/**
+ * Count Sequences
+ * Adds up the literal and run lengths without writing anything, so
+ * a header claiming more than the sequences produce is caught before
+ * the output is allocated. Returns 0, or -1 when they disagree.
+ */
+static int countSequences(
+    const uint8_t* ip,
+    const uint8_t* end,
+    uint64_t decodedSize
+) {
+    uint64_t total = 0;
+    size_t n;
+    while(total < decodedSize) {
+        if(ip >= end) return -1;
+        uint8_t token = *ip++;
+
+        uint64_t litLen = token >> 4;
+        if(litLen == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) return -1;
+            ip += n;
+            litLen += extra;
+        }
+        if(litLen > (uint64_t)(end - ip) || litLen > decodedSize - total) return -1;
+        ip += litLen;
+        total += litLen;
+        if(total == decodedSize) break;
+
+        uint64_t runLen = token & 0x0F;
+        if(runLen == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) return -1;
+            ip += n;
+            runLen += extra;
         }
+        runLen += RL_MIN_RUN;
+        if(ip >= end || runLen > decodedSize - total) return -1;
+        ip++;
+        total += runLen;
     }
+    return 0;
+}
+
+/**
+ * Decoded Size
+ * Read from the header and checked against the sequences, or counted
+ * from a legacy stream. Returns 0, or -1 when the header is truncated
+ * or the sequences do not add up to it.
+ */
+int rlDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    if(isLegacy(data, size)) {
+        *decodedSize = legacyDecodedSize(data, size);
+        return 0;
+    }
+    size_t n = varintGet(data + 2, data + size, decodedSize);
+    if(!n || countSequences(data + 2 + n, data + size, *decodedSize) != 0) {
+        *decodedSize = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Decompress Into
+ * Decodes into dst, failing if the decoded size exceeds capacity.
+ */
+int rlDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    if(isLegacy(data, size)) return legacyDecompressInto(data, size, dst, capacity, outputSize);
 
-    *outputSize = outIdx;
-    return outputBuffer;
+    const uint8_t* ip = data + 2;
+    const uint8_t* end = data + size;
+    uint64_t decodedSize = 0;
+    size_t n = varintGet(ip, end, &decodedSize);
+    if(!n || decodedSize > capacity) return -1;
+    ip += n;
+
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + decodedSize;
+    while(op < opEnd) {
+        if(ip >= end) goto corrupt;
+        uint8_t token = *ip++;
+
+        uint64_t litLen = token >> 4;
+        if(litLen == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) goto corrupt;
+            ip += n;
+            litLen += extra;
+        }
+        if(litLen > (uint64_t)(end - ip) || litLen > (uint64_t)(opEnd - op)) goto corrupt;
+        memcpy(op, ip, (size_t)litLen);
+        op += litLen;
+        ip += litLen;
+        if(op == opEnd) break;
+
+        uint64_t runLen = token & 0x0F;
+        if(runLen == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) goto corrupt;
+            ip += n;
+            runLen += extra;
+        }
+        runLen += RL_MIN_RUN;
+        if(ip >= end || runLen > (uint64_t)(opEnd - op)) goto corrupt;
+        fillRun(op, *ip++, (size_t)runLen);
+        op += runLen;
+    }
+
+    *outputSize = (size_t)decodedSize;
+    return 0;
+
+corrupt:
+    printf("ERROR RL: Corrupt stream at input offset %zu\n", (size_t)(ip - data));
+    return -1;
+}
+
+/**
+ * Decompress
+ * The decoded size is read up front, so the output is allocated once
+ * at its exact size.
+ */
+uint8_t* rlDecompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+
+    uint64_t decodedSize = 0;
+    if(rlDecodedSize(data, size, &decodedSize) != 0 || decodedSize > SIZE_MAX) {
+        printf("ERROR RL: Truncated header\n");
+        return NULL;
+    }
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) {
+        printf("ERROR RL: malloc failed for size: %llu\n", (unsigned long long)decodedSize);
+        return NULL;
+    }
+    if(rlDecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
 }
\ No newline at end of file
@@ -2,15 +2,40 @@
 #include <stdint.h>
 #include <stddef.h>
 
-#define MAX_RUN_LENGTH 255
+#define RL_MAGIC0 0xFF
+#define RL_MAGIC1 0x00
+#define RL_MIN_RUN 4
 
+/**
+ * Run-length coding, format v2.
+ *
+ * Header: bytes FF 00, varint decoded size. Legacy v1 streams
+ * (FF, run, value triplets between raw bytes) never start with a
+ * zero-length run, so they are still decoded.
+ * Sequence: token byte (literal count in the high nibble, run
+ * length - RL_MIN_RUN in the low nibble, 15 = varint follows),
+ * literal extension, literals, then unless the output is complete:
+ * run extension and the run value.
+ */
 uint8_t* rlCompress(
-    const uint8_t* data, 
-    size_t size, 
+    const uint8_t* data,
+    size_t size,
     size_t* outputSize
 );
 uint8_t* rlDecompress(
-    const uint8_t* data, 
-    size_t size, 
+    const uint8_t* data,
+    size_t size,
     size_t* outputSize
+);
+int rlDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
+int rlDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
 );
\ No newline at end of file
@@ -0,0 +1,803 @@
+#include "rsync.h"
+#include "file_io.h"
+#include "thread_pool.h"
+#include "bitstream.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#define RS_ENTRY_SIZE (4 + RS_STRONG_SIZE)
+#define RS_SIGN_BATCH 64
+
+typedef struct {
+    uint32_t blockSize;
+    uint64_t baseSize;
+    size_t blockCount;
+    const uint8_t* entries;
+} RsSignature;
+
+typedef struct {
+    uint32_t weak;
+    uint32_t block;
+} RsEntry;
+
+/**
+ * Block Index
+ * Full blocks sorted by weak checksum, with an open-addressed table
+ * from each distinct weak value to its first entry. A short last
+ * block is left out; it can only match at the very end of the target
+ * and is checked there.
+ */
+typedef struct {
+    const RsSignature* sig;
+    RsEntry* entries;
+    size_t count;
+    int32_t* table;
+    size_t mask;
+    int shift;
+} RsIndex;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} RsBuffer;
+
+typedef struct {
+    const RsSignature* sig;
+    RsIndex index;
+    RsBuffer out;
+    uint64_t copyStart;
+    uint64_t copyCount;
+    EVP_MD_CTX* targetHash;
+    uint64_t targetSize;
+} RsDeltaState;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    uint32_t blockSize;
+    uint8_t* entries;
+    TpFlag failed;
+} RsSignJob;
+
+typedef int (*RsSink)(
+    void* ctx,
+    const uint8_t* literal,
+    uint64_t baseOffset,
+    size_t length
+);
+
+/**
+ * Weak Checksum
+ * Adler-style: s1 is the byte sum, s2 the sum of the running s1, both
+ * kept mod 2^16 when combined. Rolling by one byte is O(1).
+ */
+static void weakInit(
+    const uint8_t* data,
+    size_t length,
+    uint32_t* s1,
+    uint32_t* s2
+) {
+    uint32_t a = 0;
+    uint32_t b = 0;
+    for(size_t i = 0; i < length; i++) {
+        a += data[i];
+        b += a;
+    }
+    *s1 = a;
+    *s2 = b;
+}
+
+static uint32_t weakValue(uint32_t s1, uint32_t s2) {
+    return (s1 & 0xFFFF) | (s2 << 16);
+}
+
+static int strongHash(const uint8_t* data, size_t length, uint8_t* strong) {
+    uint8_t digest[32];
+    if(!EVP_Digest(data, length, digest, NULL, EVP_sha256(), NULL)) return -1;
+    memcpy(strong, digest, RS_STRONG_SIZE);
+    return 0;
+}
+
+/**
+ * Block Size
+ * About sqrt(baseSize) in RS_BLOCK_MIN steps, which balances
+ * signature size against the literal bytes around each edit.
+ */
+uint32_t rsBlockSize(uint64_t baseSize) {
+    uint32_t blockSize = RS_BLOCK_MIN;
+    while(blockSize < RS_BLOCK_MAX && (uint64_t)blockSize * blockSize < baseSize) {
+        blockSize += RS_BLOCK_MIN;
+    }
+    return blockSize;
+}
+
+static size_t blockCountFor(uint64_t size, uint32_t blockSize) {
+    return (size_t)((size + blockSize - 1) / blockSize);
+}
+
+static void writeRsHeader(
+    uint8_t* dst,
+    uint32_t magic,
+    uint32_t blockSize,
+    uint64_t baseSize
+) {
+    writeLE32(dst, magic);
+    dst[4] = RS_VERSION;
+    dst[5] = dst[6] = dst[7] = 0;
+    writeLE32(dst + 8, blockSize);
+    writeLE64(dst + 12, baseSize);
+}
+
+static int readRsHeader(
+    const uint8_t* src,
+    size_t size,
+    uint32_t magic,
+    uint32_t* blockSize,
+    uint64_t* baseSize
+) {
+    if(size < RS_SIGNATURE_HEADER_SIZE || readLE32(src) != magic || src[4] != RS_VERSION) return -1;
+    *blockSize = readLE32(src + 8);
+    *baseSize = readLE64(src + 12);
+    return *blockSize >= RS_BLOCK_MIN && *blockSize <= RS_BLOCK_MAX ? 0 : -1;
+}
+
+static int parseSignature(
+    const uint8_t* src,
+    size_t size,
+    RsSignature* sig
+) {
+    if(readRsHeader(src, size, RS_SIGNATURE_MAGIC, &sig->blockSize, &sig->baseSize) != 0) {
+        printf("ERROR RSYNC: Invalid signature header\n");
+        return -1;
+    }
+    uint64_t count = (sig->baseSize + sig->blockSize - 1) / sig->blockSize;
+    if(count > (size - RS_SIGNATURE_HEADER_SIZE) / RS_ENTRY_SIZE ||
+        size - RS_SIGNATURE_HEADER_SIZE != count * RS_ENTRY_SIZE) {
+        printf("ERROR RSYNC: Signature size does not match %llu blocks\n", (unsigned long long)count);
+        return -1;
+    }
+    sig->blockCount = (size_t)count;
+    sig->entries = src + RS_SIGNATURE_HEADER_SIZE;
+    return 0;
+}
+
+static void signBatchTask(void* arg, size_t index) {
+    RsSignJob* job = (RsSignJob*)arg;
+    size_t first = index * RS_SIGN_BATCH;
+    size_t count = blockCountFor(job->size, job->blockSize);
+    size_t last = first + RS_SIGN_BATCH < count ? first + RS_SIGN_BATCH : count;
+    for(size_t b = first; b < last; b++) {
+        size_t offset = b * job->blockSize;
+        size_t length = job->size - offset < job->blockSize ? job->size - offset : job->blockSize;
+        uint8_t* entry = job->entries + b * RS_ENTRY_SIZE;
+        uint32_t s1;
+        uint32_t s2;
+        weakInit(job->data + offset, length, &s1, &s2);
+        writeLE32(entry, weakValue(s1, s2));
+        if(strongHash(job->data + offset, length, entry + 4) != 0) tpFlagSet(&job->failed);
+    }
+}
+
+/**
+ * Signs the blocks of data, which starts on a block boundary, into
+ * entries on the shared pool.
+ */
+static int signBlocks(
+    const uint8_t* data,
+    size_t size,
+    uint32_t blockSize,
+    uint8_t* entries
+) {
+    RsSignJob job;
+    job.data = data;
+    job.size = size;
+    job.blockSize = blockSize;
+    job.entries = entries;
+    job.failed = 0;
+    size_t batches = (blockCountFor(size, blockSize) + RS_SIGN_BATCH - 1) / RS_SIGN_BATCH;
+    tpRun(tpShared(), signBatchTask, &job, batches);
+    return tpFlagTest(&job.failed) ? -1 : 0;
+}
+
+static uint8_t* allocSignature(
+    uint64_t baseSize,
+    uint32_t* blockSize,
+    size_t* sigSize
+) {
+    *sigSize = 0;
+    if(*blockSize == 0) *blockSize = rsBlockSize(baseSize);
+    if(*blockSize < RS_BLOCK_MIN || *blockSize > RS_BLOCK_MAX) {
+        printf("ERROR RSYNC: Invalid block size: %u\n", *blockSize);
+        return NULL;
+    }
+    uint64_t count = (baseSize + *blockSize - 1) / *blockSize;
+    if(count > (SIZE_MAX - RS_SIGNATURE_HEADER_SIZE) / RS_ENTRY_SIZE) return NULL;
+    size_t size = RS_SIGNATURE_HEADER_SIZE + (size_t)count * RS_ENTRY_SIZE;
+    uint8_t* sig = malloc(size);
+    if(!sig) return NULL;
+    writeRsHeader(sig, RS_SIGNATURE_MAGIC, *blockSize, baseSize);
+    *sigSize = size;
+    return sig;
+}
+
+/**
+ * Signature
+ * blockSize 0 picks rsBlockSize(baseSize).
+ */
+uint8_t* rsSignature(
+    const uint8_t* base,
+    size_t baseSize,
+    uint32_t blockSize,
+    size_t* sigSize
+) {
+    uint8_t* sig = allocSignature(baseSize, &blockSize, sigSize);
+    if(!sig) return NULL;
+    if(signBlocks(base, baseSize, blockSize, sig + RS_SIGNATURE_HEADER_SIZE) != 0) {
+        free(sig);
+        *sigSize = 0;
+        return NULL;
+    }
+    return sig;
+}
+
+/**
+ * Signature File
+ * Signs the file a window of whole blocks at a time.
+ */
+uint8_t* rsSignatureFile(
+    const char* basePath,
+    uint32_t blockSize,
+    size_t* sigSize
+) {
+    *sigSize = 0;
+    MappedFile* in = mfOpen(basePath);
+    if(!in) {
+        printf("ERROR RSYNC: Cannot open base file: %s\n", basePath);
+        return NULL;
+    }
+
+    uint64_t baseSize = mfSize(in);
+    uint8_t* sig = allocSignature(baseSize, &blockSize, sigSize);
+    size_t window = FILE_MAP_WINDOW - FILE_MAP_WINDOW % blockSize;
+    for(uint64_t pos = 0; sig && pos < baseSize; pos += window) {
+        size_t length = baseSize - pos < window ? (size_t)(baseSize - pos) : window;
+        const uint8_t* view = mfView(in, pos, length);
+        uint8_t* entries = sig + RS_SIGNATURE_HEADER_SIZE + (size_t)(pos / blockSize) * RS_ENTRY_SIZE;
+        if(!view || signBlocks(view, length, blockSize, entries) != 0) {
+            free(sig);
+            sig = NULL;
+            *sigSize = 0;
+        }
+    }
+    mfClose(in);
+    return sig;
+}
+
+static int compareEntries(const void* a, const void* b) {
+    const RsEntry* x = (const RsEntry*)a;
+    const RsEntry* y = (const RsEntry*)b;
+    if(x->weak != y->weak) return x->weak < y->weak ? -1 : 1;
+    return x->block < y->block ? -1 : (x->block > y->block ? 1 : 0);
+}
+
+static size_t weakSlot(const RsIndex* index, uint32_t weak) {
+    return (size_t)((weak * 0x9E3779B1u) >> index->shift) & index->mask;
+}
+
+static int buildIndex(RsIndex* index, const RsSignature* sig) {
+    memset(index, 0, sizeof(*index));
+    index->sig = sig;
+    index->count = (size_t)(sig->baseSize / sig->blockSize);
+    if(index->count > INT32_MAX) return -1;
+    int bits = 4;
+    while(((size_t)1 << bits) < index->count * 2 && bits < 31) bits++;
+    index->mask = ((size_t)1 << bits) - 1;
+    index->shift = 32 - bits;
+    index->entries = malloc(sizeof(RsEntry) * (index->count ? index->count : 1));
+    index->table = malloc(sizeof(int32_t) * (index->mask + 1));
+    if(!index->entries || !index->table) return -1;
+
+    for(size_t b = 0; b < index->count; b++) {
+        index->entries[b].weak = readLE32(sig->entries + b * RS_ENTRY_SIZE);
+        index->entries[b].block = (uint32_t)b;
+    }
+    qsort(index->entries, index->count, sizeof(RsEntry), compareEntries);
+    memset(index->table, 0xFF, sizeof(int32_t) * (index->mask + 1));
+    for(size_t e = 0; e < index->count; e++) {
+        if(e > 0 && index->entries[e - 1].weak == index->entries[e].weak) continue;
+        size_t slot = weakSlot(index, index->entries[e].weak);
+        while(index->table[slot] >= 0) slot = (slot + 1) & index->mask;
+        index->table[slot] = (int32_t)e;
+    }
+    return 0;
+}
+
+static void freeIndex(RsIndex* index) {
+    free(index->entries);
+    free(index->table);
+    memset(index, 0, sizeof(*index));
+}
+
+static const uint8_t* strongOf(const RsSignature* sig, size_t block) {
+    return sig->entries + block * RS_ENTRY_SIZE + 4;
+}
+
+/**
+ * Find Block
+ * Base block whose weak and strong hashes match the window, -1 if
+ * none. The block after the current copy run wins among equals, so
+ * runs stay long and the delta stays small on repetitive data.
+ */
+static int64_t findBlock(
+    RsDeltaState* st,
+    const uint8_t* window,
+    uint32_t weak,
+    int* failed
+) {
+    const RsIndex* index = &st->index;
+    size_t slot = weakSlot(index, weak);
+    int32_t first = -1;
+    for(; index->table[slot] >= 0; slot = (slot + 1) & index->mask) {
+        if(index->entries[index->table[slot]].weak == weak) {
+            first = index->table[slot];
+            break;
+        }
+    }
+    if(first < 0) return -1;
+
+    uint8_t strong[RS_STRONG_SIZE];
+    if(strongHash(window, st->sig->blockSize, strong) != 0) {
+        *failed = 1;
+        return -1;
+    }
+    uint64_t expected = st->copyStart + st->copyCount;
+    if(st->copyCount > 0 && expected < index->count &&
+        readLE32(st->sig->entries + expected * RS_ENTRY_SIZE) == weak &&
+        memcmp(strongOf(st->sig, (size_t)expected), strong, RS_STRONG_SIZE) == 0) {
+        return (int64_t)expected;
+    }
+    for(size_t e = (size_t)first; e < index->count && index->entries[e].weak == weak; e++) {
+        if(memcmp(strongOf(st->sig, index->entries[e].block), strong, RS_STRONG_SIZE) == 0) {
+            return index->entries[e].block;
+        }
+    }
+    return -1;
+}
+
+static void bufferPut(RsBuffer* buf, const uint8_t* data, size_t length) {
+    if(buf->failed || length == 0) return;
+    if(length > buf->capacity - buf->size) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while(capacity - buf->size < length) {
+            if(capacity > SIZE_MAX / 2) {
+                buf->failed = 1;
+                return;
+            }
+            capacity *= 2;
+        }
+        uint8_t* grown = realloc(buf->data, capacity);
+        if(!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->size, data, length);
+    buf->size += length;
+}
+
+static void flushCopy(RsDeltaState* st) {
+    if(st->copyCount == 0) return;
+    uint8_t op[1 + 2 * VARINT_MAX_BYTES];
+    size_t n = 0;
+    op[n++] = RS_OP_COPY;
+    n += varintPut(op + n, st->copyStart);
+    n += varintPut(op + n, st->copyCount);
+    bufferPut(&st->out, op, n);
+    st->copyCount = 0;
+}
+
+static void emitLiteral(RsDeltaState* st, const uint8_t* data, size_t length) {
+    if(length == 0) return;
+    flushCopy(st);
+    uint8_t op[1 + VARINT_MAX_BYTES];
+    size_t n = 0;
+    op[n++] = RS_OP_LITERAL;
+    n += varintPut(op + n, length);
+    bufferPut(&st->out, op, n);
+    bufferPut(&st->out, data, length);
+}
+
+static void emitCopy(RsDeltaState* st, uint64_t block) {
+    if(st->copyCount > 0 && st->copyStart + st->copyCount == block) {
+        st->copyCount++;
+        return;
+    }
+    flushCopy(st);
+    st->copyStart = block;
+    st->copyCount = 1;
+}
+
+/**
+ * Short last base block, copied when the target ends with it.
+ */
+static int matchTail(RsDeltaState* st, const uint8_t* data, size_t length) {
+    const RsSignature* sig = st->sig;
+    if(sig->baseSize % sig->blockSize == 0 || length != sig->baseSize % sig->blockSize) return 0;
+    size_t block = sig->blockCount - 1;
+    uint32_t s1;
+    uint32_t s2;
+    uint8_t strong[RS_STRONG_SIZE];
+    weakInit(data, length, &s1, &s2);
+    return readLE32(sig->entries + block * RS_ENTRY_SIZE) == weakValue(s1, s2) &&
+        strongHash(data, length, strong) == 0 &&
+        memcmp(strongOf(sig, block), strong, RS_STRONG_SIZE) == 0;
+}
+
+/**
+ * Delta Scan
+ * Emits ops for data. Unless final, stops where a whole block no
+ * longer fits and reports in consumed how far it got; the caller
+ * continues from there with the next view.
+ */
+static int deltaScan(
+    RsDeltaState* st,
+    const uint8_t* data,
+    size_t size,
+    int final,
+    size_t* consumed
+) {
+    size_t blockSize = st->sig->blockSize;
+    size_t pos = 0;
+    size_t literalStart = 0;
+    int rolling = 0;
+    int failed = 0;
+    uint32_t s1 = 0;
+    uint32_t s2 = 0;
+    if(st->index.count == 0 && size >= blockSize) pos = size - blockSize + 1;
+    while(!failed && st->index.count > 0 && size - pos >= blockSize) {
+        if(!rolling) {
+            weakInit(data + pos, blockSize, &s1, &s2);
+            rolling = 1;
+        }
+        int64_t block = findBlock(st, data + pos, weakValue(s1, s2), &failed);
+        if(block >= 0) {
+            emitLiteral(st, data + literalStart, pos - literalStart);
+            emitCopy(st, (uint64_t)block);
+            pos += blockSize;
+            literalStart = pos;
+            rolling = 0;
+            continue;
+        }
+        if(size - pos > blockSize) {
+            uint8_t out = data[pos];
+            s1 += data[pos + blockSize] - (uint32_t)out;
+            s2 += s1 - (uint32_t)blockSize * out;
+        }
+        pos++;
+    }
+    if(failed) return -1;
+
+    if(final) {
+        size_t tail = (size_t)(st->sig->baseSize % blockSize);
+        if(tail > 0 && size - literalStart >= tail && matchTail(st, data + size - tail, tail)) {
+            emitLiteral(st, data + literalStart, size - tail - literalStart);
+            emitCopy(st, st->sig->blockCount - 1);
+        } else {
+            emitLiteral(st, data + literalStart, size - literalStart);
+        }
+        pos = size;
+    } else {
+        emitLiteral(st, data + literalStart, pos - literalStart);
+    }
+
+    if(!EVP_DigestUpdate(st->targetHash, data, pos)) return -1;
+    st->targetSize += pos;
+    *consumed = pos;
+    return st->out.failed ? -1 : 0;
+}
+
+static int deltaBegin(RsDeltaState* st, const RsSignature* sig) {
+    memset(st, 0, sizeof(*st));
+    st->sig = sig;
+    uint8_t header[RS_DELTA_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    bufferPut(&st->out, header, sizeof(header));
+    st->targetHash = EVP_MD_CTX_new();
+    if(!st->targetHash || !EVP_DigestInit_ex(st->targetHash, EVP_sha256(), NULL)) return -1;
+    return buildIndex(&st->index, sig) == 0 && !st->out.failed ? 0 : -1;
+}
+
+/**
+ * Delta End
+ * Fills in the header and hands the buffer to the caller; on failure
+ * everything is released and NULL returned.
+ */
+static uint8_t* deltaEnd(RsDeltaState* st, int ok, size_t* deltaSize) {
+    uint8_t* delta = NULL;
+    *deltaSize = 0;
+    flushCopy(st);
+    if(ok && !st->out.failed &&
+        EVP_DigestFinal_ex(st->targetHash, st->out.data + 28, NULL)) {
+        writeRsHeader(st->out.data, RS_DELTA_MAGIC, st->sig->blockSize, st->sig->baseSize);
+        writeLE64(st->out.data + 20, st->targetSize);
+        delta = st->out.data;
+        *deltaSize = st->out.size;
+    } else {
+        free(st->out.data);
+    }
+    EVP_MD_CTX_free(st->targetHash);
+    freeIndex(&st->index);
+    return delta;
+}
+
+/**
+ * Delta
+ * Ops that turn the base described by sig into target.
+ */
+uint8_t* rsDelta(
+    const uint8_t* sig,
+    size_t sigSize,
+    const uint8_t* target,
+    size_t targetSize,
+    size_t* deltaSize
+) {
+    *deltaSize = 0;
+    RsSignature parsed;
+    if(parseSignature(sig, sigSize, &parsed) != 0) return NULL;
+
+    RsDeltaState st;
+    size_t consumed = 0;
+    int ok = deltaBegin(&st, &parsed) == 0 &&
+        deltaScan(&st, target, targetSize, 1, &consumed) == 0;
+    return deltaEnd(&st, ok, deltaSize);
+}
+
+/**
+ * Delta File
+ * Same over a file, through one FILE_MAP_WINDOW view at a time; each
+ * view starts where the previous scan stopped.
+ */
+uint8_t* rsDeltaFile(
+    const uint8_t* sig,
+    size_t sigSize,
+    const char* targetPath,
+    size_t* deltaSize
+) {
+    *deltaSize = 0;
+    RsSignature parsed;
+    if(parseSignature(sig, sigSize, &parsed) != 0) return NULL;
+    MappedFile* in = mfOpen(targetPath);
+    if(!in) {
+        printf("ERROR RSYNC: Cannot open target file: %s\n", targetPath);
+        return NULL;
+    }
+
+    RsDeltaState st;
+    int ok = deltaBegin(&st, &parsed) == 0;
+    uint64_t targetSize = mfSize(in);
+    uint64_t pos = 0;
+    do {
+        size_t length = targetSize - pos < FILE_MAP_WINDOW ? (size_t)(targetSize - pos) : FILE_MAP_WINDOW;
+        int final = pos + length == targetSize;
+        const uint8_t* view = ok ? mfView(in, pos, length) : NULL;
+        size_t consumed = 0;
+        ok = view && deltaScan(&st, view, length, final, &consumed) == 0;
+        pos += consumed;
+    } while(ok && pos < targetSize);
+    mfClose(in);
+    return deltaEnd(&st, ok, deltaSize);
+}
+
+/**
+ * Apply Ops
+ * Walks the ops of a delta whose header has been checked and feeds
+ * them to sink, with bounds checked against the base and the target
+ * size. Returns 0, or -1 on a malformed delta or a failing sink.
+ */
+static int applyOps(
+    const uint8_t* delta,
+    size_t deltaSize,
+    uint32_t blockSize,
+    uint64_t baseSize,
+    uint64_t targetSize,
+    RsSink sink,
+    void* ctx
+) {
+    uint64_t blockCount = (baseSize + blockSize - 1) / blockSize;
+    const uint8_t* ip = delta + RS_DELTA_HEADER_SIZE;
+    const uint8_t* end = delta + deltaSize;
+    uint64_t written = 0;
+    while(ip < end) {
+        uint8_t op = *ip++;
+        uint64_t a;
+        uint64_t b;
+        size_t n = varintGet(ip, end, &a);
+        if(n == 0) return -1;
+        ip += n;
+        if(op == RS_OP_LITERAL) {
+            if(a > (uint64_t)(end - ip) || a > targetSize - written) return -1;
+            if(sink(ctx, ip, 0, (size_t)a) != 0) return -1;
+            ip += a;
+            written += a;
+        } else if(op == RS_OP_COPY) {
+            n = varintGet(ip, end, &b);
+            if(n == 0 || a >= blockCount || b == 0 || b > blockCount - a) return -1;
+            ip += n;
+            uint64_t offset = a * blockSize;
+            uint64_t length = b * blockSize < baseSize - offset ? b * blockSize : baseSize - offset;
+            if(length > targetSize - written) return -1;
+            if(sink(ctx, NULL, offset, (size_t)length) != 0) return -1;
+            written += length;
+        } else {
+            return -1;
+        }
+    }
+    return written == targetSize ? 0 : -1;
+}
+
+static int readDeltaHeader(
+    const uint8_t* delta,
+    size_t deltaSize,
+    uint64_t baseSize,
+    uint32_t* blockSize,
+    uint64_t* targetSize
+) {
+    uint64_t expectedBase;
+    if(deltaSize < RS_DELTA_HEADER_SIZE ||
+        readRsHeader(delta, deltaSize, RS_DELTA_MAGIC, blockSize, &expectedBase) != 0) {
+        printf("ERROR RSYNC: Invalid delta header\n");
+        return -1;
+    }
+    if(expectedBase != baseSize) {
+        printf("ERROR RSYNC: Delta expects a %llu byte base, got %llu\n",
+               (unsigned long long)expectedBase, (unsigned long long)baseSize);
+        return -1;
+    }
+    *targetSize = readLE64(delta + 20);
+    return 0;
+}
+
+typedef struct {
+    const uint8_t* base;
+    uint8_t* op;
+} RsMemorySink;
+
+static int memorySink(
+    void* ctx,
+    const uint8_t* literal,
+    uint64_t baseOffset,
+    size_t length
+) {
+    RsMemorySink* sink = (RsMemorySink*)ctx;
+    memcpy(sink->op, literal ? literal : sink->base + baseOffset, length);
+    sink->op += length;
+    return 0;
+}
+
+/**
+ * Patch
+ * Rebuilds the target from base and delta. NULL when the delta is
+ * malformed, made for another base, or the result does not hash to
+ * the target SHA-256.
+ */
+uint8_t* rsPatch(
+    const uint8_t* base,
+    size_t baseSize,
+    const uint8_t* delta,
+    size_t deltaSize,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint32_t blockSize;
+    uint64_t targetSize;
+    if(readDeltaHeader(delta, deltaSize, baseSize, &blockSize, &targetSize) != 0) return NULL;
+    if(targetSize > SIZE_MAX - 1) return NULL;
+
+    uint8_t* output = malloc(targetSize ? (size_t)targetSize : 1);
+    if(!output) return NULL;
+    RsMemorySink sink;
+    sink.base = base;
+    sink.op = output;
+    uint8_t digest[RS_TARGET_HASH_SIZE];
+    if(applyOps(delta, deltaSize, blockSize, baseSize, targetSize, memorySink, &sink) != 0) {
+        printf("ERROR RSYNC: Malformed delta\n");
+        free(output);
+        return NULL;
+    }
+    if(!EVP_Digest(output, (size_t)targetSize, digest, NULL, EVP_sha256(), NULL) ||
+        memcmp(digest, delta + 28, RS_TARGET_HASH_SIZE) != 0) {
+        printf("ERROR RSYNC: Patched output does not match the target hash\n");
+        free(output);
+        return NULL;
+    }
+    *outputSize = (size_t)targetSize;
+    return output;
+}
+
+typedef struct {
+    MappedFile* base;
+    FileWriter* out;
+    EVP_MD_CTX* hash;
+    int failed;
+} RsFileSink;
+
+static int fileSink(
+    void* ctx,
+    const uint8_t* literal,
+    uint64_t baseOffset,
+    size_t length
+) {
+    RsFileSink* sink = (RsFileSink*)ctx;
+    if(literal) {
+        sink->failed = !EVP_DigestUpdate(sink->hash, literal, length) || fwWrite(sink->out, literal, length) != 0;
+        return sink->failed ? -1 : 0;
+    }
+    while(length > 0 && !sink->failed) {
+        size_t piece = length < FILE_MAP_WINDOW ? length : FILE_MAP_WINDOW;
+        const uint8_t* view = mfView(sink->base, baseOffset, piece);
+        sink->failed = !view || !EVP_DigestUpdate(sink->hash, view, piece) || fwWrite(sink->out, view, piece) != 0;
+        baseOffset += piece;
+        length -= piece;
+    }
+    return sink->failed ? -1 : 0;
+}
+
+/**
+ * Patch File
+ * Same with base and output as files, the base mapped one copy
+ * piece at a time. Returns 0, -1 on I/O errors, -2 on a malformed or
+ * mismatched delta, -3 when the output fails the target hash; the
+ * output file is left incomplete on failure.
+ */
+int rsPatchFile(
+    const char* basePath,
+    const uint8_t* delta,
+    size_t deltaSize,
+    const char* outputPath
+) {
+    RsFileSink sink;
+    sink.failed = 0;
+    sink.base = mfOpen(basePath);
+    if(!sink.base) {
+        printf("ERROR RSYNC: Cannot open base file: %s\n", basePath);
+        return -1;
+    }
+    uint32_t blockSize;
+    uint64_t targetSize;
+    if(readDeltaHeader(delta, deltaSize, mfSize(sink.base), &blockSize, &targetSize) != 0) {
+        mfClose(sink.base);
+        return -2;
+    }
+    sink.out = fwOpen(outputPath);
+    sink.hash = EVP_MD_CTX_new();
+    if(!sink.out || !sink.hash || !EVP_DigestInit_ex(sink.hash, EVP_sha256(), NULL)) {
+        printf("ERROR RSYNC: Cannot open output file: %s\n", outputPath);
+        if(sink.out) fwClose(sink.out);
+        EVP_MD_CTX_free(sink.hash);
+        mfClose(sink.base);
+        return -1;
+    }
+
+    int result = 0;
+    if(applyOps(delta, deltaSize, blockSize, mfSize(sink.base), targetSize, fileSink, &sink) != 0) {
+        if(!sink.failed) printf("ERROR RSYNC: Malformed delta\n");
+        result = sink.failed ? -1 : -2;
+    }
+    uint8_t digest[RS_TARGET_HASH_SIZE];
+    if(result == 0 && (!EVP_DigestFinal_ex(sink.hash, digest, NULL) ||
+        memcmp(digest, delta + 28, RS_TARGET_HASH_SIZE) != 0)) {
+        printf("ERROR RSYNC: Patched output does not match the target hash\n");
+        result = -3;
+    }
+    if(fwClose(sink.out) != 0 && result == 0) result = -1;
+    EVP_MD_CTX_free(sink.hash);
+    mfClose(sink.base);
+    return result;
+}
\ No newline at end of file
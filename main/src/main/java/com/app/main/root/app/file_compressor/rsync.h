@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define RS_SIGNATURE_MAGIC 0x47495343
+#define RS_DELTA_MAGIC 0x544C4443
+#define RS_VERSION 1
+#define RS_SIGNATURE_HEADER_SIZE 20
+#define RS_DELTA_HEADER_SIZE (28 + RS_TARGET_HASH_SIZE)
+#define RS_STRONG_SIZE 16
+#define RS_TARGET_HASH_SIZE 32
+#define RS_BLOCK_MIN 1024
+#define RS_BLOCK_MAX (128 * 1024)
+#define RS_OP_LITERAL 0x01
+#define RS_OP_COPY 0x02
+
+/**
+ * rsync-style delta transfer between file versions.
+ * The side holding the old version (base) sends a signature: per
+ * block, an Adler-style rolling checksum and the first RS_STRONG_SIZE
+ * bytes of its SHA-256. The side holding the new version (target)
+ * slides a window over it, rolling the weak checksum one byte at a
+ * time, and turns every block it finds into a copy; what is left
+ * travels as literals. Applying the delta to the base rebuilds the
+ * target, which is checked against the SHA-256 the delta carries, so a
+ * wrong base or a strong-hash collision fails instead of silently
+ * producing a different file.
+ *
+ * Signature: magic, version, three zero bytes, u32 blockSize,
+ * u64 baseSize, then per block u32 weak and the strong hash; the last
+ * block may be short. Delta: the same first 20 bytes with its own
+ * magic, u64 targetSize, target SHA-256, then ops: RS_OP_LITERAL
+ * varint length and bytes, RS_OP_COPY varint first block and varint
+ * block count. All integers little endian.
+ */
+uint32_t rsBlockSize(uint64_t baseSize);
+uint8_t* rsSignature(
+    const uint8_t* base,
+    size_t baseSize,
+    uint32_t blockSize,
+    size_t* sigSize
+);
+uint8_t* rsSignatureFile(
+    const char* basePath,
+    uint32_t blockSize,
+    size_t* sigSize
+);
+uint8_t* rsDelta(
+    const uint8_t* sig,
+    size_t sigSize,
+    const uint8_t* target,
+    size_t targetSize,
+    size_t* deltaSize
+);
+uint8_t* rsDeltaFile(
+    const uint8_t* sig,
+    size_t sigSize,
+    const char* targetPath,
+    size_t* deltaSize
+);
+uint8_t* rsPatch(
+    const uint8_t* base,
+    size_t baseSize,
+    const uint8_t* delta,
+    size_t deltaSize,
+    size_t* outputSize
+);
+int rsPatchFile(
+    const char* basePath,
+    const uint8_t* delta,
+    size_t deltaSize,
+    const char* outputPath
+);
\ No newline at end of file
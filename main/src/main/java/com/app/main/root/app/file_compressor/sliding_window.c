@@ -1,41 +1,66 @@
 #include "sliding_window.h"
+#include "lz_parse.h"
+#include "varint.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
-Match findLongestMatch(
-    const uint8_t* window,
-    int windowPos,
-    const uint8_t* lookahead,
-    int lookaheadLen
-) {
-    Match best = { 0, 0, lookahead[0] };
-    int maxOffset = 
-        windowPos < WINDOW_SIZE ? 
-        windowPos : WINDOW_SIZE;
-    
-    for(int offset = 1; offset <= maxOffset; offset++) {
-        int matchLen = 0;
-        while(
-            matchLen < lookaheadLen &&
-            matchLen < LOOKAHEAD_SIZE &&
-            window[windowPos - offset + matchLen] == lookahead[matchLen]
-        ) {
-            matchLen++;
-        }
-        if(matchLen > best.length) {
-            best.offset = offset;
-            best.length = matchLen;
-            if(matchLen < lookaheadLen) {
-                best.next = lookahead[matchLen];
-            } else {
-                best.next = 0;
-            }
-        }
+typedef struct {
+    uint8_t* buffer;
+    size_t size;
+    size_t capacity;
+} SwOutput;
+
+static int swReserve(SwOutput* out, size_t extra) {
+    if(out->size + extra <= out->capacity) return 1;
+
+    size_t capacity = out->capacity * 2;
+    if(capacity < out->size + extra) capacity = out->size + extra;
+    uint8_t* buffer = realloc(out->buffer, capacity);
+    if(!buffer) return 0;
+
+    out->buffer = buffer;
+    out->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Emit Token
+ * 0xFE marks a match token, so a literal 0xFE is written as a
+ * zero-length match carrying it in next. next == 0 means no
+ * trailing literal, which the decoder skips.
+ */
+static int swEmitToken(SwOutput* out, Match match) {
+    if(!swReserve(out, 5)) return 0;
+    out->buffer[out->size++] = 0xFE;
+    out->buffer[out->size++] = (match.offset >> 8) & 0xFF;
+    out->buffer[out->size++] = match.offset & 0xFF;
+    out->buffer[out->size++] = (uint8_t)match.length;
+    out->buffer[out->size++] = match.next;
+    return 1;
+}
+
+static int swEmitLiteral(SwOutput* out, uint8_t literal) {
+    if(literal == 0xFE) {
+        Match escape = { 0, 0, literal };
+        return swEmitToken(out, escape);
     }
+    if(!swReserve(out, 1)) return 0;
+    out->buffer[out->size++] = literal;
+    return 1;
+}
+
+static uint32_t swLiteralCost(void* ctx, uint8_t literal) {
+    (void)ctx;
+    return literal == 0xFE ? 40 : 8;
+}
 
-    return best;
+static uint32_t swMatchCost(void* ctx, size_t length, size_t offset) {
+    (void)ctx;
+    (void)length;
+    (void)offset;
+    return 40;
 }
 
 /**
@@ -44,55 +69,160 @@ Match findLongestMatch(
 uint8_t* swCompress(
     const uint8_t* data,
     size_t size,
-    size_t* outputSize
+    size_t* outputSize,
+    int level
 ) {
     if(size == 0) {
         *outputSize = 0;
         return NULL;
     }
 
-    uint8_t* outputBuffer = malloc(size * 2);
-    size_t outIdx = 0;
+    LzParams params;
+    params.windowSize = WINDOW_SIZE;
+    params.minMatch = SW_MIN_MATCH;
+    params.maxMatch = LOOKAHEAD_SIZE;
+    params.level = level;
+    params.cost.literalCost = swLiteralCost;
+    params.cost.matchCost = swMatchCost;
+    params.cost.ctx = NULL;
+
+    size_t seqCount = 0;
+    LzSeq* seqs = lzParse(data, size, &params, &seqCount);
+    SwOutput out = { malloc(size / 2 + 16), 0, size / 2 + 16 };
+    if(!seqs || !out.buffer) {
+        free(seqs);
+        free(out.buffer);
+        *outputSize = 0;
+        return NULL;
+    }
+    out.buffer[out.size++] = SW_MAGIC0;
+    out.buffer[out.size++] = SW_MAGIC1;
+    out.buffer[out.size++] = SW_MAGIC2;
+    out.size += varintPut(out.buffer + out.size, size);
+
+    int ok = 1;
+    size_t pos = 0;
+    size_t skip = 0;
+    for(size_t s = 0; s < seqCount && ok; s++) {
+        for(size_t j = skip; j < seqs[s].litLen && ok; j++) {
+            ok = swEmitLiteral(&out, data[pos + j]);
+        }
+        pos += seqs[s].litLen;
+        skip = 0;
+        if(seqs[s].matchLen == 0) continue;
+
+        Match match = { (uint16_t)seqs[s].offset, (uint16_t)seqs[s].matchLen, 0 };
+        pos += seqs[s].matchLen;
+        if(s + 1 < seqCount && seqs[s + 1].litLen > 0 && data[pos] != 0) {
+            match.next = data[pos];
+            skip = 1;
+        }
+        if(ok) ok = swEmitToken(&out, match);
+    }
+    free(seqs);
 
-    uint8_t window[WINDOW_SIZE] = {0};
-    int windowPos = 0;
+    if(!ok) {
+        free(out.buffer);
+        *outputSize = 0;
+        return NULL;
+    }
+
+    *outputSize = out.size;
+    return out.buffer;
+}
+
+static int hasHeader(const uint8_t* data, size_t size) {
+    return size >= 3 && data[0] == SW_MAGIC0 && data[1] == SW_MAGIC1 && data[2] == SW_MAGIC2;
+}
+
+/**
+ * Decoded Size
+ * Read from the header, or counted from the tokens of a legacy
+ * stream. Returns 0, or -1 when the stream is truncated.
+ */
+int swDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+) {
+    if(hasHeader(data, size)) {
+        return varintGet(data + 3, data + size, decodedSize) ? 0 : -1;
+    }
 
+    uint64_t total = 0;
     size_t i = 0;
     while(i < size) {
-        int lookaheadLen = size - i;
-        if(lookaheadLen > LOOKAHEAD_SIZE) {
-            lookaheadLen = LOOKAHEAD_SIZE;
+        if(data[i] == 0xFE) {
+            if(size - i < 5) return -1;
+            total += data[i + 3] + (data[i + 4] != 0);
+            i += 5;
+        } else {
+            total++;
+            i++;
         }
+    }
+    *decodedSize = total;
+    return 0;
+}
 
-        Match match = findLongestMatch(
-            window,
-            windowPos,
-            data + i,
-            lookaheadLen
-        );
-        if(match.length > 2) {
-            outputBuffer[outIdx++] = 0xFE;
-            outputBuffer[outIdx++] = (match.offset >> 8) & 0xFF;
-            outputBuffer[outIdx++] = match.offset & 0xFF;
-            outputBuffer[outIdx++] = match.length;
-            outputBuffer[outIdx++] = match.next;
-
-            for(int j = 0; j < match.length + 1; j++) {
-                window[windowPos] = data[i + j];
-                windowPos = (windowPos + 1) % WINDOW_SIZE;
+/**
+ * Decompress Into
+ * Matches copy straight from the output, so no separate window is
+ * kept. Fails when the decoded size exceeds capacity or a match
+ * reaches before the start of the output.
+ */
+int swDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize = 0;
+    if(swDecodedSize(data, size, &decodedSize) != 0 || decodedSize > capacity) return -1;
+
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+    if(hasHeader(data, size)) ip += 3 + varintSize(decodedSize);
+
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + decodedSize;
+    while(ip < end) {
+        if(*ip != 0xFE) {
+            if(op == opEnd) goto corrupt;
+            *op++ = *ip++;
+            continue;
+        }
+        if(end - ip < 5) goto corrupt;
+        size_t offset = (size_t)ip[1] << 8 | ip[2];
+        size_t length = ip[3];
+        uint8_t next = ip[4];
+        ip += 5;
+
+        if(length) {
+            if(offset == 0 || offset > (size_t)(op - dst) || length > (size_t)(opEnd - op)) goto corrupt;
+            const uint8_t* match = op - offset;
+            if(offset >= length) {
+                memcpy(op, match, length);
+                op += length;
+            } else {
+                for(size_t j = 0; j < length; j++) *op++ = match[j];
             }
-
-            i += match.length + 1;
-        } else {
-            outputBuffer[outIdx++] = data[i];
-            window[windowPos] = data[i];
-            windowPos = (windowPos + 1) % WINDOW_SIZE;
-            i++;
+        }
+        if(next) {
+            if(op == opEnd) goto corrupt;
+            *op++ = next;
         }
     }
+    if(op != opEnd) goto corrupt;
+
+    *outputSize = (size_t)decodedSize;
+    return 0;
 
-    *outputSize = outIdx;
-    return outputBuffer;
+corrupt:
+    printf("ERROR SW: Corrupt stream at input offset %zu\n", (size_t)(ip - data));
+    return -1;
 }
 
 /**
@@ -103,47 +233,15 @@ uint8_t* swDecompress(
     size_t size,
     size_t* outputSize
 ) {
-    uint8_t* outputBuffer = malloc(size * 10);
-    size_t outIdx = 0;
-
-    uint8_t window[WINDOW_SIZE] = {0};
-    int windowPos = 0;
-
-    size_t i = 0;
-    while(i < size) {
-        if(data[i] == 0xFE && i + 4 < size) {
-            uint16_t offset = (data[i+1] << 8) | data[i+2];
-            uint8_t length = data[i+3];
-            uint8_t nextChair = data[i+4];
-
-            for(int j = 0; j < length; j++) {
-                int srcPos = (windowPos - offset + j) % WINDOW_SIZE;
-                if(srcPos < 0) srcPos += WINDOW_SIZE;
-
-                outputBuffer[outIdx] = window[srcPos];
-                window[windowPos] = outputBuffer[outIdx];
-                windowPos = (windowPos + 1) % WINDOW_SIZE;
-                outIdx++;
-            }
-
-            if(nextChair != 0) {
-                outputBuffer[outIdx] = nextChair;
-                window[windowPos] = nextChair;
-                window[windowPos] = nextChair;
-                windowPos = (windowPos + 1) % WINDOW_SIZE;
-                outIdx++;
-            }
-
-            i += 5;
-        } else {
-            outputBuffer[outIdx] = data[i];
-            window[windowPos] = data[i];
-            windowPos = (windowPos + 1) % WINDOW_SIZE;
-            outIdx++;
-            i++;
-        }
+    *outputSize = 0;
+    uint64_t decodedSize = 0;
+    if(swDecodedSize(data, size, &decodedSize) != 0 || decodedSize > SIZE_MAX) return NULL;
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(swDecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
     }
-
-    *outputSize = outIdx;
-    return outputBuffer;
+    return output;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 
 #define WINDOW_SIZE 4096
 #define LOOKAHEAD_SIZE 18
+#define SW_MIN_MATCH 5
+#define SW_MAGIC0 0xFE
+#define SW_MAGIC1 0xFF
+#define SW_MAGIC2 0xFF
 
 typedef struct {
     uint16_t offset;
@@ -11,20 +15,35 @@ typedef struct {
     uint8_t next;
 } Match;
 
-
-Match findLongestMatch(
-    const uint8_t* window, 
-    int windowPos,
-    const uint8_t* lookahead, 
-    int lookaheadLen
-);
+/**
+ * LZSS over a WINDOW_SIZE window.
+ *
+ * Header: bytes FE FF FF, varint decoded size. Legacy streams have
+ * no header; no token has offset FFFF, so they are still decoded.
+ * Tokens: a literal byte, or FE, u16 offset (big endian), u8 length,
+ * next literal (0 = none). A literal FE is a zero-length match
+ * carrying it in next.
+ */
 uint8_t* swCompress(
     const uint8_t* data, 
     size_t size, 
-    size_t* outputSize
+    size_t* outputSize,
+    int level
 );
 uint8_t* swDecompress(
     const uint8_t* data, 
     size_t size, 
     size_t* outputSize
+);
+int swDecodedSize(
+    const uint8_t* data,
+    size_t size,
+    uint64_t* decodedSize
+);
+int swDecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
 );
\ No newline at end of file
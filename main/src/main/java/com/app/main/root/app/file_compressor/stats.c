@@ -0,0 +1,97 @@
+#include "stats.h"
+
+// Platform-specific includes and types
+#ifdef _WIN32
+    #include <windows.h>
+    typedef volatile LONG64 counter_t;
+    #define COUNTER_ADD(c, v) InterlockedExchangeAdd64(&(c), (LONG64)(v))
+    #define COUNTER_LOAD(c) ((uint64_t)InterlockedCompareExchange64(&(c), 0, 0))
+#else
+    #include <time.h>
+    typedef uint64_t counter_t;
+    #define COUNTER_ADD(c, v) __atomic_fetch_add(&(c), (uint64_t)(v), __ATOMIC_RELAXED)
+    #define COUNTER_LOAD(c) __atomic_load_n(&(c), __ATOMIC_RELAXED)
+#endif
+
+/**
+ * Codec Counters
+ * Padded to a cache line so codecs running on different threads do
+ * not contend on the same line.
+ */
+typedef struct {
+    counter_t calls;
+    counter_t bytesIn;
+    counter_t bytesOut;
+    counter_t nanos;
+    counter_t fallbacks;
+    counter_t pad[3];
+} CodecCounters;
+
+static CodecCounters codecCounters[STATS_CODEC_COUNT];
+static counter_t skipCounters[SKIP_REASON_COUNT];
+
+uint64_t statsNow(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if(frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(now.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void statsRecord(
+    CompressionType type,
+    size_t bytesIn,
+    size_t bytesOut,
+    uint64_t startNanos
+) {
+    if((unsigned)type >= STATS_CODEC_COUNT) return;
+    CodecCounters* counters = &codecCounters[type];
+    COUNTER_ADD(counters->calls, 1);
+    COUNTER_ADD(counters->bytesIn, bytesIn);
+    COUNTER_ADD(counters->bytesOut, bytesOut);
+    COUNTER_ADD(counters->nanos, statsNow() - startNanos);
+}
+
+void statsFallback(CompressionType type) {
+    if((unsigned)type >= STATS_CODEC_COUNT) return;
+    COUNTER_ADD(codecCounters[type].fallbacks, 1);
+}
+
+void statsSkip(SkipReason reason) {
+    if((unsigned)reason >= SKIP_REASON_COUNT) return;
+    COUNTER_ADD(skipCounters[reason], 1);
+}
+
+/**
+ * Snapshot
+ * Copies the counters into dst in the STATS_SNAPSHOT_SIZE layout.
+ * Each value is read atomically, but the snapshot as a whole is not
+ * taken at a single instant. Returns the number of values written,
+ * 0 when capacity is too small.
+ */
+size_t statsSnapshot(uint64_t* dst, size_t capacity) {
+    if(capacity < STATS_SNAPSHOT_SIZE) return 0;
+    uint64_t* op = dst;
+    *op++ = STATS_VERSION;
+    *op++ = STATS_CODEC_COUNT;
+    *op++ = SKIP_REASON_COUNT;
+    for(int c = 0; c < STATS_CODEC_COUNT; c++) {
+        CodecCounters* counters = &codecCounters[c];
+        *op++ = COUNTER_LOAD(counters->calls);
+        *op++ = COUNTER_LOAD(counters->bytesIn);
+        *op++ = COUNTER_LOAD(counters->bytesOut);
+        *op++ = COUNTER_LOAD(counters->nanos);
+        *op++ = COUNTER_LOAD(counters->fallbacks);
+    }
+    for(int r = 0; r < SKIP_REASON_COUNT; r++) {
+        *op++ = COUNTER_LOAD(skipCounters[r]);
+    }
+    return (size_t)(op - dst);
+}
\ No newline at end of file
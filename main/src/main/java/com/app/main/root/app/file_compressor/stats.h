@@ -0,0 +1,47 @@
+#pragma once
+#include "comp.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATS_VERSION 1
+#define STATS_CODEC_COUNT 16
+#define STATS_CODEC_FIELDS 5
+
+/**
+ * Skip Reason
+ * Why an input was stored without running a codec on it.
+ */
+typedef enum {
+    SKIP_TOO_SMALL = 0,
+    SKIP_MEDIA = 1,
+    SKIP_BINARY = 2,
+    SKIP_TRIAL = 3,
+    SKIP_PROBE = 4,
+    SKIP_REASON_COUNT
+} SkipReason;
+
+/**
+ * Snapshot layout, all u64:
+ * [version, codec count, reason count]
+ * per CompressionType: [calls, bytes in, bytes out, nanoseconds, fallbacks]
+ * per SkipReason: [count]
+ */
+#define STATS_SNAPSHOT_SIZE (3 + STATS_CODEC_COUNT * STATS_CODEC_FIELDS + SKIP_REASON_COUNT)
+
+/**
+ * Per-codec counters, updated with relaxed atomic adds so encoder
+ * threads never serialise on them. Calls and times cover every run
+ * of the encoder, including trial compressions; COMP_FILTER includes
+ * the inner codec it wraps. A fallback is a codec run whose output
+ * was dropped for COMP_NONE because it did not shrink the input.
+ */
+uint64_t statsNow(void);
+void statsRecord(
+    CompressionType type,
+    size_t bytesIn,
+    size_t bytesOut,
+    uint64_t startNanos
+);
+void statsFallback(CompressionType type);
+void statsSkip(SkipReason reason);
+size_t statsSnapshot(uint64_t* dst, size_t capacity);
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "sw2.h"
+#include "lz_parse.h"
+#include "varint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static uint32_t sw2LiteralCost(void* ctx, uint8_t literal) {
+    (void)ctx;
+    (void)literal;
+    return 8;
+}
+
+static uint32_t sw2MatchCost(void* ctx, size_t length, size_t offset) {
+    (void)ctx;
+    uint32_t bits = 8 + 8 * (uint32_t)varintSize(offset);
+    if(length - SW2_MIN_MATCH >= 15) {
+        bits += 8 * (uint32_t)varintSize(length - SW2_MIN_MATCH - 15);
+    }
+    return bits;
+}
+
+static size_t sequenceSize(const LzSeq* seq, int last) {
+    size_t n = 1 + seq->litLen;
+    if(seq->litLen >= 15) n += varintSize(seq->litLen - 15);
+    if(!last || seq->matchLen) {
+        n += varintSize(seq->offset);
+        if(seq->matchLen - SW2_MIN_MATCH >= 15) {
+            n += varintSize(seq->matchLen - SW2_MIN_MATCH - 15);
+        }
+    }
+    return n;
+}
+
+/**
+ * Compress
+ */
+uint8_t* sw2Compress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level,
+    int windowLog
+) {
+    *outputSize = 0;
+    if(size == 0) return NULL;
+    if(windowLog < SW2_MIN_WINDOW_LOG) windowLog = SW2_MIN_WINDOW_LOG;
+    if(windowLog > SW2_MAX_WINDOW_LOG) windowLog = SW2_MAX_WINDOW_LOG;
+
+    LzParams params;
+    params.windowSize = (size_t)1 << windowLog;
+    params.minMatch = SW2_MIN_MATCH;
+    params.maxMatch = SW2_MAX_MATCH;
+    params.level = level;
+    params.cost.literalCost = sw2LiteralCost;
+    params.cost.matchCost = sw2MatchCost;
+    params.cost.ctx = NULL;
+
+    size_t seqCount = 0;
+    LzSeq* seqs = lzParse(data, size, &params, &seqCount);
+    if(!seqs) return NULL;
+
+    size_t total = 1 + varintSize(size);
+    for(size_t s = 0; s < seqCount; s++) {
+        total += sequenceSize(&seqs[s], s + 1 == seqCount);
+    }
+
+    uint8_t* output = malloc(total);
+    if(!output) {
+        free(seqs);
+        return NULL;
+    }
+
+    uint8_t* op = output;
+    *op++ = (uint8_t)windowLog;
+    op += varintPut(op, size);
+
+    const uint8_t* ip = data;
+    for(size_t s = 0; s < seqCount; s++) {
+        const LzSeq* seq = &seqs[s];
+        int hasMatch = seq->matchLen != 0;
+        uint32_t litCode = seq->litLen < 15 ? seq->litLen : 15;
+        uint32_t matchCode = 0;
+        if(hasMatch) {
+            uint32_t extra = seq->matchLen - SW2_MIN_MATCH;
+            matchCode = extra < 15 ? extra : 15;
+        }
+
+        *op++ = (uint8_t)((litCode << 4) | matchCode);
+        if(litCode == 15) op += varintPut(op, seq->litLen - 15);
+        memcpy(op, ip, seq->litLen);
+        op += seq->litLen;
+        ip += seq->litLen;
+
+        if(hasMatch) {
+            op += varintPut(op, seq->offset);
+            if(matchCode == 15) {
+                op += varintPut(op, seq->matchLen - SW2_MIN_MATCH - 15);
+            }
+            ip += seq->matchLen;
+        }
+    }
+    free(seqs);
+
+    *outputSize = (size_t)(op - output);
+    return output;
+}
+
+/**
+ * Decompress
+ * Every length and offset is checked against the decoded size from
+ * the header, so corrupt input returns -1 instead of overrunning.
+ * dst must hold at least the decoded size.
+ */
+int sw2DecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    if(size < 2) return -1;
+
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+    int windowLog = *ip++;
+    if(windowLog < SW2_MIN_WINDOW_LOG || windowLog > SW2_MAX_WINDOW_LOG) return -1;
+
+    uint64_t decodedSize = 0;
+    size_t n = varintGet(ip, end, &decodedSize);
+    if(!n || decodedSize > SIZE_MAX) return -1;
+    ip += n;
+
+    if(decodedSize > capacity) return -1;
+
+    uint8_t* output = dst;
+
+    uint8_t* op = output;
+    uint8_t* opEnd = output + decodedSize;
+    while(op < opEnd) {
+        if(ip >= end) goto corrupt;
+        uint8_t token = *ip++;
+
+        uint64_t litLen = token >> 4;
+        if(litLen == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) goto corrupt;
+            ip += n;
+            litLen += extra;
+        }
+        if(litLen > (uint64_t)(end - ip) || litLen > (uint64_t)(opEnd - op)) goto corrupt;
+        memcpy(op, ip, (size_t)litLen);
+        op += litLen;
+        ip += litLen;
+        if(op == opEnd) break;
+
+        uint64_t offset;
+        if(!(n = varintGet(ip, end, &offset))) goto corrupt;
+        ip += n;
+
+        uint64_t matchLen = (token & 0x0F) + SW2_MIN_MATCH;
+        if((token & 0x0F) == 15) {
+            uint64_t extra;
+            if(!(n = varintGet(ip, end, &extra))) goto corrupt;
+            ip += n;
+            matchLen += extra;
+        }
+        if(offset == 0 || offset > (uint64_t)(op - output)) goto corrupt;
+        if(matchLen > (uint64_t)(opEnd - op)) goto corrupt;
+
+        const uint8_t* src = op - offset;
+        if(offset >= matchLen) {
+            memcpy(op, src, (size_t)matchLen);
+            op += matchLen;
+        } else {
+            for(uint64_t j = 0; j < matchLen; j++) *op++ = *src++;
+        }
+    }
+
+    *outputSize = (size_t)decodedSize;
+    return 0;
+
+corrupt:
+    printf("ERROR SW2: Corrupt stream at input offset %zu\n", (size_t)(ip - data));
+    return -1;
+}
+
+/**
+ * Decompress
+ */
+uint8_t* sw2Decompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+) {
+    *outputSize = 0;
+    uint64_t decodedSize;
+    if(size < 2 || !varintGet(data + 1, data + size, &decodedSize) || decodedSize > SIZE_MAX) return NULL;
+
+    uint8_t* output = malloc(decodedSize ? (size_t)decodedSize : 1);
+    if(!output) return NULL;
+    if(sw2DecompressInto(data, size, output, (size_t)decodedSize, outputSize) != 0) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define SW2_MIN_WINDOW_LOG 16
+#define SW2_MAX_WINDOW_LOG 23
+#define SW2_MIN_MATCH 4
+#define SW2_MAX_MATCH (1 << 16)
+
+/**
+ * Wide-window LZ, format v2.
+ *
+ * Header: windowLog byte, varint decoded size.
+ * Sequence: token byte (literal run in the high nibble, match
+ * length - SW2_MIN_MATCH in the low nibble, 15 = varint follows),
+ * literal extension, literals, then unless the output is complete:
+ * varint offset, match length extension.
+ */
+uint8_t* sw2Compress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize,
+    int level,
+    int windowLog
+);
+uint8_t* sw2Decompress(
+    const uint8_t* data,
+    size_t size,
+    size_t* outputSize
+);
+int sw2DecompressInto(
+    const uint8_t* data,
+    size_t size,
+    uint8_t* dst,
+    size_t capacity,
+    size_t* outputSize
+);
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include "thread_pool.h"
+#include "debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Platform-specific includes and types
+#ifdef _WIN32
+    #include <windows.h>
+    typedef CRITICAL_SECTION mutex_t;
+    typedef CONDITION_VARIABLE cond_t;
+    typedef HANDLE thread_t;
+    #define MUTEX_INIT(m) InitializeCriticalSection(&(m))
+    #define MUTEX_LOCK(m) EnterCriticalSection(&(m))
+    #define MUTEX_UNLOCK(m) LeaveCriticalSection(&(m))
+    #define MUTEX_DESTROY(m) DeleteCriticalSection(&(m))
+    #define COND_INIT(c) InitializeConditionVariable(&(c))
+    #define COND_WAIT(c, m) SleepConditionVariableCS(&(c), &(m), INFINITE)
+    #define COND_BROADCAST(c) WakeAllConditionVariable(&(c))
+    #define COND_DESTROY(c) ((void)0)
+    #define THREAD_RETURN DWORD WINAPI
+    #define FLAG_SET(f) InterlockedExchange((f), 1)
+    #define FLAG_LOAD(f) InterlockedCompareExchange((f), 0, 0)
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    typedef pthread_mutex_t mutex_t;
+    typedef pthread_cond_t cond_t;
+    typedef pthread_t thread_t;
+    #define MUTEX_INIT(m) pthread_mutex_init(&(m), NULL)
+    #define MUTEX_LOCK(m) pthread_mutex_lock(&(m))
+    #define MUTEX_UNLOCK(m) pthread_mutex_unlock(&(m))
+    #define MUTEX_DESTROY(m) pthread_mutex_destroy(&(m))
+    #define COND_INIT(c) pthread_cond_init(&(c), NULL)
+    #define COND_WAIT(c, m) pthread_cond_wait(&(c), &(m))
+    #define COND_BROADCAST(c) pthread_cond_broadcast(&(c))
+    #define COND_DESTROY(c) pthread_cond_destroy(&(c))
+    #define THREAD_RETURN void*
+    #define FLAG_SET(f) __atomic_store_n((f), 1, __ATOMIC_RELAXED)
+    #define FLAG_LOAD(f) __atomic_load_n((f), __ATOMIC_RELAXED)
+#endif
+
+typedef struct TpJob {
+    TpTask task;
+    void* arg;
+    size_t count;
+    size_t next;
+    size_t done;
+    cond_t finished;
+    struct TpJob* nextJob;
+} TpJob;
+
+struct ThreadPool {
+    mutex_t mutex;
+    cond_t wake;
+    TpJob* head;
+    int stop;
+    int threadCount;
+    thread_t* threads;
+};
+
+static ThreadPool* sharedPool = NULL;
+
+int tpCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/**
+ * Take Task
+ * Claims the next index of job; the job leaves the queue once its
+ * last index is claimed. Called with the pool mutex held.
+ */
+static size_t takeTask(ThreadPool* pool, TpJob* job) {
+    size_t index = job->next++;
+    if(job->next == job->count) {
+        TpJob** link = &pool->head;
+        while(*link && *link != job) link = &(*link)->nextJob;
+        if(*link) *link = job->nextJob;
+    }
+    return index;
+}
+
+static void finishTask(TpJob* job) {
+    job->done++;
+    if(job->done == job->count) COND_BROADCAST(job->finished);
+}
+
+static THREAD_RETURN workerMain(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    MUTEX_LOCK(pool->mutex);
+    for(;;) {
+        while(!pool->stop && !pool->head) COND_WAIT(pool->wake, pool->mutex);
+        if(pool->stop) break;
+
+        TpJob* job = pool->head;
+        size_t index = takeTask(pool, job);
+        MUTEX_UNLOCK(pool->mutex);
+        job->task(job->arg, index);
+        MUTEX_LOCK(pool->mutex);
+        finishTask(job);
+    }
+    MUTEX_UNLOCK(pool->mutex);
+    return 0;
+}
+
+/**
+ * Create
+ * threads may be 0, in which case tpRun runs everything inline.
+ */
+ThreadPool* tpCreate(int threads) {
+    ThreadPool* pool = malloc(sizeof(ThreadPool));
+    if(!pool) return NULL;
+
+    MUTEX_INIT(pool->mutex);
+    COND_INIT(pool->wake);
+    pool->head = NULL;
+    pool->stop = 0;
+    pool->threadCount = 0;
+    pool->threads = malloc(sizeof(thread_t) * (threads > 0 ? threads : 1));
+    if(!pool->threads) {
+        tpDestroy(pool);
+        return NULL;
+    }
+
+    for(int i = 0; i < threads; i++) {
+#ifdef _WIN32
+        thread_t t = CreateThread(NULL, 0, workerMain, pool, 0, NULL);
+        if(!t) break;
+#else
+        thread_t t;
+        if(pthread_create(&t, NULL, workerMain, pool) != 0) break;
+#endif
+        pool->threads[pool->threadCount++] = t;
+    }
+    DEBUG_LOG("DEBUG C: Thread pool started with %d workers\n", pool->threadCount);
+    return pool;
+}
+
+/**
+ * Destroy
+ */
+void tpDestroy(ThreadPool* pool) {
+    if(!pool) return;
+
+    MUTEX_LOCK(pool->mutex);
+    pool->stop = 1;
+    COND_BROADCAST(pool->wake);
+    MUTEX_UNLOCK(pool->mutex);
+
+    for(int i = 0; i < pool->threadCount; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+    COND_DESTROY(pool->wake);
+    MUTEX_DESTROY(pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
+
+/**
+ * Shared
+ * One pool per process, sized to leave a core for the caller,
+ * created on first use; TP_THREADS_ENV overrides the core count.
+ */
+static void createShared(void) {
+    int threads = tpCpuCount();
+    const char* override = getenv(TP_THREADS_ENV);
+    if(override) {
+        long requested = strtol(override, NULL, 10);
+        if(requested >= 1 && requested <= TP_MAX_THREADS) threads = (int)requested;
+        else printf("ERROR C: Ignoring %s=%s\n", TP_THREADS_ENV, override);
+    }
+    sharedPool = tpCreate(threads - 1);
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK createSharedOnce(PINIT_ONCE once, PVOID param, PVOID* context) {
+    (void)once;
+    (void)param;
+    (void)context;
+    createShared();
+    return TRUE;
+}
+#endif
+
+ThreadPool* tpShared(void) {
+#ifdef _WIN32
+    static INIT_ONCE once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&once, createSharedOnce, NULL, NULL);
+#else
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, createShared);
+#endif
+    return sharedPool;
+}
+
+int tpThreadCount(const ThreadPool* pool) {
+    return pool ? pool->threadCount : 0;
+}
+
+/**
+ * Run
+ * The caller works through its own job alongside the workers, so
+ * progress never depends on a free worker.
+ */
+void tpRun(
+    ThreadPool* pool,
+    TpTask task,
+    void* arg,
+    size_t count
+) {
+    if(count == 0) return;
+    if(!pool || pool->threadCount == 0 || count == 1) {
+        for(size_t i = 0; i < count; i++) task(arg, i);
+        return;
+    }
+
+    TpJob job;
+    job.task = task;
+    job.arg = arg;
+    job.count = count;
+    job.next = 0;
+    job.done = 0;
+    job.nextJob = NULL;
+    COND_INIT(job.finished);
+
+    MUTEX_LOCK(pool->mutex);
+    TpJob** link = &pool->head;
+    while(*link) link = &(*link)->nextJob;
+    *link = &job;
+    COND_BROADCAST(pool->wake);
+
+    while(job.next < job.count) {
+        size_t index = takeTask(pool, &job);
+        MUTEX_UNLOCK(pool->mutex);
+        task(arg, index);
+        MUTEX_LOCK(pool->mutex);
+        finishTask(&job);
+    }
+    while(job.done < job.count) COND_WAIT(job.finished, pool->mutex);
+    MUTEX_UNLOCK(pool->mutex);
+    COND_DESTROY(job.finished);
+}
+
+void tpFlagSet(TpFlag* flag) {
+    FLAG_SET(flag);
+}
+
+int tpFlagTest(TpFlag* flag) {
+    return FLAG_LOAD(flag) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+
+#define TP_THREADS_ENV "FILE_COMPRESSOR_THREADS"
+#define TP_MAX_THREADS 256
+
+/**
+ * Persistent worker pool for the block engines.
+ * tpRun hands task indices 0..count-1 to the workers and to the
+ * calling thread, and returns once every task has finished. Several
+ * threads may run jobs on the same pool at once.
+ *
+ * The shared pool counts the calling thread as one of its threads:
+ * TP_THREADS_ENV, when set to 1..TP_MAX_THREADS, replaces the CPU
+ * count, so 1 runs every block engine inline.
+ */
+typedef void (*TpTask)(void* arg, size_t index);
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * Task Flag
+ * A flag the tasks of one job share, such as a failure flag; it is
+ * set and read with relaxed atomics, and tpRun returning orders every
+ * set before the caller's last read.
+ */
+typedef volatile long TpFlag;
+
+int tpCpuCount(void);
+ThreadPool* tpCreate(int threads);
+void tpDestroy(ThreadPool* pool);
+ThreadPool* tpShared(void);
+int tpThreadCount(const ThreadPool* pool);
+void tpRun(
+    ThreadPool* pool,
+    TpTask task,
+    void* arg,
+    size_t count
+);
+void tpFlagSet(TpFlag* flag);
+int tpFlagTest(TpFlag* flag);
\ No newline at end of file
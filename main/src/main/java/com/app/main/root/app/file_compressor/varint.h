@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define VARINT_MAX_BYTES 10
+
+/**
+ * LEB128 varints: 7 bits per byte, high bit set on every byte
+ * except the last.
+ */
+static inline size_t varintSize(uint64_t value) {
+    size_t n = 1;
+    while(value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static inline size_t varintPut(uint8_t* dst, uint64_t value) {
+    size_t n = 0;
+    while(value >= 0x80) {
+        dst[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * Returns bytes consumed, 0 if truncated or overlong.
+ */
+static inline size_t varintGet(
+    const uint8_t* src,
+    const uint8_t* end,
+    uint64_t* value
+) {
+    uint64_t result = 0;
+    size_t n = 0;
+    int shift = 0;
+    while(src + n < end && n < VARINT_MAX_BYTES) {
+        uint8_t b = src[n++];
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            *value = result;
+            return n;
+        }
+        shift += 7;
+    }
+    return 0;
+}
\ No newline at end of file